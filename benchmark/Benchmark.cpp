@@ -0,0 +1,156 @@
+//==--- Lumos/benchmark/Benchmark.cpp ---------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  Benchmark.cpp
+/// \brief This file implements the benchmark report and the entry point of
+///        lumos_bench.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Benchmark.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Voxx::Lumos::Bench {
+
+void BenchmarkReport::add(const BenchmarkResult& result) {
+	printf("%-44s %12.3f %-10s (min %.3f)\n", result.name.c_str(), result.value,
+	       result.unit.c_str(), result.min);
+	Results.push_back(result);
+}
+
+void BenchmarkReport::skip(const std::string& name, const std::string& reason) {
+	if (!selected(name)) {
+		return;
+	}
+	printf("%-44s skipped: %s\n", name.c_str(), reason.c_str());
+	Skipped.push_back(name + ": " + reason);
+}
+
+bool BenchmarkReport::writeJson(const char* path) const {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		fprintf(stderr, "Failed to open %s for writing\n", path);
+		return false;
+	}
+	fprintf(file, "{\n  \"repetitions\": %d,\n  \"results\": [\n", Repetitions);
+	for (std::size_t i = 0; i < Results.size(); ++i) {
+		const auto& result = Results[i];
+		fprintf(file,
+		        "    {\"name\": \"%s\", \"value\": %.6g, \"min\": %.6g, "
+		        "\"unit\": \"%s\"}%s\n",
+		        result.name.c_str(), result.value, result.min,
+		        result.unit.c_str(), i + 1 < Results.size() ? "," : "");
+	}
+	fprintf(file, "  ],\n  \"skipped\": [\n");
+	for (std::size_t i = 0; i < Skipped.size(); ++i) {
+		fprintf(file, "    \"%s\"%s\n", Skipped[i].c_str(),
+		        i + 1 < Skipped.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+int BenchmarkReport::compare(const char* path, double tolerance) const {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "Failed to open baseline %s\n", path);
+		return -1;
+	}
+
+	// The baseline is read line by line since writeJson puts each result on
+	// its own line.
+	int  regressions = 0;
+	char line[512], name[256];
+	printf("\n%-44s %12s %12s %8s\n", "comparison", "baseline", "current",
+	       "ratio");
+	while (fgets(line, sizeof(line), file)) {
+		double baseline = 0.0;
+		if (sscanf(line, " {\"name\": \"%255[^\"]\", \"value\": %lf",
+		           name, &baseline) != 2) {
+			continue;
+		}
+		for (const auto& result : Results) {
+			if (result.name != name) {
+				continue;
+			}
+			const double ratio      = baseline > 0.0 ? result.value / baseline : 1.0;
+			const bool   regression = ratio > 1.0 + tolerance;
+			regressions += regression ? 1 : 0;
+			printf("%-44s %12.3f %12.3f %7.2fx%s\n", name, baseline, result.value,
+			       ratio, regression ? "  REGRESSION" : "");
+		}
+	}
+	fclose(file);
+	return regressions;
+}
+
+} // namespace Voxx::Lumos::Bench
+
+namespace {
+
+/// Prints the usage of lumos_bench.
+void printUsage() {
+	printf("Usage: lumos_bench [options]\n"
+	       "  --json <path>        Write the results to <path> as JSON.\n"
+	       "  --compare <path>     Compare the results with the JSON at <path>\n"
+	       "                       and exit with 1 if any regressed.\n"
+	       "  --tolerance <ratio>  Allowed slowdown for --compare (0.1).\n"
+	       "  --filter <text>      Only run benchmarks whose names contain it.\n"
+	       "  --repetitions <n>    Repetitions of each measurement (5).\n");
+}
+
+} // namespace anonymous
+
+int main(int argc, char** argv) {
+	using namespace Voxx::Lumos::Bench;
+	const char* jsonPath    = nullptr;
+	const char* comparePath = nullptr;
+	const char* filter      = "";
+	double      tolerance   = 0.1;
+	int         repetitions = 5;
+	for (int i = 1; i < argc; ++i) {
+		const bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--json") && hasValue) {
+			jsonPath = argv[++i];
+		} else if (!strcmp(argv[i], "--compare") && hasValue) {
+			comparePath = argv[++i];
+		} else if (!strcmp(argv[i], "--tolerance") && hasValue) {
+			tolerance = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--filter") && hasValue) {
+			filter = argv[++i];
+		} else if (!strcmp(argv[i], "--repetitions") && hasValue) {
+			repetitions = atoi(argv[++i]);
+			repetitions = repetitions < 1 ? 1 : repetitions;
+		} else {
+			printUsage();
+			return strcmp(argv[i], "--help") ? 2 : 0;
+		}
+	}
+
+	BenchmarkReport report(filter, repetitions);
+	runDamageBenchmarks(report);
+	runEventCodingBenchmarks(report);
+	runEventQueueBenchmarks(report);
+	runKeyDispatchBenchmarks(report);
+	runPollLatencyBenchmarks(report);
+	runPresentBenchmarks(report);
+	runWindowCreateBenchmarks(report);
+
+	if (jsonPath && !report.writeJson(jsonPath)) {
+		return 2;
+	}
+	if (comparePath) {
+		const int regressions = report.compare(comparePath, tolerance);
+		return regressions < 0 ? 2 : regressions > 0 ? 1 : 0;
+	}
+	return 0;
+}
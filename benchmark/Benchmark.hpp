@@ -0,0 +1,158 @@
+//==--- Lumos/benchmark/Benchmark.hpp ---------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  Benchmark.hpp
+/// \brief This file defines the interface shared by the Lumos benchmarks.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_BENCHMARK_BENCHMARK_HPP
+#define VOXEL_LUMOS_BENCHMARK_BENCHMARK_HPP
+
+#include <Lumos/Event/EventTime.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace Voxx::Lumos::Bench {
+
+/// The BenchmarkResult struct defines a single measured result. Lower values
+/// are better for every result, so that results can be compared without
+/// knowing what they measure.
+struct BenchmarkResult {
+	std::string name;					//!< The name of the result.
+	double      value = 0.0;	//!< The median of the measurements.
+	double      min   = 0.0;	//!< The smallest of the measurements.
+	std::string unit;					//!< The unit of the value.
+};
+
+/// The BenchmarkReport class collects the results of the benchmarks.
+class BenchmarkReport {
+ public:
+ 	/// Constructor -- creates a report which runs the benchmarks whose names
+ 	/// contain \p filter, and repeats each measurement \p repetitions times.
+ 	/// \param filter      The filter for the names of the benchmarks to run.
+ 	/// \param repetitions The number of times each measurement is repeated.
+ 	BenchmarkReport(std::string filter, int repetitions)
+ 	: Filter(std::move(filter)), Repetitions(repetitions) {}
+
+ 	/// Returns true if the benchmark called \p name should be run.
+ 	/// \param name The name of the benchmark.
+ 	bool selected(const std::string& name) const {
+ 		return Filter.empty() || name.find(Filter) != std::string::npos;
+ 	}
+
+ 	/// Runs \p measure repetitions() times, if the benchmark called \p name is
+ 	/// selected, and adds the median and minimum of the values it returns to
+ 	/// the report.
+ 	/// \param  name    The name of the result.
+ 	/// \param  unit    The unit of the values returned by \p measure.
+ 	/// \param  measure The callable which performs one measurement.
+ 	/// \tparam Measure The type of the measure callable.
+ 	template <typename Measure>
+ 	void run(const std::string& name, const char* unit, Measure&& measure) {
+ 		if (!selected(name)) {
+ 			return;
+ 		}
+ 		std::vector<double> values;
+ 		for (int i = 0; i < Repetitions; ++i) {
+ 			values.push_back(measure());
+ 		}
+ 		std::sort(values.begin(), values.end());
+ 		add({name, values[values.size() / 2], values.front(), unit});
+ 	}
+
+ 	/// Adds \p result to the report and prints it.
+ 	/// \param result The result to add.
+ 	void add(const BenchmarkResult& result);
+
+ 	/// Adds a note that the benchmark called \p name was skipped because of
+ 	/// \p reason, and prints it.
+ 	/// \param name   The name of the skipped benchmark.
+ 	/// \param reason Why the benchmark was skipped.
+ 	void skip(const std::string& name, const std::string& reason);
+
+ 	/// Writes the results to \p path as JSON, with one result per line so
+ 	/// that the results of two runs can be compared with diff. Returns false
+ 	/// if the file could not be written.
+ 	/// \param path The path of the file to write.
+ 	bool writeJson(const char* path) const;
+
+ 	/// Compares the results with those in the JSON file at \p path, printing
+ 	/// the ratio of each result to its baseline. Returns the number of results
+ 	/// which are slower than the baseline by more than \p tolerance, or -1 if
+ 	/// the baseline could not be read.
+ 	/// \param path      The path of the baseline results.
+ 	/// \param tolerance The allowed fractional slowdown, such as 0.1 for 10%.
+ 	int compare(const char* path, double tolerance) const;
+
+ 	/// Returns the number of times each measurement is repeated.
+ 	int repetitions() const {
+ 		return Repetitions;
+ 	}
+
+ private:
+ 	std::vector<BenchmarkResult> Results;				//!< The results.
+ 	std::vector<std::string>     Skipped;				//!< Skipped benchmarks.
+ 	std::string                  Filter;				//!< Benchmark name filter.
+ 	int                          Repetitions;		//!< Repetitions per result.
+};
+
+/// Returns the number of nanoseconds per operation for \p count operations
+/// performed by \p body, which is given the number of operations to perform.
+/// \param  count The number of operations.
+/// \param  body  The callable which performs the operations.
+/// \tparam Body  The type of the body callable.
+template <typename Body>
+double nsPerOperation(std::size_t count, Body&& body) {
+	const auto start = monotonicTimeNs();
+	body(count);
+	return static_cast<double>(monotonicTimeNs() - start) / count;
+}
+
+/// Prevents the compiler from optimizing away the computation of \p value.
+/// \param  value The value to keep.
+/// \tparam T     The type of the value.
+template <typename T>
+inline void keep(const T& value) {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+/// Runs the benchmarks of accumulating the damage of a window.
+/// \param report The report to add the results to.
+void runDamageBenchmarks(BenchmarkReport& report);
+
+/// Runs the benchmarks of event encoding and decoding.
+/// \param report The report to add the results to.
+void runEventCodingBenchmarks(BenchmarkReport& report);
+
+/// Runs the benchmarks of the event queue.
+/// \param report The report to add the results to.
+void runEventQueueBenchmarks(BenchmarkReport& report);
+
+/// Runs the benchmarks of dispatching key events to handlers.
+/// \param report The report to add the results to.
+void runKeyDispatchBenchmarks(BenchmarkReport& report);
+
+/// Runs the benchmarks of the latency of polling a window for events.
+/// \param report The report to add the results to.
+void runPollLatencyBenchmarks(BenchmarkReport& report);
+
+/// Runs the benchmarks of presenting frames to a window.
+/// \param report The report to add the results to.
+void runPresentBenchmarks(BenchmarkReport& report);
+
+/// Runs the benchmarks of opening connections and creating windows.
+/// \param report The report to add the results to.
+void runWindowCreateBenchmarks(BenchmarkReport& report);
+
+} // namespace Voxx::Lumos::Bench
+
+#endif // VOXEL_LUMOS_BENCHMARK_BENCHMARK_HPP
@@ -0,0 +1,86 @@
+//==--- Lumos/benchmark/DamageBenchmark.cpp ---------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  DamageBenchmark.cpp
+/// \brief This file benchmarks accumulating the damage of a window.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Benchmark.hpp"
+#include <Lumos/Window/DamageRegion.hpp>
+#include <array>
+
+namespace Voxx::Lumos::Bench {
+namespace {
+
+/// Defines the number of rectangles which are added for each measurement.
+constexpr std::size_t rectCount = 1 << 20;
+
+/// Defines the number of distinct rectangles, which is a power of two.
+constexpr std::size_t inputCount = 4096;
+
+/// Defines the extent of the window which is damaged.
+constexpr Extent2d windowExtent = {1920, 1080};
+
+/// Returns pseudo random rectangles, which are the size of widgets in a tool
+/// window, scattered over the window.
+std::array<Rect2d, inputCount> makeRects() {
+	std::array<Rect2d, inputCount> rects;
+	uint32_t state = 0x9E3779B9u;
+	auto next = [&state] (uint32_t range) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return static_cast<int16_t>(state % range);
+	};
+	for (auto& rect : rects) {
+		rect = Rect2d{next(windowExtent.width), next(windowExtent.height),
+		              Extent2d{static_cast<int16_t>(next(96) + 8),
+		                       static_cast<int16_t>(next(32) + 8)}};
+	}
+	return rects;
+}
+
+} // namespace anonymous
+
+void runDamageBenchmarks(BenchmarkReport& report) {
+	static const auto rects = makeRects();
+
+	// A frame of a tool window damages a handful of widgets, so the region is
+	// cleared every few rectangles.
+	report.run("damage/add", "ns/rect", [] {
+		return nsPerOperation(rectCount, [] (std::size_t count) {
+			DamageRegion region(windowExtent);
+			int64_t      area = 0;
+			for (std::size_t i = 0; i < count; ++i) {
+				region.add(rects[i & (inputCount - 1)]);
+				if ((i & 7) == 7) {
+					area += region.area();
+					region.clear();
+				}
+			}
+			keep(area);
+		});
+	});
+
+	// A region which is never cleared is always full, so every rectangle is
+	// merged, which is the worst case.
+	report.run("damage/add-full", "ns/rect", [] {
+		return nsPerOperation(rectCount, [] (std::size_t count) {
+			DamageRegion region(windowExtent);
+			for (std::size_t i = 0; i < count; ++i) {
+				region.add(rects[i & (inputCount - 1)]);
+			}
+			keep(region);
+		});
+	});
+}
+
+} // namespace Voxx::Lumos::Bench
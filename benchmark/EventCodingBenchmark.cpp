@@ -0,0 +1,171 @@
+//==--- Lumos/benchmark/EventCodingBenchmark.cpp ----------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventCodingBenchmark.cpp
+/// \brief This file benchmarks encoding and decoding key events, and applying
+///        them to the key state.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Benchmark.hpp"
+#include <Lumos/Event/EventBatch.hpp>
+#include <Lumos/Event/KeyState.hpp>
+#include <array>
+#include <vector>
+
+namespace Voxx::Lumos::Bench {
+namespace {
+
+/// Defines the number of events which are processed for each measurement.
+constexpr std::size_t eventCount = 1 << 22;
+
+/// Defines the number of distinct inputs, which is a power of two.
+constexpr std::size_t inputCount = 4096;
+
+/// Returns pseudo random key values, so that the branches on the inputs can
+/// not be predicted from their order.
+std::array<uint8_t, inputCount> makeKeyValues() {
+	std::array<uint8_t, inputCount> values;
+	uint32_t state = 0x9E3779B9u;
+	for (auto& value : values) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		value  = static_cast<uint8_t>(state);
+	}
+	return values;
+}
+
+/// Returns a batch of events in which roughly one in eight is a key event,
+/// which is typical of a frame with pointer motion, and an array of the same
+/// events.
+/// \param batch  The batch to fill.
+/// \param events The array to fill.
+void makeMixedEvents(EventBatch& batch, std::vector<Event>& events) {
+	static const auto values = makeKeyValues();
+	for (std::size_t i = 0; i < batch.capacity(); ++i) {
+		const auto value = values[i & (inputCount - 1)];
+		const auto event = value < 32
+			? Event::key(EventActionKind::Press, static_cast<KeyEventKind>(value))
+			: Event::mouseMove(static_cast<int16_t>(i), value);
+		batch.push(event);
+		events.push_back(event);
+	}
+}
+
+} // namespace anonymous
+
+void runEventCodingBenchmarks(BenchmarkReport& report) {
+	static const auto values = makeKeyValues();
+
+	report.run("event/key/encode", "ns/event", [] {
+		return nsPerOperation(eventCount, [] (std::size_t count) {
+			uint32_t sum = 0;
+			for (std::size_t i = 0; i < count; ++i) {
+				const auto value = values[i & (inputCount - 1)];
+				KeyEvent keyEvent(value & 1 ? EventActionKind::Release
+				                            : EventActionKind::Press);
+				keyEvent.setValue(static_cast<KeyEventKind>(value));
+				sum += keyEvent.encoded();
+			}
+			keep(sum);
+		});
+	});
+
+	std::array<uint16_t, inputCount> encoded;
+	for (std::size_t i = 0; i < inputCount; ++i) {
+		KeyEvent keyEvent(values[i] & 1 ? EventActionKind::Release
+		                                : EventActionKind::Press);
+		keyEvent.setValue(static_cast<KeyEventKind>(values[i]));
+		encoded[i] = keyEvent.encoded();
+	}
+
+	report.run("event/key/decode", "ns/event", [&encoded] {
+		return nsPerOperation(eventCount, [&encoded] (std::size_t count) {
+			uint32_t sum = 0;
+			for (std::size_t i = 0; i < count; ++i) {
+				const auto keyEvent = KeyEvent::fromEncoded(encoded[i & (inputCount - 1)]);
+				sum += static_cast<uint32_t>(keyEvent.value())
+				     + static_cast<uint32_t>(keyEvent.action());
+			}
+			keep(sum);
+		});
+	});
+
+	report.run("event/unified/encode", "ns/event", [] {
+		return nsPerOperation(eventCount, [] (std::size_t count) {
+			uint64_t sum = 0;
+			for (std::size_t i = 0; i < count; ++i) {
+				const auto value = values[i & (inputCount - 1)];
+				sum += Event::key(value & 1 ? EventActionKind::Release
+				                            : EventActionKind::Press,
+				                  static_cast<KeyEventKind>(value))
+				         .stamped(i * 1000).encoded();
+			}
+			keep(sum);
+		});
+	});
+
+	// Selecting the key events from a frame of mixed events, scanning the kind
+	// column of a batch against scanning an array of whole events.
+	EventBatch            batch(inputCount);
+	std::vector<Event>    events;
+	std::vector<uint32_t> indices(inputCount);
+	makeMixedEvents(batch, events);
+
+	report.run("event/batch/select_key", "ns/event", [&] {
+		return nsPerOperation(eventCount, [&] (std::size_t count) {
+			std::size_t selected = 0;
+			for (std::size_t i = 0; i < count; i += inputCount) {
+				selected += batch.select(EventKind::Key, indices.data());
+			}
+			keep(selected);
+		});
+	});
+
+	report.run("event/array/select_key", "ns/event", [&] {
+		return nsPerOperation(eventCount, [&] (std::size_t count) {
+			std::size_t selected = 0;
+			for (std::size_t i = 0; i < count; i += inputCount) {
+				for (std::size_t j = 0; j < events.size(); ++j) {
+					if (events[j].kind() == EventKind::Key) {
+						indices[selected++ & (inputCount - 1)] = j;
+					}
+				}
+			}
+			keep(selected);
+		});
+	});
+
+	report.run("event/keystate/apply", "ns/event", [&encoded] {
+		return nsPerOperation(eventCount, [&encoded] (std::size_t count) {
+			KeyBits keys;
+			for (std::size_t i = 0; i < count; ++i) {
+				keys.apply(KeyEvent::fromEncoded(encoded[i & (inputCount - 1)]));
+			}
+			keep(keys);
+		});
+	});
+
+	report.run("event/keystate/edges", "ns/frame", [] {
+		return nsPerOperation(eventCount / 16, [] (std::size_t count) {
+			KeyBits previous, current, pressed, released;
+			for (std::size_t i = 0; i < count; ++i) {
+				current.set(static_cast<KeyEventKind>(values[i & (inputCount - 1)]));
+				computeKeyEdges(previous, current, pressed, released);
+				previous = current;
+				keep(pressed);
+			}
+			keep(released);
+		});
+	});
+}
+
+} // namespace Voxx::Lumos::Bench
@@ -0,0 +1,144 @@
+//==--- Lumos/benchmark/EventQueueBenchmark.cpp ------------ -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventQueueBenchmark.cpp
+/// \brief This file benchmarks pushing and popping events through the event
+///        queues, with and without contention.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Benchmark.hpp"
+#include <Lumos/Event/EventQueue.hpp>
+#include <Lumos/Event/KeyEvent.hpp>
+#include <Lumos/Event/PointerCoalescer.hpp>
+#include <Lumos/Event/SpscQueue.hpp>
+#include <thread>
+#include <vector>
+
+namespace Voxx::Lumos::Bench {
+namespace {
+
+/// Defines the number of events which pass through a queue per measurement.
+constexpr std::size_t eventCount = 1 << 20;
+
+/// Defines the number of events in each batch, which matches the size of the
+/// batches drained by the EventManager.
+constexpr std::size_t batchSize  = 64;
+
+/// Defines the capacity of the queues.
+constexpr std::size_t capacity   = 4096;
+
+/// Defines the number of pointer motion samples per drain, which is a 1000 Hz
+/// mouse drained at 125 frames per second.
+constexpr std::size_t samplesPerDrain = 8;
+
+/// Returns a batch of events to push.
+std::vector<KeyEvent> makeBatch() {
+	std::vector<KeyEvent> batch(batchSize);
+	for (std::size_t i = 0; i < batchSize; ++i) {
+		batch[i].setValue(static_cast<KeyEventKind>(i));
+	}
+	return batch;
+}
+
+/// Returns the number of nanoseconds per event for \p producers threads to
+/// push eventCount events in total through an EventQueue to one consumer.
+/// \param producers The number of producer threads.
+double measureContended(std::size_t producers) {
+	static const auto batch = makeBatch();
+	EventQueue<KeyEvent> queue(capacity);
+	const std::size_t perProducer = eventCount / producers / batchSize * batchSize;
+	const std::size_t total       = perProducer * producers;
+
+	const auto start = monotonicTimeNs();
+	std::vector<std::thread> threads;
+	for (std::size_t p = 0; p < producers; ++p) {
+		threads.emplace_back([&queue, perProducer] {
+			for (std::size_t pushed = 0; pushed < perProducer;) {
+				const auto count = queue.tryPushBatch(batch.data(), batchSize);
+				pushed += count;
+				if (count == 0) {
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	KeyEvent    popped[batchSize];
+	std::size_t received = 0;
+	while (received < total) {
+		const auto count = queue.popBatch(popped, batchSize);
+		received += count;
+		if (count == 0) {
+			std::this_thread::yield();
+		}
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	return static_cast<double>(monotonicTimeNs() - start) / total;
+}
+
+} // namespace anonymous
+
+void runEventQueueBenchmarks(BenchmarkReport& report) {
+	static const auto batch = makeBatch();
+
+	report.run("queue/mpmc/uncontended", "ns/event", [] {
+		EventQueue<KeyEvent> queue(capacity);
+		KeyEvent             popped[batchSize];
+		return nsPerOperation(eventCount, [&] (std::size_t count) {
+			for (std::size_t i = 0; i < count; i += batchSize) {
+				queue.pushBatch(batch.data(), batchSize);
+				keep(queue.popBatch(popped, batchSize));
+			}
+		});
+	});
+
+	report.run("queue/spsc/uncontended", "ns/event", [] {
+		SpscQueue<KeyEvent> queue(capacity);
+		KeyEvent            popped[batchSize];
+		return nsPerOperation(eventCount, [&] (std::size_t count) {
+			for (std::size_t i = 0; i < count; i += batchSize) {
+				for (const auto& keyEvent : batch) {
+					queue.push(keyEvent);
+				}
+				keep(queue.popBatch(popped, batchSize));
+			}
+		});
+	});
+
+	for (std::size_t producers : {1, 2, 4}) {
+		report.run("queue/mpmc/contended/" + std::to_string(producers) + "p",
+		           "ns/event", [producers] {
+			return measureContended(producers);
+		});
+	}
+
+	for (auto mode : {MotionCoalescing::Accumulate, MotionCoalescing::Lossless}) {
+		const std::string name = mode == MotionCoalescing::Accumulate
+		                       ? "accumulate" : "lossless";
+		report.run("pointer/" + name, "ns/sample", [mode] {
+			PointerCoalescer coalescer(capacity, mode);
+			Event            drained[batchSize];
+			return nsPerOperation(eventCount, [&] (std::size_t count) {
+				for (std::size_t i = 0; i < count; i += samplesPerDrain) {
+					for (std::size_t s = 0; s < samplesPerDrain; ++s) {
+						coalescer.addDelta(PointerCoalescer::fixedOne * 3 / 2,
+						                   -PointerCoalescer::fixedOne / 3, i);
+					}
+					keep(coalescer.drain(drained, batchSize));
+				}
+			});
+		});
+	}
+}
+
+} // namespace Voxx::Lumos::Bench
@@ -0,0 +1,188 @@
+//==--- Lumos/benchmark/KeyDispatchBenchmark.cpp ----------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  KeyDispatchBenchmark.cpp
+/// \brief This file benchmarks dispatching key events to multiple sinks.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Benchmark.hpp"
+#include <Lumos/Event/EventManager.hpp>
+#include <Lumos/Event/KeyHandlerRegistry.hpp>
+#include <Lumos/Event/ParallelDispatcher.hpp>
+#include <array>
+#include <utility>
+
+namespace Voxx::Lumos::Bench {
+namespace {
+
+/// Defines the number of events which are dispatched for each measurement.
+constexpr std::size_t eventCount = 1 << 20;
+
+/// Handler which accumulates the value of the events it receives so that the
+/// dispatch cannot be optimized away.
+struct CountingHandler : public KeyEventHandler<CountingHandler> {
+	void handleKeyEvent(const KeyEvent& keyEvent) {
+		Count += static_cast<uint64_t>(keyEvent.value()) + 1;
+	}
+
+	uint64_t Count = 0;	//!< The accumulated count.
+};
+
+/// Creates the key events to dispatch.
+std::array<KeyEvent, 256> makeEvents() {
+	std::array<KeyEvent, 256> events;
+	for (std::size_t i = 0; i < events.size(); ++i) {
+		events[i] = KeyEvent(i & 1 ? EventActionKind::Release
+		                           : EventActionKind::Press);
+		events[i].setValue(static_cast<KeyEventKind>(i));
+	}
+	return events;
+}
+
+/// Defines the number of events in each dispatched batch, which matches the
+/// size of the batches drained by the EventManager.
+constexpr std::size_t batchSize = EventManager::drainBatchSize;
+
+/// Dispatches eventCount events in batches and returns the number of
+/// nanoseconds per event.
+/// \param  dispatch  The callable which dispatches a batch to all sinks.
+/// \tparam Dispatch  The type of the dispatch callable.
+template <typename Dispatch>
+double measure(Dispatch& dispatch) {
+	static const auto events = makeEvents();
+	return nsPerOperation(eventCount, [&dispatch] (std::size_t count) {
+		for (std::size_t i = 0; i < count; i += batchSize) {
+			dispatch(&events[i & (events.size() - 1)], batchSize);
+		}
+	});
+}
+
+/// Creates a static handler set from all the \p handlers.
+template <std::size_t N, std::size_t... I>
+auto makeStaticSet(std::array<CountingHandler, N>& handlers,
+                   std::index_sequence<I...>) {
+	return makeKeyHandlerSet(handlers[I]...);
+}
+
+/// Benchmarks each of the dispatch paths for \p SinkCount sinks.
+/// \param  report    The report to add the results to.
+/// \tparam SinkCount The number of sinks to dispatch to.
+template <std::size_t SinkCount>
+void benchmarkSinks(BenchmarkReport& report) {
+	const auto prefix = "dispatch/" + std::to_string(SinkCount) + "sinks/";
+	std::array<CountingHandler, SinkCount> handlers;
+
+	std::vector<std::unique_ptr<KeyHandler>> adapters;
+	for (auto& handler : handlers) {
+		adapters.push_back(handler.clone());
+	}
+	auto adapterDispatch =
+		[&adapters] (const KeyEvent* keyEvents, std::size_t count) {
+			for (std::size_t i = 0; i < count; ++i) {
+				for (auto& adapter : adapters) {
+					adapter->handleEvent(keyEvents[i]);
+				}
+			}
+		};
+	report.run(prefix + "adapter", "ns/event", [&adapterDispatch] {
+		return measure(adapterDispatch);
+	});
+
+	KeyHandlerRegistry registry(SinkCount);
+	for (auto& handler : handlers) {
+		registry.addHandler(handler);
+	}
+	auto registryDispatch =
+		[&registry] (const KeyEvent* keyEvents, std::size_t count) {
+			registry.handleKeyEvents(keyEvents, count);
+		};
+	report.run(prefix + "registry", "ns/event", [&registryDispatch] {
+		return measure(registryDispatch);
+	});
+
+	auto staticSet = makeStaticSet(handlers,
+	                               std::make_index_sequence<SinkCount>());
+	auto staticDispatch =
+		[&staticSet] (const KeyEvent* keyEvents, std::size_t count) {
+			staticSet.handleKeyEvents(keyEvents, count);
+		};
+	report.run(prefix + "static", "ns/event", [&staticDispatch] {
+		return measure(staticDispatch);
+	});
+
+	for (const auto& handler : handlers) {
+		keep(handler.Count);
+	}
+}
+
+/// Sink which does a fixed amount of work for each batch, which stands in
+/// for a subscriber which is much slower than the dispatch itself.
+struct SlowSink {
+	void handleEvents(const EventBatch& batch) {
+		uint64_t hash = Hash + batch.size();
+		for (std::size_t i = 0; i < workPerBatch; ++i) {
+			hash = hash * 6364136223846793005ull + 1442695040888963407ull;
+		}
+		Hash = hash;
+	}
+
+	/// Defines the number of steps of work for each batch.
+	static constexpr std::size_t workPerBatch = 20000;
+
+	uint64_t Hash = 0;	//!< The accumulated work.
+};
+
+/// Benchmarks dispatching batches to \p sinkCount slow sinks, on the calling
+/// thread and on a pool with the default number of workers.
+/// \param report    The report to add the results to.
+/// \param sinkCount The number of sinks to dispatch to.
+void benchmarkParallelSinks(BenchmarkReport& report, std::size_t sinkCount) {
+	constexpr std::size_t batchCount = 256;
+	const auto prefix = "dispatch/" + std::to_string(sinkCount) + "slow/";
+	std::vector<SlowSink> sinks(sinkCount);
+	EventBatch            batch(batchSize);
+	for (std::size_t i = 0; i < batchSize; ++i) {
+		batch.push(Event::key(EventActionKind::Press, KeyEventKind::A));
+	}
+
+	auto measureWith = [&] (std::size_t workerCount) {
+		ParallelDispatcher dispatcher(workerCount);
+		for (auto& sink : sinks) {
+			dispatcher.addSink(sink);
+		}
+		return nsPerOperation(batchCount, [&] (std::size_t count) {
+			for (std::size_t i = 0; i < count; ++i) {
+				dispatcher.dispatch(batch);
+			}
+		});
+	};
+	report.run(prefix + "serial", "ns/batch", [&] {
+		return measureWith(0);
+	});
+	report.run(prefix + "parallel", "ns/batch", [&] {
+		return measureWith(ParallelDispatcher::defaultWorkerCount());
+	});
+
+	for (const auto& sink : sinks) {
+		keep(sink.Hash);
+	}
+}
+
+} // namespace anonymous
+
+void runKeyDispatchBenchmarks(BenchmarkReport& report) {
+	benchmarkSinks<1>(report);
+	benchmarkSinks<8>(report);
+	benchmarkSinks<64>(report);
+	benchmarkParallelSinks(report, 32);
+}
+
+} // namespace Voxx::Lumos::Bench
@@ -0,0 +1,166 @@
+//==--- Lumos/benchmark/PollLatencyBenchmark.cpp ----------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  PollLatencyBenchmark.cpp
+/// \brief This file benchmarks the latency from a key event being sent to an
+///        X server until it is posted to an EventManager by a window. It runs
+///        against the server named by DISPLAY, which is normally Xvfb, and is
+///        skipped if there is no server or no XCB window.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Benchmark.hpp"
+#include <Lumos/Frame/FrameHistogram.hpp>
+#include <Lumos/Window/WindowHeadless.hpp>
+#include <cstdlib>
+
+#if defined(VOXX_LUMOS_XCB)
+#include <Lumos/Window/WindowXcb.hpp>
+#include <xcb/xcb.h>
+#include <cstring>
+#endif
+
+namespace Voxx::Lumos::Bench {
+namespace {
+
+/// Defines the number of events which are sent for each measurement.
+constexpr std::size_t sampleCount = 2000;
+
+/// Defines the longest time to wait for an event, in nanoseconds.
+constexpr uint64_t timeoutNs = 1'000'000'000;
+
+/// Adds the median and 99th percentile of \p latencies to \p report, as
+/// results called \p name with the suffixes /p50 and /p99.
+/// \param report    The report to add the results to.
+/// \param name      The name of the results.
+/// \param latencies The recorded latencies.
+void addLatencies(BenchmarkReport&      report   ,
+                  const std::string&    name     ,
+                  const FrameHistogram& latencies) {
+	const auto summary = latencies.summary();
+	report.add({name + "/p50", static_cast<double>(summary.p50),
+	            static_cast<double>(summary.p50), "ns"});
+	report.add({name + "/p99", static_cast<double>(summary.p99),
+	            static_cast<double>(summary.p99), "ns"});
+}
+
+#if defined(VOXX_LUMOS_XCB)
+
+/// Measures the latency of key events which are sent by a second connection
+/// to \p window, until \p window posts them. Returns false if an event was not
+/// received within the timeout.
+/// \param window    The window to send the events to.
+/// \param sender    The connection to send the events with.
+/// \param latencies The histogram to record the latencies in.
+bool measureXcbLatency(WindowXcb&        window   ,
+                       xcb_connection_t* sender   ,
+                       FrameHistogram&   latencies) {
+	EventManager eventManager;
+	xcb_key_press_event_t keyEvent;
+	memset(&keyEvent, 0, sizeof(keyEvent));
+	keyEvent.event       = window.nativeWindow();
+	keyEvent.same_screen = 1;
+
+	for (std::size_t i = 0; i < sampleCount; ++i) {
+		keyEvent.response_type = i & 1 ? XCB_KEY_RELEASE : XCB_KEY_PRESS;
+		// Key codes 9 to 72 all translate to keys, so none are dropped.
+		keyEvent.detail        = static_cast<xcb_keycode_t>(9 + (i & 63));
+		const auto sentNs = monotonicTimeNs();
+		xcb_send_event(sender, 0, keyEvent.event, XCB_EVENT_MASK_KEY_PRESS |
+		               XCB_EVENT_MASK_KEY_RELEASE,
+		               reinterpret_cast<const char*>(&keyEvent));
+		xcb_flush(sender);
+
+		while (window.pollForEvent(eventManager) == 0) {
+			if (monotonicTimeNs() - sentNs > timeoutNs) {
+				return false;
+			}
+		}
+		latencies.record(monotonicTimeNs() - sentNs);
+		eventManager.drainKeyEvents([] (const KeyEvent&) {});
+	}
+	return true;
+}
+
+/// Runs the poll latency benchmarks against the X server.
+/// \param report The report to add the results to.
+void runXcbLatency(BenchmarkReport& report) {
+	const std::string polled   = "poll/xcb/latency";
+	const std::string threaded = "poll/xcb/input_thread/latency";
+	if (!report.selected(polled) && !report.selected(threaded)) {
+		return;
+	}
+	const char* display = getenv("DISPLAY");
+	if (!display || !*display) {
+		report.skip(polled, "DISPLAY is not set");
+		report.skip(threaded, "DISPLAY is not set");
+		return;
+	}
+
+	auto window = WindowXcb::create({64, 64}, "lumos_bench");
+	auto* sender = xcb_connect(nullptr, nullptr);
+	if (!window || xcb_connection_has_error(sender)) {
+		report.skip(polled, "could not connect to the X server");
+		report.skip(threaded, "could not connect to the X server");
+		xcb_disconnect(sender);
+		return;
+	}
+
+	FrameHistogram latencies;
+	if (report.selected(polled)) {
+		if (measureXcbLatency(*window, sender, latencies)) {
+			addLatencies(report, polled, latencies);
+		} else {
+			report.skip(polled, "events were not received");
+		}
+	}
+	if (report.selected(threaded) && window->startInputThread()) {
+		latencies.reset();
+		if (measureXcbLatency(*window, sender, latencies)) {
+			addLatencies(report, threaded, latencies);
+		} else {
+			report.skip(threaded, "events were not received");
+		}
+		window->stopInputThread();
+	}
+	xcb_disconnect(sender);
+}
+
+#endif // VOXX_LUMOS_XCB
+
+} // namespace anonymous
+
+void runPollLatencyBenchmarks(BenchmarkReport& report) {
+	// The headless window has no server, so this measures the cost of the
+	// window and event manager on their own, for comparison with XCB.
+	const std::string headless = "poll/headless/latency";
+	if (report.selected(headless)) {
+		auto           window = WindowHeadless::create({64, 64}, "lumos_bench");
+		EventManager   eventManager;
+		FrameHistogram latencies;
+		KeyEvent       keyEvent;
+		for (std::size_t i = 0; i < sampleCount; ++i) {
+			const auto sentNs = monotonicTimeNs();
+			window->injectKeyEvent(keyEvent);
+			window->pollForEvent(eventManager);
+			eventManager.drainKeyEvents([] (const KeyEvent&) {});
+			latencies.record(monotonicTimeNs() - sentNs);
+		}
+		addLatencies(report, headless, latencies);
+	}
+
+#if defined(VOXX_LUMOS_XCB)
+	runXcbLatency(report);
+#else
+	report.skip("poll/xcb/latency", "Lumos was built without the XCB window");
+#endif
+}
+
+} // namespace Voxx::Lumos::Bench
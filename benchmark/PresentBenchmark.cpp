@@ -0,0 +1,190 @@
+//==--- Lumos/benchmark/PresentBenchmark.cpp --------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  PresentBenchmark.cpp
+/// \brief This file benchmarks the time to clear and present a frame with
+///        GLX, with and without a frame capture, and with each Vulkan present
+///        mode. It runs against the server named by DISPLAY, and is skipped if
+///        there is no server or window.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Benchmark.hpp"
+#include <cstdlib>
+
+#if defined(VOXX_LUMOS_XCB)
+#include <Lumos/Window/WindowXcb.hpp>
+#include <GL/gl.h>
+#endif
+
+#if defined(VOXX_LUMOS_VULKAN)
+#include <Lumos/Window/WindowVulkan.hpp>
+#endif
+
+namespace Voxx::Lumos::Bench {
+namespace {
+
+#if defined(VOXX_LUMOS_XCB)
+
+/// Defines the number of frames which are presented for each measurement.
+constexpr std::size_t frameCount = 500;
+
+/// Defines the extent of the windows which are presented to.
+constexpr Extent2d presentExtent = {256, 256};
+
+/// Runs the GLX present benchmarks, which clear and swap each frame, without
+/// and with an asynchronous capture of every frame.
+/// \param report The report to add the results to.
+void runGlxPresent(BenchmarkReport& report) {
+	const std::string swapped  = "present/glx/swap";
+	const std::string captured = "present/glx/capture";
+	if (!report.selected(swapped) && !report.selected(captured)) {
+		return;
+	}
+	auto window = WindowXcb::create(presentExtent, "lumos_bench");
+	if (!window) {
+		report.skip(swapped, "could not create the window");
+		report.skip(captured, "could not create the window");
+		return;
+	}
+
+	auto measure = [&window] (FrameCapture* capture) {
+		return nsPerOperation(frameCount, [&] (std::size_t count) {
+			for (std::size_t i = 0; i < count; ++i) {
+				glClearColor(0.0f, (i & 255) / 255.0f, 0.0f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT);
+				if (capture) {
+					capture->capture();
+				}
+				window->swapBuffers();
+			}
+			glFinish();
+		});
+	};
+	report.run(swapped, "ns/frame", [&measure] {
+		return measure(nullptr);
+	});
+
+	// The frames are written to /dev/null, so this measures the cost to the
+	// render thread rather than the disk.
+	CaptureRequest request;
+	request.path = "/dev/null";
+	auto capture = report.selected(captured)
+	             ? window->createFrameCapture(request) : nullptr;
+	if (capture) {
+		report.run(captured, "ns/frame", [&measure, &capture] {
+			return measure(capture.get());
+		});
+	} else {
+		report.skip(captured, "could not create the capture");
+	}
+}
+
+#endif // VOXX_LUMOS_XCB
+
+#if defined(VOXX_LUMOS_VULKAN)
+
+/// Records a clear of the image of \p frame to \p shade of green, leaving the
+/// image ready to present.
+/// \param frame The frame to record the clear into.
+/// \param shade The shade of green to clear to.
+void recordClear(const VulkanFrame& frame, float shade) {
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image               = frame.image;
+	barrier.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+	vkCmdPipelineBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+	                     nullptr, 1, &barrier);
+
+	const VkClearColorValue color = {{0.0f, shade, 0.0f, 1.0f}};
+	vkCmdClearColorImage(frame.commandBuffer, frame.image,
+	                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1,
+	                     &barrier.subresourceRange);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout     = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	vkCmdPipelineBarrier(frame.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+	                     0, nullptr, 1, &barrier);
+}
+
+/// Runs the Vulkan present benchmark for \p latency, which clears and
+/// presents each frame.
+/// \param report  The report to add the results to.
+/// \param name    The name of the result.
+/// \param latency How the present mode is chosen.
+void runVulkanPresent(BenchmarkReport&   report ,
+                      const std::string& name   ,
+                      PresentLatency     latency) {
+	if (!report.selected(name)) {
+		return;
+	}
+	SwapchainRequest request;
+	request.latency = latency;
+	auto window = WindowVulkan::create(presentExtent, "lumos_bench", request);
+	if (!window) {
+		report.skip(name, "could not create the Vulkan window");
+		return;
+	}
+	report.run(name, "ns/frame", [&window] {
+		return nsPerOperation(frameCount, [&window] (std::size_t count) {
+			for (std::size_t i = 0; i < count; ++i) {
+				if (const auto* frame = window->beginFrame()) {
+					recordClear(*frame, (i & 255) / 255.0f);
+					window->endFrame();
+				}
+			}
+			window->waitIdle();
+		});
+	});
+}
+
+#endif // VOXX_LUMOS_VULKAN
+
+} // namespace anonymous
+
+void runPresentBenchmarks(BenchmarkReport& report) {
+	const char* display = getenv("DISPLAY");
+	const bool  hasServer = display && *display;
+
+#if defined(VOXX_LUMOS_XCB)
+	if (hasServer) {
+		runGlxPresent(report);
+	} else {
+		report.skip("present/glx", "DISPLAY is not set");
+	}
+#else
+	report.skip("present/glx", "Lumos was built without the XCB window");
+#endif
+
+#if defined(VOXX_LUMOS_VULKAN)
+	if (hasServer) {
+		runVulkanPresent(report, "present/vulkan/lowest", PresentLatency::Lowest);
+		runVulkanPresent(report, "present/vulkan/no-tearing",
+		                 PresentLatency::NoTearing);
+		runVulkanPresent(report, "present/vulkan/vsync", PresentLatency::VSync);
+	} else {
+		report.skip("present/vulkan", "DISPLAY is not set");
+	}
+#else
+	(void)hasServer;
+	report.skip("present/vulkan", "Lumos was built without the Vulkan window");
+#endif
+}
+
+} // namespace Voxx::Lumos::Bench
@@ -0,0 +1,99 @@
+//==--- Lumos/benchmark/WindowCreateBenchmark.cpp ---------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowCreateBenchmark.cpp
+/// \brief This file benchmarks the time to open a connection to an X server
+///        and to create a window on it, and counts the round trips which
+///        each makes. It runs against the server named by DISPLAY, and is
+///        skipped if there is no server.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Benchmark.hpp"
+#include <cstdlib>
+
+#if defined(VOXX_LUMOS_XCB)
+#include <Lumos/Window/WindowXcb.hpp>
+#endif
+
+namespace Voxx::Lumos::Bench {
+namespace {
+
+#if defined(VOXX_LUMOS_XCB)
+
+/// Defines the number of connections or windows created for each measurement.
+constexpr std::size_t createCount = 20;
+
+/// Runs the benchmarks of opening a connection and creating windows on it.
+/// \param report The report to add the results to.
+void runXcbCreate(BenchmarkReport& report) {
+	const std::string opened  = "window/xcb/open";
+	const std::string created = "window/xcb/create";
+	if (report.selected(opened)) {
+		uint64_t roundTrips = 0;
+		report.run(opened, "ns/connection", [&roundTrips] {
+			return nsPerOperation(createCount, [&] (std::size_t count) {
+				for (std::size_t i = 0; i < count; ++i) {
+					if (auto connection = XcbConnection::open()) {
+						roundTrips = connection->roundTrips();
+					}
+				}
+			});
+		});
+		const auto trips = static_cast<double>(roundTrips);
+		report.add({opened + "/round_trips", trips, trips, "round trips"});
+	}
+
+	if (!report.selected(created)) {
+		return;
+	}
+	auto connection = XcbConnection::open();
+	if (!connection) {
+		report.skip(created, "could not open the display");
+		return;
+	}
+	// The round trips which GLX makes through Xlib are not counted, so this
+	// counts only those which Lumos makes itself.
+	const auto tripsBefore = connection->roundTrips();
+	bool       failed      = false;
+	report.run(created, "ns/window", [&] {
+		return nsPerOperation(createCount, [&] (std::size_t count) {
+			for (std::size_t i = 0; i < count; ++i) {
+				failed |= !WindowXcb::create(connection, {64, 64}, "lumos_bench");
+			}
+		});
+	});
+	if (failed) {
+		report.skip(created, "could not create the window");
+		return;
+	}
+	const auto windows = static_cast<double>(createCount * report.repetitions());
+	const auto trips   = (connection->roundTrips() - tripsBefore) / windows;
+	report.add({created + "/round_trips", trips, trips, "round trips"});
+}
+
+#endif // VOXX_LUMOS_XCB
+
+} // namespace anonymous
+
+void runWindowCreateBenchmarks(BenchmarkReport& report) {
+#if defined(VOXX_LUMOS_XCB)
+	const char* display = getenv("DISPLAY");
+	if (display && *display) {
+		runXcbCreate(report);
+	} else {
+		report.skip("window/xcb", "DISPLAY is not set");
+	}
+#else
+	report.skip("window/xcb", "Lumos was built without the XCB window");
+#endif
+}
+
+} // namespace Voxx::Lumos::Bench
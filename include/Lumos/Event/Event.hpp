@@ -16,7 +16,10 @@
 #ifndef VOXEL_LUMOS_EVENT_EVENT_HPP
 #define VOXEL_LUMOS_EVENT_EVENT_HPP
 
+#include "EventTime.hpp"
 #include "Keycodes.hpp"
+#include <cstddef>
+#include <cstdint>
 
 namespace Voxx::Lumos {
 
@@ -26,6 +29,228 @@ enum class EventActionKind : uint8_t {
 	Release = 1			//!< Defines a release event.
 };
 
+/// Defines the kinds of events. The names avoid those which Xlib defines as
+/// macros, such as None and Expose.
+enum class EventKind : uint8_t {
+	Empty       = 0,	//!< No event.
+	Key         = 1,	//!< A key was pressed or released.
+	MouseMove   = 2,	//!< The pointer moved, with the position as payload.
+	MouseButton = 3,	//!< A mouse button was pressed or released.
+	Scroll      = 4,	//!< The scroll wheel moved, with the deltas as payload.
+	Resize      = 5,	//!< The window was resized, with the extent as payload.
+	Exposure    = 6,	//!< Part of the window, of the given extent, was exposed.
+	Focus       = 7,	//!< The window gained (press) or lost (release) focus.
+	Close       = 8,	//!< The window was asked to close.
+	MouseDelta  = 9,	//!< The pointer moved, with the relative motion as payload.
+	Count       = 10	//!< The number of kinds of events.
+};
+
+/// Defines the type of a set of kinds of events, with one bit for each kind.
+using EventKindMask = uint32_t;
+
+/// Returns the bit for \p kind in a set of kinds of events.
+/// \param kind The kind of event to get the bit for.
+constexpr EventKindMask eventKindBit(EventKind kind) {
+	return EventKindMask(1) << static_cast<uint8_t>(kind);
+}
+
+static_assert(static_cast<std::size_t>(EventKind::Count) <=
+              sizeof(EventKindMask) * 8, "Every kind must have a mask bit.");
+
+/// The Event class defines an event of any kind in 8 bytes, so that events of
+/// all kinds share a single queue and a single batch. The 32 bit payload is
+/// interpreted according to the kind: for events with two components, such as
+/// positions, deltas and extents, the first is in the low 16 bits and the
+/// second in the high 16 bits.
+///
+/// The time of the event is stored as the low 16 bits of the local monotonic
+/// time in microseconds, which wraps every 65.536 ms. It is recovered relative
+/// to a later reference time by EventBatch, which is valid as long as events
+/// are drained within that time of happening.
+class Event {
+ public:
+ 	/// Default constructor -- creates an event of kind Empty.
+ 	constexpr Event() = default;
+
+ 	/// Constructor -- creates an event of \p kind.
+ 	/// \param kind    The kind of the event.
+ 	/// \param action  The action of the event.
+ 	/// \param payload The payload of the event.
+ 	/// \param time    The compact time of the event.
+ 	constexpr Event(EventKind       kind    ,
+ 	                EventActionKind action  ,
+ 	                uint32_t        payload ,
+ 	                uint16_t        time = 0)
+ 	: Kind(kind), Action(action), Time(time), Payload(payload) {}
+
+ 	/// Creates a key event for \p key.
+ 	/// \param action The action of the key.
+ 	/// \param key    The key which was pressed or released.
+ 	static constexpr Event key(EventActionKind action, KeyEventKind key) {
+ 		return Event(EventKind::Key, action, static_cast<uint32_t>(key));
+ 	}
+
+ 	/// Creates a pointer motion event to the position (\p x, \p y).
+ 	/// \param x The horizontal position of the pointer.
+ 	/// \param y The vertical position of the pointer.
+ 	static constexpr Event mouseMove(int16_t x, int16_t y) {
+ 		return Event(EventKind::MouseMove, EventActionKind::Press, pack(x, y));
+ 	}
+
+ 	/// Creates a relative pointer motion event of (\p dx, \p dy), which is
+ 	/// the motion reported by the device rather than the change in position, so
+ 	/// it continues when the pointer is at the edge of the screen.
+ 	/// \param dx The horizontal motion of the pointer.
+ 	/// \param dy The vertical motion of the pointer.
+ 	static constexpr Event mouseDelta(int16_t dx, int16_t dy) {
+ 		return Event(EventKind::MouseDelta, EventActionKind::Press, pack(dx, dy));
+ 	}
+
+ 	/// Creates a mouse button event for \p button.
+ 	/// \param action The action of the button.
+ 	/// \param button The index of the button.
+ 	static constexpr Event mouseButton(EventActionKind action, uint8_t button) {
+ 		return Event(EventKind::MouseButton, action, button);
+ 	}
+
+ 	/// Creates a scroll event with the deltas \p dx and \p dy.
+ 	/// \param dx The horizontal scroll delta.
+ 	/// \param dy The vertical scroll delta.
+ 	static constexpr Event scroll(int16_t dx, int16_t dy) {
+ 		return Event(EventKind::Scroll, EventActionKind::Press, pack(dx, dy));
+ 	}
+
+ 	/// Creates a resize event to the extent \p width x \p height.
+ 	/// \param width  The new width of the window.
+ 	/// \param height The new height of the window.
+ 	static constexpr Event resize(uint16_t width, uint16_t height) {
+ 		return Event(EventKind::Resize, EventActionKind::Press,
+ 		             pack(width, height));
+ 	}
+
+ 	/// Creates an expose event for an area of \p width x \p height.
+ 	/// \param width  The width of the exposed area.
+ 	/// \param height The height of the exposed area.
+ 	static constexpr Event expose(uint16_t width, uint16_t height) {
+ 		return Event(EventKind::Exposure, EventActionKind::Press,
+ 		             pack(width, height));
+ 	}
+
+ 	/// Creates a focus event, where \p gained is true if the window gained
+ 	/// focus and false if it lost it.
+ 	/// \param gained If focus was gained.
+ 	static constexpr Event focus(bool gained) {
+ 		return Event(EventKind::Focus, gained ? EventActionKind::Press
+ 		                                      : EventActionKind::Release, 0);
+ 	}
+
+ 	/// Creates an event for a request to close the window.
+ 	static constexpr Event close() {
+ 		return Event(EventKind::Close, EventActionKind::Press, 0);
+ 	}
+
+ 	/// Returns the compact form of the local monotonic time \p timeNs, which is
+ 	/// stored in events.
+ 	/// \param timeNs The time to compact, in nanoseconds.
+ 	static constexpr uint16_t compactTime(uint64_t timeNs) {
+ 		return static_cast<uint16_t>(timeNs / 1000);
+ 	}
+
+ 	/// Returns a copy of the event with the time set from \p timeNs.
+ 	/// \param timeNs The local monotonic time of the event, in nanoseconds.
+ 	constexpr Event stamped(uint64_t timeNs) const {
+ 		Event event = *this;
+ 		event.Time  = compactTime(timeNs);
+ 		return event;
+ 	}
+
+ 	/// Returns the kind of the event.
+ 	constexpr EventKind kind() const {
+ 		return Kind;
+ 	}
+
+ 	/// Returns the action of the event.
+ 	constexpr EventActionKind action() const {
+ 		return Action;
+ 	}
+
+ 	/// Returns the compact time of the event.
+ 	constexpr uint16_t time() const {
+ 		return Time;
+ 	}
+
+ 	/// Returns the payload of the event.
+ 	constexpr uint32_t payload() const {
+ 		return Payload;
+ 	}
+
+ 	/// Returns the key of a key event.
+ 	constexpr KeyEventKind keyValue() const {
+ 		return static_cast<KeyEventKind>(Payload);
+ 	}
+
+ 	/// Returns the first signed component of the payload, such as the x
+ 	/// position or delta.
+ 	constexpr int16_t x() const {
+ 		return static_cast<int16_t>(Payload & 0xFFFF);
+ 	}
+
+ 	/// Returns the second signed component of the payload, such as the y
+ 	/// position or delta.
+ 	constexpr int16_t y() const {
+ 		return static_cast<int16_t>(Payload >> 16);
+ 	}
+
+ 	/// Returns the first unsigned component of the payload, such as a width.
+ 	constexpr uint16_t width() const {
+ 		return static_cast<uint16_t>(Payload & 0xFFFF);
+ 	}
+
+ 	/// Returns the second unsigned component of the payload, such as a height.
+ 	constexpr uint16_t height() const {
+ 		return static_cast<uint16_t>(Payload >> 16);
+ 	}
+
+ 	/// Returns the packed 64 bit encoding of the event, with the kind in the
+ 	/// lowest byte and the payload in the highest 32 bits.
+ 	constexpr uint64_t encoded() const {
+ 		return static_cast<uint64_t>(Kind)          |
+ 		       static_cast<uint64_t>(Action)  << 8  |
+ 		       static_cast<uint64_t>(Time)    << 16 |
+ 		       static_cast<uint64_t>(Payload) << 32;
+ 	}
+
+ 	/// Creates an event from the packed 64 bit encoding \p value, as returned
+ 	/// by encoded().
+ 	/// \param value The packed encoding of the event.
+ 	static constexpr Event fromEncoded(uint64_t value) {
+ 		return Event(static_cast<EventKind>(value & 0xFF)            ,
+ 		             static_cast<EventActionKind>((value >> 8) & 0xFF),
+ 		             static_cast<uint32_t>(value >> 32)              ,
+ 		             static_cast<uint16_t>(value >> 16)              );
+ 	}
+
+ private:
+ 	EventKind       Kind    = EventKind::Empty;				//!< The kind of event.
+ 	EventActionKind Action  = EventActionKind::Press;	//!< The action.
+ 	uint16_t        Time    = 0;											//!< The compact time.
+ 	uint32_t        Payload = 0;											//!< The payload.
+
+ 	/// Packs \p first into the low and \p second into the high 16 bits.
+ 	/// \param first  The first component.
+ 	/// \param second The second component.
+ 	template <typename T>
+ 	static constexpr uint32_t pack(T first, T second) {
+ 		return static_cast<uint32_t>(static_cast<uint16_t>(first)) |
+ 		       static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16;
+ 	}
+};
+
+static_assert(sizeof(Event) == 8, "Event must be 8 bytes.");
+
+/// Defines the type of an event with the full time at which it happened.
+using TimedEvent = Timestamped<Event>;
+
 } // namespace Voxx::Lumos
 
 #endif // VOXEL_LUMOS_EVENT_EVENT_HPP
\ No newline at end of file
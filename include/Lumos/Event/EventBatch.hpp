@@ -0,0 +1,249 @@
+//==--- Lumos/Event/EventBatch.hpp ------------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventBatch.hpp
+/// \brief This file defines a batch of events stored as a structure of arrays.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_EVENT_BATCH_HPP
+#define VOXEL_LUMOS_EVENT_EVENT_BATCH_HPP
+
+#include "Event.hpp"
+#include <cstdint>
+#include <memory>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+	#include <immintrin.h>
+#endif
+
+namespace Voxx::Lumos {
+
+/// The EventBatch class stores a batch of events as a structure of arrays,
+/// with a column for each field of the events. Consumers which are interested
+/// in a few kinds of events scan only the kind column, which is compared 32
+/// events at a time, and then read only the columns they need for the events
+/// which matched. The storage is allocated once, when the batch is created.
+class EventBatch {
+ public:
+ 	/// Defines the number of events whose kinds are compared at once.
+ 	static constexpr std::size_t blockSize = 32;
+
+ 	/// Constructor -- allocates the columns for \p capacity events.
+ 	/// \param capacity The maximum number of events in the batch.
+ 	explicit EventBatch(std::size_t capacity)
+ 	: Capacity(capacity),
+ 	  Kinds(new EventKind[capacity]),
+ 	  Actions(new EventActionKind[capacity]),
+ 	  Times(new uint16_t[capacity]),
+ 	  Payloads(new uint32_t[capacity]) {}
+
+ 	/// Removes all the events from the batch.
+ 	void clear() {
+ 		Size = 0;
+ 	}
+
+ 	/// Sets the time of the batch, which the compact times of the events are
+ 	/// recovered relative to. This must be no earlier than any of the events.
+ 	/// \param baseTimeNs The local monotonic time of the batch.
+ 	void setBaseTime(uint64_t baseTimeNs) {
+ 		BaseTimeNs = baseTimeNs;
+ 	}
+
+ 	/// Adds \p event to the batch, returning false if the batch is full.
+ 	/// \param event The event to add.
+ 	bool push(const Event& event) {
+ 		if (Size == Capacity) {
+ 			return false;
+ 		}
+ 		Kinds[Size]    = event.kind();
+ 		Actions[Size]  = event.action();
+ 		Times[Size]    = event.time();
+ 		Payloads[Size] = event.payload();
+ 		++Size;
+ 		return true;
+ 	}
+
+ 	/// Adds the \p count events in \p events to the batch, returning the number
+ 	/// which were added before the batch was full.
+ 	/// \param events A pointer to the events to add.
+ 	/// \param count  The number of events to add.
+ 	std::size_t push(const Event* events, std::size_t count) {
+ 		count = count < Capacity - Size ? count : Capacity - Size;
+ 		for (std::size_t i = 0; i < count; ++i) {
+ 			Kinds[Size + i]    = events[i].kind();
+ 			Actions[Size + i]  = events[i].action();
+ 			Times[Size + i]    = events[i].time();
+ 			Payloads[Size + i] = events[i].payload();
+ 		}
+ 		Size += count;
+ 		return count;
+ 	}
+
+ 	/// Returns the event at \p index.
+ 	/// \param index The index of the event.
+ 	Event operator[](std::size_t index) const {
+ 		return Event(Kinds[index], Actions[index], Payloads[index], Times[index]);
+ 	}
+
+ 	/// Returns the local monotonic time of the event at \p index, recovered
+ 	/// from its compact time and the time of the batch, in nanoseconds. The
+ 	/// compact time wraps every 65.536 ms, so this is off by a multiple of that
+ 	/// for an event which is older than the batch by more.
+ 	/// \param index The index of the event.
+ 	uint64_t timeNs(std::size_t index) const {
+ 		const uint64_t ageUs = static_cast<uint16_t>(
+ 			Event::compactTime(BaseTimeNs) - Times[index]);
+ 		return BaseTimeNs > ageUs * 1000 ? BaseTimeNs - ageUs * 1000 : 0;
+ 	}
+
+ 	/// Returns the number of events of \p kind in the batch.
+ 	/// \param kind The kind of the events to count.
+ 	std::size_t count(EventKind kind) const {
+ 		std::size_t count = 0;
+ 		forEachBlock(kind, [&count] (std::size_t, uint32_t mask) {
+ 			count += __builtin_popcount(mask);
+ 		});
+ 		return count;
+ 	}
+
+ 	/// Writes the indices of the events of \p kind into \p indices, in order,
+ 	/// returning the number of indices written. \p indices must have space for
+ 	/// size() indices.
+ 	/// \param kind    The kind of the events to select.
+ 	/// \param indices A pointer to the storage for the indices.
+ 	std::size_t select(EventKind kind, uint32_t* indices) const {
+ 		std::size_t count = 0;
+ 		forEachBlock(kind, [indices, &count] (std::size_t start, uint32_t mask) {
+ 			for (; mask; mask &= mask - 1) {
+ 				indices[count++] = static_cast<uint32_t>(start + __builtin_ctz(mask));
+ 			}
+ 		});
+ 		return count;
+ 	}
+
+ 	/// Invokes \p visitor with the index of each event of \p kind, in order.
+ 	/// \param  kind    The kind of the events to visit.
+ 	/// \param  visitor The callable to invoke with each index.
+ 	/// \tparam Visitor The type of the visitor.
+ 	template <typename Visitor>
+ 	void forEach(EventKind kind, Visitor&& visitor) const {
+ 		forEachBlock(kind, [&visitor] (std::size_t start, uint32_t mask) {
+ 			for (; mask; mask &= mask - 1) {
+ 				visitor(start + __builtin_ctz(mask));
+ 			}
+ 		});
+ 	}
+
+ 	/// Returns the column of the kinds of the events.
+ 	const EventKind* kinds() const {
+ 		return Kinds.get();
+ 	}
+
+ 	/// Returns the column of the actions of the events.
+ 	const EventActionKind* actions() const {
+ 		return Actions.get();
+ 	}
+
+ 	/// Returns the column of the compact times of the events.
+ 	const uint16_t* times() const {
+ 		return Times.get();
+ 	}
+
+ 	/// Returns the column of the payloads of the events.
+ 	const uint32_t* payloads() const {
+ 		return Payloads.get();
+ 	}
+
+ 	/// Returns the local monotonic time of the batch, in nanoseconds.
+ 	uint64_t baseTimeNs() const {
+ 		return BaseTimeNs;
+ 	}
+
+ 	/// Returns the number of events in the batch.
+ 	std::size_t size() const {
+ 		return Size;
+ 	}
+
+ 	/// Returns true if the batch has no events.
+ 	bool empty() const {
+ 		return Size == 0;
+ 	}
+
+ 	/// Returns the maximum number of events in the batch.
+ 	std::size_t capacity() const {
+ 		return Capacity;
+ 	}
+
+ private:
+ 	std::size_t                        Capacity;				//!< Maximum events.
+ 	std::size_t                        Size       = 0;	//!< Number of events.
+ 	uint64_t                           BaseTimeNs = 0;	//!< Time of the batch.
+ 	std::unique_ptr<EventKind[]>       Kinds;						//!< Kind column.
+ 	std::unique_ptr<EventActionKind[]> Actions;					//!< Action column.
+ 	std::unique_ptr<uint16_t[]>        Times;						//!< Time column.
+ 	std::unique_ptr<uint32_t[]>        Payloads;				//!< Payload column.
+
+ 	/// Invokes \p visitor with the index of the first event of each block of
+ 	/// blockSize events, and a mask with a bit set for each event in the block
+ 	/// which is of \p kind.
+ 	/// \param  kind    The kind of the events to match.
+ 	/// \param  visitor The callable to invoke with each block.
+ 	/// \tparam Visitor The type of the visitor.
+ 	template <typename Visitor>
+ 	void forEachBlock(EventKind kind, Visitor&& visitor) const {
+ 		const auto* kinds = reinterpret_cast<const uint8_t*>(Kinds.get());
+ 		const auto  value = static_cast<uint8_t>(kind);
+ 		std::size_t start = 0;
+#if defined(__AVX2__)
+ 		const auto needle = _mm256_set1_epi8(static_cast<char>(value));
+ 		for (; start + blockSize <= Size; start += blockSize) {
+ 			const auto block = _mm256_loadu_si256(
+ 				reinterpret_cast<const __m256i*>(kinds + start));
+ 			const auto mask = static_cast<uint32_t>(
+ 				_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+ 			if (mask) {
+ 				visitor(start, mask);
+ 			}
+ 		}
+#elif defined(__SSE2__)
+ 		const auto needle = _mm_set1_epi8(static_cast<char>(value));
+ 		for (; start + blockSize <= Size; start += blockSize) {
+ 			const auto low  = _mm_loadu_si128(
+ 				reinterpret_cast<const __m128i*>(kinds + start));
+ 			const auto high = _mm_loadu_si128(
+ 				reinterpret_cast<const __m128i*>(kinds + start + 16));
+ 			const auto mask =
+ 				static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(low, needle))) |
+ 				static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(high, needle)))
+ 				  << 16;
+ 			if (mask) {
+ 				visitor(start, mask);
+ 			}
+ 		}
+#endif
+ 		// The remaining events, and all of them without SIMD, are compared one
+ 		// at a time.
+ 		for (; start < Size; start += blockSize) {
+ 			const auto end  = start + blockSize < Size ? start + blockSize : Size;
+ 			uint32_t   mask = 0;
+ 			for (auto i = start; i < end; ++i) {
+ 				mask |= static_cast<uint32_t>(kinds[i] == value) << (i - start);
+ 			}
+ 			if (mask) {
+ 				visitor(start, mask);
+ 			}
+ 		}
+ 	}
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_EVENT_BATCH_HPP
@@ -16,7 +16,14 @@
 #ifndef VOXEL_LUMOS_EVENT_EVENT_MANAGER_HPP
 #define VOXEL_LUMOS_EVENT_EVENT_MANAGER_HPP
 
-#include <vector>
+#include "EventBatch.hpp"
+#include "EventQueue.hpp"
+#include "EventRecording.hpp"
+#include "KeyEvent.hpp"
+#include "KeyState.hpp"
+#include <Lumos/Utility/Instrumentation.hpp>
+#include <atomic>
+#include <mutex>
 
 namespace Voxx::Lumos {
 
@@ -24,12 +31,342 @@ namespace Voxx::Lumos {
 /// events in Lumos. It is the central point through which events flow.
 /// Objects can be added as sources which allow them to post events to the
 /// manager, and can also be added as sinks where they can consume the events.
+///
+/// Any number of threads may post events to the manager concurrently, while
+/// the thread which consumes the events drains them. Events of every kind are
+/// held in a single bounded lock-free queue, so neither posting nor draining
+/// allocates or takes a lock, and the consumer receives all the events which
+/// were pending as one EventBatch per frame. The exception is recording: while
+/// a recorder is set, posting takes a lock, so that the events are recorded in
+/// the order in which they are queued.
+///
+/// As key events are drained the manager tracks which keys are down, and once
+/// per frame the consuming thread publishes an immutable KeyState snapshot
+/// which any thread can query without traversing the events.
+///
+/// Consumers subscribe to the kinds of events they handle, and windows only
+/// ask the platform for the kinds of events which the manager they post to is
+/// subscribed to, so that events which nobody handles are never sent.
 class EventManager {
+ public:
+ 	/// Defines the default number of pending events which can be held.
+ 	static constexpr std::size_t defaultCapacity  = 4096;
+ 	/// Defines the number of events which are popped from the queue at once.
+ 	static constexpr std::size_t drainBatchSize   = 64;
+ 	/// Defines the kinds of events which a new manager is subscribed to. This is
+ 	/// the key events, so code which only dispatches key events does not need
+ 	/// to subscribe.
+ 	static constexpr EventKindMask defaultSubscriptions =
+ 		eventKindBit(EventKind::Key);
+
+ 	/// Constructor -- allocates the storage for pending and drained events.
+ 	/// \param capacity The maximum number of pending events.
+ 	/// \param policy   The behaviour when an event is posted and the manager
+ 	///                 already holds the maximum number of pending events.
+ 	explicit EventManager(std::size_t    capacity = defaultCapacity,
+ 	                      OverflowPolicy policy   = OverflowPolicy::CountAndDrop)
+ 	: Events(capacity, policy), FrameEvents(capacity) {
+ 		for (std::size_t kind = 0; kind < kindCount; ++kind) {
+ 			Subscribers[kind] = defaultSubscriptions &
+ 			                    eventKindBit(static_cast<EventKind>(kind)) ? 1 : 0;
+ 		}
+ 	}
+
+ 	/// Subscribes to events of \p kind. Subscriptions are counted, so each
+ 	/// consumer which handles a kind subscribes to it once and unsubscribes
+ 	/// when it stops handling it. This can be called from any thread, and
+ 	/// takes effect for a window at its next poll.
+ 	/// \param kind The kind of events to subscribe to.
+ 	void subscribe(EventKind kind) {
+ 		std::lock_guard<std::mutex> lock(SubscriptionMutex);
+ 		if (Subscribers[static_cast<std::size_t>(kind)]++ == 0) {
+ 			Subscribed.fetch_or(eventKindBit(kind), std::memory_order_relaxed);
+ 		}
+ 	}
+
+ 	/// Removes a subscription to events of \p kind, which must have been
+ 	/// subscribed to. This can be called from any thread.
+ 	/// \param kind The kind of events to unsubscribe from.
+ 	void unsubscribe(EventKind kind) {
+ 		std::lock_guard<std::mutex> lock(SubscriptionMutex);
+ 		auto& subscribers = Subscribers[static_cast<std::size_t>(kind)];
+ 		if (subscribers != 0 && --subscribers == 0) {
+ 			Subscribed.fetch_and(~eventKindBit(kind), std::memory_order_relaxed);
+ 		}
+ 	}
+
+ 	/// Returns the set of kinds of events which are subscribed to.
+ 	EventKindMask subscribedKinds() const {
+ 		return Subscribed.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Posts \p event to the manager, returning true if the event was
+ 	/// accepted. The time of the event should already be set. This can be
+ 	/// called from any thread.
+ 	/// \param event The event to post.
+ 	bool postEvent(const Event& event) {
+ 		return pushEvents(&event, 1) == 1;
+ 	}
+
+ 	/// Posts \p count events from \p events to the manager, returning the
+ 	/// number of events which were accepted. The times of the events should
+ 	/// already be set. This can be called from any thread.
+ 	/// \param events A pointer to the events to post.
+ 	/// \param count  The number of events to post.
+ 	std::size_t postEvents(const Event* events, std::size_t count) {
+ 		const auto posted = pushEvents(events, count);
+ 		VOXX_LUMOS_COUNT("EventManager::droppedEvents", count - posted);
+ 		return posted;
+ 	}
+
+ 	/// Posts the key event \p keyEvent to the manager, with the current time,
+ 	/// returning true if the event was accepted. This can be called from any
+ 	/// thread.
+ 	/// \param keyEvent The key event to post.
+ 	bool postKeyEvent(const KeyEvent& keyEvent) {
+ 		return postEvent(keyEvent.toEvent(monotonicTimeNs()));
+ 	}
+
+ 	/// Posts \p count key events from \p keyEvents to the manager, with the
+ 	/// current time, returning the number of events which were accepted. This
+ 	/// can be called from any thread.
+ 	/// \param keyEvents A pointer to the key events to post.
+ 	/// \param count     The number of key events to post.
+ 	std::size_t postKeyEvents(const KeyEvent* keyEvents, std::size_t count) {
+ 		const auto  timeNs = monotonicTimeNs();
+ 		Event       events[drainBatchSize];
+ 		std::size_t posted = 0;
+ 		for (std::size_t start = 0; start < count; start += drainBatchSize) {
+ 			const auto chunk = count - start < drainBatchSize
+ 			                 ? count - start : drainBatchSize;
+ 			for (std::size_t i = 0; i < chunk; ++i) {
+ 				events[i] = keyEvents[start + i].toEvent(timeNs);
+ 			}
+ 			posted += postEvents(events, chunk);
+ 		}
+ 		return posted;
+ 	}
+
+ 	/// Drains the pending events into the batch for the frame and returns it.
+ 	/// The batch holds the events in the order in which they were posted, and
+ 	/// remains valid until the next drain. At most capacity() events are
+ 	/// drained so that producers cannot keep the consumer in this call
+ 	/// indefinitely. The key state is updated from the key events.
+ 	///
+ 	/// The compact times of the events wrap every 65.536 ms, so the batch's
+ 	/// timeNs() is only valid for events which are drained within 65 ms of
+ 	/// being posted. Events are recorded as they are posted, when their full
+ 	/// time is known, for this reason.
+ 	const EventBatch& drainEvents() {
+ 		VOXX_LUMOS_TIMED_SCOPE("EventManager::drainEvents");
+ 		VOXX_LUMOS_VALUE("EventManager::queueDepth", Events.size());
+ 		Event       chunk[drainBatchSize];
+ 		std::size_t count = 0;
+ 		FrameEvents.clear();
+ 		while (FrameEvents.size() < FrameEvents.capacity()) {
+ 			const auto space = FrameEvents.capacity() - FrameEvents.size();
+ 			count = Events.popBatch(chunk, space < drainBatchSize ? space
+ 			                                                      : drainBatchSize);
+ 			if (count == 0) {
+ 				break;
+ 			}
+ 			FrameEvents.push(chunk, count);
+ 		}
+ 		// The time of the batch is taken after popping so that it is no earlier
+ 		// than any of the events.
+ 		FrameEvents.setBaseTime(monotonicTimeNs());
+ 		VOXX_LUMOS_VALUE("EventManager::batchSize", FrameEvents.size());
+
+ 		// Only changes of state are edges, so the repeated presses which
+ 		// autorepeat sends for a key which is held are not presses again.
+ 		FrameEvents.forEach(EventKind::Key, [this] (std::size_t index) {
+ 			const auto keyEvent = KeyEvent::fromEvent(FrameEvents[index]);
+ 			const bool down     = keyEvent.action() == EventActionKind::Press;
+ 			if (down != LiveKeys.test(keyEvent.value())) {
+ 				(down ? PressedSince : ReleasedSince).set(keyEvent.value());
+ 			}
+ 			LiveKeys.apply(keyEvent);
+ 		});
+ 		return FrameEvents;
+ 	}
+
+ 	/// Returns the batch of events which were drained most recently.
+ 	const EventBatch& events() const {
+ 		return FrameEvents;
+ 	}
+
+ 	/// Drains the pending events, invoking \p handler with the key events in
+ 	/// batches, as a pointer to the first key event and the number of key events
+ 	/// in the batch. The key events are passed in the order in which they were
+ 	/// posted. Events of other kinds remain available from events(). Returns
+ 	/// the number of key events which were drained.
+ 	/// \param  handler  The callable to invoke with each batch of key events.
+ 	/// \tparam Handler  The type of the handler.
+ 	template <typename Handler>
+ 	std::size_t drainKeyEventBatches(Handler&& handler) {
+ 		const auto& batch = drainEvents();
+ 		KeyEvent    keyEvents[drainBatchSize];
+ 		std::size_t count = 0, drained = 0;
+ 		auto flush = [&] {
+ 			VOXX_LUMOS_TIMED_SCOPE("EventManager::handleBatch");
+ 			handler(static_cast<const KeyEvent*>(keyEvents), count);
+ 			drained += count;
+ 			count    = 0;
+ 		};
+ 		batch.forEach(EventKind::Key, [&] (std::size_t index) {
+ 			keyEvents[count++] = KeyEvent::fromEvent(batch[index]);
+ 			if (count == drainBatchSize) {
+ 				flush();
+ 			}
+ 		});
+ 		if (count) {
+ 			flush();
+ 		}
+ 		return drained;
+ 	}
+
+ 	/// Drains the pending events, invoking \p handler with each key event in
+ 	/// the order in which the events were posted. Returns the number of key
+ 	/// events which were drained.
+ 	/// \param  handler  The callable to invoke with each key event.
+ 	/// \tparam Handler  The type of the handler.
+ 	template <typename Handler>
+ 	std::size_t drainKeyEvents(Handler&& handler) {
+ 		return drainKeyEventBatches(
+ 			[&handler] (const KeyEvent* keyEvents, std::size_t count) {
+ 				for (std::size_t i = 0; i < count; ++i) {
+ 					handler(keyEvents[i]);
+ 				}
+ 			});
+ 	}
+
+ 	/// Drains the pending events and dispatches the key events to \p sinks in
+ 	/// batches. \p sinks can be a StaticKeyHandlerSet, a KeyHandlerRegistry, or
+ 	/// any type with a handleKeyEvents(const KeyEvent*, std::size_t) member.
+ 	/// Each sink receives the events in the order in which they were posted.
+ 	/// Returns the number of key events dispatched.
+ 	/// \param  sinks The sinks to dispatch the key events to.
+ 	/// \tparam Sinks The type of the sinks.
+ 	template <typename Sinks>
+ 	std::size_t dispatchKeyEvents(Sinks& sinks) {
+ 		return drainKeyEventBatches(
+ 			[&sinks] (const KeyEvent* keyEvents, std::size_t count) {
+ 				sinks.handleKeyEvents(keyEvents, count);
+ 			});
+ 	}
+
+ 	/// Drains the pending events and delivers the whole batch to \p dispatcher,
+ 	/// which is a ParallelDispatcher or any type with a dispatch(const
+ 	/// EventBatch&) member. Unlike dispatchKeyEvents(), every kind of event is
+ 	/// delivered, and a ParallelDispatcher delivers it to its sinks in parallel.
+ 	/// Returns the number of events dispatched.
+ 	/// \param  dispatcher The dispatcher to deliver the batch with.
+ 	/// \tparam Dispatcher The type of the dispatcher.
+ 	template <typename Dispatcher>
+ 	std::size_t dispatchEvents(Dispatcher& dispatcher) {
+ 		const auto& batch = drainEvents();
+ 		dispatcher.dispatch(batch);
+ 		return batch.size();
+ 	}
+
+ 	/// Publishes a snapshot of the keys which are down, along with the keys
+ 	/// which were pressed and released since the previous publish, based on
+ 	/// the key events which have been drained. A key which was pressed and
+ 	/// released between publishes is in both, so taps which are shorter than
+ 	/// a frame are not lost, while a press of a key which is already down, or
+ 	/// a release of one which is up, is in neither. Windows remove the release
+ 	/// which core X autorepeat sends before each repeated press, so a held key
+ 	/// is only pressed once. This should be called once per frame by the
+ 	/// thread which drains the events, after draining them. Returns the
+ 	/// published snapshot.
+ 	KeyState publishKeyState() {
+ 		KeyState keyState;
+ 		keyState.held  = LiveKeys;
+ 		keyState.frame = ++Frame;
+ 		computeKeyEdges(PreviousKeys, LiveKeys, keyState.pressed,
+ 		                keyState.released);
+ 		keyState.pressed.merge(PressedSince);
+ 		keyState.released.merge(ReleasedSince);
+ 		PreviousKeys  = LiveKeys;
+ 		PressedSince  = KeyBits();
+ 		ReleasedSince = KeyBits();
+ 		PublishedKeys.publish(keyState);
+ 		return keyState;
+ 	}
+
+ 	/// Returns the most recently published key state. This can be called from
+ 	/// any thread.
+ 	KeyState keyState() const {
+ 		return PublishedKeys.load();
+ 	}
+
+ 	/// Sets the recorder which records the events as they are posted, or stops
+ 	/// recording if \p recorder is null. Events are recorded in the order in
+ 	/// which they are accepted, with the time at which they were posted. The
+ 	/// recorder must outlive its use by the manager, and is not used once this
+ 	/// returns with a different recorder.
+ 	/// \param recorder The recorder to record the events with.
+ 	void setRecorder(EventRecorder* recorder) {
+ 		std::lock_guard<std::mutex> lock(RecorderMutex);
+ 		Recorder.store(recorder, std::memory_order_release);
+ 	}
+
+ 	/// Returns the approximate number of pending events.
+ 	std::size_t pendingEvents() const {
+ 		return Events.size();
+ 	}
+
+ 	/// Returns the number of events which have been dropped because the
+ 	/// manager was full.
+ 	uint64_t droppedEvents() const {
+ 		return Events.dropped();
+ 	}
+
+ 	/// Returns the maximum number of pending events.
+ 	std::size_t capacity() const {
+ 		return Events.capacity();
+ 	}
 
  private:
- 	std::vector<KeyEvent> KeyEvents{0};	//!< Pending key events.
+ 	/// Pushes the \p count events in \p events onto the queue, returning the
+ 	/// number which were accepted. While there is a recorder, pushing and
+ 	/// recording are done together under the recorder's lock, so the accepted
+ 	/// events are recorded in the order in which they were queued, with the
+ 	/// time at which they were posted. Without a recorder no lock is taken.
+ 	/// \param events A pointer to the events to push.
+ 	/// \param count  The number of events to push.
+ 	std::size_t pushEvents(const Event* events, std::size_t count) {
+ 		if (!Recorder.load(std::memory_order_acquire)) {
+ 			return Events.pushBatch(events, count);
+ 		}
+ 		std::lock_guard<std::mutex> lock(RecorderMutex);
+ 		const auto posted = Events.pushBatch(events, count);
+ 		if (auto* recorder = Recorder.load(std::memory_order_relaxed)) {
+ 			recorder->recordEvents(events, posted, monotonicTimeNs());
+ 		}
+ 		return posted;
+ 	}
+
+ 	/// Defines the number of kinds of events.
+ 	static constexpr std::size_t kindCount =
+ 		static_cast<std::size_t>(EventKind::Count);
+
+ 	EventQueue<Event>    Events;						//!< Pending events.
+ 	EventBatch           FrameEvents;				//!< Most recently drained events.
+ 	KeyBits              LiveKeys;					//!< Keys down after draining.
+ 	KeyBits              PreviousKeys;			//!< Keys down at last publish.
+ 	KeyBits              PressedSince;			//!< Pressed since last publish.
+ 	KeyBits              ReleasedSince;			//!< Released since last publish.
+ 	uint64_t             Frame = 0;					//!< Frames published.
+ 	PublishedKeyState    PublishedKeys;		//!< Published key state.
+ 	std::atomic<EventRecorder*> Recorder{nullptr};	//!< Optional recorder.
+ 	std::mutex                  RecorderMutex;			//!< Guards recording.
+
+ 	uint32_t                   Subscribers[kindCount];	//!< Subscriber counts.
+ 	std::atomic<EventKindMask> Subscribed{defaultSubscriptions};	//!< Kinds.
+ 	std::mutex                 SubscriptionMutex;	//!< Guards the counts.
 };
 
 } // namespace Voxx::Lumos
 
-#endif // VOXEL_LUMOS_EVENT_EVENT_MANAGER_HPP
\ No newline at end of file
+#endif // VOXEL_LUMOS_EVENT_EVENT_MANAGER_HPP
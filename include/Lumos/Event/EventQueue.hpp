@@ -0,0 +1,272 @@
+//==--- Lumos/Event/EventQueue.hpp ------------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventQueue.hpp
+/// \brief This file defines a bounded, lock-free queue for events.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_EVENT_QUEUE_HPP
+#define VOXEL_LUMOS_EVENT_EVENT_QUEUE_HPP
+
+#include <Lumos/Utility/CacheLine.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace Voxx::Lumos {
+
+/// Defines the possible behaviours of a queue when an element is pushed onto
+/// the queue and the queue is full.
+enum class OverflowPolicy : uint8_t {
+	DropOldest   = 0,	//!< Discard the oldest pending element to make space.
+	Block        = 1,	//!< Wait until a consumer makes space.
+	CountAndDrop = 2	//!< Discard the new element and count the drop.
+};
+
+/// The EventQueue class defines a bounded, multi-producer, multi-consumer,
+/// lock-free ring queue. Each slot in the ring carries a sequence number which
+/// tells producers and consumers which lap of the ring the slot belongs to, so
+/// that a push or a pop only requires a single compare and swap on the
+/// appropriate position, and batches of elements can be claimed with a single
+/// compare and swap. All memory is allocated when the queue is constructed.
+///
+/// The producer and consumer positions are placed on separate cache lines so
+/// that producers and consumers do not contend on the same line.
+///
+/// \tparam T The type of the elements in the queue. This must be default
+///           constructible and should be cheap to copy.
+template <typename T>
+class EventQueue {
+ public:
+ 	/// Defines the type of the elements in the queue.
+ 	using ValueType = T;
+
+ 	/// Constructor -- allocates the slots for the queue.
+ 	/// \param capacity The number of elements which can be held by the queue,
+ 	///                 which is rounded up to the next power of two.
+ 	/// \param policy   The behaviour of the queue when it is full.
+ 	explicit EventQueue(std::size_t    capacity,
+ 	                    OverflowPolicy policy = OverflowPolicy::CountAndDrop)
+ 	: Mask(nextPowerOfTwo(capacity < 2 ? 2 : capacity) - 1),
+ 	  Cells(new Cell[Mask + 1]),
+ 	  Policy(policy) {
+ 		for (std::size_t i = 0; i <= Mask; ++i) {
+ 			Cells[i].Sequence.store(i, std::memory_order_relaxed);
+ 		}
+ 	}
+
+ 	/// Copy constructor -- deleted since the queue is shared between threads.
+ 	EventQueue(const EventQueue&) = delete;
+ 	/// Copy assignment -- deleted since the queue is shared between threads.
+ 	EventQueue& operator=(const EventQueue&) = delete;
+
+ 	/// Attempts to push \p value onto the queue, returning false if the queue
+ 	/// is full. This never applies the overflow policy.
+ 	/// \param value The value to push onto the queue.
+ 	bool tryPush(const T& value) {
+ 		return tryPushBatch(&value, 1) == 1;
+ 	}
+
+ 	/// Attempts to push up to \p count elements from \p values onto the queue,
+ 	/// claiming all the slots with a single compare and swap. Returns the number
+ 	/// of elements which were pushed, which may be less than \p count if the
+ 	/// queue does not have space for all of them.
+ 	/// \param values A pointer to the values to push.
+ 	/// \param count  The number of values to push.
+ 	std::size_t tryPushBatch(const T* values, std::size_t count) {
+ 		if (count == 0) {
+ 			return 0;
+ 		}
+ 		auto pos   = EnqueuePos.load(std::memory_order_relaxed);
+ 		auto claim = std::size_t{0};
+ 		while (true) {
+ 			claim = claimable(pos, count, 0);
+ 			if (claim == 0) {
+ 				// The slot at pos is either still full from the previous lap, in
+ 				// which case the queue is full, or another producer has moved past
+ 				// it, in which case pos must be reloaded.
+ 				const auto seq = Cells[pos & Mask].Sequence.load(
+ 					std::memory_order_acquire);
+ 				if (static_cast<intptr_t>(seq - pos) < 0) {
+ 					return 0;
+ 				}
+ 				pos = EnqueuePos.load(std::memory_order_relaxed);
+ 				continue;
+ 			}
+ 			if (EnqueuePos.compare_exchange_weak(pos                      ,
+ 			                                     pos + claim              ,
+ 			                                     std::memory_order_relaxed)) {
+ 				break;
+ 			}
+ 		}
+
+ 		for (std::size_t i = 0; i < claim; ++i) {
+ 			auto& cell = Cells[(pos + i) & Mask];
+ 			cell.Value = values[i];
+ 			cell.Sequence.store(pos + i + 1, std::memory_order_release);
+ 		}
+ 		return claim;
+ 	}
+
+ 	/// Pushes \p value onto the queue, applying the overflow policy if the
+ 	/// queue is full. Returns true if the value was placed in the queue.
+ 	/// \param value The value to push onto the queue.
+ 	bool push(const T& value) {
+ 		return pushBatch(&value, 1) == 1;
+ 	}
+
+ 	/// Pushes \p count elements from \p values onto the queue, applying the
+ 	/// overflow policy to any elements which do not fit. Returns the number of
+ 	/// elements which were placed in the queue.
+ 	/// \param values A pointer to the values to push.
+ 	/// \param count  The number of values to push.
+ 	std::size_t pushBatch(const T* values, std::size_t count) {
+ 		auto pushed = tryPushBatch(values, count);
+ 		while (pushed < count) {
+ 			const auto n = tryPushBatch(values + pushed, count - pushed);
+ 			if (n != 0) {
+ 				pushed += n;
+ 				continue;
+ 			}
+
+ 			switch (Policy) {
+ 				case OverflowPolicy::DropOldest: {
+ 					T discarded;
+ 					if (tryPop(discarded)) {
+ 						Dropped.Count.fetch_add(1, std::memory_order_relaxed);
+ 					}
+ 				}
+ 				break;
+ 				case OverflowPolicy::Block:
+ 					std::this_thread::yield();
+ 				break;
+ 				case OverflowPolicy::CountAndDrop:
+ 					Dropped.Count.fetch_add(count - pushed, std::memory_order_relaxed);
+ 					return pushed;
+ 			}
+ 		}
+ 		return pushed;
+ 	}
+
+ 	/// Attempts to pop an element from the queue into \p value, returning false
+ 	/// if the queue is empty.
+ 	/// \param value The value to pop the element into.
+ 	bool tryPop(T& value) {
+ 		return popBatch(&value, 1) == 1;
+ 	}
+
+ 	/// Pops up to \p maxCount elements from the queue into \p values, claiming
+ 	/// all the slots with a single compare and swap. Returns the number of
+ 	/// elements which were popped.
+ 	/// \param values   A pointer to the storage to pop the elements into.
+ 	/// \param maxCount The maximum number of elements to pop.
+ 	std::size_t popBatch(T* values, std::size_t maxCount) {
+ 		if (maxCount == 0) {
+ 			return 0;
+ 		}
+ 		auto pos   = DequeuePos.load(std::memory_order_relaxed);
+ 		auto claim = std::size_t{0};
+ 		while (true) {
+ 			claim = claimable(pos, maxCount, 1);
+ 			if (claim == 0) {
+ 				const auto seq = Cells[pos & Mask].Sequence.load(
+ 					std::memory_order_acquire);
+ 				if (static_cast<intptr_t>(seq - (pos + 1)) < 0) {
+ 					return 0;
+ 				}
+ 				pos = DequeuePos.load(std::memory_order_relaxed);
+ 				continue;
+ 			}
+ 			if (DequeuePos.compare_exchange_weak(pos                      ,
+ 			                                     pos + claim              ,
+ 			                                     std::memory_order_relaxed)) {
+ 				break;
+ 			}
+ 		}
+
+ 		for (std::size_t i = 0; i < claim; ++i) {
+ 			auto& cell = Cells[(pos + i) & Mask];
+ 			values[i]  = cell.Value;
+ 			cell.Sequence.store(pos + i + Mask + 1, std::memory_order_release);
+ 		}
+ 		return claim;
+ 	}
+
+ 	/// Returns the maximum number of elements which the queue can hold.
+ 	std::size_t capacity() const {
+ 		return Mask + 1;
+ 	}
+
+ 	/// Returns the approximate number of elements in the queue. This is exact
+ 	/// when there are no concurrent pushes or pops.
+ 	std::size_t size() const {
+ 		const auto dequeuePos = DequeuePos.load(std::memory_order_relaxed);
+ 		const auto enqueuePos = EnqueuePos.load(std::memory_order_relaxed);
+ 		return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+ 	}
+
+ 	/// Returns the number of elements which have been dropped due to the
+ 	/// overflow policy.
+ 	uint64_t dropped() const {
+ 		return Dropped.Count.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns the overflow policy of the queue.
+ 	OverflowPolicy policy() const {
+ 		return Policy;
+ 	}
+
+ private:
+ 	/// The Cell struct defines a slot in the ring.
+ 	struct Cell {
+ 		std::atomic<std::size_t> Sequence;	//!< The lap sequence of the slot.
+ 		T                        Value;			//!< The value in the slot.
+ 	};
+
+ 	/// The DropCounter struct wraps the dropped element count so that it is on
+ 	/// its own cache line.
+ 	struct alignas(cacheLineSize) DropCounter {
+ 		std::atomic<uint64_t> Count{0};	//!< The number of dropped elements.
+ 	};
+
+ 	/// Returns the number of consecutive slots, up to \p maxCount, starting at
+ 	/// \p pos, which are ready to be claimed. For producers \p offset is 0 and
+ 	/// the slots must be empty, for consumers it is 1 and the slots must be full.
+ 	/// \param pos      The position of the first slot.
+ 	/// \param maxCount The maximum number of slots to claim.
+ 	/// \param offset   The offset of the expected sequence from the position.
+ 	std::size_t claimable(std::size_t pos,
+ 	                      std::size_t maxCount,
+ 	                      std::size_t offset) const {
+ 		std::size_t count = 0;
+ 		while (count < maxCount && count <= Mask) {
+ 			const auto seq = Cells[(pos + count) & Mask].Sequence.load(
+ 				std::memory_order_acquire);
+ 			if (seq != pos + count + offset) {
+ 				break;
+ 			}
+ 			++count;
+ 		}
+ 		return count;
+ 	}
+
+ 	alignas(cacheLineSize) std::atomic<std::size_t> EnqueuePos{0};	//!< Producer position.
+ 	alignas(cacheLineSize) std::atomic<std::size_t> DequeuePos{0};	//!< Consumer position.
+ 	alignas(cacheLineSize) const std::size_t        Mask;						//!< Index mask.
+ 	std::unique_ptr<Cell[]>                         Cells;					//!< The slots.
+ 	OverflowPolicy                                  Policy;					//!< Overflow policy.
+ 	DropCounter                                     Dropped;				//!< Dropped count.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_EVENT_QUEUE_HPP
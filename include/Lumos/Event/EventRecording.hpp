@@ -0,0 +1,208 @@
+//==--- Lumos/Event/EventRecording.hpp --------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventRecording.hpp
+/// \brief This file defines classes for recording events to a file and for
+///        replaying recorded events.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_EVENT_RECORDING_HPP
+#define VOXEL_LUMOS_EVENT_EVENT_RECORDING_HPP
+
+#include "Event.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace Voxx::Lumos {
+
+class EventManager;
+
+/// The RecordingHeader struct defines the header at the start of a recording.
+struct RecordingHeader {
+	/// Defines the magic value which identifies a recording.
+	static constexpr char     magicValue[8] = { 'L', 'U', 'M', 'O',
+	                                            'S', 'R', 'E', 'C' };
+	/// Defines the current version of the recording format.
+	static constexpr uint32_t currentVersion = 2;
+
+	char     magic[8];	//!< Identifies the file as a recording.
+	uint32_t version;		//!< The version of the recording format.
+	uint32_t reserved;	//!< Reserved for future use.
+	uint64_t startNs;		//!< Monotonic time the recording started.
+};
+
+/// The RecordEntry struct defines a single record in a recording. Records are
+/// appended after the header and are 8 bytes each. Each record is an Event
+/// whose compact time holds the microseconds since the previous record. Gaps
+/// which are longer than the compact time can hold are recorded as events of
+/// kind Empty, whose payload holds the microseconds of the gap.
+struct RecordEntry {
+	/// Defines the largest time delta which an event record can hold.
+	static constexpr uint32_t maxEventDeltaUs = 0xFFFF;
+	/// Defines the largest time delta which a gap record can hold.
+	static constexpr uint32_t maxGapDeltaUs   = 0xFFFFFFFF;
+
+	Event event;	//!< The event, with the delta as its time.
+
+	/// Returns the microseconds since the previous record.
+	uint64_t deltaUs() const {
+		return event.kind() == EventKind::Empty ? event.payload() : event.time();
+	}
+};
+
+static_assert(sizeof(RecordEntry) == 8, "RecordEntry must be 8 bytes.");
+
+/// The EventRecorder class streams events to an append-only binary file. The
+/// records are buffered and written in large blocks, so recording an event is
+/// a copy into the buffer.
+class EventRecorder {
+ public:
+ 	/// Defines the number of records which are buffered before writing.
+ 	static constexpr std::size_t bufferedRecords = 4096;
+
+ 	/// Constructor -- allocates the record buffer.
+ 	EventRecorder();
+
+ 	/// Destructor -- flushes and closes the recording.
+ 	~EventRecorder();
+
+ 	/// Copy constructor -- deleted since the recorder owns a file.
+ 	EventRecorder(const EventRecorder&) = delete;
+ 	/// Copy assignment -- deleted since the recorder owns a file.
+ 	EventRecorder& operator=(const EventRecorder&) = delete;
+
+ 	/// Opens the recording at \p path, truncating any existing file, and writes
+ 	/// the header. Returns false if the file could not be opened.
+ 	/// \param path The path of the recording.
+ 	bool open(const char* path);
+
+ 	/// Records the \p count events in \p events, which all happened at the
+ 	/// local monotonic time \p timeNs.
+ 	/// \param events A pointer to the events to record.
+ 	/// \param count  The number of events to record.
+ 	/// \param timeNs The time of the events.
+ 	void recordEvents(const Event* events, std::size_t count, uint64_t timeNs);
+
+ 	/// Writes any buffered records to the file.
+ 	void flush();
+
+ 	/// Flushes the buffered records and closes the recording.
+ 	void close();
+
+ 	/// Returns true if a recording is open.
+ 	bool isOpen() const {
+ 		return FileDescriptor >= 0;
+ 	}
+
+ 	/// Returns the number of records written to the recording.
+ 	uint64_t recordCount() const {
+ 		return RecordCount;
+ 	}
+
+ private:
+ 	/// Appends \p entry to the buffer, flushing it if it is full.
+ 	/// \param entry The entry to append.
+ 	void append(const RecordEntry& entry);
+
+ 	/// Appends records to advance the time to \p timeNs, returning the time
+ 	/// delta for the next record.
+ 	/// \param timeNs The time of the next record.
+ 	uint16_t advanceTo(uint64_t timeNs);
+
+ 	std::unique_ptr<RecordEntry[]> Buffer;								//!< Buffered records.
+ 	std::size_t                    BufferedCount  = 0;		//!< Records in buffer.
+ 	uint64_t                       RecordCount    = 0;		//!< Records written.
+ 	uint64_t                       LastTimeUs     = 0;		//!< Time of last record.
+ 	int                            FileDescriptor = -1;		//!< The file.
+};
+
+/// Defines the timing used when replaying a recording.
+enum class ReplayTiming : uint8_t {
+	Original = 0,	//!< Replay with the recorded time between events.
+	MaxSpeed = 1	//!< Replay the events as fast as possible.
+};
+
+/// The EventReplayer class memory maps a recording and posts the recorded
+/// events back into an EventManager.
+class EventReplayer {
+ public:
+ 	/// Defines the number of events which are posted at once.
+ 	static constexpr std::size_t replayBatchSize = 64;
+
+ 	/// Constructor -- creates a replayer with no recording.
+ 	EventReplayer() = default;
+
+ 	/// Destructor -- unmaps the recording.
+ 	~EventReplayer();
+
+ 	/// Copy constructor -- deleted since the replayer owns a mapping.
+ 	EventReplayer(const EventReplayer&) = delete;
+ 	/// Copy assignment -- deleted since the replayer owns a mapping.
+ 	EventReplayer& operator=(const EventReplayer&) = delete;
+
+ 	/// Maps the recording at \p path, returning false if the file could not be
+ 	/// mapped or is not a valid recording.
+ 	/// \param path The path of the recording.
+ 	bool open(const char* path);
+
+ 	/// Unmaps the recording.
+ 	void close();
+
+ 	/// Replays the remainder of the recording into \p eventManager with the
+ 	/// given \p timing, returning the number of events which were posted.
+ 	/// If the manager does not accept an event, because it is full, the replay
+ 	/// stops at that event, so that the caller can drain the manager and call
+ 	/// this again to resume, and no event is skipped. With MaxSpeed the events
+ 	/// are posted at once, so unless another thread drains the manager
+ 	/// concurrently this stops once the manager is full, and with the
+ 	/// CountAndDrop policy the events it rejects are counted as dropped even
+ 	/// though they are posted again when the replay resumes.
+ 	/// \param eventManager The manager to post the events to.
+ 	/// \param timing       The timing to replay the events with.
+ 	std::size_t replay(EventManager& eventManager, ReplayTiming timing);
+
+ 	/// Posts the events which were recorded up to \p elapsedNs after the start
+ 	/// of the recording into \p eventManager, returning the number of events
+ 	/// which were posted. This allows a frame loop to replay a recording
+ 	/// deterministically using its own notion of time. As with replay(), this
+ 	/// stops at the first event which the manager does not accept.
+ 	/// \param eventManager The manager to post the events to.
+ 	/// \param elapsedNs    The time since the start of the recording.
+ 	std::size_t replayUntil(EventManager& eventManager, uint64_t elapsedNs);
+
+ 	/// Restarts the replay from the first record.
+ 	void rewind() {
+ 		Position  = 0;
+ 		ElapsedUs = 0;
+ 	}
+
+ 	/// Returns true if all the records have been replayed.
+ 	bool finished() const {
+ 		return Position >= EntryCount;
+ 	}
+
+ 	/// Returns the number of records in the recording.
+ 	std::size_t recordCount() const {
+ 		return EntryCount;
+ 	}
+
+ private:
+ 	const RecordEntry* Entries    = nullptr;	//!< The mapped records.
+ 	void*              Mapping    = nullptr;	//!< The mapped file.
+ 	std::size_t        MappedSize = 0;				//!< The size of the mapping.
+ 	std::size_t        EntryCount = 0;				//!< The number of records.
+ 	std::size_t        Position   = 0;				//!< The next record.
+ 	uint64_t           ElapsedUs  = 0;				//!< Time of the next record.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_EVENT_RECORDING_HPP
@@ -0,0 +1,55 @@
+//==--- Lumos/Event/EventTime.hpp -------------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventTime.hpp
+/// \brief This file defines types for timestamping events.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_EVENT_TIME_HPP
+#define VOXEL_LUMOS_EVENT_EVENT_TIME_HPP
+
+#include <chrono>
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// Returns the current time of the local monotonic clock, in nanoseconds.
+inline uint64_t monotonicTimeNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// The EventTime struct defines when an event happened, both according to the
+/// server which generated it and according to the local monotonic clock when
+/// the event was read by Lumos.
+struct EventTime {
+	uint64_t localNs  = 0;	//!< Local monotonic time the event was read.
+	uint32_t serverMs = 0;	//!< Server time of the event, in milliseconds.
+};
+
+/// The Timestamped struct defines an event along with the time of the event.
+/// \tparam EventType The type of the event.
+template <typename EventType>
+struct Timestamped {
+	EventType event;	//!< The event.
+	EventTime time;		//!< The time of the event.
+
+	/// Returns the number of nanoseconds between the event being read and the
+	/// local monotonic time \p nowNs.
+	/// \param nowNs The current local monotonic time.
+	uint64_t latencyNs(uint64_t nowNs = monotonicTimeNs()) const {
+		return nowNs > time.localNs ? nowNs - time.localNs : 0;
+	}
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_EVENT_TIME_HPP
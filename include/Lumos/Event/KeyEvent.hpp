@@ -17,11 +17,17 @@
 #define VOXEL_LUMOS_EVENT_KEY_EVENT_HPP
 
 #include "Event.hpp"
+#include "EventTime.hpp"
+#include <memory>
 
 namespace Voxx::Lumos {
 
 class KeyEvent {
  public:
+ 	/// Default constructor -- creates a press event with no key value, which
+ 	/// allows key events to be stored in preallocated containers.
+ 	KeyEvent() = default;
+
  	/// Constructor -- set the action kind of the event.
  	/// \param action The action kind of the event.
  	explicit KeyEvent(EventActionKind action) {
@@ -30,17 +36,17 @@ class KeyEvent {
  	
  	/// Sets the value kind of the key event.
  	void setValue(KeyEventKind value) {
- 		Value |= (value << 1) & valueMask;
+ 		Value |= (static_cast<uint16_t>(value) << 1) & valueMask;
  	}
 
  	/// Sets the action kind of the key event.
  	void setAction(EventActionKind action) {
- 		Value |= action & actionMask;
+ 		Value |= static_cast<uint16_t>(action) & actionMask;
  	}
 
  	/// Returns the value kind of the key event.
  	KeyEventKind value() const {
- 		return static_cast<KeyEventKind>((Value >> 1) & valueMask);
+ 		return static_cast<KeyEventKind>((Value & valueMask) >> 1);
  	}
 
  	/// Returns the action kind of the key event.
@@ -48,6 +54,34 @@ class KeyEvent {
  		return static_cast<EventActionKind>(Value & actionMask);
  	}
 
+ 	/// Returns the packed 16 bit encoding of the event.
+ 	uint16_t encoded() const {
+ 		return Value;
+ 	}
+
+ 	/// Creates a key event from the packed 16 bit encoding \p value, as returned
+ 	/// by encoded().
+ 	/// \param value The packed encoding of the event.
+ 	static KeyEvent fromEncoded(uint16_t value) {
+ 		KeyEvent keyEvent;
+ 		keyEvent.Value = value;
+ 		return keyEvent;
+ 	}
+
+ 	/// Returns the key event as an Event, with the time set from \p timeNs.
+ 	/// \param timeNs The local monotonic time of the event, in nanoseconds.
+ 	Event toEvent(uint64_t timeNs = 0) const {
+ 		return Event::key(action(), value()).stamped(timeNs);
+ 	}
+
+ 	/// Creates a key event from \p event, which must be of kind Key.
+ 	/// \param event The event to create the key event from.
+ 	static KeyEvent fromEvent(const Event& event) {
+ 		KeyEvent keyEvent(event.action());
+ 		keyEvent.setValue(event.keyValue());
+ 		return keyEvent;
+ 	}
+
  private:
  	/// Defines the mask for the action.
  	static constexpr uint16_t valueMask = 0xFFFE;
@@ -60,6 +94,9 @@ class KeyEvent {
 	uint16_t Value = 0;
 };
 
+/// Defines the type of a key event with the time at which it happened.
+using TimedKeyEvent = Timestamped<KeyEvent>;
+
 /// The KeyHandler struct defines the interface for key event handling.
 struct KeyHandler {
 	/// Destructor --- enables calling of derived destructor.
@@ -83,7 +120,7 @@ class KeyEventHandler {
 	/// \tparam 	KeyEventHandlerImpl 	The implementation of the static key
 	///																	key handling interface.
 	template <typename KeyEventHandlerImpl>
-	class KeyHandlerAdapter  : public KeyHandler, public KeyEventHandlerImpl {
+	class KeyHandlerAdapter  : public KeyHandler {
 	 public:
 	 	/// Constructor --- stores a reference to the key handling implementation.
 	 	/// \param[in] 	keyHandlerImpl 	A reference to the key handling
@@ -95,7 +132,7 @@ class KeyEventHandler {
 	 	/// from the KeyEventHandlerImpl interface to the Keyhandler interface.
 	 	/// \param[in]	keyEvent 	The key event to handle.
 	 	void handleEvent(const KeyEvent& keyEvent) final override {
-	 		static_cast<KeyEventHandlerImpl*>(this)->handleKeyEvent(keyEvent);
+	 		KeyHandlerImpl.handleKeyEvent(keyEvent);
 	 	}
 
 	 private:
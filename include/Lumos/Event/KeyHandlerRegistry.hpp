@@ -0,0 +1,253 @@
+//==--- Lumos/Event/KeyHandlerRegistry.hpp ----------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  KeyHandlerRegistry.hpp
+/// \brief This file defines containers of key handlers which dispatch key
+///        events without virtual calls.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_KEY_HANDLER_REGISTRY_HPP
+#define VOXEL_LUMOS_EVENT_KEY_HANDLER_REGISTRY_HPP
+
+#include "KeyEvent.hpp"
+#include <Lumos/Utility/Instrumentation.hpp>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace Voxx::Lumos {
+
+/// The StaticKeyHandlerSet class defines a set of key handlers which is known
+/// at compile time. Dispatching an event to the set invokes each handler's
+/// handleKeyEvent directly, in the order the handlers were given, so the
+/// calls can be inlined.
+/// \tparam Handlers The types of the handlers in the set.
+template <typename... Handlers>
+class StaticKeyHandlerSet {
+ public:
+ 	/// Constructor -- stores references to the \p handlers.
+ 	/// \param handlers The handlers to dispatch to.
+ 	explicit StaticKeyHandlerSet(Handlers&... handlers)
+ 	: HandlerRefs(handlers...) {}
+
+ 	/// Dispatches \p keyEvent to each of the handlers in the set.
+ 	/// \param keyEvent The key event to dispatch.
+ 	void handleKeyEvent(const KeyEvent& keyEvent) const {
+ 		std::apply([&keyEvent] (auto&... handlers) {
+ 			(handlers.handleKeyEvent(keyEvent), ...);
+ 		}, HandlerRefs);
+ 	}
+
+ 	/// Dispatches the \p count events in \p keyEvents to each of the handlers
+ 	/// in the set. Each handler receives the whole batch, in order, before the
+ 	/// next handler receives any of it.
+ 	/// \param keyEvents A pointer to the key events to dispatch.
+ 	/// \param count     The number of key events to dispatch.
+ 	void handleKeyEvents(const KeyEvent* keyEvents, std::size_t count) const {
+ 		std::apply([keyEvents, count] (auto&... handlers) {
+ 			(dispatchBatch(handlers, keyEvents, count), ...);
+ 		}, HandlerRefs);
+ 	}
+
+ 	/// Returns the number of handlers in the set.
+ 	static constexpr std::size_t size() {
+ 		return sizeof...(Handlers);
+ 	}
+
+ private:
+ 	std::tuple<Handlers&...> HandlerRefs;	//!< The handlers in the set.
+
+ 	/// Dispatches the \p count events in \p keyEvents to \p handler.
+ 	/// \param  handler     The handler to dispatch to.
+ 	/// \param  keyEvents   A pointer to the key events to dispatch.
+ 	/// \param  count       The number of key events to dispatch.
+ 	/// \tparam HandlerImpl The type of the handler.
+ 	template <typename HandlerImpl>
+ 	static void dispatchBatch(HandlerImpl&    handler  ,
+ 	                          const KeyEvent* keyEvents,
+ 	                          std::size_t     count    ) {
+ 		for (std::size_t i = 0; i < count; ++i) {
+ 			handler.handleKeyEvent(keyEvents[i]);
+ 		}
+ 	}
+};
+
+/// Creates a static handler set from the \p handlers.
+/// \param  handlers The handlers to dispatch to.
+/// \tparam Handlers The types of the handlers.
+template <typename... Handlers>
+StaticKeyHandlerSet<Handlers...> makeKeyHandlerSet(Handlers&... handlers) {
+	return StaticKeyHandlerSet<Handlers...>(handlers...);
+}
+
+/// The KeyHandlerDelegate class defines a small, trivially copyable callable
+/// which invokes a key handler. The handler (or a reference to it) is stored
+/// inline in the delegate, so a container of delegates is a single contiguous
+/// allocation and invoking one is a single indirect call with no pointer
+/// chasing through a vtable. Batches of events are handled with a single
+/// indirect call, with the handler inlined into the loop over the batch.
+class KeyHandlerDelegate {
+ public:
+ 	/// Defines the number of bytes available for storing a callable inline.
+ 	static constexpr std::size_t storageSize = 2 * sizeof(void*);
+
+ 	/// Creates a delegate which invokes the handleKeyEvent member of
+ 	/// \p handler. The delegate refers to \p handler, which must outlive it.
+ 	/// \param  handler     The handler to invoke.
+ 	/// \tparam HandlerImpl The type of the handler.
+ 	template <typename HandlerImpl>
+ 	static KeyHandlerDelegate fromHandler(HandlerImpl& handler) {
+ 		HandlerImpl* handlerPtr = &handler;
+ 		return fromCallable([handlerPtr] (const KeyEvent& keyEvent) {
+ 			handlerPtr->handleKeyEvent(keyEvent);
+ 		});
+ 	}
+
+ 	/// Creates a delegate which stores \p callable inline. The callable must be
+ 	/// trivially copyable, no larger than storageSize and aligned no more
+ 	/// strictly than a pointer, which is the case for lambdas which capture a
+ 	/// couple of pointers or values.
+ 	/// \param  callable The callable to store.
+ 	/// \tparam Callable The type of the callable.
+ 	template <typename Callable>
+ 	static KeyHandlerDelegate fromCallable(Callable callable) {
+ 		static_assert(sizeof(Callable) <= storageSize,
+ 		              "Callable is too large to store in a delegate.");
+ 		static_assert(std::is_trivially_copyable_v<Callable>,
+ 		              "Callable must be trivially copyable.");
+ 		static_assert(alignof(Callable) <= alignof(void*),
+ 		              "Callable is too strictly aligned to store in a delegate.");
+
+ 		KeyHandlerDelegate delegate;
+ 		std::memcpy(delegate.Storage, &callable, sizeof(Callable));
+ 		delegate.Invoke = [] (const void*     storage  ,
+ 		                      const KeyEvent* keyEvents,
+ 		                      std::size_t     count    ) {
+ 			auto& stored = *static_cast<Callable*>(const_cast<void*>(storage));
+ 			for (std::size_t i = 0; i < count; ++i) {
+ 				stored(keyEvents[i]);
+ 			}
+ 		};
+ 		return delegate;
+ 	}
+
+ 	/// Invokes the stored handler with \p keyEvent.
+ 	/// \param keyEvent The key event to handle.
+ 	void operator()(const KeyEvent& keyEvent) const {
+ 		Invoke(Storage, &keyEvent, 1);
+ 	}
+
+ 	/// Invokes the stored handler with each of the \p count events in
+ 	/// \p keyEvents, in order.
+ 	/// \param keyEvents A pointer to the key events to handle.
+ 	/// \param count     The number of key events to handle.
+ 	void operator()(const KeyEvent* keyEvents, std::size_t count) const {
+ 		Invoke(Storage, keyEvents, count);
+ 	}
+
+ private:
+ 	/// Defines the type of the function which invokes the stored callable.
+ 	using InvokeFn = void (*)(const void*, const KeyEvent*, std::size_t);
+
+ 	alignas(void*) unsigned char Storage[storageSize];	//!< Inline storage.
+ 	InvokeFn                     Invoke = nullptr;			//!< Invoker.
+};
+
+/// The KeyHandlerRegistry class defines a container of handlers which are
+/// registered at runtime. The handlers are stored as delegates in contiguous
+/// memory, and are invoked in the order in which they were added.
+class KeyHandlerRegistry {
+ public:
+ 	/// Defines the type of the identifier of a registered handler.
+ 	using HandlerId = uint32_t;
+
+ 	/// Constructor -- reserves space for \p capacity handlers.
+ 	/// \param capacity The number of handlers to reserve space for.
+ 	explicit KeyHandlerRegistry(std::size_t capacity = 16) {
+ 		Delegates.reserve(capacity);
+ 		Ids.reserve(capacity);
+ 	}
+
+ 	/// Adds \p handler to the registry, returning the identifier which can be
+ 	/// used to remove it. The handler must outlive its registration.
+ 	/// \param  handler     The handler to add.
+ 	/// \tparam HandlerImpl The type of the handler.
+ 	template <typename HandlerImpl>
+ 	HandlerId addHandler(HandlerImpl& handler) {
+ 		return addDelegate(KeyHandlerDelegate::fromHandler(handler));
+ 	}
+
+ 	/// Adds \p callable to the registry, returning the identifier which can be
+ 	/// used to remove it.
+ 	/// \param  callable The callable to add.
+ 	/// \tparam Callable The type of the callable.
+ 	template <typename Callable>
+ 	HandlerId addCallable(Callable callable) {
+ 		return addDelegate(KeyHandlerDelegate::fromCallable(callable));
+ 	}
+
+ 	/// Adds \p delegate to the registry, returning its identifier.
+ 	/// \param delegate The delegate to add.
+ 	HandlerId addDelegate(KeyHandlerDelegate delegate) {
+ 		Delegates.push_back(delegate);
+ 		Ids.push_back(NextId);
+ 		return NextId++;
+ 	}
+
+ 	/// Removes the handler with identifier \p id, returning false if there is
+ 	/// no such handler. The order of the remaining handlers is preserved.
+ 	/// \param id The identifier of the handler to remove.
+ 	bool removeHandler(HandlerId id) {
+ 		for (std::size_t i = 0; i < Ids.size(); ++i) {
+ 			if (Ids[i] == id) {
+ 				Ids.erase(Ids.begin() + i);
+ 				Delegates.erase(Delegates.begin() + i);
+ 				return true;
+ 			}
+ 		}
+ 		return false;
+ 	}
+
+ 	/// Dispatches \p keyEvent to each of the handlers in the registry.
+ 	/// \param keyEvent The key event to dispatch.
+ 	void handleKeyEvent(const KeyEvent& keyEvent) const {
+ 		for (const auto& delegate : Delegates) {
+ 			delegate(keyEvent);
+ 		}
+ 	}
+
+ 	/// Dispatches the \p count events in \p keyEvents to each of the handlers
+ 	/// in the registry. Each handler receives the whole batch, in order, before
+ 	/// the next handler receives any of it.
+ 	/// \param keyEvents A pointer to the key events to dispatch.
+ 	/// \param count     The number of key events to dispatch.
+ 	void handleKeyEvents(const KeyEvent* keyEvents, std::size_t count) const {
+ 		for (const auto& delegate : Delegates) {
+ 			VOXX_LUMOS_TIMED_SCOPE("KeyHandlerRegistry::handler");
+ 			delegate(keyEvents, count);
+ 		}
+ 	}
+
+ 	/// Returns the number of handlers in the registry.
+ 	std::size_t size() const {
+ 		return Delegates.size();
+ 	}
+
+ private:
+ 	std::vector<KeyHandlerDelegate> Delegates;	//!< The handler delegates.
+ 	std::vector<HandlerId>          Ids;				//!< The handler identifiers.
+ 	HandlerId                       NextId = 0;	//!< The next identifier.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_KEY_HANDLER_REGISTRY_HPP
@@ -0,0 +1,220 @@
+//==--- Lumos/Event/KeyState.hpp --------------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  KeyState.hpp
+/// \brief This file defines classes which hold the state of the keyboard.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_KEY_STATE_HPP
+#define VOXEL_LUMOS_EVENT_KEY_STATE_HPP
+
+#include "KeyEvent.hpp"
+#include <Lumos/Utility/CacheLine.hpp>
+#include <atomic>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+	#include <immintrin.h>
+#endif
+
+namespace Voxx::Lumos {
+
+/// The KeyBits class defines a 256 bit set with one bit for each key code,
+/// where a set bit means that the key is down.
+class alignas(32) KeyBits {
+ public:
+ 	/// Defines the number of 64 bit words in the set.
+ 	static constexpr std::size_t wordCount = 4;
+
+ 	/// Sets the bit for \p key.
+ 	/// \param key The key to set the bit for.
+ 	void set(KeyEventKind key) {
+ 		const auto index = static_cast<uint8_t>(key);
+ 		Words[index >> 6] |= uint64_t{1} << (index & 63);
+ 	}
+
+ 	/// Clears the bit for \p key.
+ 	/// \param key The key to clear the bit for.
+ 	void clear(KeyEventKind key) {
+ 		const auto index = static_cast<uint8_t>(key);
+ 		Words[index >> 6] &= ~(uint64_t{1} << (index & 63));
+ 	}
+
+ 	/// Returns true if the bit for \p key is set.
+ 	/// \param key The key to test the bit for.
+ 	bool test(KeyEventKind key) const {
+ 		const auto index = static_cast<uint8_t>(key);
+ 		return (Words[index >> 6] >> (index & 63)) & 1;
+ 	}
+
+ 	/// Returns true if any bit is set.
+ 	bool any() const {
+ 		return (Words[0] | Words[1] | Words[2] | Words[3]) != 0;
+ 	}
+
+ 	/// Sets the bits which are set in \p other.
+ 	/// \param other The set to merge into this one.
+ 	void merge(const KeyBits& other) {
+ 		for (std::size_t i = 0; i < wordCount; ++i) {
+ 			Words[i] |= other.Words[i];
+ 		}
+ 	}
+
+ 	/// Updates the set with the key event \p keyEvent.
+ 	/// \param keyEvent The key event to apply.
+ 	void apply(const KeyEvent& keyEvent) {
+ 		if (keyEvent.action() == EventActionKind::Press) {
+ 			set(keyEvent.value());
+ 		} else {
+ 			clear(keyEvent.value());
+ 		}
+ 	}
+
+ 	uint64_t Words[wordCount] = {};	//!< The bits of the set.
+};
+
+/// Computes the keys which changed state between \p previous and \p current,
+/// writing the keys which went down to \p pressed and the keys which came up
+/// to \p released. This is a single XOR across the whole set followed by an
+/// AND with each of the inputs, using 256 or 128 bit vectors when available.
+/// \param previous The key state of the previous frame.
+/// \param current  The key state of the current frame.
+/// \param pressed  The keys which were pressed this frame.
+/// \param released The keys which were released this frame.
+inline void computeKeyEdges(const KeyBits& previous,
+                            const KeyBits& current ,
+                            KeyBits&       pressed ,
+                            KeyBits&       released) {
+#if defined(__AVX2__)
+	const auto prev    = _mm256_load_si256(
+		reinterpret_cast<const __m256i*>(previous.Words));
+	const auto curr    = _mm256_load_si256(
+		reinterpret_cast<const __m256i*>(current.Words));
+	const auto changed = _mm256_xor_si256(prev, curr);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(pressed.Words),
+	                   _mm256_and_si256(changed, curr));
+	_mm256_store_si256(reinterpret_cast<__m256i*>(released.Words),
+	                   _mm256_and_si256(changed, prev));
+#elif defined(__SSE2__)
+	for (std::size_t i = 0; i < KeyBits::wordCount; i += 2) {
+		const auto prev    = _mm_load_si128(
+			reinterpret_cast<const __m128i*>(previous.Words + i));
+		const auto curr    = _mm_load_si128(
+			reinterpret_cast<const __m128i*>(current.Words + i));
+		const auto changed = _mm_xor_si128(prev, curr);
+		_mm_store_si128(reinterpret_cast<__m128i*>(pressed.Words + i),
+		                _mm_and_si128(changed, curr));
+		_mm_store_si128(reinterpret_cast<__m128i*>(released.Words + i),
+		                _mm_and_si128(changed, prev));
+	}
+#else
+	for (std::size_t i = 0; i < KeyBits::wordCount; ++i) {
+		const auto changed = previous.Words[i] ^ current.Words[i];
+		pressed.Words[i]   = changed & current.Words[i];
+		released.Words[i]  = changed & previous.Words[i];
+	}
+#endif
+}
+
+/// The KeyState struct defines an immutable snapshot of the keyboard for a
+/// frame. Each query is a single bit test.
+struct KeyState {
+	KeyBits  held;				//!< Keys which are down.
+	KeyBits  pressed;			//!< Keys which went down this frame.
+	KeyBits  released;		//!< Keys which came up this frame.
+	uint64_t frame = 0;		//!< The frame the snapshot was published for.
+
+	/// Returns true if \p key is down.
+	/// \param key The key to query.
+	bool isHeld(KeyEventKind key) const {
+		return held.test(key);
+	}
+
+	/// Returns true if \p key went down this frame.
+	/// \param key The key to query.
+	bool wasPressed(KeyEventKind key) const {
+		return pressed.test(key);
+	}
+
+	/// Returns true if \p key came up this frame.
+	/// \param key The key to query.
+	bool wasReleased(KeyEventKind key) const {
+		return released.test(key);
+	}
+};
+
+/// The PublishedKeyState class holds the most recently published KeyState so
+/// that it can be read from any thread. Publishing is done by a single thread
+/// and is protected by a sequence lock, so neither readers nor the publisher
+/// ever block, and readers only retry if they overlap a publish.
+class PublishedKeyState {
+ public:
+ 	/// Publishes \p keyState. This must only be called by one thread.
+ 	/// \param keyState The key state to publish.
+ 	void publish(const KeyState& keyState) {
+ 		const auto sequence = Sequence.load(std::memory_order_relaxed);
+ 		Sequence.store(sequence + 1, std::memory_order_relaxed);
+ 		std::atomic_thread_fence(std::memory_order_release);
+ 		store(keyState.held    , 0);
+ 		store(keyState.pressed , 1);
+ 		store(keyState.released, 2);
+ 		Frame.store(keyState.frame, std::memory_order_relaxed);
+ 		Sequence.store(sequence + 2, std::memory_order_release);
+ 	}
+
+ 	/// Returns a copy of the most recently published key state. This can be
+ 	/// called from any thread.
+ 	KeyState load() const {
+ 		KeyState keyState;
+ 		while (true) {
+ 			const auto before = Sequence.load(std::memory_order_acquire);
+ 			if (before & 1) {
+ 				continue;
+ 			}
+ 			load(keyState.held    , 0);
+ 			load(keyState.pressed , 1);
+ 			load(keyState.released, 2);
+ 			keyState.frame = Frame.load(std::memory_order_relaxed);
+ 			std::atomic_thread_fence(std::memory_order_acquire);
+ 			if (Sequence.load(std::memory_order_relaxed) == before) {
+ 				return keyState;
+ 			}
+ 		}
+ 	}
+
+ private:
+ 	/// Defines the number of words in the published bit sets.
+ 	static constexpr std::size_t publishedWords = 3 * KeyBits::wordCount;
+
+ 	/// Stores \p bits into the published bit set with index \p set.
+ 	void store(const KeyBits& bits, std::size_t set) {
+ 		for (std::size_t i = 0; i < KeyBits::wordCount; ++i) {
+ 			Words[set * KeyBits::wordCount + i].store(bits.Words[i],
+ 			                                          std::memory_order_relaxed);
+ 		}
+ 	}
+
+ 	/// Loads the published bit set with index \p set into \p bits.
+ 	void load(KeyBits& bits, std::size_t set) const {
+ 		for (std::size_t i = 0; i < KeyBits::wordCount; ++i) {
+ 			bits.Words[i] = Words[set * KeyBits::wordCount + i].load(
+ 				std::memory_order_relaxed);
+ 		}
+ 	}
+
+ 	alignas(cacheLineSize) std::atomic<uint64_t> Sequence{0};	//!< Sequence lock.
+ 	std::atomic<uint64_t> Frame{0};														//!< Published frame.
+ 	std::atomic<uint64_t> Words[publishedWords] = {};					//!< Published bits.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_KEY_STATE_HPP
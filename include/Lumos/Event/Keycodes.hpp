@@ -1,23 +1,69 @@
 //==--- Lumos/Event/Keycodes.hpp --------------------------- -*- C++ -*- ---==//
-//            
+//
 //                                Voxel : Lumos
 //
 //                        Copyright (c) 2018 Rob Clucas
-//  
+//
 //  This file is distributed under the MIT License. See LICENSE for details.
 //
 //==------------------------------------------------------------------------==//
 //
 /// \file  Keycodes.hpp
-/// \brief This file defines the appropriate key codes based on the platform.
+/// \brief This file defines the platform independent key codes.
 //
 //==------------------------------------------------------------------------==//
 
 #ifndef VOXEL_LUMOS_EVENT_KEYCODES_HPP
 #define VOXEL_LUMOS_EVENT_KEYCODES_HPP
 
-#if defined(VOXX_PLATFORM_LINUX) || defined(VOXX_PLATFORM_LINUX)
-	#include "KeycodesXcb.hpp"
-#endif
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// Defines the keys of a keyboard. Each key is identified by its physical
+/// position rather than the symbol it produces, and is named after the symbol
+/// it produces on a US keyboard, so that WASD are the same keys with any
+/// layout. Each platform translates its hardware key codes to these with a
+/// table, and the symbols of the current layout are available separately.
+enum class KeyEventKind : uint8_t {
+	Unknown = 0,		//!< A key which has no translation.
+
+	// Letters:
+	A, B, C, D, E, F, G, H, I, J, K, L, M,
+	N, O, P, Q, R, S, T, U, V, W, X, Y, Z,
+
+	// Digits on the main part of the keyboard:
+	Digit0, Digit1, Digit2, Digit3, Digit4,
+	Digit5, Digit6, Digit7, Digit8, Digit9,
+
+	// Function keys:
+	F1,  F2,  F3,  F4,  F5,  F6,  F7,  F8,  F9,  F10, F11, F12,
+	F13, F14, F15, F16, F17, F18, F19, F20, F21, F22, F23, F24,
+
+	// Punctuation:
+	Space, Apostrophe, Comma, Minus, Period, Slash, Semicolon, Equal,
+	LeftBracket, Backslash, RightBracket, Grave,
+	NonUsBackslash,	//!< The key between left shift and Z on ISO keyboards.
+
+	// Editing and navigation:
+	Esc, Enter, Tab, Backspace, Insert, Delete,
+	Right, Left, Down, Up, PageUp, PageDown, Home, End,
+	CapsLock, ScrollLock, NumLock, PrintScreen, Pause, Menu,
+
+	// Keypad:
+	Kp0, Kp1, Kp2, Kp3, Kp4, Kp5, Kp6, Kp7, Kp8, Kp9,
+	KpDecimal, KpDivide, KpMultiply, KpSubtract, KpAdd, KpEnter, KpEqual,
+
+	// Modifiers:
+	LeftShift,  LeftControl,  LeftAlt,  LeftSuper,
+	RightShift, RightControl, RightAlt, RightSuper,
+
+	Count,					//!< The number of keys.
+
+	Sub = KpSubtract,	//!< The keypad subtract key.
+	Add = KpAdd				//!< The keypad add key.
+};
+
+} // namespace Voxx::Lumos
 
-#endif // VOXEL_LUMOS_EVENT_KEYCODES_HPP
\ No newline at end of file
+#endif // VOXEL_LUMOS_EVENT_KEYCODES_HPP
@@ -1,38 +1,140 @@
 //==--- Lumos/Event/KeycodesXcb.hpp ------------------------ -*- C++ -*- ---==//
-//            
+//
 //                                Voxel : Lumos
 //
 //                        Copyright (c) 2018 Rob Clucas
-//  
+//
 //  This file is distributed under the MIT License. See LICENSE for details.
 //
 //==------------------------------------------------------------------------==//
 //
 /// \file  KeycodesXcb.hpp
-/// \brief This file defines key codes for XCB
+/// \brief This file defines the translation of XCB key codes to keys.
 //
 //==------------------------------------------------------------------------==//
 
 #ifndef VOXEL_LUMOS_EVENT_KEYCODES_XCB_HPP
 #define VOXEL_LUMOS_EVENT_KEYCODES_XCB_HPP
 
+#include "Keycodes.hpp"
+#include <array>
+#include <cstdint>
+
 namespace Voxx::Lumos {
 
-enum class KeyEventKind : uint8_t {
-	Esc 	= 0x09,
-	W 		= 0x19,
-	A 		= 0x26,
-	S 		= 0x27,
-	D 		= 0x28,
-	Space	= 0x41,
-	F1 	  = 0x43,
-	F2 	 	= 0x44,
-	F3 		= 0x45,
-	F4 		= 0x46
-	Sub 	= 0x52,
-	Add 	= 0x56,
-};
+/// Defines the number of X key codes.
+constexpr std::size_t xcbKeycodeCount  = 256;
+
+/// Defines the offset of X key codes from the Linux evdev scan codes, which
+/// identify the physical key independently of the layout.
+constexpr uint8_t     xcbKeycodeOffset = 8;
+
+/// Defines the type of the table which translates X key codes to keys.
+using XcbKeycodeTable = std::array<KeyEventKind, xcbKeycodeCount>;
+
+/// Returns the table which translates each X key code to a key, for servers
+/// which use the evdev driver, which is every modern X server on Linux.
+constexpr XcbKeycodeTable makeXcbKeycodeTable() {
+	struct Entry {
+		uint8_t      scancode;	//!< The evdev scan code.
+		KeyEventKind key;				//!< The key for the scan code.
+	};
+	using K = KeyEventKind;
+	constexpr Entry entries[] = {
+		{  1, K::Esc         }, {  2, K::Digit1      }, {  3, K::Digit2      },
+		{  4, K::Digit3      }, {  5, K::Digit4      }, {  6, K::Digit5      },
+		{  7, K::Digit6      }, {  8, K::Digit7      }, {  9, K::Digit8      },
+		{ 10, K::Digit9      }, { 11, K::Digit0      }, { 12, K::Minus       },
+		{ 13, K::Equal       }, { 14, K::Backspace   }, { 15, K::Tab         },
+		{ 16, K::Q           }, { 17, K::W           }, { 18, K::E           },
+		{ 19, K::R           }, { 20, K::T           }, { 21, K::Y           },
+		{ 22, K::U           }, { 23, K::I           }, { 24, K::O           },
+		{ 25, K::P           }, { 26, K::LeftBracket }, { 27, K::RightBracket},
+		{ 28, K::Enter       }, { 29, K::LeftControl }, { 30, K::A           },
+		{ 31, K::S           }, { 32, K::D           }, { 33, K::F           },
+		{ 34, K::G           }, { 35, K::H           }, { 36, K::J           },
+		{ 37, K::K           }, { 38, K::L           }, { 39, K::Semicolon   },
+		{ 40, K::Apostrophe  }, { 41, K::Grave       }, { 42, K::LeftShift   },
+		{ 43, K::Backslash   }, { 44, K::Z           }, { 45, K::X           },
+		{ 46, K::C           }, { 47, K::V           }, { 48, K::B           },
+		{ 49, K::N           }, { 50, K::M           }, { 51, K::Comma       },
+		{ 52, K::Period      }, { 53, K::Slash       }, { 54, K::RightShift  },
+		{ 55, K::KpMultiply  }, { 56, K::LeftAlt     }, { 57, K::Space       },
+		{ 58, K::CapsLock    }, { 59, K::F1          }, { 60, K::F2          },
+		{ 61, K::F3          }, { 62, K::F4          }, { 63, K::F5          },
+		{ 64, K::F6          }, { 65, K::F7          }, { 66, K::F8          },
+		{ 67, K::F9          }, { 68, K::F10         }, { 69, K::NumLock     },
+		{ 70, K::ScrollLock  }, { 71, K::Kp7         }, { 72, K::Kp8         },
+		{ 73, K::Kp9         }, { 74, K::KpSubtract  }, { 75, K::Kp4         },
+		{ 76, K::Kp5         }, { 77, K::Kp6         }, { 78, K::KpAdd       },
+		{ 79, K::Kp1         }, { 80, K::Kp2         }, { 81, K::Kp3         },
+		{ 82, K::Kp0         }, { 83, K::KpDecimal   }, { 86, K::NonUsBackslash},
+		{ 87, K::F11         }, { 88, K::F12         }, { 96, K::KpEnter     },
+		{ 97, K::RightControl}, { 98, K::KpDivide    }, { 99, K::PrintScreen },
+		{100, K::RightAlt    }, {102, K::Home        }, {103, K::Up          },
+		{104, K::PageUp      }, {105, K::Left        }, {106, K::Right       },
+		{107, K::End         }, {108, K::Down        }, {109, K::PageDown    },
+		{110, K::Insert      }, {111, K::Delete      }, {117, K::KpEqual     },
+		{119, K::Pause       }, {125, K::LeftSuper   }, {126, K::RightSuper  },
+		{127, K::Menu        }, {183, K::F13         }, {184, K::F14         },
+		{185, K::F15         }, {186, K::F16         }, {187, K::F17         },
+		{188, K::F18         }, {189, K::F19         }, {190, K::F20         },
+		{191, K::F21         }, {192, K::F22         }, {193, K::F23         },
+		{194, K::F24         }
+	};
+
+	XcbKeycodeTable table{};
+	for (const auto& entry : entries) {
+		table[entry.scancode + xcbKeycodeOffset] = entry.key;
+	}
+	return table;
+}
+
+/// Defines the table which translates X key codes to keys.
+inline constexpr XcbKeycodeTable xcbKeycodeTable = makeXcbKeycodeTable();
+
+/// Returns the key for the X key code \p keycode, which is a single load from
+/// the translation table.
+/// \param keycode The X key code.
+constexpr KeyEventKind translateXcbKeycode(uint8_t keycode) {
+	return xcbKeycodeTable[keycode];
+}
+
+/// Defines the type of the table which translates keys to X key codes.
+using XcbKeyTable =
+	std::array<uint8_t, static_cast<std::size_t>(KeyEventKind::Count)>;
+
+/// Returns the table which translates each key to its X key code, which is the
+/// inverse of the table returned by makeXcbKeycodeTable(), with zero for the
+/// keys which have no key code.
+constexpr XcbKeyTable makeXcbKeyTable() {
+	XcbKeyTable table{};
+	for (std::size_t keycode = 0; keycode < xcbKeycodeCount; ++keycode) {
+		if (xcbKeycodeTable[keycode] != KeyEventKind::Unknown) {
+			table[static_cast<std::size_t>(xcbKeycodeTable[keycode])] =
+				static_cast<uint8_t>(keycode);
+		}
+	}
+	return table;
+}
+
+/// Defines the table which translates keys to X key codes.
+inline constexpr XcbKeyTable xcbKeyTable = makeXcbKeyTable();
+
+/// Returns the X key code of \p key, or zero if the key has no key code.
+/// \param key The key to get the key code of.
+constexpr uint8_t xcbKeycodeOf(KeyEventKind key) {
+	return static_cast<std::size_t>(key) < xcbKeyTable.size()
+	     ? xcbKeyTable[static_cast<std::size_t>(key)] : 0;
+}
+
+static_assert(translateXcbKeycode(0x09) == KeyEventKind::Esc,
+              "Escape must have the evdev key code.");
+static_assert(translateXcbKeycode(0x19) == KeyEventKind::W,
+              "Letters must be translated by position.");
+static_assert(xcbKeycodeOf(KeyEventKind::Add) == 0x56,
+              "The key code of a key must invert the translation.");
 
 } // namespace Voxx::Lumos
 
-#endif // VOXEL_LUMOS_EVENT_KEYCODES_XCB_HPP
\ No newline at end of file
+#endif // VOXEL_LUMOS_EVENT_KEYCODES_XCB_HPP
@@ -0,0 +1,155 @@
+//==--- Lumos/Event/ParallelDispatcher.hpp ----------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  ParallelDispatcher.hpp
+/// \brief This file defines a dispatcher which delivers each batch of events
+///        to its sinks in parallel on a work stealing thread pool.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_PARALLEL_DISPATCHER_HPP
+#define VOXEL_LUMOS_EVENT_PARALLEL_DISPATCHER_HPP
+
+#include "EventBatch.hpp"
+#include "KeyEvent.hpp"
+#include <cstdint>
+#include <initializer_list>
+#include <thread>
+#include <vector>
+
+namespace Voxx::Lumos {
+
+/// The ParallelDispatcher class delivers each batch of events which is drained
+/// from an EventManager to every registered sink, running the sinks in
+/// parallel on a pool of worker threads, so that the time to dispatch a batch
+/// is that of the slowest chain of sinks rather than the sum of all of them.
+///
+/// Each sink receives the whole batch in a single call, so it sees the events
+/// in the order they were posted, and dispatch() returns only once every sink
+/// has handled the batch, so batches never overlap. A sink may depend on sinks
+/// which were registered before it, in which case it only receives a batch
+/// once those sinks have handled it, and sees everything they did.
+///
+/// Each thread has its own queue of sinks which are ready to run. A thread
+/// which finishes a sink queues the sinks which were waiting on it on its own
+/// queue, so dependent chains stay on one thread, and a thread with an empty
+/// queue steals from the others. The thread which calls dispatch() runs sinks
+/// too, so a dispatcher without workers runs every sink on it, in order.
+///
+/// Sinks must be registered before dispatching, from the thread which
+/// dispatches.
+class ParallelDispatcher {
+ public:
+ 	/// Defines the type of the identifier of a sink.
+ 	using SinkId = uint32_t;
+ 	/// Defines the type of the function which delivers a batch to a sink.
+ 	using SinkFn = void (*)(void* sink, const EventBatch& batch);
+
+ 	/// Defines the identifier which is returned when a sink can not be added.
+ 	static constexpr SinkId invalidSink = UINT32_MAX;
+
+ 	/// Returns the default number of worker threads, which leaves one hardware
+ 	/// thread for the thread which dispatches.
+ 	static std::size_t defaultWorkerCount() {
+ 		const auto threads = std::thread::hardware_concurrency();
+ 		return threads > 1 ? threads - 1 : 0;
+ 	}
+
+ 	/// Constructor -- starts \p workerCount worker threads, which sleep while
+ 	/// there is nothing to dispatch.
+ 	/// \param workerCount The number of worker threads.
+ 	explicit ParallelDispatcher(std::size_t workerCount = defaultWorkerCount());
+
+ 	/// Destructor -- stops the worker threads.
+ 	~ParallelDispatcher();
+
+ 	/// Copy constructor -- deleted since the dispatcher owns its threads.
+ 	ParallelDispatcher(const ParallelDispatcher&) = delete;
+ 	/// Copy assignment -- deleted since the dispatcher owns its threads.
+ 	ParallelDispatcher& operator=(const ParallelDispatcher&) = delete;
+
+ 	/// Adds a sink which \p deliver is invoked with \p sink and each batch for,
+ 	/// after the sinks in \p dependencies have handled the batch. Returns the
+ 	/// identifier of the sink, or invalidSink if a dependency has not been
+ 	/// added.
+ 	/// \param deliver      The function which delivers a batch to the sink.
+ 	/// \param sink         The sink.
+ 	/// \param dependencies The sinks which must handle a batch first.
+ 	SinkId addSink(SinkFn                        deliver         ,
+ 	               void*                         sink            ,
+ 	               std::initializer_list<SinkId> dependencies = {});
+
+ 	/// Adds \p sink, which has a handleEvents(const EventBatch&) member, and
+ 	/// must outlive the dispatcher. Returns the identifier of the sink, or
+ 	/// invalidSink if a dependency has not been added.
+ 	/// \param  sink         The sink to add.
+ 	/// \param  dependencies The sinks which must handle a batch first.
+ 	/// \tparam Sink         The type of the sink.
+ 	template <typename Sink>
+ 	SinkId addSink(Sink& sink, std::initializer_list<SinkId> dependencies = {}) {
+ 		return addSink([] (void* target, const EventBatch& batch) {
+ 			static_cast<Sink*>(target)->handleEvents(batch);
+ 		}, &sink, dependencies);
+ 	}
+
+ 	/// Adds \p handler, which has a handleKeyEvent(const KeyEvent&) member, as
+ 	/// a sink which receives the key events of each batch, in order. The
+ 	/// handler must outlive the dispatcher. Returns the identifier of the sink,
+ 	/// or invalidSink if a dependency has not been added.
+ 	/// \param  handler      The handler to add.
+ 	/// \param  dependencies The sinks which must handle a batch first.
+ 	/// \tparam Handler      The type of the handler.
+ 	template <typename Handler>
+ 	SinkId addKeyHandler(Handler&                      handler          ,
+ 	                     std::initializer_list<SinkId> dependencies = {}) {
+ 		return addSink([] (void* target, const EventBatch& batch) {
+ 			auto* keyHandler = static_cast<Handler*>(target);
+ 			batch.forEach(EventKind::Key, [keyHandler, &batch] (std::size_t i) {
+ 				keyHandler->handleKeyEvent(KeyEvent::fromEvent(batch[i]));
+ 			});
+ 		}, &handler, dependencies);
+ 	}
+
+ 	/// Delivers \p batch to every sink and returns once all of them have
+ 	/// handled it.
+ 	/// \param batch The batch of events to deliver.
+ 	void dispatch(const EventBatch& batch);
+
+ 	/// Returns the number of sinks.
+ 	std::size_t size() const {
+ 		return Sinks.size();
+ 	}
+
+ 	/// Returns the number of worker threads.
+ 	std::size_t workerCount() const;
+
+ 	/// Returns the number of sinks which have been run by a thread other than
+ 	/// the one whose queue they were placed on.
+ 	uint64_t stolenSinks() const;
+
+ private:
+ 	/// The Sink struct holds a registered sink.
+ 	struct Sink {
+ 		SinkFn              deliver      = nullptr;	//!< Delivers a batch.
+ 		void*               target       = nullptr;	//!< The sink.
+ 		uint32_t            dependencies = 0;				//!< Number of dependencies.
+ 		std::vector<SinkId> dependents;							//!< Sinks which wait on it.
+ 	};
+
+ 	/// The Pool struct holds the worker threads and their queues.
+ 	struct Pool;
+
+ 	std::vector<Sink> Sinks;						//!< The registered sinks.
+ 	Pool*             Workers = nullptr;	//!< The worker threads.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_PARALLEL_DISPATCHER_HPP
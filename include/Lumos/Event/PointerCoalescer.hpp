@@ -0,0 +1,251 @@
+//==--- Lumos/Event/PointerCoalescer.hpp ------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  PointerCoalescer.hpp
+/// \brief This file defines a class which coalesces high rate pointer motion
+///        between the thread which reads it and the thread which drains it.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_POINTER_COALESCER_HPP
+#define VOXEL_LUMOS_EVENT_POINTER_COALESCER_HPP
+
+#include "Event.hpp"
+#include "EventQueue.hpp"
+#include <Lumos/Utility/CacheLine.hpp>
+#include <atomic>
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// Defines how pointer motion is coalesced between drains.
+enum class MotionCoalescing : uint8_t {
+	Accumulate = 0,	//!< Merge motion into one delta and the latest position.
+	Lossless   = 1	//!< Keep every motion sample as a separate event.
+};
+
+/// The PointerCoalescer class collects pointer motion from a producer, which
+/// reads it from the platform at whatever rate the device reports it, for a
+/// consumer which drains it once per frame.
+///
+/// Relative motion is accumulated in 48.16 fixed point so that the sub-pixel
+/// precision of raw device motion is kept. When the motion is drained only
+/// the whole part is emitted as a MouseDelta event and the fraction, and any
+/// part which does not fit in the 16 bit event components, is carried into the
+/// next drain, so no motion is ever lost to rounding.
+///
+/// In the Accumulate mode the consumer receives at most one MouseDelta and
+/// one MouseMove event per drain, regardless of the rate of the device. In the
+/// Lossless mode every sample becomes an event, for code which filters the
+/// motion itself; if the consumer falls so far behind that the queue is full,
+/// further samples are accumulated instead of dropped.
+///
+/// Discrete pointer events, such as button presses, are always kept. The
+/// accumulated motion is flushed ahead of them so that they are ordered after
+/// the motion which preceded them. A producer which queues discrete events
+/// elsewhere, with other kinds of events, can instead drain the motion into
+/// that queue ahead of each discrete event.
+///
+/// There must only be one producer at a time, and one consumer at a time,
+/// although the producer may also drain.
+class PointerCoalescer {
+ public:
+ 	/// Defines the type of fixed point motion values.
+ 	using FixedType = int64_t;
+
+ 	/// Defines the number of fractional bits in fixed point motion values.
+ 	static constexpr int         fractionBits    = 16;
+ 	/// Defines the fixed point value of one pixel.
+ 	static constexpr FixedType   fixedOne        = FixedType(1) << fractionBits;
+ 	/// Defines the default number of events which can be queued between drains.
+ 	static constexpr std::size_t defaultCapacity = 1024;
+
+ 	/// Constructor -- creates the coalescer.
+ 	/// \param capacity The number of events which can be queued between drains.
+ 	/// \param mode     How motion is coalesced.
+ 	explicit PointerCoalescer(
+ 		std::size_t      capacity = defaultCapacity            ,
+ 		MotionCoalescing mode     = MotionCoalescing::Accumulate)
+ 	: Events(capacity, OverflowPolicy::CountAndDrop), Mode(mode) {}
+
+ 	/// Sets how motion is coalesced. Motion which was accumulated before the
+ 	/// change is emitted by the next drain.
+ 	/// \param mode How motion is coalesced.
+ 	void setMode(MotionCoalescing mode) {
+ 		Mode.store(mode, std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns how motion is coalesced.
+ 	MotionCoalescing mode() const {
+ 		return Mode.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Converts \p pixels to a fixed point motion value.
+ 	/// \param pixels The number of pixels.
+ 	static constexpr FixedType toFixed(int32_t pixels) {
+ 		return static_cast<FixedType>(pixels) * fixedOne;
+ 	}
+
+ 	//==--- Producer -------------------------------------------------------==//
+
+ 	/// Adds relative motion of (\p dx, \p dy), in fixed point, which happened
+ 	/// at the local monotonic time \p timeNs.
+ 	/// \param dx     The horizontal motion.
+ 	/// \param dy     The vertical motion.
+ 	/// \param timeNs The time of the motion.
+ 	void addDelta(FixedType dx, FixedType dy, uint64_t timeNs) {
+ 		DeltaX.fetch_add(dx, std::memory_order_relaxed);
+ 		DeltaY.fetch_add(dy, std::memory_order_relaxed);
+ 		LatestNs.store(timeNs, std::memory_order_relaxed);
+ 		countSample();
+ 		if (mode() == MotionCoalescing::Lossless) {
+ 			Event event;
+ 			if (takeDelta(event) && !Events.tryPush(event)) {
+ 				restore(event);
+ 			}
+ 		}
+ 	}
+
+ 	/// Sets the absolute position of the pointer to (\p x, \p y), which it
+ 	/// moved to at the local monotonic time \p timeNs.
+ 	/// \param x      The horizontal position of the pointer.
+ 	/// \param y      The vertical position of the pointer.
+ 	/// \param timeNs The time of the motion.
+ 	void addPosition(int16_t x, int16_t y, uint64_t timeNs) {
+ 		const auto event = Event::mouseMove(x, y).stamped(timeNs);
+ 		countSample();
+ 		if (mode() == MotionCoalescing::Lossless && Events.tryPush(event)) {
+ 			return;
+ 		}
+ 		Position.store(event.encoded(), std::memory_order_relaxed);
+ 		LatestNs.store(timeNs, std::memory_order_relaxed);
+ 	}
+
+ 	/// Adds the discrete pointer event \p event, such as a button press, after
+ 	/// flushing the motion which has been accumulated. Returns false if the
+ 	/// event was dropped because the queue is full.
+ 	/// \param event The event to add, which must already be stamped.
+ 	bool addEvent(const Event& event) {
+ 		Event      motion[2];
+ 		const auto count  = takeCoalesced(motion);
+ 		const auto pushed = Events.tryPushBatch(motion, count);
+ 		for (auto i = pushed; i < count; ++i) {
+ 			restore(motion[i]);
+ 		}
+ 		return Events.push(event);
+ 	}
+
+ 	//==--- Consumer -------------------------------------------------------==//
+
+ 	/// Drains up to \p maxCount events into \p events, returning the number of
+ 	/// events which were drained. Queued events are drained first, followed by
+ 	/// the coalesced motion, so a drain which returns fewer than \p maxCount
+ 	/// events has taken all of the pending motion.
+ 	/// \param events   A pointer to the storage for the events.
+ 	/// \param maxCount The maximum number of events to drain.
+ 	std::size_t drain(Event* events, std::size_t maxCount) {
+ 		auto count = Events.popBatch(events, maxCount);
+ 		if (maxCount - count >= 2) {
+ 			count += takeCoalesced(events + count);
+ 		}
+ 		return count;
+ 	}
+
+ 	/// Returns the number of motion samples which have been added.
+ 	uint64_t samples() const {
+ 		return Samples.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns the number of discrete events which were dropped because the
+ 	/// queue was full.
+ 	uint64_t dropped() const {
+ 		return Events.dropped();
+ 	}
+
+ private:
+ 	EventQueue<Event>             Events;				//!< Queued events.
+ 	std::atomic<MotionCoalescing> Mode;					//!< Coalescing mode.
+
+ 	/// The accumulated motion, which both sides modify.
+ 	alignas(cacheLineSize) std::atomic<FixedType> DeltaX{0};
+ 	std::atomic<FixedType>                        DeltaY{0};	//!< Vertical.
+ 	std::atomic<uint64_t>                         Position{0};	//!< Encoded.
+ 	std::atomic<uint64_t>                         LatestNs{0};	//!< Latest time.
+ 	std::atomic<uint64_t>                         Samples{0};	//!< Samples.
+
+ 	/// Counts a sample. Only the producer writes the count, so this does not
+ 	/// need a read-modify-write.
+ 	void countSample() {
+ 		Samples.store(Samples.load(std::memory_order_relaxed) + 1,
+ 		              std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns the whole part of \p value which fits in an event component.
+ 	/// \param value The fixed point value.
+ 	static constexpr int16_t wholePart(FixedType value) {
+ 		const auto whole = value / fixedOne;
+ 		return static_cast<int16_t>(whole < INT16_MIN ? INT16_MIN :
+ 		                            whole > INT16_MAX ? INT16_MAX : whole);
+ 	}
+
+ 	/// Takes the whole part of the accumulated relative motion as a MouseDelta
+ 	/// \p event, leaving the remainder accumulated. Returns false if there is
+ 	/// no whole motion to take.
+ 	/// \param event The event to take the motion into.
+ 	bool takeDelta(Event& event) {
+ 		const auto dx = DeltaX.exchange(0, std::memory_order_relaxed);
+ 		const auto dy = DeltaY.exchange(0, std::memory_order_relaxed);
+ 		const auto wx = wholePart(dx), wy = wholePart(dy);
+ 		if (dx != toFixed(wx)) {
+ 			DeltaX.fetch_add(dx - toFixed(wx), std::memory_order_relaxed);
+ 		}
+ 		if (dy != toFixed(wy)) {
+ 			DeltaY.fetch_add(dy - toFixed(wy), std::memory_order_relaxed);
+ 		}
+ 		if (wx == 0 && wy == 0) {
+ 			return false;
+ 		}
+ 		event = Event::mouseDelta(wx, wy)
+ 		       .stamped(LatestNs.load(std::memory_order_relaxed));
+ 		return true;
+ 	}
+
+ 	/// Returns the motion event \p event, which could not be queued, to the
+ 	/// coalesced motion. A returned position is only kept if no later position
+ 	/// has been coalesced since it was taken.
+ 	/// \param event The event to return the motion of.
+ 	void restore(const Event& event) {
+ 		if (event.kind() == EventKind::MouseMove) {
+ 			uint64_t empty = 0;
+ 			Position.compare_exchange_strong(empty, event.encoded(),
+ 			                                 std::memory_order_relaxed);
+ 			return;
+ 		}
+ 		DeltaX.fetch_add(toFixed(event.x()), std::memory_order_relaxed);
+ 		DeltaY.fetch_add(toFixed(event.y()), std::memory_order_relaxed);
+ 	}
+
+ 	/// Takes the coalesced motion into \p events, which must have space for two
+ 	/// events, and returns the number of events which were taken.
+ 	/// \param events A pointer to the storage for the events.
+ 	std::size_t takeCoalesced(Event* events) {
+ 		std::size_t count    = 0;
+ 		const auto  position = Position.exchange(0, std::memory_order_relaxed);
+ 		if (position != 0) {
+ 			events[count++] = Event::fromEncoded(position);
+ 		}
+ 		count += takeDelta(events[count]) ? 1 : 0;
+ 		return count;
+ 	}
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_POINTER_COALESCER_HPP
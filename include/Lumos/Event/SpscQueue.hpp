@@ -0,0 +1,116 @@
+//==--- Lumos/Event/SpscQueue.hpp -------------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  SpscQueue.hpp
+/// \brief This file defines a wait-free single producer, single consumer
+///        queue.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_EVENT_SPSC_QUEUE_HPP
+#define VOXEL_LUMOS_EVENT_SPSC_QUEUE_HPP
+
+#include <Lumos/Utility/CacheLine.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace Voxx::Lumos {
+
+/// The SpscQueue class defines a bounded ring queue for handing elements from
+/// exactly one producer thread to exactly one consumer thread. Both pushing
+/// and popping complete in a bounded number of steps regardless of what the
+/// other thread is doing, so a thread is never delayed by the other one. Each
+/// side keeps a cached copy of the other side's position so that the shared
+/// positions are only read when the cached copy says the queue is full or
+/// empty.
+/// \tparam T The type of the elements in the queue.
+template <typename T>
+class SpscQueue {
+ public:
+ 	/// Constructor -- allocates the slots for the queue.
+ 	/// \param capacity The number of elements which can be held by the queue,
+ 	///                 which is rounded up to the next power of two.
+ 	explicit SpscQueue(std::size_t capacity)
+ 	: Mask(nextPowerOfTwo(capacity < 2 ? 2 : capacity) - 1),
+ 	  Slots(new T[Mask + 1]) {}
+
+ 	/// Copy constructor -- deleted since the queue is shared between threads.
+ 	SpscQueue(const SpscQueue&) = delete;
+ 	/// Copy assignment -- deleted since the queue is shared between threads.
+ 	SpscQueue& operator=(const SpscQueue&) = delete;
+
+ 	/// Pushes \p value onto the queue, returning false and counting the value
+ 	/// as dropped if the queue is full. This must only be called by the
+ 	/// producer thread.
+ 	/// \param value The value to push.
+ 	bool push(const T& value) {
+ 		const auto tail = Producer.Position.load(std::memory_order_relaxed);
+ 		if (tail - Producer.CachedOther > Mask) {
+ 			Producer.CachedOther = Consumer.Position.load(std::memory_order_acquire);
+ 			if (tail - Producer.CachedOther > Mask) {
+ 				++Producer.Dropped;
+ 				DroppedCount.store(Producer.Dropped, std::memory_order_relaxed);
+ 				return false;
+ 			}
+ 		}
+ 		Slots[tail & Mask] = value;
+ 		Producer.Position.store(tail + 1, std::memory_order_release);
+ 		return true;
+ 	}
+
+ 	/// Pops up to \p maxCount elements into \p values, returning the number of
+ 	/// elements which were popped. This must only be called by the consumer
+ 	/// thread.
+ 	/// \param values   A pointer to the storage to pop the elements into.
+ 	/// \param maxCount The maximum number of elements to pop.
+ 	std::size_t popBatch(T* values, std::size_t maxCount) {
+ 		const auto head = Consumer.Position.load(std::memory_order_relaxed);
+ 		if (Consumer.CachedOther == head) {
+ 			Consumer.CachedOther = Producer.Position.load(std::memory_order_acquire);
+ 		}
+ 		auto count = Consumer.CachedOther - head;
+ 		count      = count < maxCount ? count : maxCount;
+ 		for (std::size_t i = 0; i < count; ++i) {
+ 			values[i] = Slots[(head + i) & Mask];
+ 		}
+ 		Consumer.Position.store(head + count, std::memory_order_release);
+ 		return count;
+ 	}
+
+ 	/// Returns the maximum number of elements which the queue can hold.
+ 	std::size_t capacity() const {
+ 		return Mask + 1;
+ 	}
+
+ 	/// Returns the number of elements which have been dropped because the
+ 	/// queue was full. This can be called from any thread.
+ 	uint64_t dropped() const {
+ 		return DroppedCount.load(std::memory_order_relaxed);
+ 	}
+
+ private:
+ 	/// The Side struct holds the state which is owned by one side of the queue.
+ 	struct alignas(cacheLineSize) Side {
+ 		std::atomic<std::size_t> Position{0};		//!< The side's position.
+ 		std::size_t              CachedOther = 0;	//!< Cached other position.
+ 		uint64_t                 Dropped     = 0;	//!< Local drop count.
+ 	};
+
+ 	Side                  Producer;					//!< Producer state.
+ 	Side                  Consumer;					//!< Consumer state.
+ 	std::atomic<uint64_t> DroppedCount{0};	//!< Published drop count.
+ 	const std::size_t     Mask;						//!< Index mask.
+ 	std::unique_ptr<T[]>  Slots;						//!< The slots.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_EVENT_SPSC_QUEUE_HPP
@@ -0,0 +1,154 @@
+//==--- Lumos/Frame/FrameHistogram.hpp --------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  FrameHistogram.hpp
+/// \brief This file defines a lock-free histogram of durations.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_FRAME_FRAME_HISTOGRAM_HPP
+#define VOXEL_LUMOS_FRAME_FRAME_HISTOGRAM_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// The FrameTimeSummary struct defines a summary of the durations recorded in
+/// a histogram, in nanoseconds.
+struct FrameTimeSummary {
+	uint64_t count = 0;	//!< The number of durations recorded.
+	uint64_t mean  = 0;	//!< The mean duration.
+	uint64_t p50   = 0;	//!< The median duration.
+	uint64_t p99   = 0;	//!< The 99th percentile duration.
+	uint64_t max   = 0;	//!< The maximum duration.
+};
+
+/// The FrameHistogram class records durations into log-linear buckets, so
+/// that the relative error of a reported percentile is at most 1/16 across
+/// the full range of a 64 bit duration, using a fixed amount of memory.
+///
+/// Recording is wait-free and may be done from any number of threads while
+/// other threads read percentiles. A summary read while durations are being
+/// recorded may not include the most recent of them.
+class FrameHistogram {
+ public:
+ 	/// Defines the number of buckets for each power of two.
+ 	static constexpr std::size_t subBucketCount = 16;
+ 	/// Defines the total number of buckets.
+ 	static constexpr std::size_t bucketCount    = 61 * subBucketCount;
+
+ 	/// Records a duration of \p ns nanoseconds.
+ 	/// \param ns The duration to record.
+ 	void record(uint64_t ns) {
+ 		Buckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+ 		Count.fetch_add(1, std::memory_order_relaxed);
+ 		Total.fetch_add(ns, std::memory_order_relaxed);
+ 		uint64_t max = Max.load(std::memory_order_relaxed);
+ 		while (ns > max &&
+ 		       !Max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+ 	}
+
+ 	/// Returns the number of durations which have been recorded.
+ 	uint64_t count() const {
+ 		return Count.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns the largest duration which has been recorded.
+ 	uint64_t max() const {
+ 		return Max.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns a duration which at least \p percentile percent of the recorded
+ 	/// durations are less than or equal to. The result is the upper bound of
+ 	/// the bucket the percentile falls in, limited to the maximum.
+ 	/// \param percentile The percentile to get, in the range [0, 100].
+ 	uint64_t percentile(double percentile) const {
+ 		uint64_t total = 0;
+ 		for (const auto& bucket : Buckets) {
+ 			total += bucket.load(std::memory_order_relaxed);
+ 		}
+ 		if (total == 0) {
+ 			return 0;
+ 		}
+
+ 		const double   fraction = percentile < 0.0   ? 0.0
+ 		                        : percentile > 100.0 ? 1.0 : percentile / 100.0;
+ 		const uint64_t rank     =
+ 			fraction * total < 1.0 ? 1 : static_cast<uint64_t>(fraction * total);
+ 		uint64_t seen = 0;
+ 		for (std::size_t i = 0; i < bucketCount; ++i) {
+ 			seen += Buckets[i].load(std::memory_order_relaxed);
+ 			if (seen >= rank) {
+ 				const uint64_t upper = bucketUpperBound(i);
+ 				const uint64_t max   = this->max();
+ 				return upper < max ? upper : max;
+ 			}
+ 		}
+ 		return max();
+ 	}
+
+ 	/// Returns a summary of the recorded durations.
+ 	FrameTimeSummary summary() const {
+ 		FrameTimeSummary summary;
+ 		summary.count = count();
+ 		summary.mean  = summary.count
+ 		              ? Total.load(std::memory_order_relaxed) / summary.count : 0;
+ 		summary.p50   = percentile(50.0);
+ 		summary.p99   = percentile(99.0);
+ 		summary.max   = max();
+ 		return summary;
+ 	}
+
+ 	/// Clears all recorded durations. This is not atomic with respect to
+ 	/// concurrent calls to record, which may be partially cleared.
+ 	void reset() {
+ 		for (auto& bucket : Buckets) {
+ 			bucket.store(0, std::memory_order_relaxed);
+ 		}
+ 		Count.store(0, std::memory_order_relaxed);
+ 		Total.store(0, std::memory_order_relaxed);
+ 		Max.store(0, std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns the index of the bucket for \p ns. Values below twice the
+ 	/// number of sub buckets have a bucket each, and above that each power of
+ 	/// two is split into subBucketCount buckets.
+ 	/// \param ns The duration to get the bucket of.
+ 	static constexpr std::size_t bucketIndex(uint64_t ns) {
+ 		if (ns < 2 * subBucketCount) {
+ 			return static_cast<std::size_t>(ns);
+ 		}
+ 		const unsigned shift = 63 - __builtin_clzll(ns) - 4;
+ 		return shift * subBucketCount + static_cast<std::size_t>(ns >> shift);
+ 	}
+
+ 	/// Returns the largest duration which falls in the bucket at \p index.
+ 	/// \param index The index of the bucket.
+ 	static constexpr uint64_t bucketUpperBound(std::size_t index) {
+ 		if (index < 2 * subBucketCount) {
+ 			return index;
+ 		}
+ 		const unsigned shift = static_cast<unsigned>(index / subBucketCount) - 1;
+ 		const uint64_t mantissa = index - shift * subBucketCount;
+ 		return ((mantissa + 1) << shift) - 1;
+ 	}
+
+ private:
+ 	std::atomic<uint64_t> Buckets[bucketCount] = {};	//!< Counts per bucket.
+ 	std::atomic<uint64_t> Count                = 0;		//!< Number of durations.
+ 	std::atomic<uint64_t> Total                = 0;		//!< Sum of durations.
+ 	std::atomic<uint64_t> Max                  = 0;		//!< Largest duration.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_FRAME_FRAME_HISTOGRAM_HPP
@@ -0,0 +1,162 @@
+//==--- Lumos/Frame/FrameScheduler.hpp --------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  FrameScheduler.hpp
+/// \brief This file defines a class which paces frames to a target cadence
+///        and records how long each frame, and each stage of it, takes.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_FRAME_FRAME_SCHEDULER_HPP
+#define VOXEL_LUMOS_FRAME_FRAME_SCHEDULER_HPP
+
+#include "FrameHistogram.hpp"
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// The FrameStage enum defines the stages of a frame which are timed.
+enum class FrameStage : uint8_t {
+	Poll    = 0,	//!< Polling for and dispatching events.
+	Update  = 1,	//!< Updating the application state.
+	Render  = 2,	//!< Recording and submitting rendering work.
+	Present = 3,	//!< Presenting the frame, which may block.
+	Count   = 4		//!< The number of stages.
+};
+
+/// The FrameScheduler class paces a frame loop to a target interval, and
+/// records the duration of each frame, of each stage of a frame, and of the
+/// wait at the end of a frame in lock-free histograms, which may be read from
+/// other threads while the loop runs. A loop using it looks like:
+///
+/// \code{cpp}
+/// while (running) {
+///   scheduler.beginStage(FrameStage::Poll);
+///   window->pollForEvent(eventManager);
+///   scheduler.beginStage(FrameStage::Render);
+///   render();
+///   scheduler.beginStage(FrameStage::Present);
+///   present();
+///   scheduler.waitForNextFrame();
+/// }
+/// \endcode
+///
+/// To wait, the scheduler sleeps until shortly before the deadline and then
+/// spins, where the time left for spinning adapts to how late the sleeps wake
+/// up. If a frame misses its deadline by more than a full interval, the
+/// schedule restarts from the current time rather than running the following
+/// frames back to back to catch up.
+class FrameScheduler {
+ public:
+ 	/// Defines the smallest time which is left for spinning after sleeping.
+ 	static constexpr uint64_t minSpinNs = 50'000;
+ 	/// Defines the largest time which is left for spinning after sleeping, so
+ 	/// that a single descheduled sleep does not cause long spins afterwards.
+ 	static constexpr uint64_t maxSpinNs = 2'000'000;
+ 	/// Defines the time which is initially left for spinning after sleeping.
+ 	static constexpr uint64_t defaultSpinNs = 1'000'000;
+
+ 	/// Constructor -- creates a scheduler with a target of \p intervalNs between
+ 	/// frames. An interval of zero does not pace frames, but still records them.
+ 	/// \param intervalNs The target interval between frames, in nanoseconds.
+ 	explicit FrameScheduler(uint64_t intervalNs = 0);
+
+ 	/// Sets the target interval between frames to \p intervalNs, where zero
+ 	/// disables pacing. The new interval applies from the next frame.
+ 	/// \param intervalNs The target interval between frames, in nanoseconds.
+ 	void setTargetInterval(uint64_t intervalNs);
+
+ 	/// Sets the target number of frames per second to \p rate, where zero
+ 	/// disables pacing.
+ 	/// \param rate The target frame rate, in Hz.
+ 	void setTargetRate(double rate);
+
+ 	/// Returns the target interval between frames, in nanoseconds.
+ 	uint64_t targetInterval() const {
+ 		return IntervalNs;
+ 	}
+
+ 	/// Ends the stage which is currently being timed, if there is one, and
+ 	/// starts timing \p stage.
+ 	/// \param stage The stage to start timing.
+ 	void beginStage(FrameStage stage);
+
+ 	/// Ends the stage which is currently being timed, if there is one.
+ 	void endStage();
+
+ 	/// Ends the current frame, waiting until the deadline for the next frame if
+ 	/// the scheduler is pacing, and starts the next frame. Returns the duration
+ 	/// of the frame which ended, including the wait, in nanoseconds.
+ 	uint64_t waitForNextFrame();
+
+ 	/// Returns the number of frames which have been completed.
+ 	uint64_t frameCount() const {
+ 		return Frames;
+ 	}
+
+ 	/// Returns the number of frames which finished after their deadline.
+ 	uint64_t missedDeadlines() const {
+ 		return Missed;
+ 	}
+
+ 	/// Returns the histogram of the durations of whole frames.
+ 	const FrameHistogram& frameTimes() const {
+ 		return FrameTimes;
+ 	}
+
+ 	/// Returns the histogram of the durations of \p stage.
+ 	/// \param stage The stage to get the histogram for.
+ 	const FrameHistogram& stageTimes(FrameStage stage) const {
+ 		return StageTimes[static_cast<std::size_t>(stage)];
+ 	}
+
+ 	/// Returns the histogram of the time spent waiting for the next deadline.
+ 	const FrameHistogram& waitTimes() const {
+ 		return WaitTimes;
+ 	}
+
+ 	/// Returns the histogram of how late the waits finished, which measures
+ 	/// the accuracy of the pacing.
+ 	const FrameHistogram& wakeErrors() const {
+ 		return WakeErrors;
+ 	}
+
+ 	/// Clears all the histograms and counters. This must be called from the
+ 	/// thread which runs the frame loop.
+ 	void reset();
+
+ private:
+ 	/// Defines the number of stages which are timed.
+ 	static constexpr std::size_t stageCount =
+ 		static_cast<std::size_t>(FrameStage::Count);
+
+ 	uint64_t   IntervalNs    = 0;								 //!< Target frame interval.
+ 	uint64_t   DeadlineNs    = 0;								 //!< Deadline of the frame.
+ 	uint64_t   FrameStartNs  = 0;								 //!< Start of the frame.
+ 	uint64_t   StageStartNs  = 0;								 //!< Start of the stage.
+ 	uint64_t   SpinNs        = defaultSpinNs;		 //!< Time left to spin.
+ 	uint64_t   Frames        = 0;								 //!< Completed frames.
+ 	uint64_t   Missed        = 0;								 //!< Missed deadlines.
+ 	FrameStage Stage         = FrameStage::Count; //!< The stage being timed.
+
+ 	FrameHistogram FrameTimes;							//!< Durations of frames.
+ 	FrameHistogram StageTimes[stageCount];	//!< Durations of stages.
+ 	FrameHistogram WaitTimes;								//!< Durations of waits.
+ 	FrameHistogram WakeErrors;							//!< Lateness of waits.
+
+ 	/// Waits until the monotonic time \p deadlineNs, returning the time at
+ 	/// which the wait finished.
+ 	/// \param deadlineNs The time to wait until.
+ 	uint64_t waitUntil(uint64_t deadlineNs);
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_FRAME_FRAME_SCHEDULER_HPP
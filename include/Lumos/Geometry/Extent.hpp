@@ -17,6 +17,8 @@
 #ifndef VOXEL_LUMOS_GEOMETRY_EXTENT_HPP
 #define VOXEL_LUMOS_GEOMETRY_EXTENT_HPP
 
+#include <cstdint>
+
 namespace Voxx::Lumos {
 
 /// The Extent struct defines an object which holds the size of single
@@ -0,0 +1,34 @@
+//==--- Lumos/Geometry/Rect.hpp ---------------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  Rect.hpp
+/// \brief This file defines rectangles.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_GEOMETRY_RECT_HPP
+#define VOXEL_LUMOS_GEOMETRY_RECT_HPP
+
+#include "Extent.hpp"
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// The Rect2d struct defines an object which holds a two dimensional rectangle
+/// as the offset of its top left corner and its extent.
+struct Rect2d {
+	int16_t  x;				//!< The horizontal offset of the rectangle.
+	int16_t  y;				//!< The vertical offset of the rectangle.
+	Extent2d extent;	//!< The extent of the rectangle.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_GEOMETRY_RECT_HPP
@@ -0,0 +1,40 @@
+//==--- Lumos/Utility/CacheLine.hpp ------------------------ -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  CacheLine.hpp
+/// \brief This file defines cache line related constants and utilities.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_UTILITY_CACHE_LINE_HPP
+#define VOXEL_LUMOS_UTILITY_CACHE_LINE_HPP
+
+#include <cstddef>
+
+namespace Voxx::Lumos {
+
+/// Defines the size of a cache line, in bytes. Data which is written by
+/// different threads is aligned to this to avoid false sharing.
+static constexpr std::size_t cacheLineSize = 64;
+
+/// Rounds \p value up to the next power of two, returning \p value if it is
+/// already a power of two.
+/// \param value The value to round up.
+constexpr std::size_t nextPowerOfTwo(std::size_t value) {
+	std::size_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_UTILITY_CACHE_LINE_HPP
@@ -0,0 +1,148 @@
+//==--- Lumos/Utility/FlatIdMap.hpp ------------------------ -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  FlatIdMap.hpp
+/// \brief This file defines a flat hash map from integer identifiers to
+///        pointers.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_UTILITY_FLAT_ID_MAP_HPP
+#define VOXEL_LUMOS_UTILITY_FLAT_ID_MAP_HPP
+
+#include "CacheLine.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Voxx::Lumos {
+
+/// The FlatIdMap class defines an open addressing hash map from non-zero 32 bit
+/// identifiers, such as window system handles, to pointers. The keys and
+/// values are stored in a single contiguous array which is probed linearly,
+/// so a lookup is a hash and usually a single cache line access. Removal
+/// shifts the following entries back rather than leaving tombstones, so the
+/// map does not degrade as entries are added and removed.
+/// \tparam T The type which the values point to.
+template <typename T>
+class FlatIdMap {
+ public:
+ 	/// Defines the type of the keys.
+ 	using KeyType = uint32_t;
+
+ 	/// Constructor -- allocates space for \p capacity entries.
+ 	/// \param capacity The number of entries to allocate space for.
+ 	explicit FlatIdMap(std::size_t capacity = 16)
+ 	: Slots(nextPowerOfTwo(capacity * 2 < 8 ? 8 : capacity * 2)) {}
+
+ 	/// Returns the value for \p key, or a null pointer if there is no entry for
+ 	/// \p key.
+ 	/// \param key The key to find the value for.
+ 	T* find(KeyType key) const {
+ 		const auto mask = Slots.size() - 1;
+ 		for (auto index = hash(key) & mask; ; index = (index + 1) & mask) {
+ 			const auto& slot = Slots[index];
+ 			if (slot.key == key) {
+ 				return slot.value;
+ 			}
+ 			if (slot.key == 0) {
+ 				return nullptr;
+ 			}
+ 		}
+ 	}
+
+ 	/// Sets the value for \p key to \p value, replacing any existing value.
+ 	/// \param key   The key to set the value for, which must not be zero.
+ 	/// \param value The value for the key.
+ 	void insert(KeyType key, T* value) {
+ 		if ((Count + 1) * 2 > Slots.size()) {
+ 			grow();
+ 		}
+ 		const auto mask = Slots.size() - 1;
+ 		for (auto index = hash(key) & mask; ; index = (index + 1) & mask) {
+ 			auto& slot = Slots[index];
+ 			if (slot.key == key) {
+ 				slot.value = value;
+ 				return;
+ 			}
+ 			if (slot.key == 0) {
+ 				slot = Slot{key, value};
+ 				++Count;
+ 				return;
+ 			}
+ 		}
+ 	}
+
+ 	/// Removes the entry for \p key, returning false if there was no entry.
+ 	/// \param key The key to remove the entry for.
+ 	bool erase(KeyType key) {
+ 		const auto mask  = Slots.size() - 1;
+ 		auto       index = hash(key) & mask;
+ 		while (Slots[index].key != key) {
+ 			if (Slots[index].key == 0) {
+ 				return false;
+ 			}
+ 			index = (index + 1) & mask;
+ 		}
+
+ 		// Shift back any following entries whose probe sequence passes through
+ 		// the removed slot, so that lookups never stop early.
+ 		auto hole = index;
+ 		for (auto next = (hole + 1) & mask; Slots[next].key != 0;
+ 		     next = (next + 1) & mask) {
+ 			const auto home = hash(Slots[next].key) & mask;
+ 			if (((next - home) & mask) >= ((next - hole) & mask)) {
+ 				Slots[hole] = Slots[next];
+ 				hole        = next;
+ 			}
+ 		}
+ 		Slots[hole] = Slot{};
+ 		--Count;
+ 		return true;
+ 	}
+
+ 	/// Returns the number of entries in the map.
+ 	std::size_t size() const {
+ 		return Count;
+ 	}
+
+ private:
+ 	/// The Slot struct defines an entry in the map.
+ 	struct Slot {
+ 		KeyType key   = 0;				//!< The key, or zero if empty.
+ 		T*      value = nullptr;	//!< The value.
+ 	};
+
+ 	/// Returns the hash of \p key. Window system identifiers are allocated
+ 	/// sequentially within a per-client range, so they are mixed with a
+ 	/// multiplicative hash to spread them across the table.
+ 	/// \param key The key to hash.
+ 	static std::size_t hash(KeyType key) {
+ 		return static_cast<std::size_t>((key * uint64_t{0x9E3779B97F4A7C15}) >> 32);
+ 	}
+
+ 	/// Doubles the number of slots and reinserts the entries.
+ 	void grow() {
+ 		std::vector<Slot> old(Slots.size() * 2);
+ 		old.swap(Slots);
+ 		Count = 0;
+ 		for (const auto& slot : old) {
+ 			if (slot.key != 0) {
+ 				insert(slot.key, slot.value);
+ 			}
+ 		}
+ 	}
+
+ 	std::vector<Slot> Slots;			//!< The slots of the map.
+ 	std::size_t       Count = 0;	//!< The number of entries.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_UTILITY_FLAT_ID_MAP_HPP
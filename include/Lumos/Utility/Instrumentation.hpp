@@ -0,0 +1,220 @@
+//==--- Lumos/Utility/Instrumentation.hpp ------------------ -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  Instrumentation.hpp
+/// \brief This file defines timers, counters and values which instrument the
+///        hot paths of Lumos, and the interface for reading them.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_UTILITY_INSTRUMENTATION_HPP
+#define VOXEL_LUMOS_UTILITY_INSTRUMENTATION_HPP
+
+#include <Lumos/Event/EventTime.hpp>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace Voxx::Lumos {
+
+/// The InstrumentKind enum defines the kinds of instrumentation sites.
+enum class InstrumentKind : uint8_t {
+	Timer   = 0,	//!< Records the duration of a scope, in nanoseconds.
+	Counter = 1,	//!< Records increments of a count.
+	Value   = 2		//!< Records samples of a value, such as a queue depth.
+};
+
+/// The InstrumentStats struct defines the aggregated records of a site. For a
+/// timer the total and max are durations in nanoseconds, for a counter the
+/// total is the sum of the increments, and for a value they are the sum and
+/// largest of the samples.
+struct InstrumentStats {
+	const char*    name  = nullptr;								//!< The name of the site.
+	InstrumentKind kind  = InstrumentKind::Timer;	//!< The kind of the site.
+	uint64_t       count = 0;											//!< The number of records.
+	uint64_t       total = 0;											//!< The sum of the records.
+	uint64_t       max   = 0;											//!< The largest record.
+
+	/// Returns the mean of the records, or 0 if there are none.
+	uint64_t mean() const {
+		return count ? total / count : 0;
+	}
+};
+
+/// The InstrumentSnapshot struct defines the aggregated records of every site,
+/// summed over all threads, at the time the snapshot was taken. Snapshots are
+/// cumulative, so the activity over an interval is the difference between the
+/// snapshots taken at each end of it.
+struct InstrumentSnapshot {
+	std::vector<InstrumentStats> sites;								//!< The sites.
+	uint64_t                     droppedTraceEvents = 0;	//!< Dropped trace events.
+	uint64_t                     timeNs             = 0;	//!< When it was taken.
+
+	/// Returns the stats for the site called \p name, or nullptr if there is no
+	/// such site.
+	/// \param name The name of the site.
+	const InstrumentStats* find(const char* name) const;
+
+	/// Returns the records made between \p earlier and this snapshot. The max
+	/// of each site is the max over the whole lifetime of the site.
+	/// \param earlier A snapshot taken before this one.
+	InstrumentSnapshot since(const InstrumentSnapshot& earlier) const;
+};
+
+/// The Instrumentation class collects the records of the instrumentation
+/// sites. Each thread records into its own buffer, which only it writes, so
+/// recording takes no locks and performs no atomic read-modify-write
+/// operations. Recording is disabled until enable() is called, and while it
+/// is disabled a site only checks whether recording is enabled. The buffer of
+/// a thread which exits is reused by the next thread which records, so its
+/// records are kept, and both threads have the same identifier in the Chrome
+/// trace.
+///
+/// The sites are normally created with the VOXX_LUMOS_* macros below, which
+/// are removed entirely unless VOXX_LUMOS_INSTRUMENT is defined.
+class Instrumentation {
+ public:
+ 	/// Defines the maximum number of sites.
+ 	static constexpr uint32_t maxSites       = 256;
+ 	/// Defines the identifier of a site which could not be registered.
+ 	static constexpr uint32_t invalidSite    = maxSites;
+ 	/// Defines the number of trace events each thread buffers. The buffer is
+ 	/// only allocated the first time the thread records while tracing.
+ 	static constexpr uint32_t traceCapacity  = 16384;
+
+ 	/// Registers a site called \p name, returning its identifier. Registering
+ 	/// a name which is already registered returns the existing identifier.
+ 	/// \param name The name of the site, which must outlive the program.
+ 	/// \param kind The kind of the site.
+ 	static uint32_t registerSite(const char* name, InstrumentKind kind);
+
+ 	/// Enables recording, and if \p trace is true, also buffers each record as
+ 	/// a trace event for the Chrome trace exporter.
+ 	/// \param trace If trace events are buffered.
+ 	static void enable(bool trace = false) {
+ 		Tracing.store(trace, std::memory_order_relaxed);
+ 		Enabled.store(true, std::memory_order_relaxed);
+ 	}
+
+ 	/// Disables recording.
+ 	static void disable() {
+ 		Enabled.store(false, std::memory_order_relaxed);
+ 		Tracing.store(false, std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns true if recording is enabled.
+ 	static bool enabled() {
+ 		return Enabled.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Records a duration for the timer \p site, starting at \p startNs and
+ 	/// ending at \p endNs.
+ 	/// \param site    The identifier of the site.
+ 	/// \param startNs The start of the duration.
+ 	/// \param endNs   The end of the duration.
+ 	static void recordTime(uint32_t site, uint64_t startNs, uint64_t endNs);
+
+ 	/// Records \p value for the counter or value \p site.
+ 	/// \param site  The identifier of the site.
+ 	/// \param value The increment or sample to record.
+ 	static void record(uint32_t site, uint64_t value);
+
+ 	/// Returns a snapshot of the records of all sites. This can be called from
+ 	/// any thread while records are being made.
+ 	static InstrumentSnapshot snapshot();
+
+ 	/// Writes the buffered trace events of all threads to \p path in the Chrome
+ 	/// trace event format, which can be loaded by chrome://tracing and
+ 	/// Perfetto, removing them from the buffers. Returns false if the file
+ 	/// could not be written.
+ 	/// \param path The path of the file to write.
+ 	static bool writeChromeTrace(const char* path);
+
+ private:
+ 	/// If recording is enabled.
+ 	static inline std::atomic<bool> Enabled{false};
+ 	/// If trace events are buffered.
+ 	static inline std::atomic<bool> Tracing{false};
+};
+
+/// The ScopedTimer class records the time from its construction to its
+/// destruction for a timer site, if recording was enabled when it was
+/// constructed.
+class ScopedTimer {
+ public:
+ 	/// Constructor -- starts the timer for \p site.
+ 	/// \param site The identifier of the timer site.
+ 	explicit ScopedTimer(uint32_t site)
+ 	: Site(site), StartNs(Instrumentation::enabled() ? monotonicTimeNs() : 0) {}
+
+ 	/// Destructor -- records the duration.
+ 	~ScopedTimer() {
+ 		if (StartNs) {
+ 			Instrumentation::recordTime(Site, StartNs, monotonicTimeNs());
+ 		}
+ 	}
+
+ 	/// Copy constructor -- deleted since the timer is tied to a scope.
+ 	ScopedTimer(const ScopedTimer&) = delete;
+ 	/// Copy assignment -- deleted since the timer is tied to a scope.
+ 	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+ 	uint32_t Site;		//!< The identifier of the site.
+ 	uint64_t StartNs;	//!< The start time, or 0 if not recording.
+};
+
+} // namespace Voxx::Lumos
+
+#define VOXX_LUMOS_CONCAT_IMPL(A, B) A##B
+#define VOXX_LUMOS_CONCAT(A, B)      VOXX_LUMOS_CONCAT_IMPL(A, B)
+
+#if defined(VOXX_LUMOS_INSTRUMENT)
+
+/// Defines a site with a name and kind, which is registered the first time
+/// the site is reached.
+#define VOXX_LUMOS_SITE(VAR, NAME, KIND)                                        \
+  static const uint32_t VAR =                                                  \
+    ::Voxx::Lumos::Instrumentation::registerSite(                              \
+      NAME, ::Voxx::Lumos::InstrumentKind::KIND)
+
+/// Times the rest of the enclosing scope as the timer NAME.
+#define VOXX_LUMOS_TIMED_SCOPE(NAME)                                           \
+  VOXX_LUMOS_SITE(VOXX_LUMOS_CONCAT(lumosSite, __LINE__), NAME, Timer);        \
+  ::Voxx::Lumos::ScopedTimer VOXX_LUMOS_CONCAT(lumosTimer, __LINE__)(          \
+    VOXX_LUMOS_CONCAT(lumosSite, __LINE__))
+
+/// Adds AMOUNT to the counter NAME.
+#define VOXX_LUMOS_COUNT(NAME, AMOUNT)                                         \
+  do {                                                                         \
+    if (::Voxx::Lumos::Instrumentation::enabled()) {                           \
+      VOXX_LUMOS_SITE(lumosSite, NAME, Counter);                               \
+      ::Voxx::Lumos::Instrumentation::record(lumosSite, (AMOUNT));             \
+    }                                                                          \
+  } while (false)
+
+/// Records VALUE as a sample of the value NAME.
+#define VOXX_LUMOS_VALUE(NAME, VALUE)                                          \
+  do {                                                                         \
+    if (::Voxx::Lumos::Instrumentation::enabled()) {                           \
+      VOXX_LUMOS_SITE(lumosSite, NAME, Value);                                 \
+      ::Voxx::Lumos::Instrumentation::record(lumosSite, (VALUE));              \
+    }                                                                          \
+  } while (false)
+
+#else
+
+#define VOXX_LUMOS_TIMED_SCOPE(NAME)   static_cast<void>(0)
+#define VOXX_LUMOS_COUNT(NAME, AMOUNT) static_cast<void>(0)
+#define VOXX_LUMOS_VALUE(NAME, VALUE)  static_cast<void>(0)
+
+#endif // VOXX_LUMOS_INSTRUMENT
+
+#endif // VOXEL_LUMOS_UTILITY_INSTRUMENTATION_HPP
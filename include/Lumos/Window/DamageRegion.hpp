@@ -0,0 +1,213 @@
+//==--- Lumos/Window/DamageRegion.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  DamageRegion.hpp
+/// \brief This file defines a region of a window which needs to be presented,
+///        as a small bounded set of rectangles.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_WINDOW_DAMAGE_REGION_HPP
+#define VOXEL_LUMOS_WINDOW_DAMAGE_REGION_HPP
+
+#include <Lumos/Geometry/Rect.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace Voxx::Lumos {
+
+/// The DamageRegion class accumulates the parts of a window which need to be
+/// presented, from the rectangles the server reports as exposed and the
+/// rectangles the application redraws, so that a window which mostly does not
+/// change only presents the pixels which did.
+///
+/// The region is kept as at most maxRects rectangles, clipped to the bounds of
+/// the window. When a rectangle is added it is merged with the rectangle whose
+/// bounding box wastes the fewest pixels, if merging them does not cover more
+/// than mergeSlack pixels which are in neither, since presenting a few extra
+/// pixels is cheaper than another present. The merged rectangle is merged again
+/// until nothing more can be, so the rectangles never overlap by more than the
+/// slack. If the region is full, the cheapest merge is made regardless.
+///
+/// The rectangles are stored as separate arrays of their edges, so the cost of
+/// merging with every rectangle is a single branch free pass which the
+/// compiler vectorizes.
+class DamageRegion {
+ public:
+ 	/// Defines the maximum number of rectangles in the region.
+ 	static constexpr std::size_t maxRects   = 8;
+ 	/// Defines the number of pixels outside two rectangles which merging them
+ 	/// may cover, which is roughly the cost of presenting another rectangle.
+ 	static constexpr int32_t     mergeSlack = 4096;
+
+ 	/// Constructor -- creates an empty region with the largest bounds.
+ 	DamageRegion() = default;
+
+ 	/// Constructor -- creates an empty region for a window of \p bounds.
+ 	/// \param bounds The extent of the window.
+ 	explicit DamageRegion(Extent2d bounds)
+ 	: Width(bounds.width), Height(bounds.height) {}
+
+ 	/// Sets the bounds of the region to \p bounds, clipping the rectangles
+ 	/// which are already in it.
+ 	/// \param bounds The extent of the window.
+ 	void setBounds(Extent2d bounds) {
+ 		Width  = bounds.width;
+ 		Height = bounds.height;
+ 		for (std::size_t i = Count; i-- > 0; ) {
+ 			Right[i]  = std::min(Right[i] , Width );
+ 			Bottom[i] = std::min(Bottom[i], Height);
+ 			if (Left[i] >= Right[i] || Top[i] >= Bottom[i]) {
+ 				remove(i);
+ 			}
+ 		}
+ 	}
+
+ 	/// Returns the bounds of the region.
+ 	Extent2d bounds() const {
+ 		return Extent2d{static_cast<int16_t>(Width),
+ 		                static_cast<int16_t>(Height)};
+ 	}
+
+ 	/// Adds \p rect to the region, clipped to the bounds.
+ 	/// \param rect The rectangle to add.
+ 	void add(const Rect2d& rect) {
+ 		int32_t left   = std::max<int32_t>(rect.x, 0);
+ 		int32_t top    = std::max<int32_t>(rect.y, 0);
+ 		int32_t right  = std::min<int32_t>(rect.x + rect.extent.width , Width );
+ 		int32_t bottom = std::min<int32_t>(rect.y + rect.extent.height, Height);
+ 		if (left >= right || top >= bottom) {
+ 			return;
+ 		}
+
+ 		while (Count != 0) {
+ 			const auto area = (right - left) * (bottom - top);
+ 			int32_t    cost[maxRects];
+ 			for (std::size_t i = 0; i < maxRects; ++i) {
+ 				const auto width  = std::max(Right[i] , right ) -
+ 				                    std::min(Left[i]  , left  );
+ 				const auto height = std::max(Bottom[i], bottom) -
+ 				                    std::min(Top[i]   , top   );
+ 				const auto waste  = width * height - area -
+ 				                    (Right[i] - Left[i]) * (Bottom[i] - Top[i]);
+ 				cost[i] = i < Count ? waste : std::numeric_limits<int32_t>::max();
+ 			}
+ 			const auto best = static_cast<std::size_t>(
+ 				std::min_element(cost, cost + maxRects) - cost);
+ 			if (cost[best] > mergeSlack && Count < maxRects) {
+ 				break;
+ 			}
+ 			left   = std::min(left  , Left[best]  );
+ 			top    = std::min(top   , Top[best]   );
+ 			right  = std::max(right , Right[best] );
+ 			bottom = std::max(bottom, Bottom[best]);
+ 			remove(best);
+ 		}
+ 		Left[Count]   = left;
+ 		Top[Count]    = top;
+ 		Right[Count]  = right;
+ 		Bottom[Count] = bottom;
+ 		++Count;
+ 	}
+
+ 	/// Adds the rectangles of \p other to the region.
+ 	/// \param other The region to add.
+ 	void add(const DamageRegion& other) {
+ 		for (std::size_t i = 0; i < other.size(); ++i) {
+ 			add(other[i]);
+ 		}
+ 	}
+
+ 	/// Adds the whole of the bounds to the region.
+ 	void addAll() {
+ 		clear();
+ 		add(Rect2d{0, 0, bounds()});
+ 	}
+
+ 	/// Removes every rectangle from the region.
+ 	void clear() {
+ 		Count = 0;
+ 	}
+
+ 	/// Returns true if the region has no rectangles.
+ 	bool empty() const {
+ 		return Count == 0;
+ 	}
+
+ 	/// Returns the number of rectangles in the region.
+ 	std::size_t size() const {
+ 		return Count;
+ 	}
+
+ 	/// Returns the rectangle at \p index, which must be less than size().
+ 	/// \param index The index of the rectangle.
+ 	Rect2d operator[](std::size_t index) const {
+ 		const auto width  = Right[index]  - Left[index];
+ 		const auto height = Bottom[index] - Top[index];
+ 		return Rect2d{static_cast<int16_t>(Left[index]),
+ 		              static_cast<int16_t>(Top[index]) ,
+ 		              Extent2d{static_cast<int16_t>(width) ,
+ 		                       static_cast<int16_t>(height)}};
+ 	}
+
+ 	/// Returns the number of pixels which presenting the region covers.
+ 	int64_t area() const {
+ 		int64_t total = 0;
+ 		for (std::size_t i = 0; i < Count; ++i) {
+ 			total += static_cast<int64_t>(Right[i] - Left[i]) *
+ 			         (Bottom[i] - Top[i]);
+ 		}
+ 		return total;
+ 	}
+
+ 	/// Returns the smallest rectangle which contains the region, which is empty
+ 	/// if the region is.
+ 	Rect2d boundingRect() const {
+ 		if (Count == 0) {
+ 			return Rect2d{0, 0, Extent2d{0, 0}};
+ 		}
+ 		const auto left   = *std::min_element(Left  , Left   + Count);
+ 		const auto top    = *std::min_element(Top   , Top    + Count);
+ 		const auto right  = *std::max_element(Right , Right  + Count);
+ 		const auto bottom = *std::max_element(Bottom, Bottom + Count);
+ 		return Rect2d{static_cast<int16_t>(left), static_cast<int16_t>(top),
+ 		              Extent2d{static_cast<int16_t>(right  - left),
+ 		                       static_cast<int16_t>(bottom - top )}};
+ 	}
+
+ private:
+ 	/// Defines the largest bound, for regions which are not clipped.
+ 	static constexpr int32_t maxBound = std::numeric_limits<int16_t>::max();
+
+ 	// Unused entries always hold edges within the largest bounds, so that the
+ 	// merge pass can read every entry without producing values which overflow.
+ 	alignas(16) int32_t Left[maxRects]   = {};	//!< Left edges.
+ 	alignas(16) int32_t Top[maxRects]    = {};	//!< Top edges.
+ 	alignas(16) int32_t Right[maxRects]  = {};	//!< Right edges, exclusive.
+ 	alignas(16) int32_t Bottom[maxRects] = {};	//!< Bottom edges, exclusive.
+ 	std::size_t         Count  = 0;							//!< Number of rectangles.
+ 	int32_t             Width  = maxBound;			//!< Width of the bounds.
+ 	int32_t             Height = maxBound;			//!< Height of the bounds.
+
+ 	/// Removes the rectangle at \p index by moving the last rectangle into it.
+ 	/// \param index The index of the rectangle to remove.
+ 	void remove(std::size_t index) {
+ 		--Count;
+ 		Left[index]   = Left[Count];
+ 		Top[index]    = Top[Count];
+ 		Right[index]  = Right[Count];
+ 		Bottom[index] = Bottom[Count];
+ 	}
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_DAMAGE_REGION_HPP
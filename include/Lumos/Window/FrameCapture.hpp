@@ -0,0 +1,112 @@
+//==--- Lumos/Window/FrameCapture.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  FrameCapture.hpp
+/// \brief This file defines a capture of the frames of a window which reads
+///        them back asynchronously and writes them to a file on a thread.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_WINDOW_FRAME_CAPTURE_HPP
+#define VOXEL_LUMOS_WINDOW_FRAME_CAPTURE_HPP
+
+#include <Lumos/Event/EventQueue.hpp>
+#include <cstddef>
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// Defines the formats which captured frames can be written in.
+enum class CaptureFormat : uint8_t {
+	Raw = 0,	//!< BGRA pixels, 4 bytes each, top row first, with no header.
+	Y4m = 1		//!< YUV4MPEG2 with 4:2:0 full range chroma, 1.5 bytes a pixel.
+};
+
+/// The CaptureRequest struct defines how the frames of a window are captured.
+struct CaptureRequest {
+	/// The path of the file to write the frames to, which is replaced.
+	const char*    path           = nullptr;
+	/// The format to write the frames in.
+	CaptureFormat  format         = CaptureFormat::Y4m;
+	/// The number of pixel buffers which frames are read back into, so each
+	/// frame is read back this many frames behind the one being rendered.
+	uint32_t       readbackFrames = 3;
+	/// The number of frames which can be waiting for the writer.
+	uint32_t       queuedFrames   = 8;
+	/// What happens to a frame which has been read back when the writer has
+	/// fallen behind and the queue is full. Block waits for the writer, so no
+	/// frame is dropped but rendering stalls.
+	OverflowPolicy dropPolicy     = OverflowPolicy::CountAndDrop;
+	/// The frame rate which is written in the Y4M header.
+	uint32_t       frameRate      = 60;
+};
+
+/// The FrameCapture class captures the frames of a window to a file without
+/// stalling the render thread on the GPU or the disk.
+///
+/// Each call to capture() starts reading the back buffer into the next of a
+/// ring of pixel buffer objects and inserts a fence, and then copies out each
+/// earlier readback whose fence has signalled, without waiting. A readback
+/// only has to finish within readbackFrames frames, so the transfer overlaps
+/// rendering. If every buffer is still being read, the frame is dropped.
+///
+/// Frames which have been read back are queued for a writer thread, which
+/// converts them to the capture format and writes them. When the writer has
+/// fallen behind and the queue is full, the dropPolicy decides which frame is
+/// dropped. Every dropped frame is counted.
+///
+/// Frames have the extent which the window had when the capture was created.
+class FrameCapture {
+ public:
+ 	/// Destructor -- waits for the readbacks which are in flight, writes every
+ 	/// queued frame, and closes the file. This must be called on the render
+ 	/// thread, before the window is destroyed.
+ 	~FrameCapture();
+
+ 	/// Copy constructor -- deleted since the capture owns its thread.
+ 	FrameCapture(const FrameCapture&) = delete;
+ 	/// Copy assignment -- deleted since the capture owns its thread.
+ 	FrameCapture& operator=(const FrameCapture&) = delete;
+
+ 	/// Starts reading back the frame in the back buffer, and queues the earlier
+ 	/// frames whose readback has finished for the writer. This must be called
+ 	/// on the render thread once the frame has been rendered, before the
+ 	/// buffers are swapped. Returns false if the frame was dropped because
+ 	/// every pixel buffer is still being read.
+ 	bool capture();
+
+ 	/// Returns the number of frames which have been read back.
+ 	uint64_t capturedFrames() const;
+
+ 	/// Returns the number of frames which have been written to the file.
+ 	uint64_t writtenFrames() const;
+
+ 	/// Returns the number of frames which have been dropped, either because
+ 	/// every pixel buffer was being read or because the writer fell behind.
+ 	uint64_t droppedFrames() const;
+
+ private:
+ 	/// The Resource struct holds the pixel buffers, the queue of frames and
+ 	/// the writer.
+ 	struct Resource;
+
+ 	/// Constructor -- creates the capture from its resources.
+ 	/// \param resource The pixel buffers, queue and writer.
+ 	explicit FrameCapture(Resource* resource) : Handle(resource) {}
+
+ 	Resource* Handle = nullptr;	//!< The pixel buffers, queue and writer.
+
+ 	/// Allows windows to create captures.
+ 	friend class WindowXcb;
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_FRAME_CAPTURE_HPP
@@ -0,0 +1,97 @@
+//==--- Lumos/Window/FramebufferConfig.hpp ----------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  FramebufferConfig.hpp
+/// \brief This file defines types for selecting a framebuffer configuration.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_WINDOW_FRAMEBUFFER_CONFIG_HPP
+#define VOXEL_LUMOS_WINDOW_FRAMEBUFFER_CONFIG_HPP
+
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// The FramebufferRequest struct defines the properties which are requested
+/// for the framebuffer of a window. The requested bit counts are minimums, and
+/// of the configurations which meet them the one closest to the request is
+/// chosen.
+struct FramebufferRequest {
+	uint8_t colorBits    = 8;			//!< Bits for each of red, green and blue.
+	uint8_t alphaBits    = 0;			//!< Bits for alpha.
+	uint8_t depthBits    = 24;		//!< Bits for depth.
+	uint8_t stencilBits  = 8;			//!< Bits for stencil.
+	uint8_t samples      = 0;			//!< Multisample count, 0 for none.
+	bool    doubleBuffer = true;	//!< If the framebuffer is double buffered.
+	/// If configurations which the implementation marks as slow, and those
+	/// with multisampling when none was requested, are rejected rather than
+	/// only being ranked below the others.
+	bool    avoidCostly  = true;
+	/// If the chosen configuration is cached on disk and reused by later
+	/// launches on the same display, screen and driver.
+	bool    useCache     = true;
+};
+
+/// The FramebufferAttributes struct defines the properties of an available
+/// framebuffer configuration.
+struct FramebufferAttributes {
+	int  red           = 0;				//!< Bits for red.
+	int  green         = 0;				//!< Bits for green.
+	int  blue          = 0;				//!< Bits for blue.
+	int  alpha         = 0;				//!< Bits for alpha.
+	int  depth         = 0;				//!< Bits for depth.
+	int  stencil       = 0;				//!< Bits for stencil.
+	int  samples       = 0;				//!< Multisample count.
+	bool doubleBuffer  = false;		//!< If the config is double buffered.
+	bool renderable    = false;		//!< If windows can be rendered to.
+	bool slow          = false;		//!< If the config is marked as slow.
+	bool nonConformant = false;		//!< If the config is non-conformant.
+};
+
+/// Returns the penalty for using a framebuffer with \p attributes to satisfy
+/// \p request, where a lower penalty is a better match, or -1 if the
+/// framebuffer does not satisfy the request. Missing bits reject the
+/// framebuffer, while unneeded bits, and unneeded features which cost memory
+/// bandwidth, add to the penalty.
+/// \param request    The requested framebuffer properties.
+/// \param attributes The properties of the framebuffer.
+constexpr int framebufferPenalty(const FramebufferRequest&    request   ,
+                                 const FramebufferAttributes& attributes) {
+	if (!attributes.renderable                              ||
+	    attributes.doubleBuffer != request.doubleBuffer     ||
+	    attributes.red     < request.colorBits              ||
+	    attributes.green   < request.colorBits              ||
+	    attributes.blue    < request.colorBits              ||
+	    attributes.alpha   < request.alphaBits              ||
+	    attributes.depth   < request.depthBits              ||
+	    attributes.stencil < request.stencilBits            ||
+	    attributes.samples < request.samples                ||
+	    (request.avoidCostly && attributes.slow)            ||
+	    (request.avoidCostly && request.samples == 0 &&
+	     attributes.samples > 0)) {
+		return -1;
+	}
+
+	int penalty = 0;
+	penalty += (attributes.red + attributes.green + attributes.blue -
+	            3 * request.colorBits) * 4;
+	penalty += (attributes.alpha   - request.alphaBits  ) * 8;
+	penalty += (attributes.depth   - request.depthBits  ) * 2;
+	penalty += (attributes.stencil - request.stencilBits) * 2;
+	penalty += (attributes.samples - request.samples    ) * 64;
+	penalty += attributes.slow          ? 1024 : 0;
+	penalty += attributes.nonConformant ? 256  : 0;
+	return penalty;
+}
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_FRAMEBUFFER_CONFIG_HPP
@@ -0,0 +1,100 @@
+//==--- Lumos/Window/GlUploadQueue.hpp --------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  GlUploadQueue.hpp
+/// \brief This file defines a queue of OpenGL uploads which are performed by
+///        worker threads with contexts which share objects with a window.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_WINDOW_GL_UPLOAD_QUEUE_HPP
+#define VOXEL_LUMOS_WINDOW_GL_UPLOAD_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// The GlUploadQueue class runs OpenGL upload jobs, such as filling textures
+/// and buffers, on worker threads so that they do not block the render
+/// thread. Each worker has its own context, which shares objects with the
+/// context of the window the queue was created for, and is current on a small
+/// pbuffer, or on no drawable if the framebuffer configuration has no
+/// pbuffers.
+///
+/// After each upload the worker inserts a fence and flushes. The render thread
+/// calls collect() once per frame, which invokes the completion of each job
+/// whose fence has signalled, without waiting, so the render thread only ever
+/// uses objects which are fully uploaded. If the context does not support
+/// fences, the worker finishes the upload before it is completed instead.
+///
+/// Jobs are run in the order they are submitted, but with more than one worker
+/// they may complete in a different order.
+class GlUploadQueue {
+ public:
+ 	/// Defines the type of the functions of a job, which are invoked with the
+ 	/// context of the job.
+ 	using JobFn = void (*)(void* context);
+
+ 	/// Defines the default number of jobs which can be waiting to run.
+ 	static constexpr std::size_t defaultCapacity = 256;
+
+ 	/// Destructor -- waits for the jobs which are running, discards the jobs
+ 	/// which have not run, and destroys the worker contexts. This must be
+ 	/// called on the render thread, before the window is destroyed.
+ 	~GlUploadQueue();
+
+ 	/// Copy constructor -- deleted since the queue owns its threads.
+ 	GlUploadQueue(const GlUploadQueue&) = delete;
+ 	/// Copy assignment -- deleted since the queue owns its threads.
+ 	GlUploadQueue& operator=(const GlUploadQueue&) = delete;
+
+ 	/// Submits a job which invokes \p upload with \p context on a worker, and
+ 	/// then \p complete with \p context on the thread which calls collect(),
+ 	/// once the upload has finished on the GPU. Returns false if the queue
+ 	/// already has as many jobs waiting as its capacity.
+ 	/// \param upload   The function which performs the upload.
+ 	/// \param complete The function which takes the uploaded objects.
+ 	/// \param context  The context for the functions.
+ 	bool submit(JobFn upload, JobFn complete, void* context);
+
+ 	/// Invokes the completion of each job whose upload has finished on the GPU,
+ 	/// and returns the number of jobs which were completed. This never waits,
+ 	/// and must be called from the render thread.
+ 	std::size_t collect();
+
+ 	/// Returns the number of jobs which have been submitted and have not been
+ 	/// completed.
+ 	std::size_t pending() const;
+
+ 	/// Returns the number of worker threads.
+ 	std::size_t workerCount() const;
+
+ 	/// Returns true if completion waits on fences, rather than the workers
+ 	/// finishing each upload.
+ 	bool usesFences() const;
+
+ private:
+ 	/// The Resource struct holds the workers and the queues of jobs.
+ 	struct Resource;
+
+ 	/// Constructor -- creates the queue from its resources.
+ 	/// \param resource The workers and queues.
+ 	explicit GlUploadQueue(Resource* resource) : Handle(resource) {}
+
+ 	Resource* Handle = nullptr;	//!< The workers and queues.
+
+ 	/// Allows windows to create queues.
+ 	friend class WindowXcb;
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_GL_UPLOAD_QUEUE_HPP
@@ -0,0 +1,75 @@
+//==--- Lumos/Window/ResizePolicy.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  ResizePolicy.hpp
+/// \brief This file defines the policy for reallocating the buffers of a
+///        window when it is resized.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_WINDOW_RESIZE_POLICY_HPP
+#define VOXEL_LUMOS_WINDOW_RESIZE_POLICY_HPP
+
+#include <Lumos/Geometry/Extent.hpp>
+#include <cstdint>
+
+namespace Voxx::Lumos {
+
+/// The ResizePolicy struct defines when the buffers of a window are
+/// reallocated as the window is resized. Buffers which are at least as large
+/// as the window are reused, and only the part which covers the window is
+/// presented, so that an interactive resize does not allocate every frame.
+struct ResizePolicy {
+	/// The fraction of each dimension which is added to the extent of the window
+	/// when the buffers grow, so that a window which keeps growing reallocates
+	/// rarely.
+	float growHeadroom   = 0.25f;
+	/// The fraction of the area of the buffers below which the area of the
+	/// window must fall before the buffers are shrunk.
+	float shrinkFraction = 0.25f;
+};
+
+/// Returns the extent of the buffers to use for a window of \p extent with
+/// buffers of \p capacity, as decided by \p policy. If the result is equal to
+/// \p capacity the buffers are reused.
+/// \param policy   The policy for reallocation.
+/// \param capacity The extent of the current buffers.
+/// \param extent   The extent of the window.
+constexpr Extent2d resizedCapacity(const ResizePolicy& policy  ,
+                                   Extent2d            capacity,
+                                   Extent2d            extent  ) {
+	const bool fits = extent.width  <= capacity.width &&
+	                  extent.height <= capacity.height;
+	const auto area = static_cast<float>(extent.width) * extent.height;
+	const auto capacityArea =
+		static_cast<float>(capacity.width) * capacity.height;
+	if (fits && area >= policy.shrinkFraction * capacityArea) {
+		return capacity;
+	}
+
+	// Growing only adds headroom to the dimensions which grew, and shrinking
+	// keeps headroom in both so the next small increase is absorbed.
+	auto withHeadroom = [&] (int16_t length) {
+		const auto grown = length + static_cast<int>(length * policy.growHeadroom);
+		return static_cast<int16_t>(grown > INT16_MAX ? INT16_MAX : grown);
+	};
+	if (fits) {
+		return Extent2d{withHeadroom(extent.width), withHeadroom(extent.height)};
+	}
+	return Extent2d{
+		extent.width  > capacity.width  ? withHeadroom(extent.width)
+		                                : capacity.width ,
+		extent.height > capacity.height ? withHeadroom(extent.height)
+		                                : capacity.height};
+}
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_RESIZE_POLICY_HPP
@@ -14,6 +14,8 @@
 //==------------------------------------------------------------------------==//
 
 #include <memory>
+#include <Lumos/Event/EventManager.hpp>
+#include <Lumos/Frame/FrameScheduler.hpp>
 #include <Lumos/Geometry/Extent.hpp>
 
 #ifndef VOXEL_LUMOS_WINDOW_WINDOW_HPP
@@ -38,7 +40,7 @@ template <typename WindowImpl>
 class Window  {
  public:
  	/// Defines the type of pointer the implementation must return.
- 	using WindowPtr = typename WindowTraits::WindowPtr;
+ 	using WindowPtr = typename WindowTraits<WindowImpl>::WindowPtr;
 
  	/// Creates an instance of a window, passing ownership to the caller.
  	/// \param extent The extent of the window.
@@ -48,7 +50,29 @@ class Window  {
  		return windowImpl()->create(extent, title);
  	}
 
+ 	/// Polls for pending events, posting them to \p eventManager. Returns the
+ 	/// number of events which were posted.
+ 	/// \param eventManager The manager to post the events to.
+ 	std::size_t pollForEvent(EventManager& eventManager)
+ 	{
+ 		return windowImpl()->pollForEvent(eventManager);
+ 	}
+
+ 	/// Returns the scheduler which paces the frames of the window.
+ 	FrameScheduler& frameScheduler()
+ 	{
+ 		return Scheduler;
+ 	}
+
+ 	/// Returns the scheduler which paces the frames of the window.
+ 	const FrameScheduler& frameScheduler() const
+ 	{
+ 		return Scheduler;
+ 	}
+
  private:
+ 	FrameScheduler Scheduler;	//!< The scheduler for the frames of the window.
+
  	/// Returns a pointer to the window implementation.
  	WindowImpl* windowImpl()
  	{
@@ -0,0 +1,147 @@
+//==--- Lumos/Window/WindowHeadless.hpp -------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowHeadless.hpp
+/// \brief This file provides an implementation of the Window class which does
+///				 not require a display server.
+//
+//==------------------------------------------------------------------------==//
+
+#include <Lumos/Event/EventManager.hpp>
+#include "Window.hpp"
+#include <string>
+
+#ifndef VOXEL_LUMOS_WINDOW_WINDOW_HEADLESS_HPP
+#define VOXEL_LUMOS_WINDOW_WINDOW_HEADLESS_HPP
+
+namespace Voxx::Lumos {
+
+/// The WindowHeadless class defines an implementation of the Window interface
+/// which renders into a framebuffer in memory and receives its events through
+/// programmatic injection. Neither creating the window nor polling it for
+/// events requires a display server, so it can be used to run the Lumos event
+/// and frame loop on machines without a display, and to profile Lumos without
+/// the cost of a window system.
+class WindowHeadless : public Window<WindowHeadless> {
+ public:
+ 	/// Defines the type of the window base class.
+ 	using SelfType   = Window<WindowHeadless>;
+ 	/// Defines the type of the traits class.
+ 	using TraitsType = WindowTraits<WindowHeadless>;
+ 	/// Defines the type of the window pointer to return.
+ 	using WindowPtr  = typename TraitsType::WindowPtr;
+ 	/// Defines the type of a pixel in the framebuffer, which is 8 bits per
+ 	/// channel in BGRA order, matching the X server's 32 bit visuals.
+ 	using PixelType  = uint32_t;
+
+ 	/// Defines the maximum number of injected events which can be pending.
+ 	static constexpr std::size_t injectCapacity = 4096;
+ 	/// Defines the maximum number of events which are posted at once.
+ 	static constexpr std::size_t pollBatchSize  = 64;
+
+ 	/// Constructor -- allocates the framebuffer for the window.
+ 	/// \param extent The extent of the window.
+ 	/// \param title  The title of the window.
+ 	WindowHeadless(Extent2d extent, const char* title);
+
+ 	/// Creates a new window and returns a pointer to the newly created window.
+ 	/// Ownership of the new window is passed to the caller.
+ 	/// \param extent The extent of the window.
+ 	/// \param title  The title of the window.
+ 	/// \return A WindowPtr to the newly created window.
+ 	static WindowPtr create(Extent2d extent, const char* title);
+
+ 	/// Posts all the events which have been injected into the window to
+ 	/// \p eventManager, returning the number of events which were posted.
+ 	/// \param eventManager The manager to post the events to.
+ 	std::size_t pollForEvent(EventManager& eventManager);
+
+ 	/// Injects \p event into the window, as if it had come from a display
+ 	/// server. The time of the event should already be set. Returns false if
+ 	/// the event was dropped because too many events are pending. This can be
+ 	/// called from any thread.
+ 	/// \param event The event to inject.
+ 	bool injectEvent(const Event& event) {
+ 		return Injected.push(event);
+ 	}
+
+ 	/// Injects the \p count events in \p events into the window, and returns
+ 	/// the number of events which were injected. The times of the events should
+ 	/// already be set. This can be called from any thread.
+ 	/// \param events A pointer to the events to inject.
+ 	/// \param count  The number of events to inject.
+ 	std::size_t injectEvents(const Event* events, std::size_t count) {
+ 		return Injected.pushBatch(events, count);
+ 	}
+
+ 	/// Injects \p keyEvent into the window, with the current time. Returns
+ 	/// false if the event was dropped because too many events are pending.
+ 	/// This can be called from any thread.
+ 	/// \param keyEvent The key event to inject.
+ 	bool injectKeyEvent(const KeyEvent& keyEvent) {
+ 		return Injected.push(keyEvent.toEvent(monotonicTimeNs()));
+ 	}
+
+ 	/// Injects the \p count key events in \p keyEvents into the window, with
+ 	/// the current time, and returns the number of events which were injected.
+ 	/// This can be called from any thread.
+ 	/// \param keyEvents A pointer to the key events to inject.
+ 	/// \param count     The number of key events to inject.
+ 	std::size_t injectKeyEvents(const KeyEvent* keyEvents, std::size_t count);
+
+ 	/// Marks the contents of the framebuffer as presented and returns the number
+ 	/// of frames which have been presented.
+ 	uint64_t present() {
+ 		return ++PresentCount;
+ 	}
+
+ 	/// Returns the extent of the window.
+ 	Extent2d extent() const {
+ 		return WindowExtent;
+ 	}
+
+ 	/// Returns the title of the window.
+ 	const char* title() const {
+ 		return Title.c_str();
+ 	}
+
+ 	/// Returns a pointer to the first pixel of the framebuffer. The rows of the
+ 	/// framebuffer are stride() pixels apart.
+ 	PixelType* framebuffer() {
+ 		return Framebuffer.get();
+ 	}
+
+ 	/// Returns a pointer to the first pixel of the framebuffer.
+ 	const PixelType* framebuffer() const {
+ 		return Framebuffer.get();
+ 	}
+
+ 	/// Returns the number of pixels between the start of consecutive rows of the
+ 	/// framebuffer.
+ 	std::size_t stride() const {
+ 		return static_cast<std::size_t>(WindowExtent.width);
+ 	}
+
+ 	/// Returns the number of frames which have been presented.
+ 	uint64_t presentCount() const {
+ 		return PresentCount;
+ 	}
+
+ private:
+ 	Extent2d                     WindowExtent;				//!< The window extent.
+ 	std::string                  Title;								//!< The window title.
+ 	std::unique_ptr<PixelType[]> Framebuffer;					//!< The framebuffer.
+ 	EventQueue<Event>            Injected;						//!< Injected events.
+ 	uint64_t                     PresentCount = 0;		//!< Presented frames.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_WINDOW_HEADLESS_HPP
@@ -0,0 +1,224 @@
+//==--- Lumos/Window/WindowVulkan.hpp ---------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowVulkan.hpp
+/// \brief This file provides an implementation of the Window class which
+///        presents with a Vulkan swapchain on an XCB window.
+//
+//==------------------------------------------------------------------------==//
+
+#include <vulkan/vulkan.h>
+#include "WindowXcb.hpp"
+
+#ifndef VOXEL_LUMOS_WINDOW_WINDOW_VULKAN_HPP
+#define VOXEL_LUMOS_WINDOW_WINDOW_VULKAN_HPP
+
+namespace Voxx::Lumos {
+
+/// The PresentLatency enum defines how the present mode of a swapchain is
+/// chosen, from the modes which the surface supports.
+enum class PresentLatency : uint8_t {
+	/// Prefers mailbox, which replaces the queued image with the newest one,
+	/// then immediate, which may tear, and then FIFO.
+	Lowest    = 0,
+	/// Prefers mailbox, and otherwise uses FIFO, so frames never tear.
+	NoTearing = 1,
+	/// Always uses FIFO, so frames are paced by the display.
+	VSync     = 2
+};
+
+/// Returns the present mode to use for \p latency, of the \p count modes in
+/// \p modes which the surface supports. FIFO is always supported, so it is
+/// returned when no preferred mode is.
+/// \param modes   The present modes which the surface supports.
+/// \param count   The number of modes.
+/// \param latency How the present mode is chosen.
+constexpr VkPresentModeKHR choosePresentMode(const VkPresentModeKHR* modes  ,
+                                             uint32_t                count  ,
+                                             PresentLatency          latency) {
+	auto supports = [modes, count] (VkPresentModeKHR mode) {
+		for (uint32_t i = 0; i < count; ++i) {
+			if (modes[i] == mode) {
+				return true;
+			}
+		}
+		return false;
+	};
+	if (latency != PresentLatency::VSync &&
+	    supports(VK_PRESENT_MODE_MAILBOX_KHR)) {
+		return VK_PRESENT_MODE_MAILBOX_KHR;
+	}
+	if (latency == PresentLatency::Lowest &&
+	    supports(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+		return VK_PRESENT_MODE_IMMEDIATE_KHR;
+	}
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+/// The SwapchainRequest struct defines the properties which are requested for
+/// the swapchain of a Vulkan window.
+struct SwapchainRequest {
+	/// How the present mode is chosen.
+	PresentLatency latency        = PresentLatency::Lowest;
+	/// The number of frames which the CPU may record while the GPU is still
+	/// rendering earlier ones. More frames hide stalls, at the cost of latency.
+	uint32_t       framesInFlight = 2;
+};
+
+/// The VulkanFrame struct defines a frame which has been acquired from the
+/// swapchain of a Vulkan window for the application to record.
+struct VulkanFrame {
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;	//!< Records the frame.
+	VkImage         image         = VK_NULL_HANDLE;	//!< The swapchain image.
+	VkImageView     imageView     = VK_NULL_HANDLE;	//!< A view of the image.
+	VkExtent2D      extent        = {0, 0};					//!< The extent of the image.
+	uint32_t        imageIndex    = 0;							//!< Index of the image.
+	uint32_t        frameIndex    = 0;							//!< Index of the frame.
+};
+
+/// The WindowVulkan class defines an implementation of the Window interface
+/// which presents with a Vulkan swapchain on a VK_KHR_xcb_surface. The window
+/// itself is a WindowXcb without an OpenGL context, so events are polled and
+/// routed exactly as they are for an OpenGL window.
+///
+/// The window creates its own instance, picks the physical device which can
+/// present to the window, preferring discrete GPUs, and creates a device with
+/// one queue which both renders and presents. A software driver such as
+/// lavapipe is used when it is the only device, so the window works on
+/// machines without a GPU.
+///
+/// Each frame is recorded between beginFrame() and endFrame(). There are
+/// framesInFlight sets of a command buffer, a fence and a semaphore, which are
+/// reused in turn, so beginFrame() only waits when the CPU is that many frames
+/// ahead of the GPU. The functions which are called each frame are loaded from
+/// the device, so they skip the loader's dispatch.
+///
+/// The swapchain is recreated before the next frame when a poll finds that
+/// the window has been resized, or when the surface reports that it is out of
+/// date.
+class WindowVulkan : public Window<WindowVulkan> {
+ public:
+ 	/// Defines the type of the window base class.
+ 	using SelfType      = Window<WindowVulkan>;
+ 	/// Defines the type of the traits class.
+ 	using TraitsType    = WindowTraits<WindowVulkan>;
+ 	/// Defines the type of the window pointer to return.
+ 	using WindowPtr     = typename TraitsType::WindowPtr;
+ 	/// Defines the type of a pointer to the shared connection.
+ 	using ConnectionPtr = XcbConnection::ConnectionPtr;
+
+ 	/// Defines the maximum number of frames in flight.
+ 	static constexpr uint32_t maxFramesInFlight = 4;
+
+ 	/// Destructor -- waits for the device to be idle and destroys all of the
+ 	/// Vulkan objects, and then the window.
+ 	~WindowVulkan();
+
+ 	/// Creates a new window and returns a pointer to the newly created window.
+ 	/// Ownership of the new window is passed to the caller. The window uses
+ 	/// the connection to the default display which is shared by all windows
+ 	/// created this way.
+ 	/// \param extent  The extent of the window.
+ 	/// \param title   The title of the window.
+ 	/// \param request The requested swapchain properties.
+ 	/// \return A WindowPtr to the newly created window, or a null pointer if
+ 	///         the window or its swapchain could not be created.
+ 	static WindowPtr create(Extent2d                extent ,
+ 	                        const char*             title  ,
+ 	                        const SwapchainRequest& request = {});
+
+ 	/// Creates a new window on \p connection and returns a pointer to the newly
+ 	/// created window. Ownership of the new window is passed to the caller.
+ 	/// \param connection The connection to create the window on.
+ 	/// \param extent     The extent of the window.
+ 	/// \param title      The title of the window.
+ 	/// \param request    The requested swapchain properties.
+ 	/// \return A WindowPtr to the newly created window, or a null pointer if
+ 	///         the window or its swapchain could not be created.
+ 	static WindowPtr create(ConnectionPtr           connection,
+ 	                        Extent2d                extent    ,
+ 	                        const char*             title     ,
+ 	                        const SwapchainRequest& request = {});
+
+ 	/// Polls for all pending events, posting them to \p eventManager, as
+ 	/// WindowXcb::pollForEvent() does. If the window has been resized, the
+ 	/// swapchain is recreated before the next frame. Returns the number of
+ 	/// events which were posted.
+ 	/// \param eventManager The manager to post the events to.
+ 	std::size_t pollForEvent(EventManager& eventManager);
+
+ 	/// Waits until the frame which last used the next set of frame resources
+ 	/// has finished on the GPU, acquires the next image of the swapchain, and
+ 	/// begins the frame's command buffer. Returns the frame to record, or a
+ 	/// null pointer if no image can be acquired, such as when the window is
+ 	/// minimized. The image's contents are undefined, and the commands must
+ 	/// leave it in VK_IMAGE_LAYOUT_PRESENT_SRC_KHR.
+ 	const VulkanFrame* beginFrame();
+
+ 	/// Ends the command buffer of the frame returned by beginFrame(), submits
+ 	/// it once the image has been acquired, and presents the image once it has
+ 	/// been rendered. Returns false if there is no such frame or the submit
+ 	/// failed.
+ 	bool endFrame();
+
+ 	/// Waits until the device has finished all of the submitted frames.
+ 	void waitIdle();
+
+ 	/// Returns the XCB window, for event handling such as the input thread.
+ 	WindowXcb& xcbWindow();
+
+ 	/// Returns the extent of the window, as of the last poll.
+ 	Extent2d extent() const;
+
+ 	/// Returns the instance of the window.
+ 	VkInstance instance() const;
+
+ 	/// Returns the physical device which renders to the window.
+ 	VkPhysicalDevice physicalDevice() const;
+
+ 	/// Returns the device which renders to the window.
+ 	VkDevice device() const;
+
+ 	/// Returns the queue which frames are submitted and presented on.
+ 	VkQueue queue() const;
+
+ 	/// Returns the family of the queue.
+ 	uint32_t queueFamily() const;
+
+ 	/// Returns the format of the swapchain images.
+ 	VkFormat imageFormat() const;
+
+ 	/// Returns the present mode which was chosen for the swapchain.
+ 	VkPresentModeKHR presentMode() const;
+
+ 	/// Returns the number of images in the swapchain.
+ 	uint32_t imageCount() const;
+
+ 	/// Returns the number of frames which may be in flight.
+ 	uint32_t framesInFlight() const;
+
+ 	/// Returns the number of times the swapchain has been recreated.
+ 	uint64_t swapchainRecreations() const;
+
+ private:
+ 	/// The Resource struct holds the Vulkan objects of the window.
+ 	struct Resource;
+
+ 	/// Constructor -- creates the window from the XCB window it presents to.
+ 	/// \param window The XCB window.
+ 	explicit WindowVulkan(WindowXcb::WindowPtr window);
+
+ 	WindowXcb::WindowPtr Native;						//!< The XCB window.
+ 	Resource*            Handle = nullptr;	//!< The Vulkan objects.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_WINDOW_VULKAN_HPP
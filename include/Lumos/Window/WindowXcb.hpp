@@ -14,26 +14,81 @@
 //
 //==------------------------------------------------------------------------==//
 
-#include <X11/Xlib.h>
+#include <Lumos/Event/EventManager.hpp>
+#include <Lumos/Event/PointerCoalescer.hpp>
+#include "DamageRegion.hpp"
+#include "FrameCapture.hpp"
+#include "FramebufferConfig.hpp"
+#include "GlUploadQueue.hpp"
+#include "ResizePolicy.hpp"
 #include "Window.hpp"
+#include "XcbConnection.hpp"
 
 #ifndef VOXEL_LUMOS_WINDOW_WINDOW_XCB_HPP
 #define VOXEL_LUMOS_WINDOW_WINDOW_XCB_HPP
 
+// The library is built as C++17, so the awaitable is only available to code
+// which is compiled with coroutine support, and is defined in this header.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+	#include <coroutine>
+	#define VOXX_LUMOS_COROUTINES 1
+#endif
+
 namespace Voxx::Lumos {
 
 /// The WindowXcb class defines an implementation of the Window interface by
-/// using the XCB library for window related functionality.
-class WindowXcb : Window<WindowXcb> {
+/// using the XCB library for window related functionality. Windows share an
+/// XcbConnection, which reads the events for all of its windows and routes
+/// them to each window's queue.
+///
+/// Pointer motion is coalesced between polls, as set by setMotionCoalescing(),
+/// so by default each poll posts at most one MouseDelta and one MouseMove
+/// event however fast the mouse reports motion.
+///
+/// The window only asks the server for the kinds of events which the manager
+/// it polls into is subscribed to, and updates its event mask at the first
+/// poll after the subscriptions change, so events which nobody handles, such
+/// as pointer motion, are never sent. Configure events are always selected,
+/// since the window tracks its own extent.
+///
+/// Resizes are also coalesced between polls, so each poll posts at most one
+/// Resize event with the latest extent of the window. The software
+/// framebuffers are resized lazily, when the next one is acquired, and are
+/// only reallocated when the ResizePolicy requires it. The GLX drawable
+/// follows the extent of the X window, so it never needs to be reallocated.
+///
+/// The window accumulates its damage(), the parts which need to be presented,
+/// starting with the whole window when it is created, from the expose events
+/// of each poll, the whole window when it is resized, and whatever the
+/// application adds. Presenting a DamageRegion only sends its rectangles to
+/// the server, so a window which mostly does not change costs a fraction of a
+/// full present. Expose events are always selected, so that the damage is
+/// kept whatever the manager is subscribed to, and each poll coalesces them
+/// to one Exposure event with the extent of the exposed area.
+class WindowXcb : public Window<WindowXcb> {
  public:
  	/// Defines the type of the window base class.
  	using SelfType   = Window<WindowXcb>;
  	/// Defines the type of the traits class.
- 	using TraitsType = WindowTraits<SelfType>;
+ 	using TraitsType = WindowTraits<WindowXcb>;
  	/// Defines the type of the window pointer to return.
  	using WindowPtr  = typename TraitsType::WindowPtr;
- 	/// Defines the type of the event to handle.
- 	using EventType  = typename TratisType::EventType;
+ 	/// Defines the type of a pointer to the shared connection.
+ 	using ConnectionPtr = XcbConnection::ConnectionPtr;
+ 	/// Defines the type of a callback which is invoked when events have been
+ 	/// routed to the window.
+ 	using ReadyCallback = XcbConnection::ReadyCallback;
+ 	/// Defines the type of a pixel in a software framebuffer, which is 8 bits
+ 	/// per channel in the server's native order for 24 bit visuals.
+ 	using PixelType  = uint32_t;
+
+ 	/// Defines the maximum number of events which are posted at once.
+ 	static constexpr std::size_t pollBatchSize      = 64;
+ 	/// Defines the number of events which can be routed to the window before the
+ 	/// render thread drains them.
+ 	static constexpr std::size_t eventQueueCapacity = 256;
+ 	/// Defines the maximum number of software framebuffers.
+ 	static constexpr std::size_t maxSoftwareBuffers = 3;
 
  	/// Constructor -- creates the necessary resources.
  	WindowXcb();
@@ -43,13 +98,224 @@ class WindowXcb : Window<WindowXcb> {
 
  	/// Creates a new window and returns a pointer to the newly created window.
  	/// Ownership of the new window is passed to the caller.
- 	/// \param extent The extent of the window.
- 	/// \param title  The title of the window.
- 	/// \return A WindowPtr to the newly created window.
- 	WindowPtr create(Extent2d extent, const char* title);
+ 	/// The window uses the connection to the default display which is shared
+ 	/// by all windows created this way.
+ 	/// \param extent  The extent of the window.
+ 	/// \param title   The title of the window.
+ 	/// \param request The requested framebuffer properties.
+ 	/// \return A WindowPtr to the newly created window, or a null pointer if
+ 	///         the window could not be created.
+ 	static WindowPtr create(Extent2d                  extent ,
+ 	                        const char*               title  ,
+ 	                        const FramebufferRequest& request = {});
+
+ 	/// Creates a new window on \p connection and returns a pointer to the newly
+ 	/// created window. Ownership of the new window is passed to the caller.
+ 	/// \param connection The connection to create the window on.
+ 	/// \param extent     The extent of the window.
+ 	/// \param title      The title of the window.
+ 	/// \param request    The requested framebuffer properties.
+ 	/// \return A WindowPtr to the newly created window, or a null pointer if
+ 	///         the window could not be created.
+ 	static WindowPtr create(ConnectionPtr             connection,
+ 	                        Extent2d                  extent    ,
+ 	                        const char*               title     ,
+ 	                        const FramebufferRequest& request = {});
+
+ 	/// Polls for all pending events, converting them to Lumos events and posting
+ 	/// them to \p eventManager in batches. No memory is allocated per event.
+ 	/// Returns the number of events which were posted. If the kinds of events
+ 	/// \p eventManager is subscribed to have changed, the event mask of the
+ 	/// window is updated first.
+ 	///
+ 	/// This reads the pending events for every window on the connection, and
+ 	/// then posts the events which were routed to this window. If the input
+ 	/// thread is running, this does not touch the connection and instead drains
+ 	/// the events which the input thread has already routed.
+ 	/// \param eventManager The manager to post the events to.
+ 	std::size_t pollForEvent(EventManager& eventManager);
+
+ 	/// Returns the file descriptor of the window's connection, which becomes
+ 	/// readable when the server sends events. An application with its own
+ 	/// reactor waits for it with the rest of its I/O, and calls pollForEvent()
+ 	/// (or the connection's pollEvents()) when it is readable, instead of
+ 	/// polling every frame.
+ 	int fileDescriptor() const;
+
+ 	/// Sets the callback which is invoked with \p context whenever a poll of the
+ 	/// window's connection routes events to the window, or removes it if
+ 	/// \p callback is null. The callback is invoked on the polling thread after
+ 	/// routing has finished, so it may poll the window. It is not invoked while
+ 	/// the input thread is running, since the input thread routes the events.
+ 	/// \param callback The callback to invoke.
+ 	/// \param context  The context to invoke the callback with.
+ 	void setReadyCallback(ReadyCallback callback, void* context = nullptr);
+
+#if defined(VOXX_LUMOS_COROUTINES)
+ 	/// The EventAwaitable class defines the awaitable returned by nextEvents().
+ 	class EventAwaitable;
+
+ 	/// Returns an awaitable which polls for events and, if there are none,
+ 	/// suspends the awaiting coroutine until the connection routes events to
+ 	/// the window, then resumes it with the batch of events drained from
+ 	/// \p eventManager:
+ 	///
+ 	/// \code
+ 	/// const auto& events = co_await window.nextEvents(eventManager);
+ 	/// \endcode
+ 	///
+ 	/// The coroutine is resumed from the thread which polls the connection,
+ 	/// normally a reactor which calls pollEvents() when fileDescriptor() is
+ 	/// readable, so the input thread must not be running. The batch is valid
+ 	/// until the next drain of \p eventManager.
+ 	///
+ 	/// The awaitable uses the window's ready callback, so only one awaitable
+ 	/// for a window may be outstanding at a time, and no other ready callback
+ 	/// may be set while it is. A coroutine which is suspended on it may be
+ 	/// destroyed, which removes the callback, but only on the thread which
+ 	/// polls the connection.
+ 	/// \param eventManager The manager to post and drain the events with.
+ 	EventAwaitable nextEvents(EventManager& eventManager);
+#endif
+
+ 	/// Starts a dedicated input thread for the window's connection which blocks
+ 	/// on the connection, reads events as soon as they arrive, and stamps each
+ 	/// one with the server time and the local monotonic time at which it was
+ 	/// read. The events are handed to the thread which calls pollForEvent() or
+ 	/// pollTimedEvents() through the window's queue, which the input thread is
+ 	/// the only producer for, so pushes never retry. Returns false if the thread
+ 	/// is already running.
+ 	bool startInputThread();
+
+ 	/// Stops the input thread, if it is running, and waits for it to finish.
+ 	void stopInputThread();
+
+ 	/// Returns true if the input thread is running.
+ 	bool hasInputThread() const;
+
+ 	/// Pops up to \p maxCount events which have been routed to the window into
+ 	/// \p events, keeping their timestamps, and returns the number of events
+ 	/// which were popped. Pointer events are not routed through this queue.
+ 	/// \param events   A pointer to the storage for the events.
+ 	/// \param maxCount The maximum number of events to pop.
+ 	std::size_t pollTimedEvents(TimedEvent* events, std::size_t maxCount);
+
+ 	/// Sets how pointer motion is coalesced between polls.
+ 	/// \param mode How pointer motion is coalesced.
+ 	void setMotionCoalescing(MotionCoalescing mode);
+
+ 	/// Returns how pointer motion is coalesced between polls.
+ 	MotionCoalescing motionCoalescing() const;
+
+ 	/// Returns the number of pointer motion samples which have been read for
+ 	/// the window, before coalescing.
+ 	uint64_t pointerSamples() const;
+
+ 	/// Returns the number of events which have been dropped because they were
+ 	/// not drained quickly enough.
+ 	uint64_t droppedTimedEvents() const;
+
+ 	/// Returns the connection which the window belongs to.
+ 	const ConnectionPtr& connection() const;
+
+ 	/// Returns the X identifier of the window, which other clients can use to
+ 	/// send events to it.
+ 	uint32_t nativeWindow() const;
+
+ 	/// Returns the extent of the window, as of the last poll.
+ 	Extent2d extent() const;
+
+ 	/// Sets the policy for reallocating the software framebuffers when the
+ 	/// window is resized.
+ 	/// \param policy The policy for reallocation.
+ 	void setResizePolicy(const ResizePolicy& policy);
+
+ 	/// Returns the policy for reallocating the software framebuffers when the
+ 	/// window is resized.
+ 	const ResizePolicy& resizePolicy() const;
+
+ 	/// Returns the parts of the window which need to be presented, which each
+ 	/// poll adds the exposed parts of the window to. The application adds the
+ 	/// parts it redraws, and clears the region once it has presented it.
+ 	DamageRegion& damage();
+
+ 	/// Returns the parts of the window which need to be presented.
+ 	const DamageRegion& damage() const;
+
+ 	/// Presents the back buffer of the OpenGL drawable.
+ 	void swapBuffers();
+
+ 	/// Presents the parts of the back buffer of the OpenGL drawable in
+ 	/// \p region, leaving the rest of the window as it is, which requires the
+ 	/// GLX_MESA_copy_sub_buffer extension. Unlike a swap this copies, so the
+ 	/// back buffer keeps its contents and the next frame only needs to redraw
+ 	/// its damage. Without the extension this is a full swap.
+ 	/// \param region The parts of the window to present.
+ 	void swapBuffers(const DamageRegion& region);
+
+ 	/// Returns true if swapBuffers() can present part of the window.
+ 	bool hasPartialSwap() const;
+
+ 	/// Creates a queue of uploads which are performed by \p workerCount worker
+ 	/// threads, each with a context which shares objects with the window's
+ 	/// context, so that loading textures and buffers does not block rendering.
+ 	/// This must be called on the thread where the window's context is current,
+ 	/// which is the thread which created the window, and the queue must be
+ 	/// destroyed on that thread before the window is. Returns a null pointer if
+ 	/// the worker contexts could not be created.
+ 	/// \param workerCount The number of worker threads.
+ 	/// \param capacity    The number of jobs which can be waiting to run.
+ 	std::unique_ptr<GlUploadQueue> createUploadQueue(
+ 		std::size_t workerCount = 1                             ,
+ 		std::size_t capacity    = GlUploadQueue::defaultCapacity);
 
- 	/// Polls for an event.
- 	Event pollForEvent();
+ 	/// Creates a capture which writes the frames of the window to the file in
+ 	/// \p request, reading them back asynchronously so that capturing never
+ 	/// waits for the GPU. This must be called on the thread where the window's
+ 	/// context is current, and the capture must be destroyed on that thread
+ 	/// before the window is. Returns a null pointer if the file could not be
+ 	/// opened or the context has no pixel buffers or fences.
+ 	/// \param request How the frames are captured.
+ 	std::unique_ptr<FrameCapture> createFrameCapture(
+ 		const CaptureRequest& request);
+
+ 	/// Enables presenting frames which are rendered by the CPU. The framebuffers
+ 	/// are allocated in shared memory and presented with the MIT-SHM extension
+ 	/// so that no pixels are copied through the socket. If the extension is not
+ 	/// available the framebuffers are allocated in client memory and presented
+ 	/// with put image requests which are split to fit the maximum request
+ 	/// length. Returns false if the framebuffers could not be created.
+ 	/// \param bufferCount The number of framebuffers to rotate through, which
+ 	///                    is clamped to [2, maxSoftwareBuffers].
+ 	bool enableSoftwarePresent(std::size_t bufferCount = 2);
+
+ 	/// Returns a pointer to the first pixel of a framebuffer which the CPU can
+ 	/// render the next frame into, or a null pointer if software presentation
+ 	/// is not enabled. If the server is still reading every framebuffer this
+ 	/// waits until the oldest one has been read. Rows are softwareStride()
+ 	/// pixels apart, and only the part which covers the extent of the window is
+ 	/// presented. If the window has been resized, the framebuffers are resized
+ 	/// first, which may change the stride.
+ 	PixelType* acquireSoftwareBuffer();
+
+ 	/// Presents the framebuffer which was returned by the last call to
+ 	/// acquireSoftwareBuffer(). Returns false if there is no such framebuffer.
+ 	bool presentSoftwareBuffer();
+
+ 	/// Presents the parts in \p region of the framebuffer which was returned by
+ 	/// the last call to acquireSoftwareBuffer(), leaving the rest of the window
+ 	/// as it is. Every rectangle of \p region must have been drawn into that
+ 	/// framebuffer, but the rest of it need not be, so each frame only needs to
+ 	/// redraw its damage. Returns false if there is no such framebuffer.
+ 	/// \param region The parts of the window to present.
+ 	bool presentSoftwareBuffer(const DamageRegion& region);
+
+ 	/// Returns the number of pixels between the start of consecutive rows of the
+ 	/// software framebuffers, which is at least the width of the window.
+ 	std::size_t softwareStride() const;
+
+ 	/// Returns true if software presentation uses shared memory.
+ 	bool usesSharedMemory() const;
 
  private:
  	/// The WindowResource struct holds the window API resources required by this
@@ -60,16 +326,136 @@ class WindowXcb : Window<WindowXcb> {
  	/// the window.
  	struct GraphicsResource;
 
+ 	/// The SoftwareResource struct holds the framebuffers used to present frames
+ 	/// rendered by the CPU.
+ 	struct SoftwareResource;
+
  	/// A poitner to the window resources.
  	WindowResource*   WindowHandle 	= nullptr;
  	/// A pointer to the graphics resources.
  	GraphicsResource* GfxHandle 	 	= nullptr;
+ 	/// A pointer to the software presentation resources, if enabled.
+ 	SoftwareResource* SoftwareHandle = nullptr;
+
+ 	/// Creates a new window on \p connection which has no OpenGL context, for
+ 	/// windows which present with another API, such as Vulkan. Only the event
+ 	/// handling of such a window may be used.
+ 	/// \param connection The connection to create the window on.
+ 	/// \param extent     The extent of the window.
+ 	/// \param title      The title of the window.
+ 	static WindowPtr createNative(ConnectionPtr connection,
+ 	                              Extent2d      extent    ,
+ 	                              const char*   title     );
+
+ 	/// Creates a new window on \p connection, with an OpenGL context for
+ 	/// \p request if it is not null.
+ 	/// \param connection The connection to create the window on.
+ 	/// \param extent     The extent of the window.
+ 	/// \param title      The title of the window.
+ 	/// \param request    The requested framebuffer properties, if any.
+ 	static WindowPtr createWith(ConnectionPtr             connection,
+ 	                            Extent2d                  extent    ,
+ 	                            const char*               title     ,
+ 	                            const FramebufferRequest* request   );
+
+ 	/// Sets up the window, returning true if the setup was successful. If
+ 	/// \p request is null, the window has no OpenGL context. The requests which
+ 	/// create the window are pipelined, so the only round trips are those which
+ 	/// GLX makes for the context.
+ 	/// \param extent  The extent of the window.
+ 	/// \param title   The title of the window.
+ 	/// \param request The requested framebuffer properties, if any.
+ 	bool setup(Extent2d                  extent ,
+ 	           const char*               title  ,
+ 	           const FramebufferRequest* request);
+
+ 	/// Allocates the software framebuffers with the extent \p capacity, in
+ 	/// shared memory if it is being used and in client memory otherwise.
+ 	/// \param capacity The extent of the framebuffers.
+ 	void allocateSoftwareBuffers(Extent2d capacity);
+
+ 	/// Resizes the software framebuffers to the extent of the window, only
+ 	/// reallocating them if the resize policy requires it.
+ 	void resizeSoftwareBuffers();
+
+ 	/// Selects the X events which are needed to post the kinds of events in
+ 	/// \p kinds, if they are not already selected.
+ 	/// \param kinds The kinds of events to select.
+ 	void selectEvents(EventKindMask kinds);
+
+ 	/// Releases the software presentation resources, if there are any.
+ 	void destroySoftwarePresent();
 
- 	/// Sets up the window.
- 	/// \param extent The extent of the window.
- 	void setup(Extent2d extent);
+ 	/// Allows Vulkan windows to create windows without OpenGL contexts.
+ 	friend class WindowVulkan;
 };
 
+#if defined(VOXX_LUMOS_COROUTINES)
+
+class WindowXcb::EventAwaitable {
+ public:
+ 	/// Constructor -- creates the awaitable for \p window.
+ 	/// \param window       The window to wait for events for.
+ 	/// \param eventManager The manager to post and drain the events with.
+ 	EventAwaitable(WindowXcb& window, EventManager& eventManager)
+ 	: Target(window), Manager(eventManager) {}
+
+ 	/// Destructor -- removes the ready callback if the awaitable is destroyed
+ 	/// while its coroutine is suspended, such as when the coroutine is
+ 	/// destroyed without being resumed, so that it is never resumed through a
+ 	/// dangling awaitable.
+ 	~EventAwaitable() {
+ 		if (Registered) {
+ 			Target.setReadyCallback(nullptr, nullptr);
+ 		}
+ 	}
+
+ 	/// Polls the window, returning true if there are events to drain, in which
+ 	/// case the coroutine is not suspended.
+ 	bool await_ready() {
+ 		return Target.pollForEvent(Manager) != 0 || Manager.pendingEvents() != 0;
+ 	}
+
+ 	/// Suspends the coroutine for \p handle until events are routed to the
+ 	/// window.
+ 	/// \param handle The handle of the suspended coroutine.
+ 	void await_suspend(std::coroutine_handle<> handle) {
+ 		Handle     = handle;
+ 		Registered = true;
+ 		Target.setReadyCallback(&EventAwaitable::resume, this);
+ 	}
+
+ 	/// Posts the events which were routed to the window and returns the batch
+ 	/// of events drained from the manager.
+ 	const EventBatch& await_resume() {
+ 		Target.pollForEvent(Manager);
+ 		return Manager.drainEvents();
+ 	}
+
+ private:
+ 	WindowXcb&              Target;				//!< The window to wait for.
+ 	EventManager&           Manager;			//!< The manager to drain.
+ 	std::coroutine_handle<> Handle;				//!< The suspended coroutine.
+ 	bool                    Registered = false;	//!< If the callback is set.
+
+ 	/// Resumes the coroutine which is waiting on the awaitable in \p context,
+ 	/// after removing the callback so it is only resumed once.
+ 	/// \param context The awaitable.
+ 	static void resume(void* context) {
+ 		auto* awaitable = static_cast<EventAwaitable*>(context);
+ 		awaitable->Target.setReadyCallback(nullptr, nullptr);
+ 		awaitable->Registered = false;
+ 		awaitable->Handle.resume();
+ 	}
+};
+
+inline WindowXcb::EventAwaitable
+WindowXcb::nextEvents(EventManager& eventManager) {
+	return EventAwaitable(*this, eventManager);
+}
+
+#endif // VOXX_LUMOS_COROUTINES
+
 } // namespace Voxx::Lumos
 
 #endif // VOXEL_LUMOS_WINDOW_WINDOW_XCB_HPP
@@ -0,0 +1,290 @@
+//==--- Lumos/Window/XcbConnection.hpp --------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  XcbConnection.hpp
+/// \brief This file defines a connection to an X server which is shared by
+///				 XCB windows.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_WINDOW_XCB_CONNECTION_HPP
+#define VOXEL_LUMOS_WINDOW_XCB_CONNECTION_HPP
+
+#include <Lumos/Event/EventQueue.hpp>
+#include <Lumos/Event/PointerCoalescer.hpp>
+#include <Lumos/Utility/FlatIdMap.hpp>
+#include "DamageRegion.hpp"
+#include "XcbKeymap.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Voxx::Lumos {
+
+/// The XcbConnection class defines a connection to an X server which is shared
+/// by any number of XCB windows. The connection reads the events for all of
+/// its windows at once and routes each event to the queue of the window it
+/// belongs to, using a flat hash map keyed by the X window identifier, so an
+/// application with many windows has a single socket and a single place where
+/// events are read.
+///
+/// Key codes are translated to keys by position with a constant table. The
+/// keyboard mapping of the server is read when the connection is opened and
+/// again whenever the server reports a mapping change, so no key is ever
+/// translated with a request. The release which core autorepeat sends before
+/// each repeated press of a held key is dropped as it is routed.
+///
+/// The connection can be driven by an external reactor instead of polling or
+/// an input thread: the reactor waits for fileDescriptor() to be readable and
+/// then calls pollEvents(), which invokes the ready callback of each window
+/// which events were routed to.
+///
+/// Configure events are coalesced to the latest extent of each window, which
+/// the window takes once per poll, and expose events are merged into a damage
+/// region for each window, which the window takes with takeExposed().
+///
+/// Pointer motion is routed to each window's PointerCoalescer rather than its
+/// queue, so that a high rate mouse costs a fixed amount per frame. Buttons
+/// and scrolling are routed to the queue, in the order in which they arrive
+/// with the other discrete events, and the motion which preceded each one is
+/// moved from the coalescer to the queue ahead of it. If the
+/// server supports XInput2 and a window uses it, unaccelerated raw motion is
+/// read from the device with its sub-pixel precision and routed to the window
+/// which contains the pointer; otherwise the relative motion is derived from
+/// the core motion events.
+class XcbConnection {
+ public:
+ 	/// Defines the type of a pointer to a shared connection.
+ 	using ConnectionPtr = std::shared_ptr<XcbConnection>;
+ 	/// Defines the type of the identifier of an X window.
+ 	using WindowId      = uint32_t;
+ 	/// Defines the type of the queue of events for a window.
+ 	using WindowQueue   = EventQueue<TimedEvent>;
+ 	/// Defines the type of a pointer to a keymap.
+ 	using KeymapPtr     = std::shared_ptr<const XcbKeymap>;
+ 	/// Defines the type of a callback which is invoked with its context when
+ 	/// events have been routed to a window.
+ 	using ReadyCallback = void (*)(void* context);
+
+ 	/// The WindowRoute struct defines where the events for a window are routed.
+ 	struct WindowRoute {
+ 		WindowQueue*      events  = nullptr;	//!< Queue for discrete events.
+ 		PointerCoalescer* pointer = nullptr;	//!< Coalescer for pointer events.
+ 		int16_t           x       = 0;				//!< Last core pointer x position.
+ 		int16_t           y       = 0;				//!< Last core pointer y position.
+ 		bool              entered = false;		//!< If the position is valid.
+ 		bool              pending = false;		//!< If ready is to be invoked.
+ 		ReadyCallback     ready   = nullptr;	//!< Invoked when events arrive.
+ 		void*             context = nullptr;	//!< The context for ready.
+
+ 		/// The latest extent the window was configured to, with the width in the
+ 		/// low and the height in the high 16 bits, or zero if the window has not
+ 		/// been configured since the extent was last taken. Only the latest extent
+ 		/// is kept, so any number of configure events between polls result in a
+ 		/// single resize.
+ 		std::atomic<uint32_t> extent{0};
+ 		/// The parts of the window which have been exposed since they were last
+ 		/// taken, which are guarded by the route mutex.
+ 		DamageRegion          exposed;
+ 		/// If exposed has any rectangles, so that a window which has not been
+ 		/// exposed does not need to take the mutex.
+ 		std::atomic<bool>     hasExposed{false};
+ 	};
+
+ 	/// Defines the maximum number of events which are routed at once.
+ 	static constexpr std::size_t pollBatchSize = 64;
+
+ 	/// The ConnectionResource struct holds the X resources for the connection.
+ 	struct ConnectionResource;
+
+ 	/// Opens a new connection to the display named \p displayName, or to the
+ 	/// default display if \p displayName is null. Returns a null pointer if the
+ 	/// display could not be opened.
+ 	/// \param displayName The name of the display to connect to.
+ 	static ConnectionPtr open(const char* displayName = nullptr);
+
+ 	/// Returns the connection to the default display which is shared by every
+ 	/// window created without an explicit connection, opening it if there is no
+ 	/// such connection alive.
+ 	static ConnectionPtr shared();
+
+ 	/// Destructor -- stops the input thread and closes the connection.
+ 	~XcbConnection();
+
+ 	/// Copy constructor -- deleted since the connection owns the X connection.
+ 	XcbConnection(const XcbConnection&) = delete;
+ 	/// Copy assignment -- deleted since the connection owns the X connection.
+ 	XcbConnection& operator=(const XcbConnection&) = delete;
+
+ 	/// Routes the events for \p window to \p route, which must remain valid
+ 	/// until the window is removed.
+ 	/// \param window The X window to route the events for.
+ 	/// \param route  Where to route the events to.
+ 	void addWindow(WindowId window, WindowRoute* route);
+
+ 	/// Stops routing events for \p window. When this returns, the window's queue
+ 	/// is not being accessed by the connection and will not be again.
+ 	/// \param window The X window to stop routing the events for.
+ 	void removeWindow(WindowId window);
+
+ 	/// Sets the callback which is invoked with \p context when events have been
+ 	/// routed to \p window by pollEvents(), or removes it if \p callback is
+ 	/// null. The callback is invoked at most once per poll, after routing has
+ 	/// finished, on the thread which polled, so it may poll again. It is not
+ 	/// invoked for the events routed by the input thread.
+ 	/// \param window   The X window to set the callback for.
+ 	/// \param callback The callback to invoke.
+ 	/// \param context  The context to invoke the callback with.
+ 	void setReadyCallback(WindowId      window  ,
+ 	                      ReadyCallback callback,
+ 	                      void*         context );
+
+ 	/// Adds the parts of \p window which have been exposed since they were last
+ 	/// taken to \p damage, returning false if there are none.
+ 	/// \param window The X window to take the exposed parts of.
+ 	/// \param damage The region to add the exposed parts to.
+ 	bool takeExposed(WindowId window, DamageRegion& damage);
+
+ 	/// Reads all the pending events from the server and routes each one to the
+ 	/// queue of its window, then invokes the ready callbacks of the windows
+ 	/// which events were routed to. Returns the number of events which were
+ 	/// routed. If another thread is already polling this returns immediately,
+ 	/// and that thread reads the connection again before it returns, since it
+ 	/// routes the events for every window. Only another poll, and not the
+ 	/// other uses of the routes, makes this return early.
+ 	///
+ 	/// This also routes the events which libxcb has already read from the
+ 	/// socket while waiting for a reply, which would not make the file
+ 	/// descriptor readable again, so a reactor should call this before it
+ 	/// waits.
+ 	std::size_t pollEvents();
+
+ 	/// Returns the file descriptor of the connection, which becomes readable
+ 	/// when the server sends events, for waiting on with a reactor such as
+ 	/// epoll.
+ 	int fileDescriptor() const;
+
+ 	/// Starts a dedicated input thread which blocks on the connection, reads
+ 	/// events as soon as they arrive, and routes them to their windows' queues.
+ 	/// Returns false if the thread is already running.
+ 	bool startInputThread();
+
+ 	/// Stops the input thread, if it is running, and waits for it to finish.
+ 	void stopInputThread();
+
+ 	/// Returns true if the input thread is running.
+ 	bool hasInputThread() const {
+ 		return InputHandle != nullptr;
+ 	}
+
+ 	/// Returns the number of windows which events are routed to.
+ 	std::size_t windowCount() const;
+
+ 	/// Returns the keyboard mapping of the server, as of the last mapping change
+ 	/// which was routed. This is safe to call from any thread, and the returned
+ 	/// keymap remains valid while it is held.
+ 	KeymapPtr keymap() const {
+ 		return std::atomic_load(&Keymap);
+ 	}
+
+ 	/// Returns true if the server supports XInput2 raw motion.
+ 	bool hasRawMotion() const;
+
+ 	/// Adds a user of raw motion if \p use is true, and removes one otherwise.
+ 	/// Raw motion is only selected while it has users, and while it is not the
+ 	/// relative motion is derived from core motion events. Returns false if the
+ 	/// server does not support raw motion.
+ 	/// \param use If a user is added.
+ 	bool useRawMotion(bool use);
+
+ 	/// Returns the number of events which did not belong to any window.
+ 	uint64_t unroutedEvents() const {
+ 		return Unrouted.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns the number of round trips to the server which have been made
+ 	/// through the connection by Lumos, which are the times it has waited for
+ 	/// replies. Requests whose replies are collected together are one round
+ 	/// trip, so once the display is open the connection costs one more, or two
+ 	/// if the server has XInput, and creating a window costs none beyond those
+ 	/// which GLX makes for its context.
+ 	uint64_t roundTrips() const {
+ 		return RoundTrips.load(std::memory_order_relaxed);
+ 	}
+
+ 	/// Returns the X resources for the connection.
+ 	ConnectionResource* resource() const {
+ 		return Handle;
+ 	}
+
+ private:
+ 	/// The InputThread struct holds the state of the dedicated input thread.
+ 	struct InputThread;
+
+ 	/// Constructor -- creates an unconnected connection.
+ 	XcbConnection();
+
+ 	/// Reads all the pending events from the server and routes them, and loads
+ 	/// the keymap if a mapping change was routed. The poll mutex must be held.
+ 	/// Returns the number of events which were routed.
+ 	std::size_t readEvents();
+
+ 	/// Invokes the ready callbacks of the windows which events have been routed
+ 	/// to since they were last invoked. The route mutex must not be held.
+ 	void notifyReady();
+
+ 	/// Sends the request for the keyboard mapping, without waiting for the
+ 	/// reply, and returns the sequence number of the request.
+ 	unsigned int requestKeymap();
+
+ 	/// Waits for the reply to the keyboard mapping request with \p sequence and
+ 	/// replaces the keymap with it.
+ 	/// \param sequence The sequence number returned by requestKeymap().
+ 	void loadKeymap(unsigned int sequence);
+
+ 	/// Takes the keyboard mapping request which was sent while routing a
+ 	/// mapping change, setting \p sequence to its sequence number. Returns
+ 	/// false if there is no such request. The route mutex must be held, and the
+ 	/// reply must be loaded with loadKeymap() once it has been released, since
+ 	/// waiting for it is a round trip.
+ 	/// \param sequence Set to the sequence number of the request.
+ 	bool takeKeymapRequest(unsigned int& sequence);
+
+ 	/// Counts a round trip to the server.
+ 	void countRoundTrip();
+
+ 	/// Routes the \p count XCB events in \p events, which were read at the local
+ 	/// monotonic time \p readNs, to their windows and frees them. The route
+ 	/// mutex must be held. Returns the number of events which were routed.
+ 	/// \param events A pointer to the XCB events to route.
+ 	/// \param count  The number of events to route.
+ 	/// \param readNs The time the events were read.
+ 	std::size_t routeEvents(void* const* events, std::size_t count,
+ 	                        uint64_t readNs);
+
+ 	ConnectionResource*    Handle         = nullptr;	//!< The X resources.
+ 	InputThread*           InputHandle    = nullptr;	//!< The input thread.
+ 	FlatIdMap<WindowRoute> Routes;										//!< Window routes.
+ 	WindowId               PointerTarget  = 0;				//!< Window with pointer.
+ 	std::size_t            RawMotionUsers = 0;				//!< Raw motion users.
+ 	KeymapPtr              Keymap;										//!< Keyboard mapping.
+ 	std::vector<WindowId>  ReadyWindows;							//!< Windows to notify.
+ 	mutable std::mutex     RouteMutex;						//!< Guards routing.
+ 	std::mutex             PollMutex;							//!< Held while polling.
+ 	std::atomic<bool>      PollRequested{false};		//!< If a poll must read again.
+ 	std::atomic<uint64_t>  Unrouted{0};						//!< Unrouted events.
+ 	std::atomic<uint64_t>  RoundTrips{0};					//!< Replies waited for.
+ 	unsigned int           KeymapSequence = 0;				//!< Pending keymap request.
+ 	bool                   KeymapPending  = false;		//!< If it is pending.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_XCB_CONNECTION_HPP
@@ -0,0 +1,144 @@
+//==--- Lumos/Window/XcbKeymap.hpp ------------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  XcbKeymap.hpp
+/// \brief This file defines a cached copy of the keyboard mapping of an X
+///        server, which gives the symbols of the current layout.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_WINDOW_XCB_KEYMAP_HPP
+#define VOXEL_LUMOS_WINDOW_XCB_KEYMAP_HPP
+
+#include <Lumos/Event/KeycodesXcb.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Voxx::Lumos {
+
+/// The XcbKeymap class holds a copy of the keyboard mapping of an X server,
+/// which maps keys to the symbols they produce with the current layout. Keys
+/// are translated by position with a table, so that bindings such as WASD do
+/// not depend on the layout, and the keymap is only needed to display the
+/// symbol of a key or to find the key which produces a symbol, for example for
+/// text shortcuts.
+///
+/// The keymap is read once when the connection is opened, and is only read
+/// again when the server reports that the mapping changed, so no lookup ever
+/// makes a request. A keymap is never modified once it is built, so it can be
+/// shared by any number of threads.
+class XcbKeymap {
+ public:
+ 	/// Defines the type of a symbol, which is an X keysym.
+ 	using SymbolType = uint32_t;
+
+ 	/// Defines the number of shift levels which are kept for each key.
+ 	static constexpr std::size_t levelCount = 2;
+
+ 	/// Defines the symbol for no symbol.
+ 	static constexpr SymbolType noSymbol = 0;
+
+ 	/// Constructor -- creates an empty keymap.
+ 	XcbKeymap() = default;
+
+ 	/// Constructor -- creates the keymap from the keyboard mapping returned by
+ 	/// the server, which has \p symbolsPerKeycode symbols for each of the
+ 	/// \p keycodeCount key codes from \p firstKeycode.
+ 	/// \param symbols           The symbols of the keyboard mapping.
+ 	/// \param symbolsPerKeycode The number of symbols for each key code.
+ 	/// \param firstKeycode      The first key code in the mapping.
+ 	/// \param keycodeCount      The number of key codes in the mapping.
+ 	/// \param generation        The number of times the keymap has been read.
+ 	XcbKeymap(const SymbolType* symbols          ,
+ 	          std::size_t       symbolsPerKeycode,
+ 	          std::size_t       firstKeycode     ,
+ 	          std::size_t       keycodeCount     ,
+ 	          uint64_t          generation       )
+ 	: Generation(generation) {
+ 		const auto levels = std::min(symbolsPerKeycode, levelCount);
+ 		for (std::size_t i = 0; i < keycodeCount; ++i) {
+ 			const auto keycode = firstKeycode + i;
+ 			if (keycode >= xcbKeycodeCount) {
+ 				break;
+ 			}
+ 			for (std::size_t level = 0; level < levels; ++level) {
+ 				Symbols[keycode][level] = symbols[i * symbolsPerKeycode + level];
+ 			}
+ 			// A key with a single symbol produces it at every level.
+ 			if (levels == 2 && Symbols[keycode][1] == noSymbol) {
+ 				Symbols[keycode][1] = Symbols[keycode][0];
+ 			}
+ 		}
+
+ 		// The inverse is sorted by symbol so that finding the key for a symbol is
+ 		// a binary search. Keys earlier in the table win for duplicate symbols.
+ 		for (std::size_t keycode = 0; keycode < xcbKeycodeCount; ++keycode) {
+ 			const auto key = translateXcbKeycode(static_cast<uint8_t>(keycode));
+ 			for (std::size_t level = 0; key != KeyEventKind::Unknown &&
+ 			                            level < levelCount; ++level) {
+ 				if (Symbols[keycode][level] != noSymbol) {
+ 					Keys.push_back({Symbols[keycode][level], key});
+ 				}
+ 			}
+ 		}
+ 		std::stable_sort(Keys.begin(), Keys.end(),
+ 			[] (const SymbolKey& a, const SymbolKey& b) {
+ 				return a.symbol < b.symbol;
+ 			});
+ 	}
+
+ 	/// Returns the symbol which \p key produces at the shift \p level with the
+ 	/// current layout, or noSymbol if it produces none.
+ 	/// \param key   The key to get the symbol for.
+ 	/// \param level The shift level, which is 0 or 1.
+ 	SymbolType symbol(KeyEventKind key, std::size_t level = 0) const {
+ 		const auto keycode = xcbKeycodeOf(key);
+ 		return keycode && level < levelCount
+ 		     ? Symbols[keycode][level] : noSymbol;
+ 	}
+
+ 	/// Returns the key which produces \p symbol at any level with the current
+ 	/// layout, or KeyEventKind::Unknown if no key produces it.
+ 	/// \param symbol The symbol to find the key for.
+ 	KeyEventKind key(SymbolType symbol) const {
+ 		const auto found = std::lower_bound(Keys.begin(), Keys.end(), symbol,
+ 			[] (const SymbolKey& entry, SymbolType value) {
+ 				return entry.symbol < value;
+ 			});
+ 		return found != Keys.end() && found->symbol == symbol
+ 		     ? found->key : KeyEventKind::Unknown;
+ 	}
+
+ 	/// Returns the number of times the keymap has been read before this one,
+ 	/// which changes whenever the mapping changes.
+ 	uint64_t generation() const {
+ 		return Generation;
+ 	}
+
+ private:
+ 	/// The SymbolKey struct maps a symbol to the key which produces it.
+ 	struct SymbolKey {
+ 		SymbolType   symbol;	//!< The symbol.
+ 		KeyEventKind key;			//!< The key which produces the symbol.
+ 	};
+
+ 	/// Defines the type of the symbols for a key code.
+ 	using LevelSymbols = std::array<SymbolType, levelCount>;
+
+ 	std::array<LevelSymbols, xcbKeycodeCount> Symbols    = {};	//!< By key code.
+ 	std::vector<SymbolKey>                    Keys;						//!< By symbol.
+ 	uint64_t                                  Generation = 0;		//!< Generation.
+};
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_XCB_KEYMAP_HPP
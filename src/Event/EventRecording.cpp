@@ -0,0 +1,273 @@
+//==--- Lumos/Event/EventRecording.cpp --------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventRecording.cpp
+/// \brief This is the implementation file for event recording and replay.
+//
+//==------------------------------------------------------------------------==//
+
+#include <Lumos/Event/EventManager.hpp>
+#include <Lumos/Event/EventRecording.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Voxx::Lumos {
+
+namespace {
+
+/// Writes \p size bytes from \p data to \p fileDescriptor, retrying partial
+/// writes and writes which were interrupted by a signal. Returns false if the
+/// write failed.
+/// \param fileDescriptor The file to write to.
+/// \param data           The data to write.
+/// \param size           The number of bytes to write.
+bool writeAll(int fileDescriptor, const void* data, std::size_t size) {
+	const auto* bytes = static_cast<const char*>(data);
+	while (size > 0) {
+		const auto written = ::write(fileDescriptor, bytes, size);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		bytes += written;
+		size  -= static_cast<std::size_t>(written);
+	}
+	return true;
+}
+
+} // namespace anonymous
+
+//==--- EventRecorder ------------------------------------------------------==//
+
+EventRecorder::EventRecorder()
+: Buffer(new RecordEntry[bufferedRecords]) {}
+
+EventRecorder::~EventRecorder() {
+	close();
+}
+
+bool EventRecorder::open(const char* path) {
+	close();
+	FileDescriptor = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (FileDescriptor < 0) {
+		fprintf(stderr, "Failed to open event recording %s!\n", path);
+		return false;
+	}
+
+	RecordingHeader header;
+	memcpy(header.magic, RecordingHeader::magicValue, sizeof(header.magic));
+	header.version  = RecordingHeader::currentVersion;
+	header.reserved = 0;
+	header.startNs  = monotonicTimeNs();
+	if (!writeAll(FileDescriptor, &header, sizeof(header))) {
+		fprintf(stderr, "Failed to write event recording header!\n");
+		close();
+		return false;
+	}
+	LastTimeUs  = header.startNs / 1000;
+	RecordCount = 0;
+	return true;
+}
+
+void EventRecorder::recordEvents(const Event* events,
+                                 std::size_t  count ,
+                                 uint64_t     timeNs) {
+	if (!isOpen() || count == 0) {
+		return;
+	}
+	auto delta = advanceTo(timeNs);
+	for (std::size_t i = 0; i < count; ++i) {
+		append(RecordEntry{Event(events[i].kind(), events[i].action(),
+		                         events[i].payload(), delta)});
+		delta = 0;
+	}
+}
+
+void EventRecorder::flush() {
+	if (isOpen() && BufferedCount > 0) {
+		if (!writeAll(FileDescriptor, Buffer.get(),
+		              BufferedCount * sizeof(RecordEntry))) {
+			fprintf(stderr, "Failed to write event recording!\n");
+		}
+	}
+	BufferedCount = 0;
+}
+
+void EventRecorder::close() {
+	if (!isOpen()) {
+		return;
+	}
+	flush();
+	::close(FileDescriptor);
+	FileDescriptor = -1;
+}
+
+void EventRecorder::append(const RecordEntry& entry) {
+	Buffer[BufferedCount++] = entry;
+	++RecordCount;
+	if (BufferedCount == bufferedRecords) {
+		flush();
+	}
+}
+
+uint16_t EventRecorder::advanceTo(uint64_t timeNs) {
+	const auto timeUs = timeNs / 1000;
+	auto       delta  = timeUs > LastTimeUs ? timeUs - LastTimeUs : 0;
+	LastTimeUs        = timeUs > LastTimeUs ? timeUs : LastTimeUs;
+
+	// Gaps which are too long for the compact time of an event are recorded
+	// in gap records which carry no event.
+	while (delta > RecordEntry::maxEventDeltaUs) {
+		const auto gap = delta < RecordEntry::maxGapDeltaUs
+		               ? delta : RecordEntry::maxGapDeltaUs;
+		append(RecordEntry{Event(EventKind::Empty, EventActionKind::Press,
+		                         static_cast<uint32_t>(gap))});
+		delta -= gap;
+	}
+	return static_cast<uint16_t>(delta);
+}
+
+//==--- EventReplayer ------------------------------------------------------==//
+
+EventReplayer::~EventReplayer() {
+	close();
+}
+
+bool EventReplayer::open(const char* path) {
+	close();
+	const auto fileDescriptor = ::open(path, O_RDONLY);
+	if (fileDescriptor < 0) {
+		fprintf(stderr, "Failed to open event recording %s!\n", path);
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(fileDescriptor, &fileStat) != 0 ||
+	    static_cast<std::size_t>(fileStat.st_size) < sizeof(RecordingHeader)) {
+		fprintf(stderr, "Event recording %s is too small!\n", path);
+		::close(fileDescriptor);
+		return false;
+	}
+
+	MappedSize = static_cast<std::size_t>(fileStat.st_size);
+	Mapping    = mmap(nullptr, MappedSize, PROT_READ, MAP_PRIVATE,
+	                  fileDescriptor, 0);
+	::close(fileDescriptor);
+	if (Mapping == MAP_FAILED) {
+		fprintf(stderr, "Failed to map event recording %s!\n", path);
+		Mapping = nullptr;
+		return false;
+	}
+	madvise(Mapping, MappedSize, MADV_SEQUENTIAL);
+
+	const auto* header = static_cast<const RecordingHeader*>(Mapping);
+	if (memcmp(header->magic, RecordingHeader::magicValue,
+	           sizeof(header->magic)) != 0 ||
+	    header->version != RecordingHeader::currentVersion) {
+		fprintf(stderr, "File %s is not a valid event recording!\n", path);
+		close();
+		return false;
+	}
+
+	Entries    = reinterpret_cast<const RecordEntry*>(header + 1);
+	EntryCount = (MappedSize - sizeof(RecordingHeader)) / sizeof(RecordEntry);
+	rewind();
+	return true;
+}
+
+void EventReplayer::close() {
+	if (Mapping) {
+		munmap(Mapping, MappedSize);
+	}
+	Entries    = nullptr;
+	Mapping    = nullptr;
+	MappedSize = 0;
+	EntryCount = 0;
+	rewind();
+}
+
+std::size_t EventReplayer::replay(EventManager& eventManager,
+                                  ReplayTiming  timing      ) {
+	if (timing == ReplayTiming::MaxSpeed) {
+		return replayUntil(eventManager, ~uint64_t{0});
+	}
+
+	// Events are posted at the recorded offsets from the time the replay
+	// started, rather than sleeping for each delta, so that time spent
+	// posting does not accumulate as drift.
+	const auto startNs      = monotonicTimeNs();
+	const auto startUs      = ElapsedUs;
+	std::size_t posted      = 0;
+	while (!finished()) {
+		const auto nextUs   = ElapsedUs + Entries[Position].deltaUs();
+		const auto targetNs = startNs + (nextUs - startUs) * 1000;
+		const auto nowNs    = monotonicTimeNs();
+		if (targetNs > nowNs) {
+			std::this_thread::sleep_for(std::chrono::nanoseconds(targetNs - nowNs));
+		}
+		const auto position = Position;
+		posted += replayUntil(eventManager, nextUs * 1000);
+		if (Position == position) {
+			break;
+		}
+	}
+	return posted;
+}
+
+std::size_t EventReplayer::replayUntil(EventManager& eventManager,
+                                       uint64_t      elapsedNs   ) {
+	// The replayed events are stamped with the time they are posted, since
+	// that is when the manager receives them. The position of each event in
+	// the batch is kept so that the replay can stop at the first event which
+	// the manager does not accept.
+	const auto  elapsedUs = elapsedNs / 1000;
+	const auto  nowNs     = monotonicTimeNs();
+	Event       batch[replayBatchSize];
+	std::size_t positions[replayBatchSize];
+	uint64_t    elapsed[replayBatchSize];
+	std::size_t batchCount = 0, posted = 0;
+	auto flush = [&] {
+		const auto accepted = eventManager.postEvents(batch, batchCount);
+		posted += accepted;
+		if (accepted < batchCount) {
+			Position  = positions[accepted];
+			ElapsedUs = elapsed[accepted];
+			return false;
+		}
+		batchCount = 0;
+		return true;
+	};
+	while (!finished() && ElapsedUs + Entries[Position].deltaUs() <= elapsedUs) {
+		const auto& entry = Entries[Position];
+		positions[batchCount] = Position++;
+		elapsed[batchCount]   = ElapsedUs;
+		ElapsedUs            += entry.deltaUs();
+		if (entry.event.kind() == EventKind::Empty) {
+			continue;
+		}
+
+		batch[batchCount++] = entry.event.stamped(nowNs);
+		if (batchCount == replayBatchSize && !flush()) {
+			return posted;
+		}
+	}
+	flush();
+	return posted;
+}
+
+} // namespace Voxx::Lumos
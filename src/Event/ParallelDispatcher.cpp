@@ -0,0 +1,285 @@
+//==--- Lumos/Event/ParallelDispatcher.cpp ----------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  ParallelDispatcher.cpp
+/// \brief This is the implementation file for dispatching batches of events
+///        to sinks in parallel.
+//
+//==------------------------------------------------------------------------==//
+
+#include <Lumos/Event/ParallelDispatcher.hpp>
+#include <Lumos/Utility/CacheLine.hpp>
+#include <Lumos/Utility/Instrumentation.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace Voxx::Lumos {
+namespace {
+
+/// The SinkQueue class holds the sinks which are ready to run on one thread.
+/// The owner pushes and pops at the back, so that it runs the sinks it just
+/// made ready while their batch is in its cache, and other threads steal from
+/// the front. Each sink is queued once per batch, so the queue never holds
+/// more than the number of sinks, and is only resized between batches.
+class alignas(cacheLineSize) SinkQueue {
+ public:
+ 	/// Resizes the queue to hold at least \p capacity sinks. The queue must be
+ 	/// empty.
+ 	/// \param capacity The number of sinks to hold.
+ 	void reserve(std::size_t capacity) {
+ 		std::lock_guard<std::mutex> lock(Mutex);
+ 		if (capacity > Slots.size()) {
+ 			Slots.resize(nextPowerOfTwo(capacity));
+ 		}
+ 	}
+
+ 	/// Pushes \p sink onto the back of the queue.
+ 	/// \param sink The sink to push.
+ 	void push(uint32_t sink) {
+ 		std::lock_guard<std::mutex> lock(Mutex);
+ 		Slots[Tail++ & (Slots.size() - 1)] = sink;
+ 	}
+
+ 	/// Pops the sink at the back of the queue into \p sink, returning false if
+ 	/// the queue is empty.
+ 	/// \param sink The popped sink.
+ 	bool pop(uint32_t& sink) {
+ 		std::lock_guard<std::mutex> lock(Mutex);
+ 		if (Head == Tail) {
+ 			return false;
+ 		}
+ 		sink = Slots[--Tail & (Slots.size() - 1)];
+ 		return true;
+ 	}
+
+ 	/// Steals the sink at the front of the queue into \p sink, returning false
+ 	/// if the queue is empty.
+ 	/// \param sink The stolen sink.
+ 	bool steal(uint32_t& sink) {
+ 		std::lock_guard<std::mutex> lock(Mutex);
+ 		if (Head == Tail) {
+ 			return false;
+ 		}
+ 		sink = Slots[Head++ & (Slots.size() - 1)];
+ 		return true;
+ 	}
+
+ private:
+ 	std::vector<uint32_t> Slots;		//!< The ring of sinks.
+ 	std::size_t           Head = 0;	//!< Index of the front.
+ 	std::size_t           Tail = 0;	//!< Index past the back.
+ 	std::mutex            Mutex;		//!< Guards the queue.
+};
+
+} // namespace anonymous
+
+struct ParallelDispatcher::Pool {
+	/// Constructor -- creates the queues for \p workerCount workers and the
+	/// dispatching thread, which has the first queue.
+	/// \param workerCount The number of worker threads.
+	explicit Pool(std::size_t workerCount)
+	: Queues(new SinkQueue[workerCount + 1]), QueueCount(workerCount + 1) {}
+
+	/// Defines the type of the counts of dependencies each sink is waiting on.
+	using WaitingCounts = std::unique_ptr<std::atomic<uint32_t>[]>;
+
+	std::vector<Sink>*           Sinks    = nullptr;	//!< The sinks.
+	const EventBatch*            Batch    = nullptr;	//!< The current batch.
+	WaitingCounts                Waiting;							//!< Waits for each sink.
+	std::size_t                  Capacity = 0;				//!< Sinks reserved for.
+	std::unique_ptr<SinkQueue[]> Queues;							//!< Queue for each thread.
+	std::size_t                  QueueCount;					//!< Number of queues.
+	std::vector<std::thread>     Threads;							//!< The worker threads.
+
+	std::atomic<std::size_t> Remaining{0};			//!< Sinks left in the batch.
+	std::atomic<std::size_t> Queued{0};					//!< Sinks in the queues.
+	std::atomic<std::size_t> Sleepers{0};				//!< Threads which are waiting.
+	std::atomic<uint64_t>    Stolen{0};					//!< Sinks which were stolen.
+	std::atomic<bool>        Stopping{false};		//!< If the workers must stop.
+	std::mutex               SleepMutex;				//!< Guards sleeping.
+	std::condition_variable  Wake;							//!< Signals work or the end.
+
+	/// Queues \p sink on the queue of thread \p self and wakes a sleeping
+	/// thread to steal it, if there is one.
+	/// \param self The index of the thread.
+	/// \param sink The sink to queue.
+	void push(std::size_t self, uint32_t sink) {
+		Queues[self].push(sink);
+		Queued.fetch_add(1);
+		notifyIfSleeping();
+	}
+
+	/// Wakes the sleeping threads, if there are any. The mutex is taken so that
+	/// a thread which has decided to sleep is waiting before it is notified.
+	void notifyIfSleeping() {
+		if (Sleepers.load() != 0) {
+			{ std::lock_guard<std::mutex> lock(SleepMutex); }
+			Wake.notify_all();
+		}
+	}
+
+	/// Takes a ready sink for thread \p self into \p sink, from its own queue
+	/// if it has one and otherwise from another thread's queue. Returns false
+	/// if every queue is empty.
+	/// \param self The index of the thread.
+	/// \param sink The sink which was taken.
+	bool take(std::size_t self, uint32_t& sink) {
+		if (Queued.load(std::memory_order_relaxed) == 0) {
+			return false;
+		}
+		if (Queues[self].pop(sink)) {
+			Queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		for (std::size_t i = 1; i < QueueCount; ++i) {
+			if (Queues[(self + i) % QueueCount].steal(sink)) {
+				Queued.fetch_sub(1, std::memory_order_relaxed);
+				Stolen.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// Delivers the batch to \p sink on thread \p self, then queues the sinks
+	/// which were only waiting on it.
+	/// \param self The index of the thread.
+	/// \param sink The sink to run.
+	void run(std::size_t self, uint32_t sink) {
+		const auto& target = (*Sinks)[sink];
+		{
+			VOXX_LUMOS_TIMED_SCOPE("ParallelDispatcher::sink");
+			target.deliver(target.target, *Batch);
+		}
+		for (const auto dependent : target.dependents) {
+			if (Waiting[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				push(self, dependent);
+			}
+		}
+		if (Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			{ std::lock_guard<std::mutex> lock(SleepMutex); }
+			Wake.notify_all();
+		}
+	}
+
+	/// Runs sinks on thread \p self until \p done returns true, sleeping while
+	/// there are no sinks to run.
+	/// \param self The index of the thread.
+	/// \param done Returns true when the thread must return.
+	template <typename Done>
+	void runUntil(std::size_t self, Done&& done) {
+		uint32_t sink;
+		while (!done()) {
+			if (take(self, sink)) {
+				run(self, sink);
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(SleepMutex);
+			Sleepers.fetch_add(1);
+			Wake.wait(lock, [&] { return done() || Queued.load() != 0; });
+			Sleepers.fetch_sub(1);
+		}
+	}
+};
+
+ParallelDispatcher::ParallelDispatcher(std::size_t workerCount)
+: Workers(new Pool(workerCount)) {
+	auto* pool = Workers;
+	pool->Sinks = &Sinks;
+	for (std::size_t i = 1; i <= workerCount; ++i) {
+		pool->Threads.emplace_back([pool, i] {
+			pool->runUntil(i, [pool] { return pool->Stopping.load(); });
+		});
+	}
+}
+
+ParallelDispatcher::~ParallelDispatcher() {
+	auto* pool = Workers;
+	{
+		std::lock_guard<std::mutex> lock(pool->SleepMutex);
+		pool->Stopping.store(true);
+	}
+	pool->Wake.notify_all();
+	for (auto& thread : pool->Threads) {
+		thread.join();
+	}
+	delete pool;
+}
+
+ParallelDispatcher::SinkId
+ParallelDispatcher::addSink(SinkFn                        deliver     ,
+                            void*                         sink        ,
+                            std::initializer_list<SinkId> dependencies) {
+	// Sinks can only depend on sinks which already exist, so the dependencies
+	// can never form a cycle.
+	const auto id = static_cast<SinkId>(Sinks.size());
+	for (const auto dependency : dependencies) {
+		if (dependency >= id) {
+			return invalidSink;
+		}
+	}
+	Sinks.push_back(Sink{deliver, sink, 0, {}});
+	for (const auto dependency : dependencies) {
+		Sinks[dependency].dependents.push_back(id);
+		++Sinks[id].dependencies;
+	}
+	return id;
+}
+
+void ParallelDispatcher::dispatch(const EventBatch& batch) {
+	VOXX_LUMOS_TIMED_SCOPE("ParallelDispatcher::dispatch");
+	auto* pool = Workers;
+	if (Sinks.empty()) {
+		return;
+	}
+	if (pool->Capacity < Sinks.size()) {
+		pool->Capacity = Sinks.size();
+		pool->Waiting.reset(new std::atomic<uint32_t>[pool->Capacity]);
+		for (std::size_t i = 0; i < pool->QueueCount; ++i) {
+			pool->Queues[i].reserve(pool->Capacity);
+		}
+	}
+
+	// Every count is set before any sink is queued, since a sink may run as
+	// soon as it is. The sinks without dependencies are spread over the queues
+	// so that every thread starts with work, and the rest are queued by the
+	// thread which runs their last dependency.
+	pool->Batch = &batch;
+	pool->Remaining.store(Sinks.size(), std::memory_order_relaxed);
+	for (std::size_t i = 0; i < Sinks.size(); ++i) {
+		pool->Waiting[i].store(Sinks[i].dependencies, std::memory_order_relaxed);
+	}
+	std::size_t next = 0;
+	for (std::size_t i = 0; i < Sinks.size(); ++i) {
+		if (Sinks[i].dependencies == 0) {
+			pool->Queues[next].push(static_cast<uint32_t>(i));
+			pool->Queued.fetch_add(1);
+			next = (next + 1) % pool->QueueCount;
+		}
+	}
+	pool->notifyIfSleeping();
+
+	pool->runUntil(0, [pool] {
+		return pool->Remaining.load(std::memory_order_acquire) == 0;
+	});
+	pool->Batch = nullptr;
+}
+
+std::size_t ParallelDispatcher::workerCount() const {
+	return Workers->Threads.size();
+}
+
+uint64_t ParallelDispatcher::stolenSinks() const {
+	return Workers->Stolen.load(std::memory_order_relaxed);
+}
+
+} // namespace Voxx::Lumos
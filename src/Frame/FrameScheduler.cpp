@@ -0,0 +1,159 @@
+//==--- Lumos/Frame/FrameScheduler.cpp --------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  FrameScheduler.cpp
+/// \brief This is the implementation file for the frame scheduler.
+//
+//==------------------------------------------------------------------------==//
+
+#include <Lumos/Frame/FrameScheduler.hpp>
+#include <Lumos/Event/EventTime.hpp>
+#include <thread>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <time.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace Voxx::Lumos {
+namespace {
+
+/// Sleeps until the monotonic time \p deadlineNs, or longer.
+/// \param deadlineNs The time to sleep until.
+void sleepUntil(uint64_t deadlineNs) {
+#if defined(__linux__)
+	// The steady clock is CLOCK_MONOTONIC, and an absolute sleep is not
+	// lengthened by the time taken to make the call.
+	timespec deadline;
+	deadline.tv_sec  = static_cast<time_t>(deadlineNs / 1'000'000'000);
+	deadline.tv_nsec = static_cast<long>(deadlineNs % 1'000'000'000);
+	// Only an interrupted sleep is retried, since any other error would recur.
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) ==
+	       EINTR) {}
+#else
+	const auto now = monotonicTimeNs();
+	if (deadlineNs > now) {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(deadlineNs - now));
+	}
+#endif
+}
+
+/// Hints to the processor that the thread is spinning.
+inline void spinPause() {
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
+} // namespace anonymous
+
+FrameScheduler::FrameScheduler(uint64_t intervalNs) : IntervalNs(intervalNs) {}
+
+void FrameScheduler::setTargetInterval(uint64_t intervalNs) {
+	IntervalNs = intervalNs;
+}
+
+void FrameScheduler::setTargetRate(double rate) {
+	IntervalNs = rate > 0.0 ? static_cast<uint64_t>(1.0e9 / rate) : 0;
+}
+
+void FrameScheduler::beginStage(FrameStage stage) {
+	const uint64_t now = monotonicTimeNs();
+	if (FrameStartNs == 0) {
+		FrameStartNs = now;
+		DeadlineNs   = now + IntervalNs;
+	}
+	if (Stage != FrameStage::Count) {
+		StageTimes[static_cast<std::size_t>(Stage)].record(now - StageStartNs);
+	}
+	Stage        = stage;
+	StageStartNs = now;
+}
+
+void FrameScheduler::endStage() {
+	if (Stage != FrameStage::Count) {
+		StageTimes[static_cast<std::size_t>(Stage)].record(
+			monotonicTimeNs() - StageStartNs);
+		Stage = FrameStage::Count;
+	}
+}
+
+uint64_t FrameScheduler::waitForNextFrame() {
+	endStage();
+	const uint64_t now = monotonicTimeNs();
+	if (FrameStartNs == 0) {
+		FrameStartNs = now;
+		DeadlineNs   = now + IntervalNs;
+	}
+
+	uint64_t end = now;
+	if (IntervalNs) {
+		if (now <= DeadlineNs) {
+			end = waitUntil(DeadlineNs);
+			WaitTimes.record(end - now);
+			WakeErrors.record(end - DeadlineNs);
+		} else {
+			++Missed;
+			// Restart the schedule if the frame was more than an interval late,
+			// otherwise keep the phase so that the next frame makes up for it.
+			if (now - DeadlineNs >= IntervalNs) {
+				DeadlineNs = now;
+			}
+		}
+		DeadlineNs += IntervalNs;
+	}
+
+	const uint64_t frameNs = end - FrameStartNs;
+	FrameTimes.record(frameNs);
+	FrameStartNs = end;
+	++Frames;
+	return frameNs;
+}
+
+void FrameScheduler::reset() {
+	FrameTimes.reset();
+	for (auto& stageTimes : StageTimes) {
+		stageTimes.reset();
+	}
+	WaitTimes.reset();
+	WakeErrors.reset();
+	FrameStartNs = 0;
+	Stage        = FrameStage::Count;
+	Frames       = 0;
+	Missed       = 0;
+}
+
+uint64_t FrameScheduler::waitUntil(uint64_t deadlineNs) {
+	uint64_t now = monotonicTimeNs();
+	if (deadlineNs > now + SpinNs) {
+		const uint64_t wakeNs = deadlineNs - SpinNs;
+		sleepUntil(wakeNs);
+		now = monotonicTimeNs();
+
+		// Leave twice the latest oversleep for spinning, growing immediately
+		// when a sleep wakes late and shrinking slowly when they are accurate.
+		const uint64_t target = 2 * (now - wakeNs);
+		SpinNs = target > SpinNs ? target : (SpinNs * 15 + target) / 16;
+		SpinNs = SpinNs < minSpinNs ? minSpinNs
+		       : SpinNs > maxSpinNs ? maxSpinNs : SpinNs;
+	}
+	while (now < deadlineNs) {
+		spinPause();
+		now = monotonicTimeNs();
+	}
+	return now;
+}
+
+} // namespace Voxx::Lumos
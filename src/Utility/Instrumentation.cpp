@@ -0,0 +1,311 @@
+//==--- Lumos/Utility/Instrumentation.cpp ------------------ -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  Instrumentation.cpp
+/// \brief This is the implementation file for the instrumentation.
+//
+//==------------------------------------------------------------------------==//
+
+#include <Lumos/Utility/Instrumentation.hpp>
+#include <Lumos/Event/SpscQueue.hpp>
+#include <unistd.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace Voxx::Lumos {
+namespace {
+
+/// The SiteRecord struct defines the records of a site made by one thread.
+/// Only the owning thread writes them, so the atomics are only used to make
+/// the values safe to read from other threads, and compile to plain loads and
+/// stores.
+struct SiteRecord {
+	std::atomic<uint64_t> count{0};	//!< The number of records.
+	std::atomic<uint64_t> total{0};	//!< The sum of the records.
+	std::atomic<uint64_t> max{0};		//!< The largest record.
+
+	/// Adds \p value to the records. This must only be called by the owner.
+	/// \param value The value to add.
+	void add(uint64_t value) {
+		count.store(count.load(std::memory_order_relaxed) + 1,
+		            std::memory_order_relaxed);
+		total.store(total.load(std::memory_order_relaxed) + value,
+		            std::memory_order_relaxed);
+		if (value > max.load(std::memory_order_relaxed)) {
+			max.store(value, std::memory_order_relaxed);
+		}
+	}
+};
+
+/// The TraceRecord struct defines a buffered trace event.
+struct TraceRecord {
+	uint64_t startNs = 0;	//!< When the event started.
+	uint64_t value   = 0;	//!< The duration, increment or sample.
+	uint32_t site    = 0;	//!< The identifier of the site.
+};
+
+/// Defines the type of the buffer of trace events.
+using TraceRing = SpscQueue<TraceRecord>;
+
+/// The ThreadBuffer struct defines the records made by a single thread. The
+/// trace ring is large, so it is only allocated by the owning thread the
+/// first time it records while tracing is enabled.
+struct ThreadBuffer {
+	/// Constructor -- creates the buffer for the thread \p id.
+	/// \param id The identifier of the thread.
+	explicit ThreadBuffer(uint32_t id) : threadId(id) {}
+
+	/// Destructor -- frees the trace ring.
+	~ThreadBuffer() {
+		delete trace.load(std::memory_order_relaxed);
+	}
+
+	/// Returns the trace ring, allocating it on the first call. This must only
+	/// be called by the owner.
+	TraceRing& traceRing() {
+		auto* ring = trace.load(std::memory_order_relaxed);
+		if (!ring) {
+			ring = new TraceRing(Instrumentation::traceCapacity);
+			trace.store(ring, std::memory_order_release);
+		}
+		return *ring;
+	}
+
+	uint32_t                threadId;											//!< Thread identifier.
+	SiteRecord              sites[Instrumentation::maxSites];	//!< Site records.
+	std::atomic<TraceRing*> trace{nullptr};							//!< Trace events.
+};
+
+/// The Registry struct defines the sites and the buffers of all threads which
+/// have made a record. When a thread exits its buffer is put on the free list
+/// and reused by the next thread which records, so its records remain in
+/// snapshots and the number of buffers is the largest number of threads which
+/// have recorded at the same time.
+struct Registry {
+	std::mutex                                 mutex;			//!< Protects the registry.
+	const char*                                names[Instrumentation::maxSites] = {};
+	InstrumentKind                             kinds[Instrumentation::maxSites] = {};
+	uint32_t                                   siteCount = 0;	//!< Number of sites.
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;				//!< Thread buffers.
+	std::vector<ThreadBuffer*>                 freeBuffers;		//!< Unowned buffers.
+};
+
+/// Returns the registry. It is never destroyed, so that threads which record
+/// during static destruction are safe.
+Registry& registry() {
+	static auto* instance = new Registry();
+	return *instance;
+}
+
+/// The buffer of the calling thread, or nullptr if it does not have one.
+thread_local ThreadBuffer* currentBuffer = nullptr;
+/// If the calling thread has released its buffer because it is exiting.
+thread_local bool          threadExiting = false;
+
+/// The BufferLease struct returns the buffer of a thread to the free list of
+/// the registry when the thread exits.
+struct BufferLease {
+	/// Destructor -- puts the buffer of the thread on the free list.
+	~BufferLease() {
+		threadExiting = true;
+		if (currentBuffer) {
+			auto& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			reg.freeBuffers.push_back(currentBuffer);
+			currentBuffer = nullptr;
+		}
+	}
+};
+
+/// Gives the calling thread a buffer, reusing one from the free list if there
+/// is one. A thread which records after it has released its buffer, such as
+/// from the destructor of another thread local, keeps the buffer it is given.
+ThreadBuffer* acquireBuffer() {
+	auto& reg = registry();
+	{
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		if (!reg.freeBuffers.empty()) {
+			currentBuffer = reg.freeBuffers.back();
+			reg.freeBuffers.pop_back();
+		} else {
+			const auto id = static_cast<uint32_t>(reg.buffers.size());
+			reg.buffers.push_back(std::make_unique<ThreadBuffer>(id));
+			currentBuffer = reg.buffers.back().get();
+		}
+	}
+	if (!threadExiting) {
+		thread_local BufferLease lease;
+		static_cast<void>(lease);
+	}
+	return currentBuffer;
+}
+
+/// Returns the buffer of the calling thread, giving it one on the first call.
+ThreadBuffer& threadBuffer() {
+	return *(currentBuffer ? currentBuffer : acquireBuffer());
+}
+
+/// Writes \p name to \p file as a JSON string.
+/// \param file The file to write to.
+/// \param name The string to write.
+void writeJsonString(FILE* file, const char* name) {
+	fputc('"', file);
+	for (; *name; ++name) {
+		if (*name == '"' || *name == '\\') {
+			fputc('\\', file);
+		}
+		fputc(static_cast<unsigned char>(*name) < 0x20 ? ' ' : *name, file);
+	}
+	fputc('"', file);
+}
+
+} // namespace anonymous
+
+//==--- InstrumentSnapshot -------------------------------------------------==//
+
+const InstrumentStats* InstrumentSnapshot::find(const char* name) const {
+	for (const auto& site : sites) {
+		if (strcmp(site.name, name) == 0) {
+			return &site;
+		}
+	}
+	return nullptr;
+}
+
+InstrumentSnapshot
+InstrumentSnapshot::since(const InstrumentSnapshot& earlier) const {
+	InstrumentSnapshot delta = *this;
+	for (std::size_t i = 0; i < delta.sites.size() && i < earlier.sites.size();
+	     ++i) {
+		delta.sites[i].count -= earlier.sites[i].count;
+		delta.sites[i].total -= earlier.sites[i].total;
+	}
+	delta.droppedTraceEvents -= earlier.droppedTraceEvents;
+	return delta;
+}
+
+//==--- Instrumentation ----------------------------------------------------==//
+
+uint32_t Instrumentation::registerSite(const char* name, InstrumentKind kind) {
+	auto& reg = registry();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	for (uint32_t i = 0; i < reg.siteCount; ++i) {
+		if (strcmp(reg.names[i], name) == 0) {
+			return i;
+		}
+	}
+	if (reg.siteCount == maxSites) {
+		fprintf(stderr, "Too many instrumentation sites, ignoring %s\n", name);
+		return invalidSite;
+	}
+	reg.names[reg.siteCount] = name;
+	reg.kinds[reg.siteCount] = kind;
+	return reg.siteCount++;
+}
+
+void Instrumentation::recordTime(uint32_t site, uint64_t startNs,
+                                 uint64_t endNs) {
+	if (site == invalidSite) {
+		return;
+	}
+	auto& buffer = threadBuffer();
+	buffer.sites[site].add(endNs - startNs);
+	if (Tracing.load(std::memory_order_relaxed)) {
+		buffer.traceRing().push({startNs, endNs - startNs, site});
+	}
+}
+
+void Instrumentation::record(uint32_t site, uint64_t value) {
+	if (site == invalidSite) {
+		return;
+	}
+	auto& buffer = threadBuffer();
+	buffer.sites[site].add(value);
+	if (Tracing.load(std::memory_order_relaxed)) {
+		buffer.traceRing().push({monotonicTimeNs(), value, site});
+	}
+}
+
+InstrumentSnapshot Instrumentation::snapshot() {
+	auto& reg = registry();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	InstrumentSnapshot snapshot;
+	snapshot.timeNs = monotonicTimeNs();
+	snapshot.sites.resize(reg.siteCount);
+	for (uint32_t i = 0; i < reg.siteCount; ++i) {
+		snapshot.sites[i].name = reg.names[i];
+		snapshot.sites[i].kind = reg.kinds[i];
+	}
+	for (const auto& buffer : reg.buffers) {
+		for (uint32_t i = 0; i < reg.siteCount; ++i) {
+			const auto& record = buffer->sites[i];
+			auto&       stats  = snapshot.sites[i];
+			stats.count += record.count.load(std::memory_order_relaxed);
+			stats.total += record.total.load(std::memory_order_relaxed);
+			const auto max = record.max.load(std::memory_order_relaxed);
+			stats.max = max > stats.max ? max : stats.max;
+		}
+		if (const auto* trace = buffer->trace.load(std::memory_order_acquire)) {
+			snapshot.droppedTraceEvents += trace->dropped();
+		}
+	}
+	return snapshot;
+}
+
+bool Instrumentation::writeChromeTrace(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		fprintf(stderr, "Failed to open trace file %s\n", path);
+		return false;
+	}
+
+	// Holding the lock makes this the only consumer of every trace buffer.
+	auto& reg = registry();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	const int   pid   = static_cast<int>(getpid());
+	bool        first = true;
+	TraceRecord records[256];
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	for (const auto& buffer : reg.buffers) {
+		auto* trace = buffer->trace.load(std::memory_order_acquire);
+		if (!trace) {
+			continue;
+		}
+		std::size_t count = 0;
+		while ((count = trace->popBatch(records, 256)) != 0) {
+			for (std::size_t i = 0; i < count; ++i) {
+				const auto& record = records[i];
+				fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+				writeJsonString(file, reg.names[record.site]);
+				if (reg.kinds[record.site] == InstrumentKind::Timer) {
+					fprintf(file,
+					        ",\"cat\":\"lumos\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+					        "\"pid\":%d,\"tid\":%" PRIu32 "}",
+					        record.startNs / 1000.0, record.value / 1000.0, pid,
+					        buffer->threadId);
+				} else {
+					fprintf(file,
+					        ",\"cat\":\"lumos\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%d,"
+					        "\"tid\":%" PRIu32 ",\"args\":{\"value\":%" PRIu64 "}}",
+					        record.startNs / 1000.0, pid, buffer->threadId,
+					        record.value);
+				}
+				first = false;
+			}
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+} // namespace Voxx::Lumos
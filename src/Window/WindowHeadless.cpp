@@ -0,0 +1,63 @@
+//==--- Lumos/Window/WindowHeadless.cpp -------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowHeadless.cpp
+/// \brief This is the implementation file for a Window class which does not
+///        require a display server.
+//
+//==------------------------------------------------------------------------==//
+
+#include <Lumos/Window/WindowHeadless.hpp>
+
+namespace Voxx::Lumos {
+
+WindowHeadless::WindowHeadless(Extent2d extent, const char* title)
+: WindowExtent(extent),
+  Title(title ? title : ""),
+  Framebuffer(new PixelType[static_cast<std::size_t>(extent.width) *
+                            static_cast<std::size_t>(extent.height)]()),
+  Injected(injectCapacity) {}
+
+WindowHeadless::WindowPtr WindowHeadless::create(Extent2d    extent,
+                                                 const char* title ) {
+	if (extent.width <= 0 || extent.height <= 0) {
+		return nullptr;
+	}
+	return WindowPtr(new WindowHeadless(extent, title));
+}
+
+std::size_t WindowHeadless::pollForEvent(EventManager& eventManager) {
+	VOXX_LUMOS_TIMED_SCOPE("WindowHeadless::pollForEvent");
+	Event       events[pollBatchSize];
+	std::size_t posted = 0, count = 0;
+	while ((count = Injected.popBatch(events, pollBatchSize)) != 0) {
+		VOXX_LUMOS_VALUE("WindowHeadless::pollBatch", count);
+		posted += eventManager.postEvents(events, count);
+	}
+	return posted;
+}
+
+std::size_t WindowHeadless::injectKeyEvents(const KeyEvent* keyEvents,
+                                            std::size_t     count    ) {
+	const auto  timeNs = monotonicTimeNs();
+	Event       events[pollBatchSize];
+	std::size_t injected = 0;
+	for (std::size_t start = 0; start < count; start += pollBatchSize) {
+		const auto chunk = count - start < pollBatchSize
+		                 ? count - start : pollBatchSize;
+		for (std::size_t i = 0; i < chunk; ++i) {
+			events[i] = keyEvents[start + i].toEvent(timeNs);
+		}
+		injected += Injected.pushBatch(events, chunk);
+	}
+	return injected;
+}
+
+} // namespace Voxx::Lumos
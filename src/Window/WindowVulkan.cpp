@@ -0,0 +1,742 @@
+//==--- Lumos/Window/WindowVulkan.cpp ---------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowVulkan.cpp
+/// \brief This is the implementation file for a Window class which presents
+///        with a Vulkan swapchain.
+//
+//==------------------------------------------------------------------------==//
+
+#include "WindowXcbResource.hpp"
+#include <Lumos/Window/WindowVulkan.hpp>
+#include <vulkan/vulkan_xcb.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace Voxx::Lumos {
+namespace {
+
+/// The DeviceFunctions struct holds the device functions which are called
+/// every frame. They are loaded from the device, so that the calls go
+/// straight to the driver rather than through the loader's dispatch.
+struct DeviceFunctions {
+	PFN_vkWaitForFences       waitForFences      = nullptr;	//!< Waits on fences.
+	PFN_vkResetFences         resetFences        = nullptr;	//!< Resets fences.
+	PFN_vkAcquireNextImageKHR acquireNextImage   = nullptr;	//!< Acquires images.
+	PFN_vkResetCommandBuffer  resetCommandBuffer = nullptr;	//!< Resets commands.
+	PFN_vkBeginCommandBuffer  beginCommandBuffer = nullptr;	//!< Begins commands.
+	PFN_vkEndCommandBuffer    endCommandBuffer   = nullptr;	//!< Ends commands.
+	PFN_vkQueueSubmit         queueSubmit        = nullptr;	//!< Submits commands.
+	PFN_vkQueuePresentKHR     queuePresent       = nullptr;	//!< Presents images.
+};
+
+/// Returns the rank of a physical device of \p type, where a higher rank is
+/// preferred, so that software drivers are only used when there is no GPU.
+/// \param type The type of the physical device.
+int deviceRank(VkPhysicalDeviceType type) {
+	switch (type) {
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU  : return 4;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 3;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU   : return 2;
+		case VK_PHYSICAL_DEVICE_TYPE_CPU           : return 1;
+		default                                    : return 0;
+	}
+}
+
+/// Returns true if \p device supports the swapchain extension.
+/// \param device The physical device to check.
+bool hasSwapchain(VkPhysicalDevice device) {
+	uint32_t count = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+	std::vector<VkExtensionProperties> extensions(count);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &count,
+	                                     extensions.data());
+	for (const auto& extension : extensions) {
+		if (strcmp(extension.extensionName,
+		           VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace anonymous
+
+struct WindowVulkan::Resource {
+	/// The FrameSync struct holds the objects which are reused by every
+	/// framesInFlight-th frame.
+	struct FrameSync {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;	//!< Records the frame.
+		VkSemaphore     acquired      = VK_NULL_HANDLE;	//!< Signals the image.
+		VkFence         rendered      = VK_NULL_HANDLE;	//!< Signals completion.
+	};
+
+	/// The SwapImage struct holds the objects for an image of the swapchain.
+	/// The semaphore which signals that the image has been rendered belongs to
+	/// the image, since it is only reused once the image has been presented.
+	struct SwapImage {
+		VkImage     image    = VK_NULL_HANDLE;	//!< The image.
+		VkImageView view     = VK_NULL_HANDLE;	//!< A view of the image.
+		VkSemaphore rendered = VK_NULL_HANDLE;	//!< Signals it can be presented.
+		VkFence     inFlight = VK_NULL_HANDLE;	//!< Fence of the last frame.
+	};
+
+	VkInstance         instance       = VK_NULL_HANDLE;	//!< The instance.
+	VkSurfaceKHR       surface        = VK_NULL_HANDLE;	//!< The XCB surface.
+	VkPhysicalDevice   physicalDevice = VK_NULL_HANDLE;	//!< The GPU.
+	VkDevice           device         = VK_NULL_HANDLE;	//!< The device.
+	VkQueue            queue          = VK_NULL_HANDLE;	//!< Renders and presents.
+	uint32_t           queueFamily    = 0;								//!< Family of the queue.
+	VkCommandPool      commandPool    = VK_NULL_HANDLE;	//!< Command buffer pool.
+	VkSwapchainKHR     swapchain      = VK_NULL_HANDLE;	//!< The swapchain.
+	VkSurfaceFormatKHR format         = {};								//!< Image format.
+	VkPresentModeKHR   presentMode    = VK_PRESENT_MODE_FIFO_KHR;
+	VkImageUsageFlags  usage          = 0;								//!< Image usage.
+	VkExtent2D         extent         = {0, 0};						//!< Image extent.
+	DeviceFunctions    functions;													//!< Per frame functions.
+
+	FrameSync              frames[maxFramesInFlight];	//!< Frame resources.
+	uint32_t               frameCount  = 0;						//!< Frames in flight.
+	uint32_t               frameIndex  = 0;						//!< The next frame.
+	std::vector<SwapImage> images;										//!< Swapchain images.
+	VulkanFrame            current;										//!< The acquired frame.
+	bool                   acquired    = false;				//!< If a frame is begun.
+	bool                   stale       = false;				//!< If it must recreate.
+	uint64_t               recreations = 0;						//!< Recreation count.
+
+	/// Creates all of the Vulkan objects for \p window, returning false if any
+	/// of them could not be created.
+	/// \param window  The window to present to.
+	/// \param request The requested swapchain properties.
+	bool setup(WindowXcb& window, const SwapchainRequest& request);
+
+	/// Chooses the physical device and queue family which can present to the
+	/// surface, returning false if there is none.
+	bool chooseDevice();
+
+	/// Creates the device and queue, and loads the per frame functions.
+	bool createDevice();
+
+	/// Creates the swapchain for a window of \p windowExtent, replacing the
+	/// current one, which must no longer be in use. Returns false if the
+	/// window has no area or the swapchain could not be created.
+	/// \param windowExtent The extent of the window.
+	bool createSwapchain(Extent2d windowExtent);
+
+	/// Waits for the device and recreates the swapchain for a window of
+	/// \p windowExtent.
+	/// \param windowExtent The extent of the window.
+	bool recreateSwapchain(Extent2d windowExtent);
+
+	/// Destroys the views and semaphores of the swapchain images.
+	void destroyImages();
+
+	/// Restores \p frame after the submit of its commands failed, leaving its
+	/// fence signalled and its acquire semaphore unsignalled, so that the next
+	/// frame to use them neither hangs nor reuses a signalled semaphore.
+	/// \param frame The frame whose submit failed.
+	void recoverFrame(FrameSync& frame);
+
+	/// Destroys every Vulkan object.
+	void destroy();
+};
+
+bool WindowVulkan::Resource::setup(WindowXcb&              window ,
+                                   const SwapchainRequest& request) {
+	const char* instanceExtensions[] = {
+		VK_KHR_SURFACE_EXTENSION_NAME,
+		VK_KHR_XCB_SURFACE_EXTENSION_NAME
+	};
+	VkApplicationInfo appInfo = {};
+	appInfo.sType         = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pEngineName   = "Lumos";
+	appInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
+	appInfo.apiVersion    = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instanceInfo = {};
+	instanceInfo.sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo        = &appInfo;
+	instanceInfo.enabledExtensionCount   = 2;
+	instanceInfo.ppEnabledExtensionNames = instanceExtensions;
+	if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+		fprintf(stderr, "Failed to create Vulkan instance!\n");
+		instance = VK_NULL_HANDLE;
+		return false;
+	}
+
+	VkXcbSurfaceCreateInfoKHR surfaceInfo = {};
+	surfaceInfo.sType      = VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR;
+	surfaceInfo.connection = window.connection()->resource()->connection;
+	surfaceInfo.window     = window.nativeWindow();
+	if (vkCreateXcbSurfaceKHR(instance, &surfaceInfo, nullptr, &surface) !=
+	    VK_SUCCESS) {
+		fprintf(stderr, "Failed to create Vulkan XCB surface!\n");
+		surface = VK_NULL_HANDLE;
+		return false;
+	}
+	if (!chooseDevice() || !createDevice()) {
+		return false;
+	}
+
+	// The swapchain images are presented to a 24 bit visual, so the format
+	// which matches the software framebuffers is preferred.
+	uint32_t count = 0;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &count,
+	                                     nullptr);
+	std::vector<VkSurfaceFormatKHR> formats(count);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &count,
+	                                     formats.data());
+	if (formats.empty()) {
+		fprintf(stderr, "Vulkan surface has no formats!\n");
+		return false;
+	}
+	format = formats.front();
+	for (const auto& candidate : formats) {
+		if (candidate.format     == VK_FORMAT_B8G8R8A8_UNORM &&
+		    candidate.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+			format = candidate;
+		}
+	}
+	if (format.format == VK_FORMAT_UNDEFINED) {
+		format.format = VK_FORMAT_B8G8R8A8_UNORM;
+	}
+
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &count,
+	                                          nullptr);
+	std::vector<VkPresentModeKHR> presentModes(count);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &count,
+	                                          presentModes.data());
+	presentMode = choosePresentMode(presentModes.data(), count,
+	                                request.latency);
+
+	VkSurfaceCapabilitiesKHR capabilities;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface,
+	                                          &capabilities);
+	usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+	        (capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) !=
+	    VK_SUCCESS) {
+		fprintf(stderr, "Failed to create Vulkan command pool!\n");
+		commandPool = VK_NULL_HANDLE;
+		return false;
+	}
+
+	// The fences start signalled, so the first use of each frame does not
+	// wait for a frame which was never submitted.
+	frameCount = std::clamp<uint32_t>(request.framesInFlight, 1,
+	                                  maxFramesInFlight);
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType              =
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool        = commandPool;
+	allocateInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	for (uint32_t i = 0; i < frameCount; ++i) {
+		auto& frame = frames[i];
+		const auto allocated =
+			vkAllocateCommandBuffers(device, &allocateInfo, &frame.commandBuffer);
+		const auto semaphore =
+			vkCreateSemaphore(device, &semaphoreInfo, nullptr, &frame.acquired);
+		const auto fence     =
+			vkCreateFence(device, &fenceInfo, nullptr, &frame.rendered);
+		if (allocated != VK_SUCCESS || semaphore != VK_SUCCESS ||
+		    fence     != VK_SUCCESS) {
+			fprintf(stderr, "Failed to create Vulkan frame resources!\n");
+			return false;
+		}
+	}
+
+	if (!createSwapchain(window.extent())) {
+		fprintf(stderr, "Failed to create Vulkan swapchain!\n");
+		return false;
+	}
+	return true;
+}
+
+bool WindowVulkan::Resource::chooseDevice() {
+	uint32_t count = 0;
+	vkEnumeratePhysicalDevices(instance, &count, nullptr);
+	std::vector<VkPhysicalDevice> devices(count);
+	vkEnumeratePhysicalDevices(instance, &count, devices.data());
+
+	int bestRank = -1;
+	for (auto candidate : devices) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(candidate, &properties);
+		const auto rank = deviceRank(properties.deviceType);
+		if (rank <= bestRank || !hasSwapchain(candidate)) {
+			continue;
+		}
+
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount,
+		                                         nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount,
+		                                         families.data());
+		for (uint32_t family = 0; family < familyCount; ++family) {
+			VkBool32 presents = VK_FALSE;
+			vkGetPhysicalDeviceSurfaceSupportKHR(candidate, family, surface,
+			                                     &presents);
+			if (presents && (families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+				physicalDevice = candidate;
+				queueFamily    = family;
+				bestRank       = rank;
+				break;
+			}
+		}
+	}
+	if (bestRank < 0) {
+		fprintf(stderr, "No Vulkan device can present to the window!\n");
+		return false;
+	}
+	return true;
+}
+
+bool WindowVulkan::Resource::createDevice() {
+	const char* deviceExtensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	const float priority           = 1.0f;
+
+	VkDeviceQueueCreateInfo queueInfo = {};
+	queueInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = queueFamily;
+	queueInfo.queueCount       = 1;
+	queueInfo.pQueuePriorities = &priority;
+
+	VkDeviceCreateInfo deviceInfo = {};
+	deviceInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.queueCreateInfoCount    = 1;
+	deviceInfo.pQueueCreateInfos       = &queueInfo;
+	deviceInfo.enabledExtensionCount   = 1;
+	deviceInfo.ppEnabledExtensionNames = deviceExtensions;
+	if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) !=
+	    VK_SUCCESS) {
+		fprintf(stderr, "Failed to create Vulkan device!\n");
+		device = VK_NULL_HANDLE;
+		return false;
+	}
+	vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+	auto load = [this] (auto& function, const char* name) {
+		function = reinterpret_cast<std::remove_reference_t<decltype(function)>>(
+			vkGetDeviceProcAddr(device, name));
+		return function != nullptr;
+	};
+	if (!load(functions.waitForFences     , "vkWaitForFences"      ) ||
+	    !load(functions.resetFences       , "vkResetFences"        ) ||
+	    !load(functions.acquireNextImage  , "vkAcquireNextImageKHR") ||
+	    !load(functions.resetCommandBuffer, "vkResetCommandBuffer" ) ||
+	    !load(functions.beginCommandBuffer, "vkBeginCommandBuffer" ) ||
+	    !load(functions.endCommandBuffer  , "vkEndCommandBuffer"   ) ||
+	    !load(functions.queueSubmit       , "vkQueueSubmit"        ) ||
+	    !load(functions.queuePresent      , "vkQueuePresentKHR"    )) {
+		fprintf(stderr, "Failed to load Vulkan device functions!\n");
+		return false;
+	}
+	return true;
+}
+
+bool WindowVulkan::Resource::createSwapchain(Extent2d windowExtent) {
+	VkSurfaceCapabilitiesKHR capabilities;
+	if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface,
+	                                              &capabilities) != VK_SUCCESS) {
+		return false;
+	}
+
+	// X surfaces report the extent of the window, but the extent of the window
+	// as of the last poll is used if the surface leaves it to the swapchain.
+	auto imageExtent = capabilities.currentExtent;
+	if (imageExtent.width == UINT32_MAX) {
+		imageExtent.width  = std::clamp<uint32_t>(
+			std::max<int16_t>(windowExtent.width, 0),
+			capabilities.minImageExtent.width , capabilities.maxImageExtent.width);
+		imageExtent.height = std::clamp<uint32_t>(
+			std::max<int16_t>(windowExtent.height, 0),
+			capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+	}
+	if (imageExtent.width == 0 || imageExtent.height == 0) {
+		return false;
+	}
+
+	// One image more than the minimum lets mailbox always have an image to
+	// render to while one is queued and one is displayed.
+	auto imageCount = capabilities.minImageCount + 1;
+	if (capabilities.maxImageCount != 0) {
+		imageCount = std::min(imageCount, capabilities.maxImageCount);
+	}
+	auto compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	if (!(capabilities.supportedCompositeAlpha & compositeAlpha)) {
+		const auto supported = capabilities.supportedCompositeAlpha;
+		compositeAlpha = static_cast<VkCompositeAlphaFlagBitsKHR>(
+			supported & (~supported + 1));
+	}
+
+	VkSwapchainCreateInfoKHR swapchainInfo = {};
+	swapchainInfo.sType            = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	swapchainInfo.surface          = surface;
+	swapchainInfo.minImageCount    = imageCount;
+	swapchainInfo.imageFormat      = format.format;
+	swapchainInfo.imageColorSpace  = format.colorSpace;
+	swapchainInfo.imageExtent      = imageExtent;
+	swapchainInfo.imageArrayLayers = 1;
+	swapchainInfo.imageUsage       = usage;
+	swapchainInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	swapchainInfo.preTransform     = capabilities.currentTransform;
+	swapchainInfo.compositeAlpha   = compositeAlpha;
+	swapchainInfo.presentMode      = presentMode;
+	swapchainInfo.clipped          = VK_TRUE;
+	swapchainInfo.oldSwapchain     = swapchain;
+
+	VkSwapchainKHR created = VK_NULL_HANDLE;
+	if (vkCreateSwapchainKHR(device, &swapchainInfo, nullptr, &created) !=
+	    VK_SUCCESS) {
+		return false;
+	}
+	destroyImages();
+	if (swapchain) {
+		vkDestroySwapchainKHR(device, swapchain, nullptr);
+	}
+	swapchain = created;
+	extent    = imageExtent;
+
+	uint32_t count = 0;
+	vkGetSwapchainImagesKHR(device, swapchain, &count, nullptr);
+	std::vector<VkImage> swapImages(count);
+	vkGetSwapchainImagesKHR(device, swapchain, &count, swapImages.data());
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format           = format.format;
+	viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	images.resize(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		images[i].image = swapImages[i];
+		viewInfo.image  = swapImages[i];
+		if (vkCreateImageView(device, &viewInfo, nullptr, &images[i].view) !=
+		      VK_SUCCESS ||
+		    vkCreateSemaphore(device, &semaphoreInfo, nullptr,
+		                      &images[i].rendered) != VK_SUCCESS) {
+			return false;
+		}
+	}
+	stale = false;
+	return true;
+}
+
+bool WindowVulkan::Resource::recreateSwapchain(Extent2d windowExtent) {
+	VOXX_LUMOS_TIMED_SCOPE("WindowVulkan::recreateSwapchain");
+	vkDeviceWaitIdle(device);
+	if (!createSwapchain(windowExtent)) {
+		return false;
+	}
+	++recreations;
+	return true;
+}
+
+void WindowVulkan::Resource::destroyImages() {
+	for (auto& image : images) {
+		if (image.view) {
+			vkDestroyImageView(device, image.view, nullptr);
+		}
+		if (image.rendered) {
+			vkDestroySemaphore(device, image.rendered, nullptr);
+		}
+	}
+	images.clear();
+}
+
+void WindowVulkan::Resource::recoverFrame(FrameSync& frame) {
+	// An empty submit waits on the acquire semaphore and signals the fence, as
+	// the failed submit would have.
+	const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pWaitSemaphores    = &frame.acquired;
+	submitInfo.pWaitDstStageMask  = &waitStage;
+	if (functions.queueSubmit(queue, 1, &submitInfo, frame.rendered) ==
+	    VK_SUCCESS) {
+		return;
+	}
+
+	// Otherwise the semaphore and fence are replaced, with the fence created
+	// signalled, once the device has finished with them.
+	vkDeviceWaitIdle(device);
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	VkFence     fence     = VK_NULL_HANDLE;
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) ==
+	    VK_SUCCESS) {
+		vkDestroySemaphore(device, frame.acquired, nullptr);
+		frame.acquired = semaphore;
+	}
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) == VK_SUCCESS) {
+		for (auto& image : images) {
+			if (image.inFlight == frame.rendered) {
+				image.inFlight = VK_NULL_HANDLE;
+			}
+		}
+		vkDestroyFence(device, frame.rendered, nullptr);
+		frame.rendered = fence;
+	}
+}
+
+void WindowVulkan::Resource::destroy() {
+	if (device) {
+		vkDeviceWaitIdle(device);
+		destroyImages();
+		if (swapchain) {
+			vkDestroySwapchainKHR(device, swapchain, nullptr);
+		}
+		for (auto& frame : frames) {
+			if (frame.acquired) {
+				vkDestroySemaphore(device, frame.acquired, nullptr);
+			}
+			if (frame.rendered) {
+				vkDestroyFence(device, frame.rendered, nullptr);
+			}
+		}
+		if (commandPool) {
+			vkDestroyCommandPool(device, commandPool, nullptr);
+		}
+		vkDestroyDevice(device, nullptr);
+	}
+	if (surface) {
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
+	if (instance) {
+		vkDestroyInstance(instance, nullptr);
+	}
+}
+
+WindowVulkan::WindowVulkan(WindowXcb::WindowPtr window)
+: Native(std::move(window)), Handle(new Resource()) {}
+
+WindowVulkan::~WindowVulkan() {
+	// The surface must be destroyed before the X window it presents to, which
+	// is destroyed after this, with the members.
+	Handle->destroy();
+	delete Handle;
+}
+
+WindowVulkan::WindowPtr WindowVulkan::create(Extent2d                extent ,
+                                             const char*             title  ,
+                                             const SwapchainRequest& request) {
+	return create(XcbConnection::shared(), extent, title, request);
+}
+
+WindowVulkan::WindowPtr
+WindowVulkan::create(ConnectionPtr           connection,
+                     Extent2d                extent    ,
+                     const char*             title     ,
+                     const SwapchainRequest& request   ) {
+	auto native = WindowXcb::createNative(std::move(connection), extent, title);
+	if (!native) {
+		return nullptr;
+	}
+	auto windowPtr = WindowPtr(new WindowVulkan(std::move(native)));
+	if (!windowPtr->Handle->setup(*windowPtr->Native, request)) {
+		return nullptr;
+	}
+	return windowPtr;
+}
+
+std::size_t WindowVulkan::pollForEvent(EventManager& eventManager) {
+	const auto posted = Native->pollForEvent(eventManager);
+	const auto extent = Native->extent();
+	if (static_cast<uint32_t>(extent.width)  != Handle->extent.width ||
+	    static_cast<uint32_t>(extent.height) != Handle->extent.height) {
+		Handle->stale = true;
+	}
+	return posted;
+}
+
+const VulkanFrame* WindowVulkan::beginFrame() {
+	VOXX_LUMOS_TIMED_SCOPE("WindowVulkan::beginFrame");
+	auto* resource   = Handle;
+	auto& functions  = resource->functions;
+	if (resource->acquired) {
+		return &resource->current;
+	}
+	if (resource->stale && !resource->recreateSwapchain(Native->extent())) {
+		return nullptr;
+	}
+
+	// Waiting on the fence bounds how far the CPU runs ahead of the GPU. The
+	// fence is only reset when the frame is submitted, so a failed acquire
+	// never leaves it unsignalled.
+	auto& frame = resource->frames[resource->frameIndex];
+	functions.waitForFences(resource->device, 1, &frame.rendered, VK_TRUE,
+	                        UINT64_MAX);
+	uint32_t imageIndex = 0;
+	auto     result     = VK_SUCCESS;
+	for (int attempt = 0; attempt < 2; ++attempt) {
+		result = functions.acquireNextImage(resource->device, resource->swapchain,
+		                                    UINT64_MAX, frame.acquired,
+		                                    VK_NULL_HANDLE, &imageIndex);
+		if (result != VK_ERROR_OUT_OF_DATE_KHR ||
+		    !resource->recreateSwapchain(Native->extent())) {
+			break;
+		}
+	}
+	if (result == VK_SUBOPTIMAL_KHR) {
+		resource->stale = true;
+	} else if (result != VK_SUCCESS) {
+		return nullptr;
+	}
+
+	// The image may have been acquired by a different frame, whose fence must
+	// then have signalled before the image is rendered to again.
+	auto& image = resource->images[imageIndex];
+	if (image.inFlight && image.inFlight != frame.rendered) {
+		functions.waitForFences(resource->device, 1, &image.inFlight, VK_TRUE,
+		                        UINT64_MAX);
+	}
+	image.inFlight = frame.rendered;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	functions.resetCommandBuffer(frame.commandBuffer, 0);
+	functions.beginCommandBuffer(frame.commandBuffer, &beginInfo);
+
+	resource->current  = VulkanFrame{frame.commandBuffer, image.image,
+	                                 image.view, resource->extent, imageIndex,
+	                                 resource->frameIndex};
+	resource->acquired = true;
+	return &resource->current;
+}
+
+bool WindowVulkan::endFrame() {
+	VOXX_LUMOS_TIMED_SCOPE("WindowVulkan::endFrame");
+	auto* resource  = Handle;
+	auto& functions = resource->functions;
+	if (!resource->acquired) {
+		return false;
+	}
+	resource->acquired = false;
+	auto& frame = resource->frames[resource->frameIndex];
+	auto& image = resource->images[resource->current.imageIndex];
+	resource->frameIndex = (resource->frameIndex + 1) % resource->frameCount;
+	functions.endCommandBuffer(frame.commandBuffer);
+
+	// The image may be written by render passes or transfers, so the wait for
+	// it to be acquired blocks both.
+	const VkPipelineStageFlags waitStages =
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+		VK_PIPELINE_STAGE_TRANSFER_BIT;
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount   = 1;
+	submitInfo.pWaitSemaphores      = &frame.acquired;
+	submitInfo.pWaitDstStageMask    = &waitStages;
+	submitInfo.commandBufferCount   = 1;
+	submitInfo.pCommandBuffers      = &frame.commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores    = &image.rendered;
+	functions.resetFences(resource->device, 1, &frame.rendered);
+	if (functions.queueSubmit(resource->queue, 1, &submitInfo, frame.rendered) !=
+	    VK_SUCCESS) {
+		// The image was acquired but will not be presented, so the swapchain is
+		// recreated before the next frame, which returns the image.
+		fprintf(stderr, "Failed to submit Vulkan frame!\n");
+		resource->recoverFrame(frame);
+		resource->stale = true;
+		return false;
+	}
+
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores    = &image.rendered;
+	presentInfo.swapchainCount     = 1;
+	presentInfo.pSwapchains        = &resource->swapchain;
+	presentInfo.pImageIndices      = &resource->current.imageIndex;
+	const auto result = functions.queuePresent(resource->queue, &presentInfo);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+		resource->stale = true;
+		return true;
+	}
+	return result == VK_SUCCESS;
+}
+
+void WindowVulkan::waitIdle() {
+	vkDeviceWaitIdle(Handle->device);
+}
+
+WindowXcb& WindowVulkan::xcbWindow() {
+	return *Native;
+}
+
+Extent2d WindowVulkan::extent() const {
+	return Native->extent();
+}
+
+VkInstance WindowVulkan::instance() const {
+	return Handle->instance;
+}
+
+VkPhysicalDevice WindowVulkan::physicalDevice() const {
+	return Handle->physicalDevice;
+}
+
+VkDevice WindowVulkan::device() const {
+	return Handle->device;
+}
+
+VkQueue WindowVulkan::queue() const {
+	return Handle->queue;
+}
+
+uint32_t WindowVulkan::queueFamily() const {
+	return Handle->queueFamily;
+}
+
+VkFormat WindowVulkan::imageFormat() const {
+	return Handle->format.format;
+}
+
+VkPresentModeKHR WindowVulkan::presentMode() const {
+	return Handle->presentMode;
+}
+
+uint32_t WindowVulkan::imageCount() const {
+	return static_cast<uint32_t>(Handle->images.size());
+}
+
+uint32_t WindowVulkan::framesInFlight() const {
+	return Handle->frameCount;
+}
+
+uint64_t WindowVulkan::swapchainRecreations() const {
+	return Handle->recreations;
+}
+
+} // namespace Voxx::Lumos
@@ -13,110 +13,250 @@
 //
 //==------------------------------------------------------------------------==//
 
-#include <X11/Xlib.h>
-#include <X11/Xlib-xcb.h>
-#include <xcb/xcb.h>
-#include <GL/glx.h>
-#include <GL/gl.h>
-
-#include "WindowXcb.hpp"
+#include "WindowXcbResource.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 namespace Voxx::Lumos {
+namespace {
+
+/// Returns the depth of the visual with \p visualId on \p screen, or the
+/// depth of the root window if the visual is not found.
+/// \param screen   The screen the visual belongs to.
+/// \param visualId The id of the visual.
+uint8_t visualDepth(const xcb_screen_t* screen, xcb_visualid_t visualId) {
+	auto depths = xcb_screen_allowed_depths_iterator(screen);
+	for (; depths.rem; xcb_depth_next(&depths)) {
+		auto visuals = xcb_depth_visuals_iterator(depths.data);
+		for (; visuals.rem; xcb_visualtype_next(&visuals)) {
+			if (visuals.data->visual_id == visualId) {
+				return depths.data->depth;
+			}
+		}
+	}
+	return screen->root_depth;
+}
 
-WindowXcb::WindowResource {
- 	/// The type of a pointer to the connection to the server.
- 	using ConnectionPtr 	= xcb_connection_t*;
- 	/// The type of a pointer to the screen object.
- 	using ScreenPtr 			= xcb_screen_t*;
- 	/// The type of the X window.
- 	using WindowType 		  = xcb_window_t;
-
- 	Display* 			display 	 		= nullptr; 	//!< A pointer to the display.
- 	ConnectionPtr	connection 	 	= nullptr;	//!< A pointer to the connection.
- 	ScreenPtr 		screen 			 	= nullptr;	//!< A pointer to the screen.
- 	WindowType		window 			 	= 0;				//!< A handle to the XCB window.
- 	int 					screenNumber 	= 0; 				//!< The screen number to use.
+/// Returns the X event mask which selects the events needed to post the kinds
+/// of events in \p kinds. Configure and expose events are always selected,
+/// since the extent and the damage of the window are kept from them, and the
+/// server only sends the expose events for mapping a window to clients which
+/// select them when it is mapped. If \p rawMotion is true, relative motion is
+/// read as raw motion and does not need core motion events.
+/// \param kinds     The kinds of events to post.
+/// \param rawMotion If raw motion is used.
+uint32_t xcbEventMask(EventKindMask kinds, bool rawMotion) {
+	auto wants = [kinds] (EventKind kind) {
+		return (kinds & eventKindBit(kind)) != 0;
+	};
+	uint32_t mask = XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_EXPOSURE;
+	if (wants(EventKind::Key)) {
+		mask |= XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE;
+	}
+	if (wants(EventKind::MouseButton) || wants(EventKind::Scroll)) {
+		mask |= XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE;
+	}
+	if (wants(EventKind::MouseMove) ||
+	    (wants(EventKind::MouseDelta) && !rawMotion)) {
+		mask |= XCB_EVENT_MASK_POINTER_MOTION;
+	}
+	// Entering the window is needed for raw motion too, since it is routed to
+	// the window which contains the pointer.
+	if (wants(EventKind::MouseMove) || wants(EventKind::MouseDelta)) {
+		mask |= XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_LEAVE_WINDOW;
+	}
+	if (wants(EventKind::Focus)) {
+		mask |= XCB_EVENT_MASK_FOCUS_CHANGE;
+	}
+	return mask;
+}
+
+/// The SizeHints struct defines the WM_NORMAL_HINTS property of ICCCM, which
+/// tells the window manager the size the window is created with.
+struct SizeHints {
+	/// Defines the flag for a program specified size.
+	static constexpr uint32_t programSize = 1 << 3;
+
+	uint32_t flags         = 0;				//!< Which of the fields are set.
+	int32_t  x             = 0;				//!< Obsolete x position.
+	int32_t  y             = 0;				//!< Obsolete y position.
+	int32_t  width         = 0;				//!< Width, for the program size.
+	int32_t  height        = 0;				//!< Height, for the program size.
+	int32_t  minWidth      = 0;				//!< Minimum width.
+	int32_t  minHeight     = 0;				//!< Minimum height.
+	int32_t  maxWidth      = 0;				//!< Maximum width.
+	int32_t  maxHeight     = 0;				//!< Maximum height.
+	int32_t  widthInc      = 0;				//!< Width increment.
+	int32_t  heightInc     = 0;				//!< Height increment.
+	int32_t  minAspect[2]  = {};			//!< Minimum aspect ratio.
+	int32_t  maxAspect[2]  = {};			//!< Maximum aspect ratio.
+	int32_t  baseWidth     = 0;				//!< Base width.
+	int32_t  baseHeight    = 0;				//!< Base height.
+	uint32_t winGravity    = 0;				//!< Window gravity.
 };
 
-WindowXcb::GraphicsResource {
-	GLXContext  context;		//!< A handle to the OpenGL context.
-	GLXWindow   window;			//!< A handle to the OpenGL window.
-	GLXDrawable drawable;		//!< A handle to the OpenGL drawable object.
+/// Sends the requests which set the title of \p window to \p title, add it
+/// to the WM_DELETE_WINDOW protocol, and give its size to the window manager.
+/// None of these have replies, so nothing is waited for.
+/// \param connection The resources of the connection.
+/// \param window     The window to set the properties of.
+/// \param extent     The extent of the window.
+/// \param title      The title of the window.
+void setWindowProperties(const XcbConnection::ConnectionResource& connection,
+                         xcb_window_t                             window    ,
+                         Extent2d                                 extent    ,
+                         const char*                              title     ) {
+	auto*      xcb         = connection.connection;
+	const auto titleLength = static_cast<uint32_t>(strlen(title));
+	xcb_change_property(xcb, XCB_PROP_MODE_REPLACE, window, XCB_ATOM_WM_NAME,
+	                    XCB_ATOM_STRING, 8, titleLength, title);
+	if (connection.netWmName && connection.utf8String) {
+		xcb_change_property(xcb, XCB_PROP_MODE_REPLACE, window,
+		                    connection.netWmName, connection.utf8String, 8,
+		                    titleLength, title);
+	}
+	if (connection.wmProtocols && connection.wmDeleteWindow) {
+		xcb_change_property(xcb, XCB_PROP_MODE_REPLACE, window,
+		                    connection.wmProtocols, XCB_ATOM_ATOM, 32, 1,
+		                    &connection.wmDeleteWindow);
+	}
+
+	SizeHints hints;
+	hints.flags     = SizeHints::programSize;
+	hints.width     = extent.width;
+	hints.height    = extent.height;
+	xcb_change_property(xcb, XCB_PROP_MODE_REPLACE, window,
+	                    XCB_ATOM_WM_NORMAL_HINTS, XCB_ATOM_WM_SIZE_HINTS, 32,
+	                    sizeof(hints) / sizeof(uint32_t), &hints);
+}
+
+} // namespace anonymous
+
+bool hasExtensionName(const char* extensions, const char* name) {
+	const auto length = strlen(name);
+	for (auto* found = extensions; found && (found = strstr(found, name));
+	     found += length) {
+		if ((found == extensions || found[-1] == ' ') &&
+		    (found[length] == ' ' || found[length] == '\0')) {
+			return true;
+		}
+	}
+	return false;
 }
 
 WindowXcb::WindowXcb() {
-	GraphicsHandle = new GraphicsHandle();
-	WindowHandle   = new WindowResource();
+	GfxHandle    = new GraphicsResource();
+	WindowHandle = new WindowResource();
 }
 
 WindowXcb::~WindowXcb() {
-	if (GraphicsHandle) {
-		if (WindowHandle) {
-			glXDestroyWindow(WindowHandle->display, GraphicsHandle->window);
+	destroySoftwarePresent();
+	if (WindowHandle && WindowHandle->display) {
+		if (WindowHandle->window) {
+			WindowHandle->shared->removeWindow(WindowHandle->window);
+		}
+		if (WindowHandle->rawMotion) {
+			WindowHandle->shared->useRawMotion(false);
+		}
+		if (GfxHandle) {
+			if (GfxHandle->window) {
+				glXDestroyWindow(WindowHandle->display, GfxHandle->window);
+			}
+			if (GfxHandle->context) {
+				glXDestroyContext(WindowHandle->display, GfxHandle->context);
+			}
+		}
+		if (WindowHandle->window) {
 			xcb_destroy_window(WindowHandle->connection, WindowHandle->window);
-			glXDestroyContext(WindowHandle->display, GraphicsHandle->context);
-			XCloseDisplay(WindowHandle->display);
-			delete WindowHandle;
+			xcb_flush(WindowHandle->connection);
 		}
-		delete GraphicsHandle;
 	}
+	delete WindowHandle;
+	delete GfxHandle;
 }
 
-WindowXcb::WindowPtr WindowXcb::create(Extent2d extent, const char* title) {
-	auto* window   = WindowHandle;
-	auto* graphics = GraphicsHandle;
-	if (!(window->display = XOpenDisplay(0))) {
-		fprintf(stderr, "Can't open display!\n");
-		return nullptr;
-	}
-	window->screenNumber = DefaultScreen(window->display);
+WindowXcb::WindowPtr WindowXcb::create(Extent2d                  extent ,
+                                       const char*               title  ,
+                                       const FramebufferRequest& request) {
+	return create(XcbConnection::shared(), extent, title, request);
+}
+
+WindowXcb::WindowPtr WindowXcb::create(ConnectionPtr             connection,
+                                       Extent2d                  extent    ,
+                                       const char*               title     ,
+                                       const FramebufferRequest& request   ) {
+	return createWith(std::move(connection), extent, title, &request);
+}
+
+WindowXcb::WindowPtr WindowXcb::createNative(ConnectionPtr connection,
+                                             Extent2d      extent    ,
+                                             const char*   title     ) {
+	return createWith(std::move(connection), extent, title, nullptr);
+}
 
-	if (!(window->connection = XGetXCBConnection(window->display))) {
-		XCloseDisplay(window->display);
-		fprintf(stderr, "Can't get XCB connection from display!\n");
+WindowXcb::WindowPtr
+WindowXcb::createWith(ConnectionPtr             connection,
+                      Extent2d                  extent    ,
+                      const char*               title     ,
+                      const FramebufferRequest* request   ) {
+	if (!connection) {
 		return nullptr;
 	}
-	XSetEventQueueOwnership(window->display, XCBOwnsEventQueue);
 
-	// Find the XCB screen to use:
-	xcb_screen_iterator_t screenIterator = 
-		xcb_setup_roots_iterator(xcb_get_setup(window->connection));
-	for (auto screenNumber = window->screenNumber;
-			 screenIterator.rem && screenNumber > 0;
-			 --screenNumber, xcb_screen_next(&screenIterator)) {
-		window->screen = screen_iter.data;
+	auto  windowPtr      = WindowPtr(new WindowXcb());
+	auto* window         = windowPtr->WindowHandle;
+	auto* resource       = connection->resource();
+	window->display      = resource->display;
+	window->connection   = resource->connection;
+	window->screen       = resource->screen;
+	window->screenNumber = resource->screenNumber;
+	window->shared       = std::move(connection);
+	window->events       =
+		std::make_unique<WindowResource::QueueType>(eventQueueCapacity);
+	window->route.events  = window->events.get();
+	window->route.pointer = &window->pointer;
+
+	if (!windowPtr->setup(extent, title, request)) {
+		// The route is removed before the queue it points to is freed.
+		if (window->window) {
+			window->shared->removeWindow(window->window);
+		}
+		return nullptr;
 	}
+	xcb_flush(window->connection);
+	return windowPtr;
 }
 
-void WindowXcb::setup(Extent2d extent) {
+bool WindowXcb::setup(Extent2d                  extent ,
+                      const char*               title  ,
+                      const FramebufferRequest* request) {
 	auto* window   	= WindowHandle;
-	auto* graphics 	= GraphicsHandle;
-
-  int visualID = 0, numFbufferConfigs = 0;
-  auto fbufferConfigs = glXGetFBConfigs(window->display 		,
-  																			window->screenNumber,
-  																			&numFbufferConfigs  );
-  if (!fbufferConfigs || numFbufferConfigs == 0) {
-  	fprintf(stderr, "Frame buffer configuration failed!\n");
-    return;
-  }
+	auto* graphics 	= GfxHandle;
+	window->extent  = extent;
+	window->damage.setBounds(extent);
+	window->damage.addAll();
 
-  GLXFBConfig fbufferConfig = fbufferConfigs[0];
-  glXGetFBConfigAttrib(window->display,
-  										 fbufferConfig  ,
-  										 GLX_VISUAL_ID  ,
-  										 &visualID 			);
-
-  graphics->context = glXCreateNewContext(window->display,
-  		  																	fbufferConfig  ,
-  																				GLX_RGBA_TYPE  ,
-  																				0						   ,
-  																				True 			  	);
-  if (!graphics->context) {
-  	fprintf(stderr, "Failed to create new GLX context!\n");
-    return;
-  }
+	// Without a request the window is presented by another API, which works
+	// with any visual, so the root visual is used and there is no context.
+	int         visualID      = window->screen->root_visual;
+	GLXFBConfig fbufferConfig = nullptr;
+	if (request) {
+		fbufferConfig = chooseFramebufferConfig(window->display     ,
+		                                        window->screenNumber,
+		                                        *request            );
+		if (!fbufferConfig) {
+			fprintf(stderr, "Frame buffer configuration failed!\n");
+			return false;
+		}
+		glXGetFBConfigAttrib(window->display, fbufferConfig, GLX_VISUAL_ID,
+		                     &visualID);
+		graphics->config = fbufferConfig;
+	}
 
+	// None of the requests which create the window have replies, so they are
+	// all sent without waiting, and the first request which does wait, such as
+	// creating the context, carries them to the server.
   xcb_colormap_t colormap = xcb_generate_id(window->connection);
   xcb_create_colormap(window->connection 		 ,
       								XCB_COLORMAP_ALLOC_NONE,
@@ -124,12 +264,18 @@ void WindowXcb::setup(Extent2d extent) {
       								window->screen->root 	 ,
       								visualID 							 );
 
-  uint32_t eventMask   	= XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_KEY_PRESS;
-  uint32_t valueList[] 	= { eventMask, colormap, 0 };
-  uint32_t valueMask   	= XCB_CW_EVENT_MASK | XCB_CW_COLORMAP;
-  Xcb.window = xcb_generate_id(window->connection);
+  // Until the first poll the window only selects the events which a new
+  // event manager is subscribed to.
+  uint32_t eventMask   	= xcbEventMask(window->selectedKinds, false);
+  // The chosen visual need not match the root window, in which case the
+  // depth must be that of the visual and a border pixel must be given.
+  uint32_t valueList[] 	= { 0, eventMask, colormap };
+  uint32_t valueMask   	= XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK |
+                          XCB_CW_COLORMAP;
+  window->window = xcb_generate_id(window->connection);
+  window->depth  = visualDepth(window->screen, visualID);
 	xcb_create_window(window->connection 					 ,
-            				XCB_COPY_FROM_PARENT				 ,
+            				window->depth 							 ,
             				window->window 							 ,
             				window->screen->root 				 ,
             				0 													 ,
@@ -142,51 +288,245 @@ void WindowXcb::setup(Extent2d extent) {
             				valueMask 									 ,
             				valueList										 );
 
+	// The window is routed before it is mapped, since the input thread or
+	// another window's poll may read its first events, such as the expose and
+	// configure events from mapping it, before this returns.
+	window->shared->addWindow(window->window, &window->route);
+
+	// The properties are set before mapping, so the window manager sees them
+	// when it first manages the window.
+	setWindowProperties(*window->shared->resource(), window->window, extent,
+	                    title);
+
   // NOTE: window must be mapped before glXMakeContextCurrent.
   xcb_map_window(window->connection, window->window); 
+	if (!request) {
+		return true;
+	}
 
-  Glx.Window = glXCreateWindow(window->display, fbConfig, window->window, 0);
-  if (!window->window) {
-   	xcb_destroy_window(window->connection, window->window);
-    glXDestroyContext(window->display, graphics->context);
+	graphics->context = glXCreateNewContext(window->display, fbufferConfig,
+	                                        GLX_RGBA_TYPE  , 0            ,
+	                                        True           );
+	if (!graphics->context) {
+		fprintf(stderr, "Failed to create new GLX context!\n");
+		return false;
+	}
 
-    fprintf(stderr, "Failed to destroy GLX context!\n");
-    return -1;
+  graphics->window = glXCreateWindow(window->display,
+                                     fbufferConfig  ,
+                                     window->window ,
+                                     0              );
+  if (!graphics->window) {
+    fprintf(stderr, "Failed to create GLX window!\n");
+    return false;
   }
-	graphics->drawable = window->window;
+	graphics->drawable = graphics->window;
+
+	// Partial presents copy from the back buffer, which is only possible with
+	// the MESA extension.
+	if (hasExtensionName(
+	      glXQueryExtensionsString(window->display, window->screenNumber),
+	      "GLX_MESA_copy_sub_buffer")) {
+		graphics->copySubBuffer =
+			reinterpret_cast<GraphicsResource::CopySubBufferFn>(glXGetProcAddress(
+				reinterpret_cast<const GLubyte*>("glXCopySubBufferMESA")));
+	}
 
 	// Make the OpenGL context current:
   if (!glXMakeContextCurrent(window->display   ,
   													 graphics->drawable,
   													 graphics->drawable,
   													 graphics->context )) {
-  	xcb_destroy_window(window->connection, window->window);
-    glXDestroyContext(window->display, graphics->context);
-
     fprintf(stderr, "Failed to make OpenGL context current!\n");
-    return;
+    return false;
   }
+  return true;
 }
 
-void WindowXcb::pollForEvent(EventManager& eventManager) {
+std::size_t WindowXcb::pollForEvent(EventManager& eventManager) {
+	// Reading from the connection routes the events for every window which
+	// shares it, including this one. If the input thread is running it has
+	// already routed them.
+	VOXX_LUMOS_TIMED_SCOPE("WindowXcb::pollForEvent");
 	auto* window = WindowHandle;
-	xcb_flush(window->connection);
-	xcb_generic_event_t* event;
-	constexpr uint8_t eventMask = 0x7f;
-	while ((event = xcb_poll_for_event(event))) {
-		switch (event->response_type & eventMask) {
-			case XCB_KEY_PRESS: {
-				KeyEvent keyEvent(EventActionKind::Press);
+	selectEvents(eventManager.subscribedKinds());
+	if (!window->shared->hasInputThread()) {
+		window->shared->pollEvents();
+	}
 
-			}
-			break;
-			case XCB_KEY_RELEASE: {
-				KeyEvent keyEvent(EventActionKind::Release);
-			}
+	TimedEvent  timedEvents[pollBatchSize];
+	Event       events[pollBatchSize];
+	std::size_t posted = 0, count = 0;
+
+	// However many configure events arrived since the last poll, only the
+	// latest extent is taken, and it is only posted if it changed.
+	const auto configured = window->route.extent.exchange(
+		0, std::memory_order_relaxed);
+	if (configured != 0) {
+		const auto width  = static_cast<int16_t>(configured & 0xFFFF);
+		const auto height = static_cast<int16_t>(configured >> 16);
+		if (width != window->extent.width || height != window->extent.height) {
+			window->extent = Extent2d{width, height};
+			window->damage.setBounds(window->extent);
+			window->damage.addAll();
+			posted += eventManager.postEvent(
+				Event::resize(width, height).stamped(monotonicTimeNs())) ? 1 : 0;
+		}
+	}
+	// However many expose events arrived, they are posted as one event with
+	// the extent of the exposed area, and the area itself is in the damage.
+	if (window->route.hasExposed.load(std::memory_order_relaxed)) {
+		DamageRegion exposed(window->extent);
+		if (window->shared->takeExposed(window->window, exposed) &&
+		    !exposed.empty()) {
+			const auto area = exposed.boundingRect();
+			window->damage.add(exposed);
+			posted += eventManager.postEvent(
+				Event::expose(area.extent.width, area.extent.height)
+				.stamped(monotonicTimeNs())) ? 1 : 0;
+		}
+	}
+	while ((count = pollTimedEvents(timedEvents, pollBatchSize)) != 0) {
+		VOXX_LUMOS_VALUE("WindowXcb::pollBatch", count);
+		for (std::size_t i = 0; i < count; ++i) {
+			events[i] = timedEvents[i].event;
+		}
+		posted += eventManager.postEvents(events, count);
+	}
+
+	// The pointer motion is drained after the discrete events, which it was
+	// moved ahead of as they were routed, and however many motion samples were
+	// read, there are at most two coalesced motion events.
+	while ((count = window->pointer.drain(events, pollBatchSize)) != 0) {
+		VOXX_LUMOS_VALUE("WindowXcb::pointerBatch", count);
+		posted += eventManager.postEvents(events, count);
+		if (count < pollBatchSize) {
 			break;
 		}
 	}
-	free(event);
+	return posted;
+}
+
+void WindowXcb::selectEvents(EventKindMask kinds) {
+	auto* window = WindowHandle;
+	if (kinds == window->selectedKinds) {
+		return;
+	}
+
+	// Relative motion uses raw motion when the server supports it, which is
+	// selected for the whole connection while any window uses it.
+	const bool wantsRaw = (kinds & eventKindBit(EventKind::MouseDelta)) != 0;
+	if (wantsRaw != window->rawMotion) {
+		window->rawMotion = window->shared->useRawMotion(wantsRaw) && wantsRaw;
+	}
+
+	const uint32_t eventMask = xcbEventMask(kinds, window->rawMotion);
+	xcb_change_window_attributes(window->connection, window->window,
+	                             XCB_CW_EVENT_MASK, &eventMask);
+	xcb_flush(window->connection);
+	window->selectedKinds = kinds;
+	VOXX_LUMOS_COUNT("WindowXcb::eventMaskChanges", 1);
+}
+
+int WindowXcb::fileDescriptor() const {
+	return WindowHandle->shared ? WindowHandle->shared->fileDescriptor() : -1;
+}
+
+void WindowXcb::setReadyCallback(ReadyCallback callback, void* context) {
+	if (WindowHandle->shared && WindowHandle->window) {
+		WindowHandle->shared->setReadyCallback(WindowHandle->window, callback,
+		                                       context);
+	}
+}
+
+bool WindowXcb::startInputThread() {
+	return WindowHandle->shared && WindowHandle->shared->startInputThread();
+}
+
+void WindowXcb::stopInputThread() {
+	if (WindowHandle->shared) {
+		WindowHandle->shared->stopInputThread();
+	}
+}
+
+bool WindowXcb::hasInputThread() const {
+	return WindowHandle->shared && WindowHandle->shared->hasInputThread();
+}
+
+std::size_t WindowXcb::pollTimedEvents(TimedEvent* events  ,
+                                       std::size_t maxCount) {
+	return WindowHandle->events
+	     ? WindowHandle->events->popBatch(events, maxCount) : 0;
+}
+
+void WindowXcb::setMotionCoalescing(MotionCoalescing mode) {
+	WindowHandle->pointer.setMode(mode);
+}
+
+MotionCoalescing WindowXcb::motionCoalescing() const {
+	return WindowHandle->pointer.mode();
+}
+
+uint64_t WindowXcb::pointerSamples() const {
+	return WindowHandle->pointer.samples();
+}
+
+uint64_t WindowXcb::droppedTimedEvents() const {
+	return WindowHandle->events ? WindowHandle->events->dropped() : 0;
+}
+
+const XcbConnection::ConnectionPtr& WindowXcb::connection() const {
+	return WindowHandle->shared;
+}
+
+uint32_t WindowXcb::nativeWindow() const {
+	return WindowHandle->window;
+}
+
+Extent2d WindowXcb::extent() const {
+	return WindowHandle->extent;
+}
+
+DamageRegion& WindowXcb::damage() {
+	return WindowHandle->damage;
+}
+
+const DamageRegion& WindowXcb::damage() const {
+	return WindowHandle->damage;
+}
+
+void WindowXcb::swapBuffers() {
+	glXSwapBuffers(WindowHandle->display, GfxHandle->drawable);
+}
+
+void WindowXcb::swapBuffers(const DamageRegion& region) {
+	auto* graphics = GfxHandle;
+	if (!graphics->copySubBuffer) {
+		swapBuffers();
+		return;
+	}
+
+	// GLX rectangles have their origin at the bottom left of the drawable.
+	VOXX_LUMOS_VALUE("WindowXcb::presentedPixels", region.area());
+	const auto height = WindowHandle->extent.height;
+	for (std::size_t i = 0; i < region.size(); ++i) {
+		const auto rect = region[i];
+		graphics->copySubBuffer(WindowHandle->display, graphics->drawable,
+		                        rect.x, height - rect.y - rect.extent.height,
+		                        rect.extent.width, rect.extent.height);
+	}
+}
+
+bool WindowXcb::hasPartialSwap() const {
+	return GfxHandle->copySubBuffer != nullptr;
+}
+
+void WindowXcb::setResizePolicy(const ResizePolicy& policy) {
+	WindowHandle->resizePolicy = policy;
+}
+
+const ResizePolicy& WindowXcb::resizePolicy() const {
+	return WindowHandle->resizePolicy;
 }
 
-} // namespace Voxx::Lumos
\ No newline at end of file
+} // namespace Voxx::Lumos
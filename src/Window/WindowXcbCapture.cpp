@@ -0,0 +1,414 @@
+//==--- Lumos/Window/WindowXcbCapture.cpp ------------------ -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowXcbCapture.cpp
+/// \brief This is the implementation file for capturing the frames of an XCB
+///        window to a file.
+//
+//==------------------------------------------------------------------------==//
+
+#include "WindowXcbResource.hpp"
+#include <Lumos/Window/FrameCapture.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Voxx::Lumos {
+namespace {
+
+/// The BufferFunctions struct holds the buffer object functions of OpenGL,
+/// which are loaded at run time since libGL does not need to export them.
+struct BufferFunctions {
+	PFNGLGENBUFFERSPROC     genBuffers     = nullptr;	//!< Creates buffers.
+	PFNGLDELETEBUFFERSPROC  deleteBuffers  = nullptr;	//!< Deletes buffers.
+	PFNGLBINDBUFFERPROC     bindBuffer     = nullptr;	//!< Binds a buffer.
+	PFNGLBUFFERDATAPROC     bufferData     = nullptr;	//!< Allocates a buffer.
+	PFNGLMAPBUFFERRANGEPROC mapBufferRange = nullptr;	//!< Maps a buffer.
+	PFNGLUNMAPBUFFERPROC    unmapBuffer    = nullptr;	//!< Unmaps a buffer.
+};
+
+/// Returns the buffer object functions, which are null if any of them is not
+/// available.
+BufferFunctions loadBufferFunctions() {
+	BufferFunctions functions;
+	auto load = [] (auto& function, const char* name) {
+		function = reinterpret_cast<std::remove_reference_t<decltype(function)>>(
+			glXGetProcAddress(reinterpret_cast<const GLubyte*>(name)));
+		return function != nullptr;
+	};
+	if (!load(functions.genBuffers    , "glGenBuffers"    ) ||
+	    !load(functions.deleteBuffers , "glDeleteBuffers" ) ||
+	    !load(functions.bindBuffer    , "glBindBuffer"    ) ||
+	    !load(functions.bufferData    , "glBufferData"    ) ||
+	    !load(functions.mapBufferRange, "glMapBufferRange") ||
+	    !load(functions.unmapBuffer   , "glUnmapBuffer"   )) {
+		functions = BufferFunctions();
+	}
+	return functions;
+}
+
+/// Converts a frame of BGRA \p pixels, whose rows are bottom first as OpenGL
+/// reads them, to the Y, U and V planes of a 4:2:0 Y4M frame in \p planes,
+/// using full range BT.601 coefficients. Each chroma sample is converted from
+/// the average of the pixels it covers.
+/// \param pixels The pixels of the frame.
+/// \param width  The width of the frame.
+/// \param height The height of the frame.
+/// \param planes The storage for the planes.
+void convertToY4m(const uint8_t* pixels, int width, int height,
+                  uint8_t*       planes) {
+	const int chromaWidth  = (width  + 1) / 2;
+	const int chromaHeight = (height + 1) / 2;
+	auto* yPlane = planes;
+	auto* uPlane = yPlane + width * height;
+	auto* vPlane = uPlane + chromaWidth * chromaHeight;
+	auto  row    = [pixels, width, height] (int y) {
+		return pixels + static_cast<std::size_t>(height - 1 - y) * width * 4;
+	};
+
+	for (int y = 0; y < height; ++y) {
+		const auto* source = row(y);
+		auto*       luma   = yPlane + static_cast<std::size_t>(y) * width;
+		for (int x = 0; x < width; ++x, source += 4) {
+			luma[x] = static_cast<uint8_t>(
+				(29 * source[0] + 150 * source[1] + 77 * source[2] + 128) >> 8);
+		}
+	}
+
+	// The bias keeps the sums positive, so the shifts round consistently, and
+	// only a saturated blue or red can round past the largest value.
+	for (int y = 0; y < chromaHeight; ++y) {
+		const auto* top    = row(2 * y);
+		const auto* bottom = row(std::min(2 * y + 1, height - 1));
+		for (int x = 0; x < chromaWidth; ++x) {
+			const int left  = 8 * x;
+			const int right = 4 * std::min(2 * x + 1, width - 1);
+			const int b = top[left + 0] + top[right + 0] + bottom[left + 0] +
+			              bottom[right + 0];
+			const int g = top[left + 1] + top[right + 1] + bottom[left + 1] +
+			              bottom[right + 1];
+			const int r = top[left + 2] + top[right + 2] + bottom[left + 2] +
+			              bottom[right + 2];
+			const auto index = static_cast<std::size_t>(y) * chromaWidth + x;
+			const int u = (128 * b - 43 * r - 85 * g + (128 << 10) + 512) >> 10;
+			const int v = (128 * r - 107 * g - 21 * b + (128 << 10) + 512) >> 10;
+			uPlane[index] = static_cast<uint8_t>(std::min(u, 255));
+			vPlane[index] = static_cast<uint8_t>(std::min(v, 255));
+		}
+	}
+}
+
+} // namespace anonymous
+
+struct FrameCapture::Resource {
+	/// The Readback struct holds a pixel buffer which frames are read into.
+	struct Readback {
+		GLuint buffer  = 0;				//!< The pixel buffer.
+		GLsync fence   = nullptr;	//!< Signals when the readback has finished.
+		bool   pending = false;		//!< If the buffer is being read into.
+	};
+
+	BufferFunctions       buffers;								//!< Buffer functions.
+	FenceFunctions        fences;									//!< Fence functions.
+	FILE*                 file       = nullptr;		//!< The file to write to.
+	CaptureFormat         format     = CaptureFormat::Y4m;
+	OverflowPolicy        dropPolicy = OverflowPolicy::CountAndDrop;
+	int                   width      = 0;					//!< Width of the frames.
+	int                   height     = 0;					//!< Height of the frames.
+	std::size_t           frameBytes = 0;					//!< Bytes in a frame.
+	std::vector<Readback> readbacks;							//!< The pixel buffers.
+	std::size_t           nextRead   = 0;					//!< Buffer to read into.
+	std::size_t           oldestRead = 0;					//!< Oldest pending buffer.
+	std::size_t           pending    = 0;					//!< Pending readbacks.
+
+	std::vector<std::vector<uint8_t>> frames;			//!< Frames for the writer.
+	std::vector<std::size_t>          freeFrames;	//!< Frames which are unused.
+	std::deque<std::size_t>           queued;			//!< Frames to write, in order.
+	std::vector<uint8_t>              converted;	//!< Writer only.
+	bool                              stopping = false;	//!< If it must stop.
+	std::mutex                        mutex;				//!< Guards the above.
+	std::condition_variable           frameQueued;	//!< Signals queued frames.
+	std::condition_variable           frameFreed;		//!< Signals free frames.
+	std::thread                       writer;				//!< The writer thread.
+
+	std::atomic<uint64_t> captured{0};	//!< Frames read back.
+	std::atomic<uint64_t> written{0};		//!< Frames written.
+	std::atomic<uint64_t> dropped{0};		//!< Frames dropped.
+
+	/// Queues the frames whose readback has finished for the writer, in order.
+	/// If \p wait is true, this waits for every readback and for space in the
+	/// queue, so that no frame is dropped.
+	/// \param wait If the readbacks and the writer are waited for.
+	void collect(bool wait);
+
+	/// Copies the frame of \p pixels into a free frame and queues it for the
+	/// writer. If no frame is free, this waits for one if \p wait is true or
+	/// the drop policy blocks, and otherwise drops a frame as the policy
+	/// decides.
+	/// \param pixels The pixels of the frame.
+	/// \param wait   If a full queue is waited on, whatever the policy.
+	void queue(const uint8_t* pixels, bool wait);
+
+	/// Writes queued frames until the capture stops and the queue is empty.
+	void run();
+
+	/// Writes \p frame to the file in the capture format.
+	/// \param frame The pixels of the frame.
+	void write(const std::vector<uint8_t>& frame);
+
+	/// Counts a dropped frame.
+	void drop() {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		VOXX_LUMOS_COUNT("FrameCapture::dropped", 1);
+	}
+};
+
+void FrameCapture::Resource::collect(bool wait) {
+	// The flush makes sure that a fence which has not been flushed yet will
+	// signal, and a zero timeout only tests it.
+	while (pending != 0) {
+		auto&      readback = readbacks[oldestRead];
+		const auto status   = fences.clientWaitSync(
+			readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? UINT64_MAX : 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			break;
+		}
+		fences.deleteSync(readback.fence);
+		readback.fence   = nullptr;
+		readback.pending = false;
+		oldestRead       = (oldestRead + 1) % readbacks.size();
+		--pending;
+
+		buffers.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		const auto* pixels = static_cast<const uint8_t*>(
+			buffers.mapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes,
+			                       GL_MAP_READ_BIT));
+		if (pixels) {
+			queue(pixels, wait);
+			buffers.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+		} else {
+			drop();
+		}
+		buffers.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
+
+void FrameCapture::Resource::queue(const uint8_t* pixels, bool wait) {
+	std::size_t frame = 0;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (freeFrames.empty() && !wait &&
+		    dropPolicy != OverflowPolicy::Block) {
+			// Dropping the oldest frame reuses it for this one, unless the writer
+			// already has every frame.
+			if (dropPolicy != OverflowPolicy::DropOldest || queued.empty()) {
+				drop();
+				return;
+			}
+			frame = queued.front();
+			queued.pop_front();
+			drop();
+		} else {
+			frameFreed.wait(lock, [this] { return !freeFrames.empty(); });
+			frame = freeFrames.back();
+			freeFrames.pop_back();
+		}
+	}
+
+	// The frame belongs to this thread until it is queued, so the copy is made
+	// without holding the lock.
+	memcpy(frames[frame].data(), pixels, frameBytes);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queued.push_back(frame);
+	}
+	frameQueued.notify_one();
+}
+
+void FrameCapture::Resource::run() {
+	while (true) {
+		std::size_t frame = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frameQueued.wait(lock, [this] { return stopping || !queued.empty(); });
+			if (queued.empty()) {
+				break;
+			}
+			frame = queued.front();
+			queued.pop_front();
+		}
+		write(frames[frame]);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			freeFrames.push_back(frame);
+		}
+		frameFreed.notify_one();
+	}
+	fflush(file);
+}
+
+void FrameCapture::Resource::write(const std::vector<uint8_t>& frame) {
+	VOXX_LUMOS_TIMED_SCOPE("FrameCapture::write");
+	bool ok = true;
+	if (format == CaptureFormat::Y4m) {
+		convertToY4m(frame.data(), width, height, converted.data());
+		ok = fputs("FRAME\n", file) >= 0 &&
+		     fwrite(converted.data(), converted.size(), 1, file) == 1;
+	} else {
+		// OpenGL reads the bottom row first, and raw frames are top row first.
+		const auto rowBytes = static_cast<std::size_t>(width) * 4;
+		for (int y = height; ok && y-- > 0; ) {
+			ok = fwrite(frame.data() + y * rowBytes, rowBytes, 1, file) == 1;
+		}
+	}
+	if (ok) {
+		written.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		drop();
+	}
+}
+
+FrameCapture::~FrameCapture() {
+	auto* resource = Handle;
+	resource->collect(true);
+	{
+		std::lock_guard<std::mutex> lock(resource->mutex);
+		resource->stopping = true;
+	}
+	resource->frameQueued.notify_all();
+	resource->writer.join();
+
+	for (auto& readback : resource->readbacks) {
+		if (readback.fence) {
+			resource->fences.deleteSync(readback.fence);
+		}
+		if (readback.buffer) {
+			resource->buffers.deleteBuffers(1, &readback.buffer);
+		}
+	}
+	fclose(resource->file);
+	delete resource;
+}
+
+bool FrameCapture::capture() {
+	VOXX_LUMOS_TIMED_SCOPE("FrameCapture::capture");
+	auto* resource = Handle;
+	resource->collect(false);
+	if (resource->pending == resource->readbacks.size()) {
+		resource->drop();
+		return false;
+	}
+
+	// With a pixel pack buffer bound the read only queues a transfer, which
+	// the fence signals the end of.
+	auto& readback = resource->readbacks[resource->nextRead];
+	resource->buffers.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+	glReadPixels(0, 0, resource->width, resource->height, GL_BGRA,
+	             GL_UNSIGNED_BYTE, nullptr);
+	resource->buffers.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.fence   =
+		resource->fences.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.pending = true;
+	resource->nextRead = (resource->nextRead + 1) % resource->readbacks.size();
+	++resource->pending;
+	resource->captured.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+uint64_t FrameCapture::capturedFrames() const {
+	return Handle->captured.load(std::memory_order_relaxed);
+}
+
+uint64_t FrameCapture::writtenFrames() const {
+	return Handle->written.load(std::memory_order_relaxed);
+}
+
+uint64_t FrameCapture::droppedFrames() const {
+	return Handle->dropped.load(std::memory_order_relaxed);
+}
+
+std::unique_ptr<FrameCapture>
+WindowXcb::createFrameCapture(const CaptureRequest& request) {
+	auto* window   = WindowHandle;
+	auto* graphics = GfxHandle;
+	if (!graphics->context || glXGetCurrentContext() != graphics->context) {
+		fprintf(stderr, "Window context must be current to capture frames!\n");
+		return nullptr;
+	}
+	if (window->extent.width <= 0 || window->extent.height <= 0 ||
+	    !request.path) {
+		fprintf(stderr, "Frame capture needs a path and a visible window!\n");
+		return nullptr;
+	}
+
+	// Without fences there is no way to know that a readback has finished
+	// without waiting for it, which the capture must never do.
+	auto buffers = loadBufferFunctions();
+	auto fences  = loadFenceFunctions();
+	if (!buffers.genBuffers || !fences.fenceSync) {
+		fprintf(stderr, "Frame capture needs pixel buffers and fences!\n");
+		return nullptr;
+	}
+	FILE* file = fopen(request.path, "wb");
+	if (!file) {
+		fprintf(stderr, "Failed to open %s for frame capture!\n", request.path);
+		return nullptr;
+	}
+	setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+	auto* resource       = new FrameCapture::Resource();
+	resource->buffers    = buffers;
+	resource->fences     = fences;
+	resource->file       = file;
+	resource->format     = request.format;
+	resource->dropPolicy = request.dropPolicy;
+	resource->width      = window->extent.width;
+	resource->height     = window->extent.height;
+	resource->frameBytes = static_cast<std::size_t>(resource->width) *
+	                       resource->height * 4;
+	if (request.format == CaptureFormat::Y4m) {
+		const std::size_t chromaBytes =
+			static_cast<std::size_t>((resource->width  + 1) / 2) *
+			((resource->height + 1) / 2);
+		resource->converted.resize(
+			static_cast<std::size_t>(resource->width) * resource->height +
+			2 * chromaBytes);
+		fprintf(file, "YUV4MPEG2 W%d H%d F%u:1 Ip A1:1 C420jpeg\n",
+		        resource->width, resource->height,
+		        request.frameRate ? request.frameRate : 60);
+	}
+
+	resource->readbacks.resize(std::max<uint32_t>(request.readbackFrames, 1));
+	for (auto& readback : resource->readbacks) {
+		buffers.genBuffers(1, &readback.buffer);
+		buffers.bindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		buffers.bufferData(GL_PIXEL_PACK_BUFFER, resource->frameBytes, nullptr,
+		                   GL_STREAM_READ);
+	}
+	buffers.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	const auto queuedFrames = std::max<uint32_t>(request.queuedFrames, 1);
+	resource->frames.resize(queuedFrames);
+	for (std::size_t i = 0; i < queuedFrames; ++i) {
+		resource->frames[i].resize(resource->frameBytes);
+		resource->freeFrames.push_back(i);
+	}
+	resource->writer = std::thread([resource] { resource->run(); });
+	return std::unique_ptr<FrameCapture>(new FrameCapture(resource));
+}
+
+} // namespace Voxx::Lumos
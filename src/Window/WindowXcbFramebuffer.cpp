@@ -0,0 +1,291 @@
+//==--- Lumos/Window/WindowXcbFramebuffer.cpp -------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowXcbFramebuffer.cpp
+/// \brief This file implements the framebuffer configuration selection for
+///        the XCB window, and the on-disk cache of the selection.
+//
+//==------------------------------------------------------------------------==//
+
+#include "WindowXcbResource.hpp"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Voxx::Lumos {
+namespace {
+
+/// The maximum number of entries kept in the cache file.
+constexpr std::size_t maxCacheEntries = 32;
+
+/// The CachedConfig struct defines an entry in the cache file.
+struct CachedConfig {
+	uint64_t key      = 0;	//!< The key of the display, driver and request.
+	int      configId = 0;	//!< The GLX_FBCONFIG_ID of the chosen config.
+	int      visualId = 0;	//!< The visual of the chosen config.
+};
+
+/// Hashes \p size bytes at \p data into \p hash, using FNV-1a.
+/// \param hash The hash to combine the data into.
+/// \param data The data to hash.
+/// \param size The number of bytes to hash.
+uint64_t hashBytes(uint64_t hash, const void* data, std::size_t size) {
+	auto* bytes = static_cast<const unsigned char*>(data);
+	for (std::size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+/// Hashes the null terminated \p str into \p hash, treating a null pointer as
+/// the empty string.
+/// \param hash The hash to combine the string into.
+/// \param str  The string to hash.
+uint64_t hashString(uint64_t hash, const char* str) {
+	return str ? hashBytes(hash, str, strlen(str) + 1) : hashBytes(hash, "", 1);
+}
+
+/// Returns the key which identifies the choice for \p request on \p display,
+/// which changes if the display, screen, driver or request changes.
+/// \param display      The display to create the key for.
+/// \param screenNumber The screen to create the key for.
+/// \param request      The request to create the key for.
+uint64_t cacheKey(Display*                  display     ,
+                  int                       screenNumber,
+                  const FramebufferRequest& request     ) {
+	const uint8_t fields[] = {
+		request.colorBits                         ,
+		request.alphaBits                         ,
+		request.depthBits                         ,
+		request.stencilBits                       ,
+		request.samples                           ,
+		static_cast<uint8_t>(request.doubleBuffer),
+		static_cast<uint8_t>(request.avoidCostly)
+	};
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash = hashString(hash, DisplayString(display));
+	hash = hashBytes(hash, &screenNumber, sizeof(screenNumber));
+	hash = hashString(hash, glXQueryServerString(display     ,
+	                                             screenNumber,
+	                                             GLX_VENDOR  ));
+	hash = hashString(hash, glXQueryServerString(display     ,
+	                                             screenNumber,
+	                                             GLX_VERSION ));
+	hash = hashString(hash, glXGetClientString(display, GLX_VENDOR ));
+	hash = hashString(hash, glXGetClientString(display, GLX_VERSION));
+	return hashBytes(hash, fields, sizeof(fields));
+}
+
+/// Creates the directory \p path if it does not exist, returning false if it
+/// could not be created.
+/// \param path The path of the directory to create.
+bool makeDirectory(const std::string& path) {
+	return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+/// Returns the path of the cache file, creating the directories which contain
+/// it, or an empty string if there is no cache directory.
+std::string cachePath() {
+	std::string directory;
+	if (const char* xdgCache = getenv("XDG_CACHE_HOME"); xdgCache && *xdgCache) {
+		directory = xdgCache;
+	} else if (const char* home = getenv("HOME"); home && *home) {
+		directory = std::string(home) + "/.cache";
+	} else {
+		return "";
+	}
+	if (!makeDirectory(directory) || !makeDirectory(directory + "/lumos")) {
+		return "";
+	}
+	return directory + "/lumos/fbconfig";
+}
+
+/// Reads the entries of the cache file at \p path. A missing or malformed file
+/// results in no entries.
+/// \param path The path of the cache file.
+std::vector<CachedConfig> readCache(const std::string& path) {
+	std::vector<CachedConfig> entries;
+	FILE* file = fopen(path.c_str(), "r");
+	if (!file) {
+		return entries;
+	}
+	CachedConfig entry;
+	while (fscanf(file, "%" SCNx64 " %d %d",
+	              &entry.key, &entry.configId, &entry.visualId) == 3) {
+		entries.push_back(entry);
+	}
+	fclose(file);
+	return entries;
+}
+
+/// Writes \p entries to the cache file at \p path. The file is replaced
+/// atomically so that concurrent launches never read a partial file.
+/// \param path    The path of the cache file.
+/// \param entries The entries to write.
+void writeCache(const std::string& path, const std::vector<CachedConfig>& entries) {
+	const auto tempPath = path + "." + std::to_string(getpid());
+	FILE* file = fopen(tempPath.c_str(), "w");
+	if (!file) {
+		return;
+	}
+	bool written = true;
+	for (const auto& entry : entries) {
+		written &= fprintf(file, "%016" PRIx64 " %d %d\n",
+		                   entry.key, entry.configId, entry.visualId) > 0;
+	}
+	written &= fclose(file) == 0;
+	if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+		unlink(tempPath.c_str());
+	}
+}
+
+/// Returns the value of \p attribute for \p config, or 0 if it is unknown.
+/// \param display   The display the config belongs to.
+/// \param config    The config to get the attribute of.
+/// \param attribute The attribute to get.
+int configAttribute(Display* display, GLXFBConfig config, int attribute) {
+	int value = 0;
+	return glXGetFBConfigAttrib(display, config, attribute, &value) == Success
+		? value : 0;
+}
+
+/// Returns the attributes of \p config which are used for scoring.
+/// \param display The display the config belongs to.
+/// \param config  The config to get the attributes of.
+FramebufferAttributes configAttributes(Display* display, GLXFBConfig config) {
+	const int caveat = configAttribute(display, config, GLX_CONFIG_CAVEAT);
+	FramebufferAttributes attributes;
+	attributes.red           = configAttribute(display, config, GLX_RED_SIZE  );
+	attributes.green         = configAttribute(display, config, GLX_GREEN_SIZE);
+	attributes.blue          = configAttribute(display, config, GLX_BLUE_SIZE );
+	attributes.alpha         = configAttribute(display, config, GLX_ALPHA_SIZE);
+	attributes.depth         = configAttribute(display, config, GLX_DEPTH_SIZE);
+	attributes.stencil       = configAttribute(display, config, GLX_STENCIL_SIZE);
+	attributes.samples       = configAttribute(display, config, GLX_SAMPLES   );
+	attributes.doubleBuffer  = configAttribute(display, config, GLX_DOUBLEBUFFER);
+	attributes.slow          = caveat == GLX_SLOW_CONFIG;
+	attributes.nonConformant = caveat == GLX_NON_CONFORMANT_CONFIG;
+	attributes.renderable    =
+		configAttribute(display, config, GLX_X_RENDERABLE) &&
+		configAttribute(display, config, GLX_VISUAL_ID   ) &&
+		(configAttribute(display, config, GLX_DRAWABLE_TYPE) & GLX_WINDOW_BIT) &&
+		(configAttribute(display, config, GLX_RENDER_TYPE  ) & GLX_RGBA_BIT  );
+	return attributes;
+}
+
+/// Returns the config for the cached \p entry if it still exists and still
+/// satisfies \p request, otherwise returns nullptr.
+/// \param display      The display to get the config for.
+/// \param screenNumber The screen to get the config for.
+/// \param request      The requested framebuffer properties.
+/// \param entry        The cached choice.
+GLXFBConfig cachedConfig(Display*                  display     ,
+                         int                       screenNumber,
+                         const FramebufferRequest& request     ,
+                         const CachedConfig&       entry       ) {
+	const int attributes[] = { GLX_FBCONFIG_ID, entry.configId, None };
+	int         count  = 0;
+	GLXFBConfig config = nullptr;
+	if (auto* configs = glXChooseFBConfig(display     ,
+	                                      screenNumber,
+	                                      attributes  ,
+	                                      &count      )) {
+		if (count > 0                                                        &&
+		    configAttribute(display, configs[0], GLX_VISUAL_ID) == entry.visualId &&
+		    framebufferPenalty(request, configAttributes(display, configs[0])) >= 0) {
+			config = configs[0];
+		}
+		XFree(configs);
+	}
+	return config;
+}
+
+/// Searches all configs on the screen for the one with the lowest penalty for
+/// \p request, returning nullptr if none satisfy it.
+/// \param display      The display to search.
+/// \param screenNumber The screen to search.
+/// \param request      The requested framebuffer properties.
+GLXFBConfig searchConfigs(Display*                  display     ,
+                          int                       screenNumber,
+                          const FramebufferRequest& request     ) {
+	int  count   = 0;
+	auto configs = glXGetFBConfigs(display, screenNumber, &count);
+	if (!configs) {
+		return nullptr;
+	}
+
+	GLXFBConfig best        = nullptr;
+	int         bestPenalty = -1;
+	for (int i = 0; i < count; ++i) {
+		const int penalty =
+			framebufferPenalty(request, configAttributes(display, configs[i]));
+		if (penalty >= 0 && (bestPenalty < 0 || penalty < bestPenalty)) {
+			best        = configs[i];
+			bestPenalty = penalty;
+		}
+	}
+	XFree(configs);
+	return best;
+}
+
+} // namespace anonymous
+
+GLXFBConfig chooseFramebufferConfig(Display*                  display     ,
+                                    int                       screenNumber,
+                                    const FramebufferRequest& request     ) {
+	if (!request.useCache) {
+		return searchConfigs(display, screenNumber, request);
+	}
+
+	const auto path    = cachePath();
+	const auto key     = cacheKey(display, screenNumber, request);
+	auto       entries = path.empty() ? std::vector<CachedConfig>{}
+	                                  : readCache(path);
+	for (const auto& entry : entries) {
+		if (entry.key != key) {
+			continue;
+		}
+		if (auto config = cachedConfig(display, screenNumber, request, entry)) {
+			return config;
+		}
+		break;
+	}
+
+	auto config = searchConfigs(display, screenNumber, request);
+	if (!config || path.empty()) {
+		return config;
+	}
+
+	// Replace any stale entry for the key, and keep the most recent entries so
+	// that the file does not grow without bound.
+	std::vector<CachedConfig> updated;
+	for (const auto& entry : entries) {
+		if (entry.key != key) {
+			updated.push_back(entry);
+		}
+	}
+	if (updated.size() >= maxCacheEntries) {
+		updated.erase(updated.begin(),
+		              updated.begin() + (updated.size() - maxCacheEntries + 1));
+	}
+	updated.push_back({key                                              ,
+	                   configAttribute(display, config, GLX_FBCONFIG_ID),
+	                   configAttribute(display, config, GLX_VISUAL_ID  )});
+	writeCache(path, updated);
+	return config;
+}
+
+} // namespace Voxx::Lumos
@@ -0,0 +1,125 @@
+//==--- Lumos/Window/WindowXcbResource.hpp ----------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowXcbResource.hpp
+/// \brief This file defines the resources used by the XCB window, which are
+///        shared by the translation units which implement the window.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_WINDOW_WINDOW_XCB_RESOURCE_HPP
+#define VOXEL_LUMOS_WINDOW_WINDOW_XCB_RESOURCE_HPP
+
+#include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#include <GL/glx.h>
+#include <GL/gl.h>
+
+#include <Lumos/Window/WindowXcb.hpp>
+#include <Lumos/Window/XcbConnection.hpp>
+
+namespace Voxx::Lumos {
+
+struct XcbConnection::ConnectionResource {
+	Display*          display      = nullptr;	//!< A pointer to the display.
+	xcb_connection_t* connection   = nullptr;	//!< A pointer to the connection.
+	xcb_screen_t*     screen       = nullptr;	//!< A pointer to the screen.
+	int               screenNumber = 0;				//!< The screen number to use.
+	xcb_window_t      wakeWindow   = 0;				//!< Window for waking input.
+	uint8_t           xinputOpcode = 0;				//!< XInput2 opcode, if supported.
+
+	/// The atoms which windows use, which are interned once for the connection
+	/// so that creating a window does not wait for them.
+	xcb_atom_t        wmProtocols    = XCB_ATOM_NONE;	//!< WM_PROTOCOLS.
+	xcb_atom_t        wmDeleteWindow = XCB_ATOM_NONE;	//!< WM_DELETE_WINDOW.
+	xcb_atom_t        netWmName      = XCB_ATOM_NONE;	//!< _NET_WM_NAME.
+	xcb_atom_t        utf8String     = XCB_ATOM_NONE;	//!< UTF8_STRING.
+};
+
+struct WindowXcb::WindowResource {
+ 	/// The type of a pointer to the connection to the server.
+ 	using ConnectionPtr 	= xcb_connection_t*;
+ 	/// The type of a pointer to the screen object.
+ 	using ScreenPtr 			= xcb_screen_t*;
+ 	/// The type of the X window.
+ 	using WindowType 		  = xcb_window_t;
+ 	/// The type of the queue of events routed to the window.
+ 	using QueueType 			= XcbConnection::WindowQueue;
+
+ 	Display* 			display 	 		= nullptr; 	//!< A pointer to the display.
+ 	ConnectionPtr	connection 	 	= nullptr;	//!< A pointer to the connection.
+ 	ScreenPtr 		screen 			 	= nullptr;	//!< A pointer to the screen.
+ 	WindowType		window 			 	= 0;				//!< A handle to the XCB window.
+ 	int 					screenNumber 	= 0; 				//!< The screen number to use.
+ 	uint8_t 			depth 				= 0;				//!< The depth of the window.
+ 	Extent2d 			extent 				= {0, 0};		//!< The extent of the window.
+ 	ResizePolicy  resizePolicy;							//!< Buffer reallocation policy.
+ 	DamageRegion  damage;										//!< Parts to present.
+ 	/// The kinds of events which the event mask of the window is selected for.
+ 	EventKindMask selectedKinds = EventManager::defaultSubscriptions;
+ 	/// If the window is a user of the connection's raw motion.
+ 	bool          rawMotion     = false;
+
+ 	/// The connection which the window belongs to. The display, connection and
+ 	/// screen above are cached from it.
+ 	XcbConnection::ConnectionPtr shared;
+ 	/// The events which the connection has routed to the window.
+ 	std::unique_ptr<QueueType>   events;
+ 	/// The pointer events which the connection has routed to the window.
+ 	PointerCoalescer             pointer;
+ 	/// Where the connection routes the events for the window.
+ 	XcbConnection::WindowRoute   route;
+};
+
+struct WindowXcb::GraphicsResource {
+	/// Defines the type of glXCopySubBufferMESA, which is loaded at run time.
+	using CopySubBufferFn = void (*)(Display*, GLXDrawable, int, int, int, int);
+
+	GLXFBConfig     config        = nullptr;	//!< The framebuffer configuration.
+	GLXContext      context       = nullptr;	//!< A handle to the OpenGL context.
+	GLXWindow       window        = 0;				//!< A handle to the OpenGL window.
+	GLXDrawable     drawable      = 0;				//!< A handle to the drawable object.
+	CopySubBufferFn copySubBuffer = nullptr;	//!< Partial present, if supported.
+};
+
+/// The FenceFunctions struct holds the fence functions of OpenGL, which are
+/// loaded at run time since libGL does not need to export them.
+struct FenceFunctions {
+	PFNGLFENCESYNCPROC      fenceSync      = nullptr;	//!< Inserts a fence.
+	PFNGLCLIENTWAITSYNCPROC clientWaitSync = nullptr;	//!< Tests a fence.
+	PFNGLDELETESYNCPROC     deleteSync     = nullptr;	//!< Deletes a fence.
+};
+
+/// Returns the fence functions for the current context, which are null if the
+/// context supports neither OpenGL 3.2 nor ARB_sync.
+FenceFunctions loadFenceFunctions();
+
+/// Returns true if the space separated list of \p extensions has the
+/// extension \p name. Extension names may be prefixes of others, so only whole
+/// names match.
+/// \param extensions The list of extensions, which may be null.
+/// \param name       The name of the extension.
+bool hasExtensionName(const char* extensions, const char* name);
+
+/// Chooses the framebuffer configuration on \p screenNumber of \p display
+/// which best matches \p request, returning nullptr if none is suitable. If
+/// the request allows it, the choice is cached on disk so that later launches
+/// on the same display and driver skip the search.
+/// \param display      The display to choose the configuration for.
+/// \param screenNumber The screen to choose the configuration for.
+/// \param request      The requested framebuffer properties.
+GLXFBConfig chooseFramebufferConfig(Display*                  display     ,
+                                    int                       screenNumber,
+                                    const FramebufferRequest& request     );
+
+} // namespace Voxx::Lumos
+
+#endif // VOXEL_LUMOS_WINDOW_WINDOW_XCB_RESOURCE_HPP
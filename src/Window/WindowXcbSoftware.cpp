@@ -0,0 +1,356 @@
+//==--- Lumos/Window/WindowXcbSoftware.cpp ----------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowXcbSoftware.cpp
+/// \brief This is the implementation file for presenting frames rendered by
+///        the CPU to an XCB window.
+//
+//==------------------------------------------------------------------------==//
+
+#include "WindowXcbResource.hpp"
+#include <xcb/shm.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace Voxx::Lumos {
+
+namespace {
+
+/// The SoftwareBuffer struct holds a single framebuffer.
+struct SoftwareBuffer {
+	WindowXcb::PixelType*        pixels       = nullptr;	//!< The pixels.
+	xcb_shm_seg_t                segment      = 0;				//!< The SHM segment.
+	xcb_get_input_focus_cookie_t fence        = {0};			//!< Read fence.
+	bool                         fencePending = false;		//!< If fence is live.
+};
+
+/// Defines the size of the fixed part of a PutImage request, in bytes.
+constexpr std::size_t putImageHeaderSize = 24;
+
+/// Returns true if the server supports the MIT-SHM extension.
+/// \param connection The connection to the server.
+bool hasSharedMemory(xcb_connection_t* connection) {
+	const auto* extension = xcb_get_extension_data(connection, &xcb_shm_id);
+	if (!extension || !extension->present) {
+		return false;
+	}
+	auto* reply = xcb_shm_query_version_reply(
+		connection, xcb_shm_query_version(connection), nullptr);
+	const bool supported = reply != nullptr;
+	free(reply);
+	return supported;
+}
+
+/// Creates a shared memory segment of \p size bytes and attaches it to the
+/// server as \p buffer's segment, returning false on failure. The segment is
+/// marked for removal as soon as the server has attached it, so that it is
+/// released even if the process exits without detaching it.
+/// \param connection The connection to the server.
+/// \param buffer     The buffer to create the segment for.
+/// \param size       The size of the segment, in bytes.
+bool createSharedBuffer(xcb_connection_t* connection,
+                        SoftwareBuffer&   buffer    ,
+                        std::size_t       size      ) {
+	const auto shmId = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+	if (shmId < 0) {
+		return false;
+	}
+
+	auto* address = shmat(shmId, nullptr, 0);
+	if (address == reinterpret_cast<void*>(-1)) {
+		shmctl(shmId, IPC_RMID, nullptr);
+		return false;
+	}
+
+	buffer.segment = xcb_generate_id(connection);
+	auto* error    = xcb_request_check(
+		connection, xcb_shm_attach_checked(connection, buffer.segment, shmId, 1));
+	shmctl(shmId, IPC_RMID, nullptr);
+	if (error) {
+		free(error);
+		shmdt(address);
+		buffer.segment = 0;
+		return false;
+	}
+	buffer.pixels = static_cast<WindowXcb::PixelType*>(address);
+	return true;
+}
+
+/// Releases the memory for \p buffer.
+/// \param connection   The connection to the server.
+/// \param buffer       The buffer to release.
+/// \param sharedMemory If the buffer is in shared memory.
+void destroyBuffer(xcb_connection_t* connection  ,
+                   SoftwareBuffer&   buffer      ,
+                   bool              sharedMemory) {
+	if (buffer.fencePending) {
+		xcb_discard_reply(connection, buffer.fence.sequence);
+		buffer.fencePending = false;
+	}
+	if (!buffer.pixels) {
+		return;
+	}
+	if (sharedMemory) {
+		xcb_shm_detach(connection, buffer.segment);
+		shmdt(buffer.pixels);
+	} else {
+		delete[] buffer.pixels;
+	}
+	buffer.pixels = nullptr;
+}
+
+} // namespace anonymous
+
+struct WindowXcb::SoftwareResource {
+	SoftwareBuffer buffers[maxSoftwareBuffers];		//!< The framebuffers.
+	std::size_t    bufferCount   = 0;							//!< Number of buffers.
+	std::size_t    current       = 0;							//!< The acquired buffer.
+	std::size_t    rowsPerPut    = 0;							//!< Rows per put image.
+	Extent2d       extent        = {0, 0};				//!< Presented extent.
+	Extent2d       capacity      = {0, 0};				//!< Allocated extent.
+	xcb_gcontext_t context       = 0;							//!< Graphics context.
+	uint8_t        depth         = 0;							//!< Window depth.
+	bool           acquired      = false;					//!< If a buffer is acquired.
+	bool           sharedMemory  = false;					//!< If SHM is used.
+	/// The rows of a rectangle which is presented from client memory, packed
+	/// without the stride.
+	std::vector<PixelType> packed;
+};
+
+bool WindowXcb::enableSoftwarePresent(std::size_t bufferCount) {
+	auto* window = WindowHandle;
+	if (SoftwareHandle || !window->connection || !window->window) {
+		return false;
+	}
+
+	auto* software         = new SoftwareResource();
+	software->bufferCount  = bufferCount < 2 ? 2
+	                       : bufferCount > maxSoftwareBuffers ? maxSoftwareBuffers
+	                       : bufferCount;
+	software->extent       = window->extent;
+	software->depth        = window->depth;
+	software->sharedMemory = hasSharedMemory(window->connection);
+	SoftwareHandle         = software;
+	allocateSoftwareBuffers(window->extent);
+
+	software->context = xcb_generate_id(window->connection);
+	xcb_create_gc(window->connection, software->context, window->window, 0,
+	              nullptr);
+	return true;
+}
+
+void WindowXcb::allocateSoftwareBuffers(Extent2d capacity) {
+	auto*      window     = WindowHandle;
+	auto*      software   = SoftwareHandle;
+	const auto pixelCount = static_cast<std::size_t>(capacity.width) *
+	                        static_cast<std::size_t>(capacity.height);
+	const auto size       = pixelCount * sizeof(PixelType);
+	software->capacity    = capacity;
+
+	// If any segment cannot be shared (for example when the server is remote)
+	// then all the buffers fall back to client memory.
+	if (software->sharedMemory) {
+		for (std::size_t i = 0; i < software->bufferCount; ++i) {
+			if (!createSharedBuffer(window->connection, software->buffers[i], size)) {
+				for (std::size_t j = 0; j < i; ++j) {
+					destroyBuffer(window->connection, software->buffers[j], true);
+				}
+				software->sharedMemory = false;
+				break;
+			}
+		}
+	}
+	if (!software->sharedMemory) {
+		for (std::size_t i = 0; i < software->bufferCount; ++i) {
+			software->buffers[i].pixels = new PixelType[pixelCount]();
+		}
+	}
+
+	// Put image requests must fit within the maximum request length, so the
+	// fallback path sends as many whole rows as fit in each request.
+	const auto maxRequestBytes =
+		static_cast<std::size_t>(xcb_get_maximum_request_length(window->connection)) * 4;
+	const auto rowBytes = static_cast<std::size_t>(capacity.width) *
+	                      sizeof(PixelType);
+	software->rowsPerPut = (maxRequestBytes - putImageHeaderSize) / rowBytes;
+	software->rowsPerPut = software->rowsPerPut ? software->rowsPerPut : 1;
+}
+
+void WindowXcb::resizeSoftwareBuffers() {
+	auto*       software = SoftwareHandle;
+	const auto& extent   = WindowHandle->extent;
+	const auto  capacity = resizedCapacity(WindowHandle->resizePolicy,
+	                                       software->capacity        ,
+	                                       extent                    );
+	software->extent = extent;
+	if (capacity.width  == software->capacity.width &&
+	    capacity.height == software->capacity.height) {
+		return;
+	}
+
+	// The server keeps its own mapping of a segment until it processes the
+	// detach, which follows any put image which is still reading it, so the
+	// buffers can be released without waiting for their fences.
+	VOXX_LUMOS_COUNT("WindowXcb::softwareReallocations", 1);
+	for (std::size_t i = 0; i < software->bufferCount; ++i) {
+		destroyBuffer(WindowHandle->connection, software->buffers[i],
+		              software->sharedMemory);
+	}
+	allocateSoftwareBuffers(capacity);
+}
+
+WindowXcb::PixelType* WindowXcb::acquireSoftwareBuffer() {
+	auto* software = SoftwareHandle;
+	if (!software) {
+		return nullptr;
+	}
+
+	// The reply to the request which followed the put image for this buffer
+	// can only arrive once the server has processed the put image, so once the
+	// reply has arrived the server is no longer reading the buffer. With two or
+	// three buffers the reply has almost always arrived already.
+	if (software->extent.width  != WindowHandle->extent.width ||
+	    software->extent.height != WindowHandle->extent.height) {
+		resizeSoftwareBuffers();
+	}
+
+	auto& buffer = software->buffers[software->current];
+	if (buffer.fencePending) {
+		free(xcb_get_input_focus_reply(WindowHandle->connection, buffer.fence,
+		                               nullptr));
+		buffer.fencePending = false;
+	}
+	software->acquired = true;
+	return buffer.pixels;
+}
+
+bool WindowXcb::presentSoftwareBuffer() {
+	DamageRegion region(WindowHandle->extent);
+	region.addAll();
+	return presentSoftwareBuffer(region);
+}
+
+bool WindowXcb::presentSoftwareBuffer(const DamageRegion& region) {
+	VOXX_LUMOS_TIMED_SCOPE("WindowXcb::presentSoftwareBuffer");
+	auto* software = SoftwareHandle;
+	if (!software || !software->acquired) {
+		return false;
+	}
+
+	// Only the parts of the region which are inside the buffer are presented,
+	// and the rows of the buffer are always the full stride.
+	auto*        window = WindowHandle;
+	auto&        buffer = software->buffers[software->current];
+	const auto   stride = static_cast<uint16_t>(software->capacity.width);
+	DamageRegion clipped(software->extent);
+	clipped.add(region);
+	VOXX_LUMOS_VALUE("WindowXcb::presentedPixels", clipped.area());
+
+	for (std::size_t i = 0; i < clipped.size(); ++i) {
+		const auto rect   = clipped[i];
+		const auto width  = static_cast<uint16_t>(rect.extent.width);
+		const auto height = static_cast<uint16_t>(rect.extent.height);
+		if (software->sharedMemory) {
+			xcb_shm_put_image(window->connection         ,
+			                  window->window             ,
+			                  software->context          ,
+			                  stride                     ,
+			                  static_cast<uint16_t>(software->capacity.height),
+			                  static_cast<uint16_t>(rect.x),
+			                  static_cast<uint16_t>(rect.y),
+			                  width                      ,
+			                  height                     ,
+			                  rect.x                     ,
+			                  rect.y                     ,
+			                  software->depth            ,
+			                  XCB_IMAGE_FORMAT_Z_PIXMAP  ,
+			                  0                          ,
+			                  buffer.segment             ,
+			                  0                          );
+			continue;
+		}
+
+		// libxcb has consumed the pixels by the time xcb_put_image returns, so
+		// the client memory buffers never need a fence. Rectangles which span the
+		// window send whole rows of the buffer, which the server clips to the
+		// window, and narrower ones are packed so only their pixels are sent.
+		const bool wholeRows = rect.x == 0 &&
+		                       rect.extent.width == software->extent.width;
+		const auto putWidth  = wholeRows ? stride : width;
+		if (!wholeRows) {
+			software->packed.resize(software->rowsPerPut * width);
+		}
+		for (std::size_t row = 0; row < height; row += software->rowsPerPut) {
+			const auto rows  = row + software->rowsPerPut > height
+			                 ? height - row : software->rowsPerPut;
+			const auto first = buffer.pixels + (rect.y + row) * stride + rect.x;
+			if (!wholeRows) {
+				for (std::size_t r = 0; r < rows; ++r) {
+					std::copy(first + r * stride, first + r * stride + width,
+					          software->packed.data() + r * width);
+				}
+			}
+			xcb_put_image(window->connection                                  ,
+			              XCB_IMAGE_FORMAT_Z_PIXMAP                           ,
+			              window->window                                      ,
+			              software->context                                   ,
+			              putWidth                                            ,
+			              static_cast<uint16_t>(rows)                         ,
+			              rect.x                                              ,
+			              static_cast<int16_t>(rect.y + row)                  ,
+			              0                                                   ,
+			              software->depth                                     ,
+			              static_cast<uint32_t>(rows * putWidth * sizeof(PixelType)),
+			              reinterpret_cast<const uint8_t*>(
+			                wholeRows ? first : software->packed.data())      );
+		}
+	}
+
+	// The fence follows every put image for the buffer, so its reply means the
+	// server has finished reading all of them.
+	if (software->sharedMemory && !clipped.empty()) {
+		buffer.fence        = xcb_get_input_focus(window->connection);
+		buffer.fencePending = true;
+	}
+	xcb_flush(window->connection);
+
+	software->acquired = false;
+	software->current  = (software->current + 1) % software->bufferCount;
+	return true;
+}
+
+std::size_t WindowXcb::softwareStride() const {
+	return SoftwareHandle
+	     ? static_cast<std::size_t>(SoftwareHandle->capacity.width) : 0;
+}
+
+bool WindowXcb::usesSharedMemory() const {
+	return SoftwareHandle && SoftwareHandle->sharedMemory;
+}
+
+void WindowXcb::destroySoftwarePresent() {
+	auto* software = SoftwareHandle;
+	if (!software) {
+		return;
+	}
+	for (std::size_t i = 0; i < software->bufferCount; ++i) {
+		destroyBuffer(WindowHandle->connection, software->buffers[i],
+		              software->sharedMemory);
+	}
+	xcb_free_gc(WindowHandle->connection, software->context);
+	delete software;
+	SoftwareHandle = nullptr;
+}
+
+} // namespace Voxx::Lumos
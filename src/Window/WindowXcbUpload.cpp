@@ -0,0 +1,391 @@
+//==--- Lumos/Window/WindowXcbUpload.cpp ------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowXcbUpload.cpp
+/// \brief This is the implementation file for uploading OpenGL resources for
+///        an XCB window from worker threads.
+//
+//==------------------------------------------------------------------------==//
+
+#include "WindowXcbResource.hpp"
+#include <Lumos/Window/GlUploadQueue.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Voxx::Lumos {
+namespace {
+
+/// Set when an X error is raised while an ErrorTrap is installed.
+std::atomic<bool> trappedError{false};
+
+/// Records that an X error was raised, instead of exiting as the default
+/// handler does.
+int trapError(Display*, XErrorEvent*) {
+	trappedError.store(true, std::memory_order_relaxed);
+	return 0;
+}
+
+/// The ErrorTrap struct installs an X error handler which records errors
+/// rather than exiting, for calls which fail with an X error on some servers.
+/// The handler is global, so it also traps the errors of other threads while
+/// it is installed.
+struct ErrorTrap {
+	/// Constructor -- installs the handler, once the errors of earlier requests
+	/// have been reported.
+	/// \param display The display to trap the errors of.
+	explicit ErrorTrap(Display* display) : TrapDisplay(display) {
+		XSync(TrapDisplay, False);
+		trappedError.store(false, std::memory_order_relaxed);
+		Previous = XSetErrorHandler(trapError);
+	}
+
+	/// Destructor -- restores the previous handler, once the errors of the
+	/// trapped requests have been reported.
+	~ErrorTrap() {
+		XSync(TrapDisplay, False);
+		XSetErrorHandler(Previous);
+	}
+
+	/// Returns true if an error has been raised by a request made since the
+	/// handler was installed.
+	bool failed() const {
+		XSync(TrapDisplay, False);
+		return trappedError.load(std::memory_order_relaxed);
+	}
+
+	Display*      TrapDisplay = nullptr;	//!< The display.
+	XErrorHandler Previous    = nullptr;	//!< The previous handler.
+};
+
+} // namespace anonymous
+
+FenceFunctions loadFenceFunctions() {
+	FenceFunctions functions;
+	const auto* version    =
+		reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	const auto* extensions =
+		reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+	int major = 0, minor = 0;
+	if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) {
+		return functions;
+	}
+	if (major < 3 || (major == 3 && minor < 2)) {
+		if (!hasExtensionName(extensions, "GL_ARB_sync")) {
+			return functions;
+		}
+	}
+
+	auto load = [] (const char* name) {
+		return glXGetProcAddress(reinterpret_cast<const GLubyte*>(name));
+	};
+	functions.fenceSync      =
+		reinterpret_cast<PFNGLFENCESYNCPROC>(load("glFenceSync"));
+	functions.clientWaitSync =
+		reinterpret_cast<PFNGLCLIENTWAITSYNCPROC>(load("glClientWaitSync"));
+	functions.deleteSync     =
+		reinterpret_cast<PFNGLDELETESYNCPROC>(load("glDeleteSync"));
+	if (!functions.fenceSync || !functions.clientWaitSync ||
+	    !functions.deleteSync) {
+		functions = FenceFunctions();
+	}
+	return functions;
+}
+
+struct GlUploadQueue::Resource {
+	/// The Job struct holds a job which has been submitted.
+	struct Job {
+		JobFn upload   = nullptr;	//!< Performs the upload.
+		JobFn complete = nullptr;	//!< Takes the uploaded objects.
+		void* context  = nullptr;	//!< The context of the job.
+	};
+
+	/// The Uploaded struct holds a job whose upload has been submitted to the
+	/// GPU, and the fence which signals when it has finished.
+	struct Uploaded {
+		JobFn  complete = nullptr;	//!< Takes the uploaded objects.
+		void*  context  = nullptr;	//!< The context of the job.
+		GLsync fence    = nullptr;	//!< Signals when the upload has finished.
+	};
+
+	/// The Worker struct holds a worker thread and its context.
+	struct Worker {
+		GLXContext  context = nullptr;	//!< Shares objects with the window.
+		GLXPbuffer  pbuffer = 0;				//!< The drawable, if any.
+		std::thread thread;							//!< The worker thread.
+	};
+
+	Display*                 display   = nullptr;	//!< The display.
+	FenceFunctions           fences;							//!< Fence functions.
+	std::vector<Worker>      workers;							//!< The workers.
+	std::size_t              capacity  = 0;				//!< Maximum waiting jobs.
+	std::size_t              started   = 0;				//!< Workers which started.
+	bool                     failed    = false;		//!< If a worker failed.
+	bool                     stopping  = false;		//!< If workers must stop.
+	std::deque<Job>          jobs;								//!< Jobs to run.
+	std::vector<Uploaded>    uploaded;						//!< Uploads to collect.
+	std::vector<Uploaded>    collecting;					//!< Render thread only.
+	std::atomic<std::size_t> pending{0};					//!< Uncompleted jobs.
+	std::mutex               mutex;								//!< Guards the above.
+	std::condition_variable  jobReady;						//!< Signals jobs.
+	std::condition_variable  workerStarted;				//!< Signals starts.
+
+	/// Runs jobs with the context of \p worker current until the queue stops.
+	/// \param worker The worker to run the jobs for.
+	void run(Worker& worker);
+};
+
+void GlUploadQueue::Resource::run(Worker& worker) {
+	// Without a pbuffer the context is made current on no drawable, which is
+	// allowed for the OpenGL 3.0 contexts made by glXCreateContextAttribsARB.
+	const bool current =
+		glXMakeContextCurrent(display, worker.pbuffer, worker.pbuffer,
+		                      worker.context);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++started;
+		failed = failed || !current;
+	}
+	workerStarted.notify_all();
+	if (!current) {
+		return;
+	}
+
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping) {
+				break;
+			}
+			job = jobs.front();
+			jobs.pop_front();
+		}
+
+		// The fence must be flushed so that the render thread's context can see
+		// it signal. Without fences the upload is finished before it completes.
+		VOXX_LUMOS_TIMED_SCOPE("GlUploadQueue::upload");
+		job.upload(job.context);
+		GLsync fence = nullptr;
+		if (fences.fenceSync) {
+			fence = fences.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+		} else {
+			glFinish();
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		uploaded.push_back({job.complete, job.context, fence});
+	}
+	glXMakeContextCurrent(display, 0, 0, nullptr);
+}
+
+GlUploadQueue::~GlUploadQueue() {
+	auto* resource = Handle;
+	{
+		std::lock_guard<std::mutex> lock(resource->mutex);
+		resource->stopping = true;
+		resource->jobs.clear();
+	}
+	resource->jobReady.notify_all();
+	for (auto& worker : resource->workers) {
+		if (worker.thread.joinable()) {
+			worker.thread.join();
+		}
+	}
+
+	// The fences belong to the share group, so the render thread's context can
+	// delete them.
+	for (auto* list : {&resource->uploaded, &resource->collecting}) {
+		for (const auto& upload : *list) {
+			if (upload.fence) {
+				resource->fences.deleteSync(upload.fence);
+			}
+		}
+	}
+	for (auto& worker : resource->workers) {
+		if (worker.pbuffer) {
+			glXDestroyPbuffer(resource->display, worker.pbuffer);
+		}
+		if (worker.context) {
+			glXDestroyContext(resource->display, worker.context);
+		}
+	}
+	delete resource;
+}
+
+bool GlUploadQueue::submit(JobFn upload, JobFn complete, void* context) {
+	auto* resource = Handle;
+	{
+		std::lock_guard<std::mutex> lock(resource->mutex);
+		if (resource->jobs.size() >= resource->capacity) {
+			VOXX_LUMOS_COUNT("GlUploadQueue::rejected", 1);
+			return false;
+		}
+		resource->jobs.push_back({upload, complete, context});
+		resource->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	resource->jobReady.notify_one();
+	return true;
+}
+
+std::size_t GlUploadQueue::collect() {
+	auto* resource = Handle;
+	auto& uploads  = resource->collecting;
+	{
+		std::lock_guard<std::mutex> lock(resource->mutex);
+		uploads.insert(uploads.end(), resource->uploaded.begin(),
+		               resource->uploaded.end());
+		resource->uploaded.clear();
+	}
+
+	// A zero timeout only tests the fence, so uploads which are still running
+	// are kept, in order, for the next collection.
+	std::size_t completed = 0, kept = 0;
+	for (const auto& upload : uploads) {
+		if (upload.fence) {
+			const auto status =
+				resource->fences.clientWaitSync(upload.fence, 0, 0);
+			if (status == GL_TIMEOUT_EXPIRED) {
+				uploads[kept++] = upload;
+				continue;
+			}
+			resource->fences.deleteSync(upload.fence);
+		}
+		if (upload.complete) {
+			upload.complete(upload.context);
+		}
+		++completed;
+	}
+	uploads.resize(kept);
+	resource->pending.fetch_sub(completed, std::memory_order_relaxed);
+	VOXX_LUMOS_VALUE("GlUploadQueue::completed", completed);
+	return completed;
+}
+
+std::size_t GlUploadQueue::pending() const {
+	return Handle->pending.load(std::memory_order_relaxed);
+}
+
+std::size_t GlUploadQueue::workerCount() const {
+	return Handle->workers.size();
+}
+
+bool GlUploadQueue::usesFences() const {
+	return Handle->fences.fenceSync != nullptr;
+}
+
+std::unique_ptr<GlUploadQueue>
+WindowXcb::createUploadQueue(std::size_t workerCount, std::size_t capacity) {
+	auto* window   = WindowHandle;
+	auto* graphics = GfxHandle;
+	if (!graphics->context || glXGetCurrentContext() != graphics->context) {
+		fprintf(stderr, "Window context must be current to create uploads!\n");
+		return nullptr;
+	}
+
+	// Workers use a pbuffer if the window's configuration has them, since any
+	// server can make a context current on one, and no drawable otherwise.
+	int drawableTypes = 0;
+	glXGetFBConfigAttrib(window->display, graphics->config, GLX_DRAWABLE_TYPE,
+	                     &drawableTypes);
+	const bool usePbuffer = (drawableTypes & GLX_PBUFFER_BIT) != 0;
+
+	// Only contexts made by glXCreateContextAttribsARB for OpenGL 3.0 or later
+	// can be made current without a drawable, so those are used when there is
+	// no pbuffer.
+	PFNGLXCREATECONTEXTATTRIBSARBPROC createContextAttribs = nullptr;
+	if (!usePbuffer) {
+		if (hasExtensionName(
+		      glXQueryExtensionsString(window->display, window->screenNumber),
+		      "GLX_ARB_create_context")) {
+			createContextAttribs =
+				reinterpret_cast<PFNGLXCREATECONTEXTATTRIBSARBPROC>(glXGetProcAddress(
+					reinterpret_cast<const GLubyte*>("glXCreateContextAttribsARB")));
+		}
+		if (!createContextAttribs) {
+			fprintf(stderr, "No drawable is available for upload contexts!\n");
+			return nullptr;
+		}
+	}
+
+	auto* resource     = new GlUploadQueue::Resource();
+	auto  queue        = std::unique_ptr<GlUploadQueue>(
+		new GlUploadQueue(resource));
+	resource->display  = window->display;
+	resource->fences   = loadFenceFunctions();
+	resource->capacity = capacity ? capacity : 1;
+	resource->workers  = std::vector<GlUploadQueue::Resource::Worker>(
+		workerCount ? workerCount : 1);
+
+	const int pbufferAttributes[] = {
+		GLX_PBUFFER_WIDTH , 1,
+		GLX_PBUFFER_HEIGHT, 1,
+		None
+	};
+	const int contextAttributes[] = {
+		GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
+		GLX_CONTEXT_MINOR_VERSION_ARB, 0,
+		None
+	};
+
+	// Servers report unsupported contexts and drawables as X errors, which the
+	// default handler exits on, so they are trapped until every worker has
+	// made its context current, and the queue fails instead. A failed queue is
+	// destroyed while the errors are still trapped, since destroying objects
+	// which failed to be created raises more errors.
+	ErrorTrap errors(window->display);
+	auto fail = [&queue] (const char* message) {
+		fprintf(stderr, "%s\n", message);
+		queue.reset();
+		return nullptr;
+	};
+	for (auto& worker : resource->workers) {
+		worker.context = createContextAttribs
+			? createContextAttribs(window->display  , graphics->config,
+			                       graphics->context, True            ,
+			                       contextAttributes)
+			: glXCreateNewContext(window->display , graphics->config ,
+			                      GLX_RGBA_TYPE   , graphics->context,
+			                      True            );
+		if (!worker.context || errors.failed()) {
+			return fail("Failed to create upload context!");
+		}
+		if (usePbuffer) {
+			worker.pbuffer = glXCreatePbuffer(window->display, graphics->config,
+			                                  pbufferAttributes);
+			if (!worker.pbuffer || errors.failed()) {
+				return fail("Failed to create upload pbuffer!");
+			}
+		}
+		worker.thread = std::thread([resource, &worker] {
+			resource->run(worker);
+		});
+	}
+
+	// Each worker makes its context current on its own thread, and the queue
+	// is only returned once all of them have.
+	std::unique_lock<std::mutex> lock(resource->mutex);
+	resource->workerStarted.wait(lock, [resource] {
+		return resource->started == resource->workers.size();
+	});
+	if (resource->failed || errors.failed()) {
+		lock.unlock();
+		return fail("Failed to make upload context current!");
+	}
+	return queue;
+}
+
+} // namespace Voxx::Lumos
@@ -0,0 +1,797 @@
+//==--- Lumos/Window/XcbConnection.cpp --------------------- -*- C++ -*- ---==//
+//            
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//  
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  XcbConnection.cpp
+/// \brief This is the implementation file for a connection to an X server
+///        which is shared by XCB windows.
+//
+//==------------------------------------------------------------------------==//
+
+#include "WindowXcbResource.hpp"
+#if defined(VOXX_LUMOS_XINPUT)
+#include <xcb/xinput.h>
+#endif
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace Voxx::Lumos {
+
+struct XcbConnection::InputThread {
+	std::atomic<bool> running{true};	//!< If the thread must continue.
+	std::thread       thread;					//!< The input thread.
+};
+
+namespace {
+
+/// Mask for the response type of an XCB event, removing the synthetic bit.
+constexpr uint8_t responseTypeMask = 0x7f;
+
+/// Defines the type of fixed point pointer motion.
+using FixedType = PointerCoalescer::FixedType;
+
+/// Converts the core X button \p button into an event, returning an Empty
+/// event for the release of a scroll button. Buttons 4 to 7 are the steps of
+/// the scroll wheel, which are converted to scroll events with a positive delta
+/// up and left, and the remaining buttons are numbered from 0 for the left
+/// button, skipping the scroll buttons.
+/// \param pressed If the button was pressed.
+/// \param button  The core X button.
+Event translateButton(bool pressed, uint8_t button) {
+	if (button >= 4 && button <= 7) {
+		if (!pressed) {
+			return Event();
+		}
+		return button == 4 ? Event::scroll( 0,  1) :
+		       button == 5 ? Event::scroll( 0, -1) :
+		       button == 6 ? Event::scroll( 1,  0) : Event::scroll(-1, 0);
+	}
+	return Event::mouseButton(pressed ? EventActionKind::Press
+	                                  : EventActionKind::Release,
+	                          static_cast<uint8_t>(button < 4 ? button - 1
+	                                                          : button - 5));
+}
+
+/// Returns true if \p event is the release of a key which is immediately
+/// followed by \p next, a press of the same key in the same window at the
+/// same server time. Core X autorepeat sends such a pair for each repeat of a
+/// key which is held, and the release is not a release of the key.
+/// \param event The event which may be an autorepeat release.
+/// \param next  The event which follows it, or null if there is none.
+bool isRepeatRelease(const xcb_generic_event_t* event,
+                     const xcb_generic_event_t* next ) {
+	if ((event->response_type & responseTypeMask) != XCB_KEY_RELEASE ||
+	    !next || (next->response_type & responseTypeMask) != XCB_KEY_PRESS) {
+		return false;
+	}
+	const auto* release = reinterpret_cast<const xcb_key_release_event_t*>(event);
+	const auto* press   = reinterpret_cast<const xcb_key_press_event_t*>(next);
+	return release->detail == press->detail && release->time  == press->time &&
+	       release->event  == press->event;
+}
+
+/// Fills \p events with \p first and the events which libxcb has already
+/// read from the socket, up to the batch size, and returns the number of
+/// events. A batch which would end with a key release takes one more event,
+/// so that an autorepeat release is always routed with the press after it,
+/// and \p events must have space for one event more than the batch size.
+/// \param connection The connection to take the queued events from.
+/// \param first      The first event of the batch.
+/// \param events     The storage for the events.
+/// Moves the pointer motion which has been routed to \p route from its
+/// coalescer to its queue, so that the discrete event which is queued next is
+/// ordered after the motion which preceded it. The route mutex must be held.
+/// \param route  The route of the window.
+/// \param readNs The time the events were read.
+void queueMotion(XcbConnection::WindowRoute& route, uint64_t readNs) {
+	Event       events[XcbConnection::pollBatchSize];
+	TimedEvent  timedEvent;
+	std::size_t count = 0;
+	timedEvent.time.localNs  = readNs;
+	timedEvent.time.serverMs = 0;
+	while ((count = route.pointer->drain(events, XcbConnection::pollBatchSize))) {
+		for (std::size_t i = 0; i < count; ++i) {
+			timedEvent.event = events[i];
+			route.events->push(timedEvent);
+		}
+		if (count < XcbConnection::pollBatchSize) {
+			break;
+		}
+	}
+}
+
+std::size_t queuedBatch(xcb_connection_t*    connection,
+                        xcb_generic_event_t* first     ,
+                        void**               events    ) {
+	std::size_t          count = 0;
+	xcb_generic_event_t* event = first;
+	events[count++]            = event;
+	while (count < XcbConnection::pollBatchSize &&
+	       (event = xcb_poll_for_queued_event(connection))) {
+		events[count++] = event;
+	}
+	const auto* last = static_cast<const xcb_generic_event_t*>(events[count - 1]);
+	if (count == XcbConnection::pollBatchSize &&
+	    (last->response_type & responseTypeMask) == XCB_KEY_RELEASE &&
+	    (event = xcb_poll_for_queued_event(connection))) {
+		events[count++] = event;
+	}
+	return count;
+}
+
+#if defined(VOXX_LUMOS_XINPUT)
+
+/// Sets the opcode of the XInput extension in \p resource if the server
+/// supports XInput 2.0, which provides raw motion. The extension data must
+/// have been prefetched. Returns true if the version of the extension was
+/// queried, which is a round trip.
+/// \param resource The resources of the connection.
+bool queryRawMotion(XcbConnection::ConnectionResource& resource) {
+	auto*       connection = resource.connection;
+	const auto* extension  = xcb_get_extension_data(connection, &xcb_input_id);
+	if (!extension || !extension->present) {
+		return false;
+	}
+
+	auto* version = xcb_input_xi_query_version_reply(
+		connection, xcb_input_xi_query_version(connection, 2, 0), nullptr);
+	const bool supported = version && version->major_version >= 2;
+	free(version);
+	if (supported) {
+		resource.xinputOpcode = extension->major_opcode;
+	}
+	return true;
+}
+
+/// Selects XInput2 raw motion events from all master pointers on the root
+/// window of \p resource if \p enable is true, and deselects them otherwise.
+/// \param resource The resources of the connection.
+/// \param enable   If raw motion events are selected.
+void selectRawMotion(XcbConnection::ConnectionResource& resource, bool enable) {
+	struct {
+		xcb_input_event_mask_t header;
+		uint32_t               mask;
+	} eventMask;
+	eventMask.header.deviceid = XCB_INPUT_DEVICE_ALL_MASTER;
+	eventMask.header.mask_len = 1;
+	eventMask.mask            = enable ? XCB_INPUT_XI_EVENT_MASK_RAW_MOTION : 0;
+	xcb_input_xi_select_events(resource.connection, resource.screen->root, 1,
+	                           &eventMask.header);
+	xcb_flush(resource.connection);
+}
+
+/// Converts the XInput2 fixed point \p value to fixed point pointer motion.
+/// \param value The value to convert.
+FixedType toFixed(xcb_input_fp3232_t value) {
+	constexpr int fractionShift = 32 - PointerCoalescer::fractionBits;
+	return static_cast<FixedType>(value.integral) * PointerCoalescer::fixedOne
+	     + static_cast<FixedType>(value.frac >> fractionShift);
+}
+
+/// Reads the unaccelerated motion of \p rawEvent into \p dx and \p dy,
+/// returning false if the event has no motion on either axis.
+/// \param rawEvent The raw motion event.
+/// \param dx       The horizontal motion.
+/// \param dy       The vertical motion.
+bool rawMotionDelta(const xcb_input_raw_motion_event_t* rawEvent,
+                    FixedType&                          dx      ,
+                    FixedType&                          dy      ) {
+	if (rawEvent->valuators_len == 0) {
+		return false;
+	}
+
+	// Values are only present for the valuators whose bit is set in the mask,
+	// in order, and the first two valuators are the x and y axes.
+	const auto* mask   = xcb_input_raw_button_press_valuator_mask(rawEvent);
+	const auto* values = xcb_input_raw_button_press_axisvalues_raw(rawEvent);
+	std::size_t value  = 0;
+	dx = dy = 0;
+	if (mask[0] & 1) {
+		dx = toFixed(values[value++]);
+	}
+	if (mask[0] & 2) {
+		dy = toFixed(values[value++]);
+	}
+	return value != 0;
+}
+
+#endif // VOXX_LUMOS_XINPUT
+
+} // namespace anonymous
+
+XcbConnection::XcbConnection()
+: Handle(new ConnectionResource()) {}
+
+XcbConnection::~XcbConnection() {
+	stopInputThread();
+	if (Handle->display) {
+		if (Handle->wakeWindow) {
+			xcb_destroy_window(Handle->connection, Handle->wakeWindow);
+		}
+		XCloseDisplay(Handle->display);
+	}
+	delete Handle;
+}
+
+XcbConnection::ConnectionPtr XcbConnection::open(const char* displayName) {
+	auto connectionPtr = ConnectionPtr(new XcbConnection());
+	auto* resource     = connectionPtr->Handle;
+
+	// Xlib is used from render threads for GLX while the input thread may be
+	// reading from the same connection, so it must be made thread safe before
+	// the display is opened.
+	XInitThreads();
+	if (!(resource->display = XOpenDisplay(displayName))) {
+		fprintf(stderr, "Can't open display!\n");
+		return nullptr;
+	}
+	resource->screenNumber = DefaultScreen(resource->display);
+
+	if (!(resource->connection = XGetXCBConnection(resource->display))) {
+		fprintf(stderr, "Can't get XCB connection from display!\n");
+		return nullptr;
+	}
+	XSetEventQueueOwner(resource->display, XCBOwnsEventQueue);
+
+	// Find the XCB screen to use:
+	xcb_screen_iterator_t screenIterator = 
+		xcb_setup_roots_iterator(xcb_get_setup(resource->connection));
+	for (auto screenNumber = resource->screenNumber;
+			 screenIterator.rem && screenNumber > 0;
+			 --screenNumber) {
+		xcb_screen_next(&screenIterator);
+	}
+	resource->screen = screenIterator.data;
+
+	// Every request which the connection needs is sent before any reply is
+	// waited for, so together they cost a single round trip. Only the version
+	// of XInput, which is sent with the extension's opcode, costs another.
+	auto* connection = resource->connection;
+#if defined(VOXX_LUMOS_XINPUT)
+	xcb_prefetch_extension_data(connection, &xcb_input_id);
+#endif
+	const char* atomNames[] = {
+		"WM_PROTOCOLS", "WM_DELETE_WINDOW", "_NET_WM_NAME", "UTF8_STRING"
+	};
+	xcb_atom_t* atoms[] = {
+		&resource->wmProtocols, &resource->wmDeleteWindow,
+		&resource->netWmName  , &resource->utf8String
+	};
+	constexpr std::size_t    atomCount = sizeof(atoms) / sizeof(atoms[0]);
+	xcb_intern_atom_cookie_t atomCookies[atomCount];
+	for (std::size_t i = 0; i < atomCount; ++i) {
+		atomCookies[i] = xcb_intern_atom(connection, 0, strlen(atomNames[i]),
+		                                 atomNames[i]);
+	}
+	const auto keymapSequence = connectionPtr->requestKeymap();
+
+	connectionPtr->countRoundTrip();
+	for (std::size_t i = 0; i < atomCount; ++i) {
+		if (auto* reply = xcb_intern_atom_reply(connection, atomCookies[i],
+		                                        nullptr)) {
+			*atoms[i] = reply->atom;
+			free(reply);
+		}
+	}
+	connectionPtr->loadKeymap(keymapSequence);
+#if defined(VOXX_LUMOS_XINPUT)
+	if (queryRawMotion(*resource)) {
+		connectionPtr->countRoundTrip();
+	}
+#endif
+	return connectionPtr;
+}
+
+XcbConnection::ConnectionPtr XcbConnection::shared() {
+	static std::mutex                   sharedMutex;
+	static std::weak_ptr<XcbConnection> sharedConnection;
+
+	std::lock_guard<std::mutex> lock(sharedMutex);
+	auto connection = sharedConnection.lock();
+	if (!connection) {
+		connection       = open();
+		sharedConnection = connection;
+	}
+	return connection;
+}
+
+void XcbConnection::addWindow(WindowId window, WindowRoute* route) {
+	std::lock_guard<std::mutex> lock(RouteMutex);
+	Routes.insert(window, route);
+	// Each window is notified at most once per poll, so reserving a slot for
+	// every window means that routing never allocates.
+	ReadyWindows.reserve(Routes.size());
+}
+
+void XcbConnection::setReadyCallback(WindowId      window  ,
+                                     ReadyCallback callback,
+                                     void*         context ) {
+	std::lock_guard<std::mutex> lock(RouteMutex);
+	if (auto* route = Routes.find(window)) {
+		route->ready   = callback;
+		route->context = context;
+	}
+}
+
+int XcbConnection::fileDescriptor() const {
+	return xcb_get_file_descriptor(Handle->connection);
+}
+
+void XcbConnection::removeWindow(WindowId window) {
+	std::lock_guard<std::mutex> lock(RouteMutex);
+	Routes.erase(window);
+	if (PointerTarget == window) {
+		PointerTarget = 0;
+	}
+}
+
+void XcbConnection::countRoundTrip() {
+	RoundTrips.fetch_add(1, std::memory_order_relaxed);
+	VOXX_LUMOS_COUNT("XcbConnection::roundTrips", 1);
+}
+
+bool XcbConnection::takeKeymapRequest(unsigned int& sequence) {
+	if (!KeymapPending) {
+		return false;
+	}
+	sequence      = KeymapSequence;
+	KeymapPending = false;
+	return true;
+}
+
+unsigned int XcbConnection::requestKeymap() {
+	auto*       connection = Handle->connection;
+	const auto* setup      = xcb_get_setup(connection);
+	const auto  first      = setup->min_keycode;
+	const auto  count      = static_cast<uint8_t>(setup->max_keycode - first + 1);
+	return xcb_get_keyboard_mapping(connection, first, count).sequence;
+}
+
+void XcbConnection::loadKeymap(unsigned int sequence) {
+	auto*       connection = Handle->connection;
+	const auto* setup      = xcb_get_setup(connection);
+	const auto  first      = setup->min_keycode;
+	const auto  count      = static_cast<uint8_t>(setup->max_keycode - first + 1);
+	auto* reply = xcb_get_keyboard_mapping_reply(
+		connection, xcb_get_keyboard_mapping_cookie_t{sequence}, nullptr);
+	if (!reply) {
+		fprintf(stderr, "Can't get keyboard mapping!\n");
+		return;
+	}
+
+	// The keymap is replaced without the route mutex, so it is read atomically.
+	const auto current    = keymap();
+	const auto generation = current ? current->generation() + 1 : 0;
+	auto keymap = std::make_shared<const XcbKeymap>(
+		xcb_get_keyboard_mapping_keysyms(reply), reply->keysyms_per_keycode,
+		first, count, generation);
+	free(reply);
+	std::atomic_store(&Keymap, KeymapPtr(std::move(keymap)));
+}
+
+bool XcbConnection::hasRawMotion() const {
+	return Handle->xinputOpcode != 0;
+}
+
+bool XcbConnection::useRawMotion(bool use) {
+	std::lock_guard<std::mutex> lock(RouteMutex);
+	if (!Handle->xinputOpcode) {
+		return false;
+	}
+
+	// Raw motion is selected on the root window for the whole connection, so it
+	// is only selected while at least one window uses it.
+	const auto previous = RawMotionUsers;
+	RawMotionUsers = use ? RawMotionUsers + 1
+	               : RawMotionUsers ? RawMotionUsers - 1 : 0;
+	if ((previous == 0) != (RawMotionUsers == 0)) {
+#if defined(VOXX_LUMOS_XINPUT)
+		selectRawMotion(*Handle, RawMotionUsers != 0);
+#endif
+	}
+	return true;
+}
+
+std::size_t XcbConnection::windowCount() const {
+	std::lock_guard<std::mutex> lock(RouteMutex);
+	return Routes.size();
+}
+
+bool XcbConnection::takeExposed(WindowId window, DamageRegion& damage) {
+	std::lock_guard<std::mutex> lock(RouteMutex);
+	auto* route = Routes.find(window);
+	if (!route || !route->hasExposed.exchange(false, std::memory_order_relaxed)) {
+		return false;
+	}
+	damage.add(route->exposed);
+	route->exposed.clear();
+	return true;
+}
+
+std::size_t XcbConnection::pollEvents() {
+	// A poll which finds another in progress leaves a request for it to read
+	// again rather than waiting for it, and the poll in progress reads again
+	// until there are no requests, so data which arrives during a poll is
+	// never left unread. The poll mutex is released before the callbacks are
+	// invoked, so that they may poll again.
+	std::size_t routed = 0;
+	PollRequested.store(true);
+	while (PollRequested.load()) {
+		std::unique_lock<std::mutex> poll(PollMutex, std::try_to_lock);
+		if (!poll.owns_lock()) {
+			break;
+		}
+		PollRequested.store(false);
+		routed += readEvents();
+		poll.unlock();
+		notifyReady();
+	}
+	return routed;
+}
+
+std::size_t XcbConnection::readEvents() {
+	auto* connection = Handle->connection;
+	xcb_flush(connection);
+
+	// Only the first read touches the socket, the remainder of each batch is
+	// taken from the events which libxcb has already queued. The route mutex
+	// is only held while each batch is routed.
+	void*       events[pollBatchSize + 1];
+	std::size_t routed = 0;
+	auto*       event  = xcb_poll_for_event(connection);
+	const auto  readNs = monotonicTimeNs();
+	while (event) {
+		const auto count = queuedBatch(connection, event, events);
+		{
+			std::lock_guard<std::mutex> lock(RouteMutex);
+			routed += routeEvents(events, count, readNs);
+		}
+		event = count >= pollBatchSize
+		      ? xcb_poll_for_queued_event(connection) : nullptr;
+	}
+
+	unsigned int keymapSequence = 0;
+	bool         keymapChanged  = false;
+	{
+		std::lock_guard<std::mutex> lock(RouteMutex);
+		keymapChanged = takeKeymapRequest(keymapSequence);
+	}
+	if (keymapChanged) {
+		countRoundTrip();
+		loadKeymap(keymapSequence);
+	}
+	return routed;
+}
+
+void XcbConnection::notifyReady() {
+	// Each window is removed from the list before its callback is invoked, so
+	// a callback which polls again, and so adds to the list, is safe.
+	while (true) {
+		ReadyCallback callback = nullptr;
+		void*         context  = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(RouteMutex);
+			if (ReadyWindows.empty()) {
+				return;
+			}
+			auto* route = Routes.find(ReadyWindows.back());
+			ReadyWindows.pop_back();
+			if (!route) {
+				continue;
+			}
+			route->pending = false;
+			callback       = route->ready;
+			context        = route->context;
+		}
+		if (callback) {
+			callback(context);
+		}
+	}
+}
+
+std::size_t XcbConnection::routeEvents(void* const* events,
+                                       std::size_t  count ,
+                                       uint64_t     readNs) {
+	VOXX_LUMOS_TIMED_SCOPE("XcbConnection::routeEvents");
+	VOXX_LUMOS_VALUE("XcbConnection::routeBatch", count);
+
+	// Consecutive events almost always belong to the same window, so the last
+	// lookup is reused until the window changes.
+	xcb_window_t lastWindow = 0;
+	WindowRoute* route      = nullptr;
+	auto findRoute = [&] (xcb_window_t window) {
+		if (window != lastWindow || !route) {
+			route      = Routes.find(window);
+			lastWindow = window;
+		}
+		if (!route) {
+			Unrouted.fetch_add(1, std::memory_order_relaxed);
+		} else if (route->ready && !route->pending && !InputHandle) {
+			route->pending = true;
+			ReadyWindows.push_back(window);
+		}
+		return route;
+	};
+
+	const bool  rawMotion = RawMotionUsers != 0;
+	TimedEvent  timedEvent;
+	std::size_t routed = 0;
+	timedEvent.time.localNs = readNs;
+	for (std::size_t i = 0; i < count; ++i) {
+		auto*      xcbEvent     = static_cast<xcb_generic_event_t*>(events[i]);
+		const auto responseType = xcbEvent->response_type & responseTypeMask;
+		switch (responseType) {
+			case XCB_KEY_PRESS:
+			case XCB_KEY_RELEASE: {
+				// The autorepeat release before a repeated press is dropped, so that a
+				// key which is held is a press followed by repeated presses, as with
+				// detectable autorepeat, without a request to enable it.
+				const auto* keyEvent =
+					reinterpret_cast<const xcb_key_press_event_t*>(xcbEvent);
+				const auto  key  = translateXcbKeycode(keyEvent->detail);
+				const auto* next = i + 1 < count
+					? static_cast<const xcb_generic_event_t*>(events[i + 1]) : nullptr;
+				if (key == KeyEventKind::Unknown || isRepeatRelease(xcbEvent, next)) {
+					break;
+				}
+				if (auto* target = findRoute(keyEvent->event)) {
+					timedEvent.event = Event::key(
+						responseType == XCB_KEY_PRESS ? EventActionKind::Press
+						                              : EventActionKind::Release,
+						key).stamped(readNs);
+					timedEvent.time.serverMs = keyEvent->time;
+					routed += target->events->push(timedEvent) ? 1 : 0;
+				}
+				break;
+			}
+			case XCB_BUTTON_PRESS:
+			case XCB_BUTTON_RELEASE: {
+				const auto* buttonEvent =
+					reinterpret_cast<const xcb_button_press_event_t*>(xcbEvent);
+				const auto event = translateButton(
+					responseType == XCB_BUTTON_PRESS, buttonEvent->detail);
+				if (event.kind() == EventKind::Empty) {
+					break;
+				}
+				if (auto* target = findRoute(buttonEvent->event)) {
+					queueMotion(*target, readNs);
+					timedEvent.event         = event.stamped(readNs);
+					timedEvent.time.serverMs = buttonEvent->time;
+					routed += target->events->push(timedEvent) ? 1 : 0;
+				}
+				break;
+			}
+			case XCB_MOTION_NOTIFY:
+			case XCB_ENTER_NOTIFY: {
+				// Enter and motion events share the layout of the fields used here.
+				const auto* motionEvent =
+					reinterpret_cast<const xcb_motion_notify_event_t*>(xcbEvent);
+				if (auto* target = findRoute(motionEvent->event)) {
+					// Without raw motion the relative motion is the change in position,
+					// which stops at the edges of the screen.
+					const auto x = motionEvent->event_x, y = motionEvent->event_y;
+					if (!rawMotion && target->entered) {
+						target->pointer->addDelta(
+							PointerCoalescer::toFixed(x - target->x),
+							PointerCoalescer::toFixed(y - target->y), readNs);
+					}
+					target->pointer->addPosition(x, y, readNs);
+					target->x       = x;
+					target->y       = y;
+					target->entered = true;
+					PointerTarget   = motionEvent->event;
+					++routed;
+				}
+				break;
+			}
+			case XCB_MAPPING_NOTIFY: {
+				// Mapping changes are rare, so the keymap is read again, which is the
+				// only time it is read after the connection is opened. Only the request
+				// is sent here, and the reply is waited for once the route mutex has
+				// been released, so routing for other windows never waits on it.
+				const auto* mappingEvent =
+					reinterpret_cast<const xcb_mapping_notify_event_t*>(xcbEvent);
+				if (mappingEvent->request == XCB_MAPPING_KEYBOARD && !KeymapPending) {
+					KeymapSequence = requestKeymap();
+					KeymapPending  = true;
+				}
+				break;
+			}
+			case XCB_FOCUS_IN:
+			case XCB_FOCUS_OUT: {
+				// Changes of focus to and from the window under the pointer are not
+				// changes of the window's focus.
+				const auto* focusEvent =
+					reinterpret_cast<const xcb_focus_in_event_t*>(xcbEvent);
+				if (focusEvent->detail == XCB_NOTIFY_DETAIL_POINTER) {
+					break;
+				}
+				if (auto* target = findRoute(focusEvent->event)) {
+					timedEvent.event = Event::focus(responseType == XCB_FOCUS_IN)
+					                   .stamped(readNs);
+					timedEvent.time.serverMs = 0;
+					routed += target->events->push(timedEvent) ? 1 : 0;
+				}
+				break;
+			}
+			case XCB_CONFIGURE_NOTIFY: {
+				const auto* configureEvent =
+					reinterpret_cast<const xcb_configure_notify_event_t*>(xcbEvent);
+				if (auto* target = findRoute(configureEvent->window)) {
+					target->extent.store(
+						static_cast<uint32_t>(configureEvent->width) |
+						static_cast<uint32_t>(configureEvent->height) << 16,
+						std::memory_order_relaxed);
+					++routed;
+				}
+				break;
+			}
+			case XCB_EXPOSE: {
+				// A series of expose events is merged into a few rectangles, however
+				// many the server splits the exposed area into.
+				const auto* exposeEvent =
+					reinterpret_cast<const xcb_expose_event_t*>(xcbEvent);
+				if (auto* target = findRoute(exposeEvent->window)) {
+					target->exposed.add(Rect2d{
+						static_cast<int16_t>(exposeEvent->x),
+						static_cast<int16_t>(exposeEvent->y),
+						Extent2d{static_cast<int16_t>(exposeEvent->width) ,
+						         static_cast<int16_t>(exposeEvent->height)}});
+					target->hasExposed.store(true, std::memory_order_relaxed);
+					++routed;
+				}
+				break;
+			}
+			case XCB_CLIENT_MESSAGE: {
+				// The window manager asks the window to close, rather than destroying
+				// it, since the window takes part in the WM_DELETE_WINDOW protocol.
+				const auto* clientEvent =
+					reinterpret_cast<const xcb_client_message_event_t*>(xcbEvent);
+				if (clientEvent->type != Handle->wmProtocols ||
+				    clientEvent->data.data32[0] != Handle->wmDeleteWindow) {
+					break;
+				}
+				if (auto* target = findRoute(clientEvent->window)) {
+					timedEvent.event         = Event::close().stamped(readNs);
+					timedEvent.time.serverMs = 0;
+					routed += target->events->push(timedEvent) ? 1 : 0;
+				}
+				break;
+			}
+			case XCB_LEAVE_NOTIFY: {
+				const auto* leaveEvent =
+					reinterpret_cast<const xcb_leave_notify_event_t*>(xcbEvent);
+				if (auto* target = findRoute(leaveEvent->event)) {
+					target->entered = false;
+				}
+				if (PointerTarget == leaveEvent->event) {
+					PointerTarget = 0;
+				}
+				break;
+			}
+#if defined(VOXX_LUMOS_XINPUT)
+			case XCB_GE_GENERIC: {
+				// Raw motion is reported for the root window, so it is routed to the
+				// window which contains the pointer, if any.
+				const auto* genericEvent =
+					reinterpret_cast<const xcb_ge_generic_event_t*>(xcbEvent);
+				FixedType dx, dy;
+				if (!rawMotion || !PointerTarget                     ||
+				    genericEvent->extension  != Handle->xinputOpcode ||
+				    genericEvent->event_type != XCB_INPUT_RAW_MOTION ||
+				    !rawMotionDelta(
+				    	reinterpret_cast<const xcb_input_raw_motion_event_t*>(xcbEvent),
+				    	dx, dy)) {
+					break;
+				}
+				if (auto* target = findRoute(PointerTarget)) {
+					target->pointer->addDelta(dx, dy, readNs);
+					++routed;
+				}
+				break;
+			}
+#endif
+			default:
+				break;
+		}
+		free(xcbEvent);
+	}
+	return routed;
+}
+
+bool XcbConnection::startInputThread() {
+	if (InputHandle || !Handle->connection) {
+		return false;
+	}
+
+	// The input thread is woken to stop by a client message sent to a window
+	// which only exists for that purpose.
+	auto* resource = Handle;
+	if (!resource->wakeWindow) {
+		resource->wakeWindow = xcb_generate_id(resource->connection);
+		xcb_create_window(resource->connection         ,
+		                  XCB_COPY_FROM_PARENT         ,
+		                  resource->wakeWindow         ,
+		                  resource->screen->root       ,
+		                  0, 0, 1, 1, 0                ,
+		                  XCB_WINDOW_CLASS_INPUT_ONLY  ,
+		                  XCB_COPY_FROM_PARENT         ,
+		                  0                            ,
+		                  nullptr                      );
+		xcb_flush(resource->connection);
+	}
+
+	InputHandle = new InputThread();
+	auto* input = InputHandle;
+	input->thread = std::thread([this, input, connection = resource->connection] {
+		// xcb_wait_for_event blocks on the connection's file descriptor, but
+		// unlike polling the descriptor directly it also wakes when another
+		// thread waiting for a reply reads events from the socket.
+		void*                events[pollBatchSize + 1];
+		xcb_generic_event_t* event;
+		while ((event = xcb_wait_for_event(connection))) {
+			// Every event in the batch was read by the same socket read, so they
+			// share the local timestamp.
+			const auto readNs = monotonicTimeNs();
+			while (event) {
+				const auto count = queuedBatch(connection, event, events);
+				unsigned int keymapSequence = 0;
+				bool         keymapChanged  = false;
+				{
+					std::lock_guard<std::mutex> lock(RouteMutex);
+					routeEvents(events, count, readNs);
+					keymapChanged = takeKeymapRequest(keymapSequence);
+				}
+				if (keymapChanged) {
+					countRoundTrip();
+					loadKeymap(keymapSequence);
+				}
+				event = count >= pollBatchSize
+				      ? xcb_poll_for_queued_event(connection) : nullptr;
+			}
+
+			if (!input->running.load(std::memory_order_acquire)) {
+				break;
+			}
+		}
+	});
+	return true;
+}
+
+void XcbConnection::stopInputThread() {
+	if (!InputHandle) {
+		return;
+	}
+
+	// The input thread is blocked waiting for an event, so send a client message
+	// to the wake window to wake it up after telling it to stop.
+	auto* resource = Handle;
+	InputHandle->running.store(false, std::memory_order_release);
+	xcb_client_message_event_t wakeEvent;
+	memset(&wakeEvent, 0, sizeof(wakeEvent));
+	wakeEvent.response_type = XCB_CLIENT_MESSAGE;
+	wakeEvent.format        = 32;
+	wakeEvent.window        = resource->wakeWindow;
+	wakeEvent.type          = XCB_ATOM_NOTICE;
+	xcb_send_event(resource->connection                         ,
+	               0                                            ,
+	               resource->wakeWindow                         ,
+	               XCB_EVENT_MASK_NO_EVENT                      ,
+	               reinterpret_cast<const char*>(&wakeEvent)    );
+	xcb_flush(resource->connection);
+
+	InputHandle->thread.join();
+	delete InputHandle;
+	InputHandle = nullptr;
+}
+
+} // namespace Voxx::Lumos
@@ -0,0 +1,141 @@
+//==--- Lumos/tests/DamageRegionTests.cpp ------------------ -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  DamageRegionTests.cpp
+/// \brief This file tests the clipping and merging of rectangles which are
+///        added to a DamageRegion.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Test.hpp"
+#include <Lumos/Window/DamageRegion.hpp>
+
+using namespace Voxx::Lumos;
+
+namespace {
+
+/// Returns true if \p a and \p b are the same rectangle.
+bool sameRect(const Rect2d& a, const Rect2d& b) {
+	return a.x == b.x && a.y == b.y && a.extent.width  == b.extent.width
+	                                && a.extent.height == b.extent.height;
+}
+
+/// Returns true if \p inner is contained in \p outer.
+bool contains(const Rect2d& outer, const Rect2d& inner) {
+	return inner.x >= outer.x && inner.y >= outer.y &&
+	       inner.x + inner.extent.width  <= outer.x + outer.extent.width &&
+	       inner.y + inner.extent.height <= outer.y + outer.extent.height;
+}
+
+void testClipping() {
+	DamageRegion region(Extent2d{100, 50});
+	region.add(Rect2d{-10, -10, Extent2d{20, 20}});
+	LUMOS_CHECK(region.size() == 1);
+	LUMOS_CHECK(sameRect(region[0], Rect2d{0, 0, Extent2d{10, 10}}));
+
+	region.clear();
+	region.add(Rect2d{100, 0, Extent2d{10, 10}});
+	region.add(Rect2d{0, 0, Extent2d{0, 10}});
+	LUMOS_CHECK(region.empty());
+
+	region.addAll();
+	LUMOS_CHECK(region.size() == 1);
+	LUMOS_CHECK(sameRect(region[0], Rect2d{0, 0, Extent2d{100, 50}}));
+
+	region.setBounds(Extent2d{40, 20});
+	LUMOS_CHECK(sameRect(region[0], Rect2d{0, 0, Extent2d{40, 20}}));
+}
+
+void testMergeAdjacent() {
+	DamageRegion region(Extent2d{1000, 1000});
+	region.add(Rect2d{0 , 0, Extent2d{10, 10}});
+	region.add(Rect2d{10, 0, Extent2d{10, 10}});
+	LUMOS_CHECK(region.size() == 1);
+	LUMOS_CHECK(sameRect(region[0], Rect2d{0, 0, Extent2d{20, 10}}));
+	LUMOS_CHECK(region.area() == 200);
+
+	// A rectangle inside the region adds nothing.
+	region.add(Rect2d{5, 5, Extent2d{2, 2}});
+	LUMOS_CHECK(region.size() == 1);
+	LUMOS_CHECK(region.area() == 200);
+}
+
+void testMergeWithinSlack() {
+	// Merging these covers a 20 x 20 square, which wastes 200 pixels, so they
+	// are merged, while merging with the distant rectangle would waste more
+	// than the slack.
+	DamageRegion region(Extent2d{1000, 1000});
+	region.add(Rect2d{0  , 0  , Extent2d{10, 10}});
+	region.add(Rect2d{500, 500, Extent2d{10, 10}});
+	LUMOS_CHECK(region.size() == 2);
+	region.add(Rect2d{10, 10, Extent2d{10, 10}});
+	LUMOS_CHECK(region.size() == 2);
+	LUMOS_CHECK(region.area() == 400 + 100);
+	LUMOS_CHECK(sameRect(region.boundingRect(),
+	                     Rect2d{0, 0, Extent2d{510, 510}}));
+}
+
+void testChainedMerge() {
+	// A rectangle which bridges two separate rectangles merges with both.
+	DamageRegion region(Extent2d{1000, 1000});
+	region.add(Rect2d{0  , 0, Extent2d{100, 100}});
+	region.add(Rect2d{200, 0, Extent2d{100, 100}});
+	LUMOS_CHECK(region.size() == 2);
+	region.add(Rect2d{100, 0, Extent2d{100, 100}});
+	LUMOS_CHECK(region.size() == 1);
+	LUMOS_CHECK(sameRect(region[0], Rect2d{0, 0, Extent2d{300, 100}}));
+}
+
+void testFull() {
+	// Rectangles which are far apart are kept separate until the region is
+	// full, after which each new rectangle is merged with the cheapest one.
+	DamageRegion region(Extent2d{2000, 2000});
+	Rect2d       rects[DamageRegion::maxRects + 4];
+	for (int i = 0; i < int(DamageRegion::maxRects) + 4; ++i) {
+		rects[i] = Rect2d{static_cast<int16_t>(i * 150),
+		                  static_cast<int16_t>(i * 150), Extent2d{10, 10}};
+		region.add(rects[i]);
+		if (i < int(DamageRegion::maxRects)) {
+			LUMOS_CHECK(region.size() == std::size_t(i) + 1);
+		} else {
+			LUMOS_CHECK(region.size() == DamageRegion::maxRects);
+		}
+	}
+
+	// Every rectangle which was added is still covered.
+	for (const auto& rect : rects) {
+		bool covered = false;
+		for (std::size_t i = 0; i < region.size(); ++i) {
+			covered |= contains(region[i], rect);
+		}
+		LUMOS_CHECK(covered);
+	}
+}
+
+void testAddRegion() {
+	DamageRegion first(Extent2d{1000, 1000}), second(Extent2d{1000, 1000});
+	first.add(Rect2d{0, 0, Extent2d{10, 10}});
+	second.add(Rect2d{500, 500, Extent2d{10, 10}});
+	first.add(second);
+	LUMOS_CHECK(first.size() == 2);
+	LUMOS_CHECK(first.area() == 200);
+}
+
+} // namespace anonymous
+
+int main() {
+	Test::run("DamageRegion clipping"         , testClipping);
+	Test::run("DamageRegion merge adjacent"   , testMergeAdjacent);
+	Test::run("DamageRegion merge within slack", testMergeWithinSlack);
+	Test::run("DamageRegion chained merge"    , testChainedMerge);
+	Test::run("DamageRegion full"             , testFull);
+	Test::run("DamageRegion add region"       , testAddRegion);
+	return Test::result();
+}
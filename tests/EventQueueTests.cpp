@@ -0,0 +1,156 @@
+//==--- Lumos/tests/EventQueueTests.cpp -------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventQueueTests.cpp
+/// \brief This file tests the overflow policies of the EventQueue, batches
+///        which wrap around the end of its slots, and the recovery of event
+///        times in an EventBatch.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Test.hpp"
+#include <Lumos/Event/EventBatch.hpp>
+#include <Lumos/Event/EventQueue.hpp>
+#include <chrono>
+#include <thread>
+
+using namespace Voxx::Lumos;
+
+namespace {
+
+/// Defines the values which are pushed by the tests.
+constexpr int values[] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+void testCapacity() {
+	LUMOS_CHECK(EventQueue<int>(0).capacity() == 2);
+	LUMOS_CHECK(EventQueue<int>(3).capacity() == 4);
+	LUMOS_CHECK(EventQueue<int>(4).capacity() == 4);
+	LUMOS_CHECK(EventQueue<int>(5).capacity() == 8);
+}
+
+void testTryPushNeverDrops() {
+	EventQueue<int> queue(4, OverflowPolicy::DropOldest);
+	LUMOS_CHECK(queue.tryPushBatch(values, 6) == 4);
+	LUMOS_CHECK(!queue.tryPush(values[6]));
+	LUMOS_CHECK(queue.dropped() == 0);
+
+	int popped[8];
+	LUMOS_CHECK(queue.popBatch(popped, 8) == 4);
+	LUMOS_CHECK(popped[0] == 0 && popped[3] == 3);
+}
+
+void testCountAndDrop() {
+	EventQueue<int> queue(4, OverflowPolicy::CountAndDrop);
+	LUMOS_CHECK(queue.pushBatch(values, 6) == 4);
+	LUMOS_CHECK(!queue.push(values[6]));
+	LUMOS_CHECK(queue.dropped() == 3);
+	LUMOS_CHECK(queue.size() == 4);
+
+	// The new elements are dropped, so the oldest are kept.
+	int popped[8];
+	LUMOS_CHECK(queue.popBatch(popped, 8) == 4);
+	for (int i = 0; i < 4; ++i) {
+		LUMOS_CHECK(popped[i] == i);
+	}
+}
+
+void testDropOldest() {
+	EventQueue<int> queue(4, OverflowPolicy::DropOldest);
+	LUMOS_CHECK(queue.pushBatch(values, 6) == 6);
+	LUMOS_CHECK(queue.push(values[6]));
+	LUMOS_CHECK(queue.dropped() == 3);
+	LUMOS_CHECK(queue.size() == 4);
+
+	// The oldest elements are dropped, so the newest are kept.
+	int popped[8];
+	LUMOS_CHECK(queue.popBatch(popped, 8) == 4);
+	for (int i = 0; i < 4; ++i) {
+		LUMOS_CHECK(popped[i] == i + 3);
+	}
+}
+
+void testBlock() {
+	EventQueue<int> queue(4, OverflowPolicy::Block);
+	LUMOS_CHECK(queue.pushBatch(values, 4) == 4);
+
+	int  popped[8];
+	auto consumer = std::thread([&] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		LUMOS_CHECK(queue.popBatch(popped, 2) == 2);
+	});
+	LUMOS_CHECK(queue.pushBatch(values + 4, 2) == 2);
+	consumer.join();
+
+	LUMOS_CHECK(queue.dropped() == 0);
+	LUMOS_CHECK(queue.popBatch(popped + 2, 6) == 4);
+	for (int i = 0; i < 6; ++i) {
+		LUMOS_CHECK(popped[i] == i);
+	}
+}
+
+void testBatchWraparound() {
+	EventQueue<int> queue(4);
+	int popped[8];
+	for (int lap = 0; lap < 3; ++lap) {
+		// Offset the batches by three slots each lap, so that they start at
+		// every position and most of them wrap around the end of the slots.
+		LUMOS_CHECK(queue.pushBatch(values, 3) == 3);
+		LUMOS_CHECK(queue.popBatch(popped, 3) == 3);
+		LUMOS_CHECK(queue.pushBatch(values + 4, 4) == 4);
+		LUMOS_CHECK(queue.size() == 4);
+		LUMOS_CHECK(queue.popBatch(popped, 8) == 4);
+		for (int i = 0; i < 4; ++i) {
+			LUMOS_CHECK(popped[i] == i + 4);
+		}
+	}
+	LUMOS_CHECK(queue.dropped() == 0);
+}
+
+void testBatchTimes() {
+	EventBatch batch(4);
+	const uint64_t baseNs = 1'000'000'000;
+	batch.push(Event::close().stamped(baseNs - 5'000'000));
+	batch.push(Event::close().stamped(baseNs));
+	batch.setBaseTime(baseNs);
+	LUMOS_CHECK(batch.timeNs(0) == baseNs - 5'000'000);
+	LUMOS_CHECK(batch.timeNs(1) == baseNs);
+
+	// An event stamped just before the compact time wraps is recovered as
+	// older than a batch whose time is just after it.
+	const uint64_t wrapNs = uint64_t{0x10000} * 1000 * 20;
+	batch.clear();
+	batch.push(Event::close().stamped(wrapNs - 2000));
+	batch.setBaseTime(wrapNs + 1000);
+	LUMOS_CHECK(batch.timeNs(0) == wrapNs - 2000);
+}
+
+void testBatchFull() {
+	EventBatch  batch(2);
+	const Event events[] = {Event::close(), Event::focus(true),
+	                        Event::mouseMove(1, 2)};
+	LUMOS_CHECK(batch.push(events, 3) == 2);
+	LUMOS_CHECK(!batch.push(events[2]));
+	LUMOS_CHECK(batch.count(EventKind::Close) == 1);
+	LUMOS_CHECK(batch.count(EventKind::MouseMove) == 0);
+}
+
+} // namespace anonymous
+
+int main() {
+	Test::run("EventQueue capacity"         , testCapacity);
+	Test::run("EventQueue tryPush never drops", testTryPushNeverDrops);
+	Test::run("EventQueue CountAndDrop"      , testCountAndDrop);
+	Test::run("EventQueue DropOldest"        , testDropOldest);
+	Test::run("EventQueue Block"             , testBlock);
+	Test::run("EventQueue batch wraparound"  , testBatchWraparound);
+	Test::run("EventBatch times"             , testBatchTimes);
+	Test::run("EventBatch full"              , testBatchFull);
+	return Test::result();
+}
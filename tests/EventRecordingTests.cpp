@@ -0,0 +1,214 @@
+//==--- Lumos/tests/EventRecordingTests.cpp ---------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  EventRecordingTests.cpp
+/// \brief This file tests that events which are recorded are replayed in the
+///        same order and at the same offsets, including across gaps which are
+///        too long for the compact time of an event.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Test.hpp"
+#include <Lumos/Event/EventManager.hpp>
+#include <Lumos/Event/EventRecording.hpp>
+#include <string>
+#include <unistd.h>
+
+using namespace Voxx::Lumos;
+
+namespace {
+
+/// Defines the number of nanoseconds in a millisecond.
+constexpr uint64_t nsPerMs = 1'000'000;
+
+/// Returns the path of a temporary recording for the test named \p name.
+/// \param name The name of the test.
+std::string recordingPath(const char* name) {
+	return "/tmp/lumos_test_" + std::string(name) + "_" +
+	       std::to_string(getpid()) + ".rec";
+}
+
+/// Returns true if \p a and \p b are the same event, ignoring their times.
+bool sameEvent(const Event& a, const Event& b) {
+	return a.kind()   == b.kind()   && a.action()  == b.action() &&
+	       a.payload() == b.payload();
+}
+
+/// Defines the events which are recorded.
+const Event recorded[] = {
+	Event::key(EventActionKind::Press, KeyEventKind::A),
+	Event::mouseMove(3, -4),
+	Event::close(),
+	Event::focus(true)
+};
+
+/// Records the events with gaps of 1 ms, 200 ms, and 5000 s between them,
+/// where the last two are too long for an event record to hold and the last
+/// is too long for a single gap record, to a recording at \p path. Returns
+/// the time of the first event after the start of the recording.
+/// \param path The path of the recording.
+uint64_t writeRecording(const std::string& path) {
+	EventRecorder recorder;
+	LUMOS_CHECK(recorder.open(path.c_str()));
+	const auto startNs = monotonicTimeNs();
+	recorder.recordEvents(recorded + 0, 1, startNs);
+	recorder.recordEvents(recorded + 1, 1, startNs + nsPerMs);
+	recorder.recordEvents(recorded + 2, 1, startNs + 201 * nsPerMs);
+	recorder.recordEvents(recorded + 3, 1,
+	                      startNs + 201 * nsPerMs + 5'000'000 * nsPerMs);
+
+	// One gap record for the 200 ms gap, and two for the 5000 s gap.
+	LUMOS_CHECK(recorder.recordCount() == 4 + 1 + 2);
+	recorder.close();
+	LUMOS_CHECK(!recorder.isOpen());
+	return startNs;
+}
+
+/// Drains \p eventManager and checks that it received \p count events which
+/// match the recorded events starting at \p first.
+/// \param eventManager The manager to drain.
+/// \param first        The index of the first recorded event expected.
+/// \param count        The number of events expected.
+void checkReplayed(EventManager& eventManager, std::size_t first,
+                   std::size_t count) {
+	const auto& batch = eventManager.drainEvents();
+	LUMOS_CHECK(batch.size() == count);
+	for (std::size_t i = 0; i < batch.size() && i < count; ++i) {
+		LUMOS_CHECK(sameEvent(batch[i], recorded[first + i]));
+	}
+}
+
+void testRoundTrip() {
+	const auto path = recordingPath("round_trip");
+	writeRecording(path);
+
+	EventReplayer replayer;
+	LUMOS_CHECK(replayer.open(path.c_str()));
+	LUMOS_CHECK(replayer.recordCount() == 7);
+
+	EventManager eventManager;
+	LUMOS_CHECK(replayer.replay(eventManager, ReplayTiming::MaxSpeed) == 4);
+	LUMOS_CHECK(replayer.finished());
+	checkReplayed(eventManager, 0, 4);
+	unlink(path.c_str());
+}
+
+void testReplayUntil() {
+	// The gap records advance the time without posting events, so each event
+	// is posted once its recorded offset has elapsed. The first event is at a
+	// small offset, from the time the recording was opened.
+	const auto path = recordingPath("replay_until");
+	writeRecording(path);
+
+	EventReplayer replayer;
+	EventManager  eventManager;
+	LUMOS_CHECK(replayer.open(path.c_str()));
+	LUMOS_CHECK(replayer.replayUntil(eventManager, 100 * nsPerMs) == 2);
+	checkReplayed(eventManager, 0, 2);
+	LUMOS_CHECK(replayer.replayUntil(eventManager, 150 * nsPerMs) == 0);
+	LUMOS_CHECK(replayer.replayUntil(eventManager, 300 * nsPerMs) == 1);
+	checkReplayed(eventManager, 2, 1);
+	LUMOS_CHECK(!replayer.finished());
+	LUMOS_CHECK(replayer.replayUntil(eventManager,
+	                                 4'000'000 * nsPerMs) == 0);
+	LUMOS_CHECK(replayer.replayUntil(eventManager,
+	                                 6'000'000 * nsPerMs) == 1);
+	checkReplayed(eventManager, 3, 1);
+	LUMOS_CHECK(replayer.finished());
+
+	replayer.rewind();
+	LUMOS_CHECK(replayer.replay(eventManager, ReplayTiming::MaxSpeed) == 4);
+	checkReplayed(eventManager, 0, 4);
+	unlink(path.c_str());
+}
+
+void testManagerRecording() {
+	// Events posted to a manager which has a recorder are recorded as they are
+	// posted, whether or not they are drained.
+	const auto    path = recordingPath("manager");
+	EventRecorder recorder;
+	LUMOS_CHECK(recorder.open(path.c_str()));
+
+	EventManager eventManager;
+	eventManager.setRecorder(&recorder);
+	eventManager.postEvent(recorded[0]);
+	eventManager.postEvents(recorded + 1, 3);
+	eventManager.setRecorder(nullptr);
+	eventManager.postEvent(recorded[0]);
+	recorder.close();
+
+	EventReplayer replayer;
+	EventManager  replayed;
+	LUMOS_CHECK(replayer.open(path.c_str()));
+	LUMOS_CHECK(replayer.replay(replayed, ReplayTiming::MaxSpeed) == 4);
+	checkReplayed(replayed, 0, 4);
+	unlink(path.c_str());
+}
+
+void testReplayBeyondCapacity() {
+	// More events than the manager can hold are replayed in parts, each of
+	// which stops at the first event the manager rejects, so that once the
+	// manager is drained the replay resumes without skipping any. The events
+	// are spread over several replay batches, with a gap in the middle.
+	const auto    path = recordingPath("capacity");
+	EventRecorder recorder;
+	LUMOS_CHECK(recorder.open(path.c_str()));
+	constexpr std::size_t eventCount = 200;
+	const auto            startNs    = monotonicTimeNs();
+	for (std::size_t i = 0; i < eventCount; ++i) {
+		const auto event = Event::mouseMove(static_cast<int16_t>(i), 0);
+		const auto gapNs = i >= eventCount / 2 ? 100 * nsPerMs : 0;
+		recorder.recordEvents(&event, 1, startNs + i * 1000 + gapNs);
+	}
+	recorder.close();
+
+	EventReplayer replayer;
+	EventManager  eventManager(16);
+	LUMOS_CHECK(replayer.open(path.c_str()));
+	std::size_t replayed = 0;
+	for (int part = 0; part < 20 && !replayer.finished(); ++part) {
+		const auto posted = replayer.replay(eventManager, ReplayTiming::MaxSpeed);
+		LUMOS_CHECK(posted == eventManager.capacity() ||
+		            posted == eventCount - replayed);
+		const auto& batch = eventManager.drainEvents();
+		LUMOS_CHECK(batch.size() == posted);
+		for (std::size_t i = 0; i < batch.size(); ++i) {
+			LUMOS_CHECK(batch[i].x() == static_cast<int16_t>(replayed + i));
+		}
+		replayed += batch.size();
+	}
+	LUMOS_CHECK(replayer.finished());
+	LUMOS_CHECK(replayed == eventCount);
+	unlink(path.c_str());
+}
+
+void testInvalidRecording() {
+	const auto path = recordingPath("invalid");
+	EventReplayer replayer;
+	LUMOS_CHECK(!replayer.open(path.c_str()));
+
+	EventRecorder recorder;
+	LUMOS_CHECK(recorder.open(path.c_str()));
+	recorder.close();
+	LUMOS_CHECK(replayer.open(path.c_str()));
+	LUMOS_CHECK(replayer.recordCount() == 0 && replayer.finished());
+	unlink(path.c_str());
+}
+
+} // namespace anonymous
+
+int main() {
+	Test::run("EventRecording round trip"      , testRoundTrip);
+	Test::run("EventRecording replay until"    , testReplayUntil);
+	Test::run("EventRecording beyond capacity" , testReplayBeyondCapacity);
+	Test::run("EventRecording from manager"    , testManagerRecording);
+	Test::run("EventRecording empty or none"   , testInvalidRecording);
+	return Test::result();
+}
@@ -0,0 +1,128 @@
+//==--- Lumos/tests/FlatIdMapTests.cpp --------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  FlatIdMapTests.cpp
+/// \brief This file tests the FlatIdMap, and in particular that erasing keys
+///        which collide keeps the entries which probed past them reachable.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Test.hpp"
+#include <Lumos/Utility/FlatIdMap.hpp>
+#include <vector>
+
+using namespace Voxx::Lumos;
+
+namespace {
+
+/// Defines the number of slots in a map created with a capacity of four.
+constexpr std::size_t slotCount = 8;
+
+/// Returns the slot which \p key hashes to in a map of slotCount slots. This
+/// must match the hash of the FlatIdMap.
+/// \param key The key to find the slot for.
+std::size_t homeSlot(uint32_t key) {
+	return static_cast<std::size_t>((key * uint64_t{0x9E3779B97F4A7C15}) >> 32)
+	     & (slotCount - 1);
+}
+
+/// Returns the first \p count keys which hash to \p slot.
+/// \param slot  The slot which the keys hash to.
+/// \param count The number of keys to find.
+std::vector<uint32_t> keysFor(std::size_t slot, std::size_t count) {
+	std::vector<uint32_t> keys;
+	for (uint32_t key = 1; keys.size() < count; ++key) {
+		if (homeSlot(key) == slot) {
+			keys.push_back(key);
+		}
+	}
+	return keys;
+}
+
+void testInsertFind() {
+	FlatIdMap<int> map;
+	int            values[64];
+	for (uint32_t key = 1; key <= 64; ++key) {
+		map.insert(key, &values[key - 1]);
+	}
+	LUMOS_CHECK(map.size() == 64);
+	for (uint32_t key = 1; key <= 64; ++key) {
+		LUMOS_CHECK(map.find(key) == &values[key - 1]);
+	}
+	LUMOS_CHECK(map.find(65) == nullptr);
+
+	int replacement = 0;
+	map.insert(7, &replacement);
+	LUMOS_CHECK(map.size() == 64);
+	LUMOS_CHECK(map.find(7) == &replacement);
+}
+
+void testEraseColliding() {
+	// Three keys which share a home slot, followed by a key whose home is the
+	// next slot, which is displaced past them. Erasing each of the colliding
+	// keys must shift the later entries back so that they are still found.
+	for (std::size_t erased = 0; erased < 3; ++erased) {
+		FlatIdMap<int> map(4);
+		const auto     keys = keysFor(3, 3);
+		const auto     next = keysFor(4, 1)[0];
+		int            values[4];
+		for (std::size_t i = 0; i < 3; ++i) {
+			map.insert(keys[i], &values[i]);
+		}
+		map.insert(next, &values[3]);
+
+		LUMOS_CHECK(map.erase(keys[erased]));
+		LUMOS_CHECK(!map.erase(keys[erased]));
+		LUMOS_CHECK(map.size() == 3);
+		LUMOS_CHECK(map.find(keys[erased]) == nullptr);
+		for (std::size_t i = 0; i < 3; ++i) {
+			if (i != erased) {
+				LUMOS_CHECK(map.find(keys[i]) == &values[i]);
+			}
+		}
+		LUMOS_CHECK(map.find(next) == &values[3]);
+	}
+}
+
+void testEraseWrapsAround() {
+	// Keys which collide in the last slot are displaced to the start of the
+	// slots, and must be shifted back across the end when one is erased.
+	FlatIdMap<int> map(4);
+	const auto     keys = keysFor(slotCount - 1, 3);
+	int            values[3];
+	for (std::size_t i = 0; i < 3; ++i) {
+		map.insert(keys[i], &values[i]);
+	}
+	LUMOS_CHECK(map.erase(keys[0]));
+	LUMOS_CHECK(map.find(keys[1]) == &values[1]);
+	LUMOS_CHECK(map.find(keys[2]) == &values[2]);
+	LUMOS_CHECK(map.erase(keys[1]));
+	LUMOS_CHECK(map.find(keys[2]) == &values[2]);
+	LUMOS_CHECK(map.size() == 1);
+}
+
+void testEraseMissing() {
+	FlatIdMap<int> map;
+	int            value = 0;
+	LUMOS_CHECK(!map.erase(1));
+	map.insert(1, &value);
+	LUMOS_CHECK(!map.erase(2));
+	LUMOS_CHECK(map.size() == 1);
+}
+
+} // namespace anonymous
+
+int main() {
+	Test::run("FlatIdMap insert and find"     , testInsertFind);
+	Test::run("FlatIdMap erase colliding keys", testEraseColliding);
+	Test::run("FlatIdMap erase wraps around"  , testEraseWrapsAround);
+	Test::run("FlatIdMap erase missing keys"  , testEraseMissing);
+	return Test::result();
+}
@@ -0,0 +1,110 @@
+//==--- Lumos/tests/InstrumentationTests.cpp --------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  InstrumentationTests.cpp
+/// \brief This file tests that the records of threads which have exited are
+///        kept when their buffers are reused, and that trace events are only
+///        buffered while tracing is enabled.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Test.hpp"
+#include <Lumos/Utility/Instrumentation.hpp>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace Voxx::Lumos;
+
+namespace {
+
+/// Records \p count increments of \p site on a new thread, and waits for the
+/// thread to exit.
+/// \param site  The identifier of the site.
+/// \param count The number of increments.
+void recordOnThread(uint32_t site, int count) {
+	std::thread thread([site, count] {
+		for (int i = 0; i < count; ++i) {
+			Instrumentation::record(site, 1);
+		}
+	});
+	thread.join();
+}
+
+void testExitedThreadsAreKept() {
+	const auto site =
+		Instrumentation::registerSite("test.exited", InstrumentKind::Counter);
+	const auto before = Instrumentation::snapshot();
+
+	Instrumentation::enable();
+	for (int i = 0; i < 8; ++i) {
+		recordOnThread(site, i + 1);
+	}
+	Instrumentation::disable();
+
+	const auto  delta = Instrumentation::snapshot().since(before);
+	const auto* stats = delta.find("test.exited");
+	LUMOS_CHECK(stats != nullptr);
+	LUMOS_CHECK(stats && stats->count == 36);
+	LUMOS_CHECK(stats && stats->total == 36);
+	LUMOS_CHECK(delta.droppedTraceEvents == 0);
+}
+
+/// Writes the Chrome trace to a temporary file and returns the number of
+/// events in it for the site called \p name, or -1 if it could not be written.
+/// \param name The name of the site.
+int tracedEvents(const char* name) {
+	char path[] = "/tmp/lumos-trace-XXXXXX";
+	const int fd = mkstemp(path);
+	if (fd < 0) {
+		return -1;
+	}
+	close(fd);
+
+	char contents[4096] = {};
+	bool written        = Instrumentation::writeChromeTrace(path);
+	if (FILE* file = fopen(path, "r")) {
+		written = written && fread(contents, 1, sizeof(contents) - 1, file) > 0;
+		fclose(file);
+	}
+	remove(path);
+
+	int events = 0;
+	for (const char* at = contents; (at = strstr(at, name)); ++at) {
+		++events;
+	}
+	return written ? events : -1;
+}
+
+void testTraceOfExitedThread() {
+	const auto site =
+		Instrumentation::registerSite("test.traced", InstrumentKind::Counter);
+	recordOnThread(site, 2);
+	Instrumentation::enable();
+	recordOnThread(site, 3);
+	Instrumentation::enable(true);
+	recordOnThread(site, 4);
+	Instrumentation::disable();
+
+	// Only the records made while tracing are trace events, and writing the
+	// trace removes them.
+	LUMOS_CHECK(tracedEvents("test.traced") == 4);
+	LUMOS_CHECK(tracedEvents("test.traced") == 0);
+}
+
+} // namespace anonymous
+
+int main() {
+	Test::run("ExitedThreadsAreKept", testExitedThreadsAreKept);
+	Test::run("TraceOfExitedThread", testTraceOfExitedThread);
+	return Test::result();
+}
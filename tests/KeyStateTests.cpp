@@ -0,0 +1,164 @@
+//==--- Lumos/tests/KeyStateTests.cpp ---------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  KeyStateTests.cpp
+/// \brief This file tests the computation of the keys which changed state
+///        between frames, and the key state which the EventManager publishes.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Test.hpp"
+#include <Lumos/Event/EventManager.hpp>
+#include <Lumos/Event/KeyState.hpp>
+
+using namespace Voxx::Lumos;
+
+namespace {
+
+/// Returns the key with the code \p code.
+/// \param code The code of the key.
+constexpr KeyEventKind keyWithCode(unsigned code) {
+	return static_cast<KeyEventKind>(code);
+}
+
+/// Returns the number of set bits in \p bits.
+/// \param bits The bits to count.
+std::size_t countBits(const KeyBits& bits) {
+	std::size_t count = 0;
+	for (unsigned code = 0; code < 256; ++code) {
+		count += bits.test(keyWithCode(code)) ? 1 : 0;
+	}
+	return count;
+}
+
+/// Posts a key event for \p key with \p action to \p eventManager.
+/// \param eventManager The manager to post the event to.
+/// \param action       The action of the key.
+/// \param key          The key which changed.
+void postKey(EventManager& eventManager, EventActionKind action,
+             KeyEventKind  key) {
+	eventManager.postEvent(Event::key(action, key));
+}
+
+void testKeyBits() {
+	KeyBits bits;
+	LUMOS_CHECK(!bits.any());
+	bits.set(keyWithCode(0));
+	bits.set(keyWithCode(63));
+	bits.set(keyWithCode(64));
+	bits.set(keyWithCode(255));
+	LUMOS_CHECK(bits.any() && countBits(bits) == 4);
+	bits.clear(keyWithCode(63));
+	LUMOS_CHECK(!bits.test(keyWithCode(63)) && bits.test(keyWithCode(64)));
+
+	KeyBits other;
+	other.set(keyWithCode(128));
+	bits.merge(other);
+	LUMOS_CHECK(countBits(bits) == 4 && bits.test(keyWithCode(128)));
+}
+
+void testKeyEdges() {
+	// Use keys in every word so that each lane of the vector paths is used.
+	KeyBits previous, current, pressed, released;
+	for (unsigned code = 0; code < 256; code += 3) {
+		previous.set(keyWithCode(code));
+	}
+	for (unsigned code = 0; code < 256; code += 5) {
+		current.set(keyWithCode(code));
+	}
+	computeKeyEdges(previous, current, pressed, released);
+	for (unsigned code = 0; code < 256; ++code) {
+		const auto key  = keyWithCode(code);
+		const bool was  = code % 3 == 0, is = code % 5 == 0;
+		LUMOS_CHECK(pressed.test(key)  == (is && !was));
+		LUMOS_CHECK(released.test(key) == (was && !is));
+	}
+
+	computeKeyEdges(current, current, pressed, released);
+	LUMOS_CHECK(!pressed.any() && !released.any());
+}
+
+void testPublishedEdges() {
+	EventManager eventManager;
+	postKey(eventManager, EventActionKind::Press, KeyEventKind::A);
+	eventManager.drainEvents();
+	auto keyState = eventManager.publishKeyState();
+	LUMOS_CHECK(keyState.isHeld(KeyEventKind::A));
+	LUMOS_CHECK(keyState.wasPressed(KeyEventKind::A));
+	LUMOS_CHECK(!keyState.wasReleased(KeyEventKind::A));
+
+	// A held key is not pressed again in the next frame.
+	eventManager.drainEvents();
+	keyState = eventManager.publishKeyState();
+	LUMOS_CHECK(keyState.isHeld(KeyEventKind::A));
+	LUMOS_CHECK(!keyState.wasPressed(KeyEventKind::A));
+
+	postKey(eventManager, EventActionKind::Release, KeyEventKind::A);
+	eventManager.drainEvents();
+	keyState = eventManager.publishKeyState();
+	LUMOS_CHECK(!keyState.isHeld(KeyEventKind::A));
+	LUMOS_CHECK(keyState.wasReleased(KeyEventKind::A));
+	LUMOS_CHECK(keyState.frame == 3);
+	LUMOS_CHECK(eventManager.keyState().frame == 3);
+}
+
+void testPublishedTaps() {
+	// A key which is pressed and released within a frame is reported as both
+	// pressed and released, but only for that frame.
+	EventManager eventManager;
+	postKey(eventManager, EventActionKind::Press  , KeyEventKind::A);
+	postKey(eventManager, EventActionKind::Release, KeyEventKind::A);
+	eventManager.drainEvents();
+	auto keyState = eventManager.publishKeyState();
+	LUMOS_CHECK(!keyState.isHeld(KeyEventKind::A));
+	LUMOS_CHECK(keyState.wasPressed(KeyEventKind::A));
+	LUMOS_CHECK(keyState.wasReleased(KeyEventKind::A));
+
+	eventManager.drainEvents();
+	keyState = eventManager.publishKeyState();
+	LUMOS_CHECK(!keyState.pressed.any() && !keyState.released.any());
+}
+
+void testPublishedAutorepeat() {
+	// Autorepeat sends repeated presses of a key which is held, which are not
+	// presses again, and a release of a key which is up is not a release.
+	EventManager eventManager;
+	postKey(eventManager, EventActionKind::Press, KeyEventKind::Space);
+	eventManager.drainEvents();
+	LUMOS_CHECK(eventManager.publishKeyState().wasPressed(KeyEventKind::Space));
+
+	for (int frame = 0; frame < 3; ++frame) {
+		postKey(eventManager, EventActionKind::Press, KeyEventKind::Space);
+		postKey(eventManager, EventActionKind::Press, KeyEventKind::Space);
+		postKey(eventManager, EventActionKind::Release, KeyEventKind::B);
+		eventManager.drainEvents();
+		const auto keyState = eventManager.publishKeyState();
+		LUMOS_CHECK(keyState.isHeld(KeyEventKind::Space));
+		LUMOS_CHECK(!keyState.pressed.any() && !keyState.released.any());
+	}
+
+	postKey(eventManager, EventActionKind::Release, KeyEventKind::Space);
+	eventManager.drainEvents();
+	const auto keyState = eventManager.publishKeyState();
+	LUMOS_CHECK(!keyState.isHeld(KeyEventKind::Space));
+	LUMOS_CHECK(!keyState.wasPressed(KeyEventKind::Space));
+	LUMOS_CHECK(keyState.wasReleased(KeyEventKind::Space));
+}
+
+} // namespace anonymous
+
+int main() {
+	Test::run("KeyBits"                    , testKeyBits);
+	Test::run("computeKeyEdges"            , testKeyEdges);
+	Test::run("EventManager key edges"     , testPublishedEdges);
+	Test::run("EventManager key taps"      , testPublishedTaps);
+	Test::run("EventManager key autorepeat", testPublishedAutorepeat);
+	return Test::result();
+}
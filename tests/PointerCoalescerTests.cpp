@@ -0,0 +1,149 @@
+//==--- Lumos/tests/PointerCoalescerTests.cpp -------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  PointerCoalescerTests.cpp
+/// \brief This file tests that the PointerCoalescer carries the motion which
+///        it cannot emit into later drains, so that none of it is lost.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Test.hpp"
+#include <Lumos/Event/PointerCoalescer.hpp>
+
+using namespace Voxx::Lumos;
+
+namespace {
+
+/// Defines the fixed point value of half a pixel.
+constexpr auto half = PointerCoalescer::fixedOne / 2;
+
+/// Drains \p coalescer and returns the total motion of the MouseDelta events.
+/// \param coalescer The coalescer to drain.
+/// \param dx        The total horizontal motion.
+/// \param dy        The total vertical motion.
+std::size_t drainDelta(PointerCoalescer& coalescer, int& dx, int& dy) {
+	Event      events[16];
+	const auto count = coalescer.drain(events, 16);
+	dx = dy = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		if (events[i].kind() == EventKind::MouseDelta) {
+			dx += events[i].x();
+			dy += events[i].y();
+		}
+	}
+	return count;
+}
+
+void testFractionCarry() {
+	PointerCoalescer coalescer;
+	int              dx = 0, dy = 0;
+	coalescer.addDelta(half, -half, 1000);
+	LUMOS_CHECK(drainDelta(coalescer, dx, dy) == 0);
+
+	coalescer.addDelta(half, -half, 2000);
+	LUMOS_CHECK(drainDelta(coalescer, dx, dy) == 1);
+	LUMOS_CHECK(dx == 1 && dy == -1);
+
+	// Three quarters of a pixel each time adds up to three pixels over four
+	// drains, whatever the order in which the whole pixels are emitted.
+	int totalX = 0;
+	for (int i = 0; i < 4; ++i) {
+		coalescer.addDelta(3 * PointerCoalescer::fixedOne / 4, 0, 3000 + i);
+		drainDelta(coalescer, dx, dy);
+		totalX += dx;
+	}
+	LUMOS_CHECK(totalX == 3);
+	LUMOS_CHECK(drainDelta(coalescer, dx, dy) == 0);
+	LUMOS_CHECK(coalescer.samples() == 6);
+}
+
+void testComponentOverflowCarry() {
+	// Motion which does not fit in an event component is carried.
+	PointerCoalescer coalescer;
+	int              dx = 0, dy = 0;
+	coalescer.addDelta(PointerCoalescer::toFixed(40000),
+	                   PointerCoalescer::toFixed(-40000), 1000);
+	LUMOS_CHECK(drainDelta(coalescer, dx, dy) == 1);
+	LUMOS_CHECK(dx == INT16_MAX && dy == INT16_MIN);
+	LUMOS_CHECK(drainDelta(coalescer, dx, dy) == 1);
+	LUMOS_CHECK(dx == 40000 - INT16_MAX && dy == -40000 - INT16_MIN);
+}
+
+void testAccumulate() {
+	PointerCoalescer coalescer;
+	for (int i = 0; i < 100; ++i) {
+		coalescer.addDelta(PointerCoalescer::toFixed(1),
+		                   PointerCoalescer::toFixed(2), i);
+		coalescer.addPosition(static_cast<int16_t>(i), 7, i);
+	}
+	Event      events[16];
+	const auto count = coalescer.drain(events, 16);
+	LUMOS_CHECK(count == 2);
+	LUMOS_CHECK(events[0].kind() == EventKind::MouseMove);
+	LUMOS_CHECK(events[0].x() == 99 && events[0].y() == 7);
+	LUMOS_CHECK(events[1].kind() == EventKind::MouseDelta);
+	LUMOS_CHECK(events[1].x() == 100 && events[1].y() == 200);
+}
+
+void testDiscreteEventOrder() {
+	// Motion before a button press is flushed ahead of it.
+	PointerCoalescer coalescer;
+	coalescer.addDelta(PointerCoalescer::toFixed(2), 0, 1000);
+	LUMOS_CHECK(coalescer.addEvent(
+		Event::mouseButton(EventActionKind::Press, 1).stamped(2000)));
+	Event      events[16];
+	const auto count = coalescer.drain(events, 16);
+	LUMOS_CHECK(count == 2);
+	LUMOS_CHECK(events[0].kind() == EventKind::MouseDelta);
+	LUMOS_CHECK(events[1].kind() == EventKind::MouseButton);
+}
+
+void testLosslessOverflow() {
+	// Once the queue is full, further samples are accumulated rather than
+	// dropped, and are emitted by the next drain after the queued samples.
+	PointerCoalescer coalescer(2, MotionCoalescing::Lossless);
+	for (int i = 0; i < 5; ++i) {
+		coalescer.addDelta(PointerCoalescer::toFixed(1),
+		                   PointerCoalescer::toFixed(-1), i);
+	}
+	Event      events[16];
+	const auto count = coalescer.drain(events, 16);
+	LUMOS_CHECK(count == 3);
+	LUMOS_CHECK(events[0].x() == 1 && events[0].y() == -1);
+	LUMOS_CHECK(events[1].x() == 1 && events[1].y() == -1);
+	LUMOS_CHECK(events[2].x() == 3 && events[2].y() == -3);
+	LUMOS_CHECK(coalescer.dropped() == 0);
+	LUMOS_CHECK(coalescer.drain(events, 16) == 0);
+}
+
+void testLosslessPositions() {
+	// Positions which do not fit in the queue keep only the latest.
+	PointerCoalescer coalescer(2, MotionCoalescing::Lossless);
+	for (int16_t x = 0; x < 5; ++x) {
+		coalescer.addPosition(x, 0, x);
+	}
+	Event      events[16];
+	const auto count = coalescer.drain(events, 16);
+	LUMOS_CHECK(count == 3);
+	LUMOS_CHECK(events[0].x() == 0 && events[1].x() == 1);
+	LUMOS_CHECK(events[2].x() == 4);
+}
+
+} // namespace anonymous
+
+int main() {
+	Test::run("PointerCoalescer fraction carry"   , testFractionCarry);
+	Test::run("PointerCoalescer component carry"  , testComponentOverflowCarry);
+	Test::run("PointerCoalescer accumulate"       , testAccumulate);
+	Test::run("PointerCoalescer discrete order"   , testDiscreteEventOrder);
+	Test::run("PointerCoalescer lossless overflow", testLosslessOverflow);
+	Test::run("PointerCoalescer lossless position", testLosslessPositions);
+	return Test::result();
+}
@@ -0,0 +1,68 @@
+//==--- Lumos/tests/Test.hpp ------------------------------- -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  Test.hpp
+/// \brief This file defines the checks which the tests are written with. Each
+///        test file is an executable which runs its tests and returns non-zero
+///        if any check failed, so that ctest reports it.
+//
+//==------------------------------------------------------------------------==//
+
+#ifndef VOXEL_LUMOS_TESTS_TEST_HPP
+#define VOXEL_LUMOS_TESTS_TEST_HPP
+
+#include <cstdio>
+
+namespace Voxx::Lumos::Test {
+
+/// Returns the number of checks which have failed.
+inline int& failureCount() {
+	static int count = 0;
+	return count;
+}
+
+/// Records the result of a check, printing \p expression if it failed.
+/// \param passed     If the check passed.
+/// \param expression The text of the expression which was checked.
+/// \param file       The file which the check is in.
+/// \param line       The line which the check is on.
+inline void check(bool passed, const char* expression, const char* file,
+                  int line) {
+	if (!passed) {
+		fprintf(stderr, "%s:%d: Check failed: %s\n", file, line, expression);
+		++failureCount();
+	}
+}
+
+/// Runs the test \p test, which is named \p name.
+/// \param  name The name of the test.
+/// \param  test The test to run.
+/// \tparam TestType The type of the test.
+template <typename TestType>
+void run(const char* name, TestType&& test) {
+	const auto failuresBefore = failureCount();
+	test();
+	printf("%-48s %s\n", name, failureCount() == failuresBefore ? "ok"
+	                                                           : "FAILED");
+}
+
+/// Returns the exit code of the test executable.
+inline int result() {
+	return failureCount() == 0 ? 0 : 1;
+}
+
+} // namespace Voxx::Lumos::Test
+
+/// Checks that \p expression is true, recording a failure if it is not.
+#define LUMOS_CHECK(expression)                                                \
+	::Voxx::Lumos::Test::check(static_cast<bool>(expression), #expression,     \
+	                           __FILE__, __LINE__)
+
+#endif // VOXEL_LUMOS_TESTS_TEST_HPP
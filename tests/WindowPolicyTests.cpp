@@ -0,0 +1,151 @@
+//==--- Lumos/tests/WindowPolicyTests.cpp ------------------ -*- C++ -*- ---==//
+//
+//                                Voxel : Lumos
+//
+//                        Copyright (c) 2018 Rob Clucas
+//
+//  This file is distributed under the MIT License. See LICENSE for details.
+//
+//==------------------------------------------------------------------------==//
+//
+/// \file  WindowPolicyTests.cpp
+/// \brief This file tests the policies which the windows use to choose the
+///        capacity of their buffers when they are resized, and to choose a
+///        framebuffer configuration.
+//
+//==------------------------------------------------------------------------==//
+
+#include "Test.hpp"
+#include <Lumos/Window/FramebufferConfig.hpp>
+#include <Lumos/Window/ResizePolicy.hpp>
+
+using namespace Voxx::Lumos;
+
+namespace {
+
+/// Returns true if \p a and \p b are the same extent.
+bool sameExtent(Extent2d a, Extent2d b) {
+	return a.width == b.width && a.height == b.height;
+}
+
+/// Returns the attributes of a framebuffer which exactly matches the default
+/// request.
+FramebufferAttributes exactAttributes() {
+	FramebufferAttributes attributes;
+	attributes.red          = 8;
+	attributes.green        = 8;
+	attributes.blue         = 8;
+	attributes.depth        = 24;
+	attributes.stencil      = 8;
+	attributes.doubleBuffer = true;
+	attributes.renderable   = true;
+	return attributes;
+}
+
+void testResizeReuse() {
+	const ResizePolicy policy;
+	const Extent2d     capacity{100, 100};
+	LUMOS_CHECK(sameExtent(resizedCapacity(policy, capacity, {100, 100}),
+	                       capacity));
+	LUMOS_CHECK(sameExtent(resizedCapacity(policy, capacity, {80, 90}),
+	                       capacity));
+	LUMOS_CHECK(sameExtent(resizedCapacity(policy, capacity, {50, 50}),
+	                       capacity));
+}
+
+void testResizeShrink() {
+	// Shrinking below the fraction keeps headroom in both dimensions.
+	const ResizePolicy policy;
+	LUMOS_CHECK(sameExtent(resizedCapacity(policy, {100, 100}, {40, 40}),
+	                       Extent2d{50, 50}));
+	LUMOS_CHECK(sameExtent(resizedCapacity(policy, {100, 100}, {100, 20}),
+	                       Extent2d{125, 25}));
+}
+
+void testResizeGrow() {
+	// Growing only adds headroom to the dimensions which grew.
+	const ResizePolicy policy;
+	LUMOS_CHECK(sameExtent(resizedCapacity(policy, {100, 100}, {120, 90}),
+	                       Extent2d{150, 100}));
+	LUMOS_CHECK(sameExtent(resizedCapacity(policy, {100, 100}, {120, 130}),
+	                       Extent2d{150, 162}));
+	LUMOS_CHECK(sameExtent(resizedCapacity(policy, {100, 100}, {30000, 10}),
+	                       Extent2d{INT16_MAX, 100}));
+
+	ResizePolicy exact;
+	exact.growHeadroom   = 0.0f;
+	exact.shrinkFraction = 1.0f;
+	LUMOS_CHECK(sameExtent(resizedCapacity(exact, {100, 100}, {120, 90}),
+	                       Extent2d{120, 100}));
+	LUMOS_CHECK(sameExtent(resizedCapacity(exact, {100, 100}, {99, 100}),
+	                       Extent2d{99, 100}));
+}
+
+void testFramebufferRejected() {
+	const FramebufferRequest request;
+	LUMOS_CHECK(framebufferPenalty(request, exactAttributes()) == 0);
+
+	auto attributes = exactAttributes();
+	attributes.renderable = false;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == -1);
+
+	attributes = exactAttributes();
+	attributes.doubleBuffer = false;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == -1);
+
+	attributes = exactAttributes();
+	attributes.green = 6;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == -1);
+
+	attributes = exactAttributes();
+	attributes.depth = 16;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == -1);
+
+	attributes = exactAttributes();
+	attributes.slow = true;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == -1);
+
+	attributes = exactAttributes();
+	attributes.samples = 4;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == -1);
+
+	auto multisampled    = request;
+	multisampled.samples = 4;
+	LUMOS_CHECK(framebufferPenalty(multisampled, exactAttributes()) == -1);
+	LUMOS_CHECK(framebufferPenalty(multisampled, attributes) == 0);
+}
+
+void testFramebufferPenalty() {
+	const FramebufferRequest request;
+	auto attributes  = exactAttributes();
+	attributes.alpha = 8;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == 64);
+
+	attributes       = exactAttributes();
+	attributes.red   = attributes.green = attributes.blue = 10;
+	attributes.depth = 32;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == 6 * 4 + 8 * 2);
+
+	attributes               = exactAttributes();
+	attributes.nonConformant = true;
+	LUMOS_CHECK(framebufferPenalty(request, attributes) == 256);
+
+	// Without avoiding costly configurations they are penalised instead.
+	auto costly        = request;
+	costly.avoidCostly = false;
+	attributes         = exactAttributes();
+	attributes.slow    = true;
+	attributes.samples = 2;
+	LUMOS_CHECK(framebufferPenalty(costly, attributes) == 1024 + 2 * 64);
+}
+
+} // namespace anonymous
+
+int main() {
+	Test::run("resizedCapacity reuse"      , testResizeReuse);
+	Test::run("resizedCapacity shrink"     , testResizeShrink);
+	Test::run("resizedCapacity grow"       , testResizeGrow);
+	Test::run("framebufferPenalty rejected", testFramebufferRejected);
+	Test::run("framebufferPenalty penalty" , testFramebufferPenalty);
+	return Test::result();
+}